@@ -37,6 +37,16 @@ inline std::string EscapeJsString(const std::string& input) {
     return result;
 }
 
+inline bool IsV8Number(const CefRefPtr<CefV8Value>& value) {
+    return value->IsInt() || value->IsUInt() || value->IsDouble();
+}
+
+// State versions are sent to JavaScript as numbers, so they stay exact up to 2^53.
+inline uint64_t V8ValueToStateVersion(const CefRefPtr<CefV8Value>& value) {
+    double version = value->GetDoubleValue();
+    return version > 0 ? static_cast<uint64_t>(version) : 0;
+}
+
 class JavascriptStateUpdateSubscription
 {
 public:
@@ -79,22 +89,39 @@ public:
 
                 m_ApplicationStateManager->setState(namespaceName, key, value);
 
-                auto cefState = ApplicationStateManagerHelper::jsonToCefValue(value);
+                SendStateUpdateToBrowser(namespaceName, key, value);
+                PushToJavascript(namespaceName, key, true);
+                return true;
+            } else {
+                exception = "Invalid arguments for setState";
+                return false;
+            }
+        } else if (name == "setStates") {
+            if (arguments.size() == 2 && arguments[0]->IsString() && arguments[1]->IsObject() && !arguments[1]->IsArray()) {
+                std::string namespaceName = arguments[0]->GetStringValue().ToString();
+                nlohmann::json values = ApplicationStateManagerHelper::cefV8ValueToJson(arguments[1]);
+                if (!values.is_object() || values.empty()) {
+                    return true;
+                }
+
+                nlohmann::json updates = nlohmann::json::object();
+                updates[namespaceName] = std::move(values);
+                m_ApplicationStateManager->applyBatch(updates);
+
+                // One message for the whole batch, the browser side fans it out to the Python handlers
                 CefRefPtr<CefProcessMessage> messageReturn =
-                        CefProcessMessage::Create("push-app-state-update");
+                        CefProcessMessage::Create("push-app-state-batch-update");
 
                 CefRefPtr<CefListValue> message_args_return =
                         messageReturn->GetArgumentList();
 
-                message_args_return->SetSize(3);
-                message_args_return->SetString(0, namespaceName);
-                message_args_return->SetString(1, key);
-                message_args_return->SetValue(2, cefState);
+                message_args_return->SetSize(1);
+                message_args_return->SetValue(0, ApplicationStateManagerHelper::jsonToCefValue(updates));
                 m_Browser->GetMainFrame()->SendProcessMessage(PID_BROWSER, messageReturn);
-                PushToJavascript(namespaceName, key, true);
+                PushBatchToJavascript(updates, nlohmann::json::object(), true);
                 return true;
             } else {
-                exception = "Invalid arguments for setState";
+                exception = "Invalid arguments for setStates";
                 return false;
             }
         } else if (name == "getState") {
@@ -109,12 +136,75 @@ public:
                 exception = "Invalid arguments for getState";
                 return false;
             }
+        } else if (name == "compareAndSetState") {
+            if (arguments.size() == 4 && arguments[0]->IsString() && arguments[1]->IsString() && IsV8Number(arguments[2])) {
+                std::string namespaceName = arguments[0]->GetStringValue().ToString();
+                std::string key = arguments[1]->GetStringValue().ToString();
+                uint64_t expectedVersion = V8ValueToStateVersion(arguments[2]);
+                nlohmann::json value = ApplicationStateManagerHelper::cefV8ValueToJson(arguments[3]);
+
+                uint64_t version = m_ApplicationStateManager->compareAndSetState(namespaceName, key, expectedVersion, value);
+                if (version == 0) {
+                    retval = CefV8Value::CreateBool(false);
+                    return true;
+                }
+
+                SendStateUpdateToBrowser(namespaceName, key, value);
+                PushToJavascript(namespaceName, key, true);
+                retval = CefV8Value::CreateBool(true);
+                return true;
+            } else {
+                exception = "Invalid arguments for compareAndSetState";
+                return false;
+            }
+        } else if (name == "getVersion") {
+            if (arguments.size() == 1 && arguments[0]->IsString()) {
+                std::string namespaceName = arguments[0]->GetStringValue().ToString();
+                retval = CefV8Value::CreateDouble(static_cast<double>(m_ApplicationStateManager->getVersion(namespaceName)));
+                return true;
+            } else {
+                exception = "Invalid arguments for getVersion";
+                return false;
+            }
+        } else if (name == "getStateVersion") {
+            if (arguments.size() == 2 && arguments[0]->IsString() && arguments[1]->IsString()) {
+                std::string namespaceName = arguments[0]->GetStringValue().ToString();
+                std::string key = arguments[1]->GetStringValue().ToString();
+                retval = CefV8Value::CreateDouble(static_cast<double>(m_ApplicationStateManager->getStateVersion(namespaceName, key)));
+                return true;
+            } else {
+                exception = "Invalid arguments for getStateVersion";
+                return false;
+            }
+        } else if (name == "getChangesSince") {
+            if (arguments.size() == 2 && arguments[0]->IsString() && IsV8Number(arguments[1])) {
+                std::string namespaceName = arguments[0]->GetStringValue().ToString();
+                uint64_t sinceVersion = V8ValueToStateVersion(arguments[1]);
+                retval = ApplicationStateManagerHelper::jsonToCefV8Value(
+                        m_ApplicationStateManager->getChangesSince(namespaceName, sinceVersion));
+                return true;
+            } else {
+                exception = "Invalid arguments for getChangesSince";
+                return false;
+            }
         } else if (name == "removeState") {
             if (arguments.size() == 2 && arguments[0]->IsString() && arguments[1]->IsString()) {
                 std::string namespaceName = arguments[0]->GetStringValue().ToString();
                 std::string key = arguments[1]->GetStringValue().ToString();
 
                 m_ApplicationStateManager->removeState(namespaceName, key);
+
+                // Let the browser drop its cached copy
+                CefRefPtr<CefProcessMessage> messageReturn =
+                        CefProcessMessage::Create("push-app-state-remove");
+
+                CefRefPtr<CefListValue> message_args_return =
+                        messageReturn->GetArgumentList();
+
+                message_args_return->SetSize(2);
+                message_args_return->SetString(0, namespaceName);
+                message_args_return->SetString(1, key);
+                m_Browser->GetMainFrame()->SendProcessMessage(PID_BROWSER, messageReturn);
                 return true;
             } else {
                 exception = "Invalid arguments for removeState";
@@ -154,6 +244,22 @@ public:
         return false;
     }
 
+    void SendStateUpdateToBrowser(const std::string& namespaceName, const std::string& key, const nlohmann::json& value)
+    {
+        auto cefState = ApplicationStateManagerHelper::jsonToCefValue(value);
+        CefRefPtr<CefProcessMessage> messageReturn =
+                CefProcessMessage::Create("push-app-state-update");
+
+        CefRefPtr<CefListValue> message_args_return =
+                messageReturn->GetArgumentList();
+
+        message_args_return->SetSize(3);
+        message_args_return->SetString(0, namespaceName);
+        message_args_return->SetString(1, key);
+        message_args_return->SetValue(2, cefState);
+        m_Browser->GetMainFrame()->SendProcessMessage(PID_BROWSER, messageReturn);
+    }
+
     void RegisterJavascriptForStateUpdateEvent()
     {
         std::string jsCode = jsTriggerCustomEvent;
@@ -189,6 +295,55 @@ public:
     }
 
 
+    // Fires a single aggregated event per matching subscription for a batch update.
+    // `updates` maps namespace -> {key: value}, `removals` maps namespace -> [key, ...].
+    void PushBatchToJavascript(const nlohmann::json& updates, const nlohmann::json& removals, bool fromJavascript = false)
+    {
+        if(!JavascriptIsRegisteredForStateEvents)
+        {
+            return;
+        }
+
+        for (const auto& registration: StateUpdateSubscriptions)
+        {
+            if((fromJavascript && !registration.UpdatesFromJavascript) || (!fromJavascript && !registration.UpdatesFromPython))
+            {
+                continue;
+            }
+
+            nlohmann::json changes = nlohmann::json::object();
+            nlohmann::json removed = nlohmann::json::object();
+            for (const auto& stateSpace: registration.NameSpaces)
+            {
+                if(updates.contains(stateSpace))
+                {
+                    changes[stateSpace] = updates[stateSpace];
+                }
+                if(removals.contains(stateSpace))
+                {
+                    removed[stateSpace] = removals[stateSpace];
+                }
+            }
+
+            if(!changes.empty() || !removed.empty())
+            {
+                FireBatchEvent(changes, removed, registration.EventName);
+            }
+        }
+    }
+
+    void FireBatchEvent(const nlohmann::json& changes, const nlohmann::json& removed, const std::string& eventName)
+    {
+        std::stringstream jsCodeStream;
+        jsCodeStream << "triggerCustomStateChangePytoniumEvent('" << EscapeJsString(eventName) << "', {";
+        jsCodeStream << "'batch': true, ";
+        jsCodeStream << "'changes': " << changes.dump() << ", ";
+        jsCodeStream << "'removed': " << removed.dump();
+        jsCodeStream << "});";
+
+        m_Browser->GetMainFrame()->ExecuteJavaScript(jsCodeStream.str(), m_Browser->GetMainFrame()->GetURL(), 0);
+    }
+
     void FireEvent(const std::string& stateNamespace, const std::string& stateName, const std::string& eventName)
     {
         // Serialize the updated state (or namespace) to JSON string
@@ -13,7 +13,11 @@
 #include <iostream>
 #include <unordered_map>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include "nlohmann/json.hpp"
 #include "cef_value_wrapper.h"
 
@@ -230,84 +234,419 @@ public:
     }
 };
 
+// Holds the application state of one browser in the renderer process.
+//
+// Every namespace is stored as an immutable snapshot behind a shared_ptr. Writers
+// take the exclusive lock, copy the affected namespace, modify the copy and swap
+// it in (copy-on-write). Readers only take the shared lock long enough to grab the
+// snapshot pointer, so reads never block each other and never mutate the store.
+// Values inside a snapshot are shared as well, so copying a namespace only copies
+// the key table, not the JSON payloads.
+//
+// Every write is stamped with a store-wide, monotonically increasing version. Keys
+// remember the version of their last write, namespaces the version of their last
+// change, and removed keys leave a tombstone so getChangesSince can report them.
+// Tombstones are bounded per namespace; a getChangesSince older than the pruned
+// ones returns the whole namespace with "reset" set instead.
 class ApplicationStateManager {
+public:
+    // Tombstones kept per namespace before the oldest half is dropped.
+    static constexpr size_t kMaxTombstones = 1024;
+
+    using StateValue = std::shared_ptr<const nlohmann::json>;
+
+    struct StateEntry {
+        StateValue value;
+        uint64_t version = 0;
+    };
+
+    struct NamespaceState {
+        std::unordered_map<std::string, StateEntry> entries;
+        // Removed keys and the version they were removed at
+        std::unordered_map<std::string, uint64_t> removed;
+        // Newest version of a dropped tombstone; changes since older versions are incomplete.
+        uint64_t prunedVersion = 0;
+        uint64_t version = 0;
+    };
+
+    using NamespaceSnapshot = std::shared_ptr<const NamespaceState>;
+    using StoreSnapshot = std::unordered_map<std::string, NamespaceSnapshot>;
+
 private:
-    std::unordered_map<std::string, std::unordered_map<std::string, nlohmann::json>> namespaces;
-    mutable std::mutex m_mutex;
+    StoreSnapshot namespaces;
+    uint64_t m_version = 0;
+    mutable std::shared_mutex m_mutex;
+
+    NamespaceSnapshot findNamespace(const std::string& namespaceName) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = namespaces.find(namespaceName);
+        if (it != namespaces.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    // Returns a private copy of the namespace, ready to be modified and swapped in.
+    // Must be called with the exclusive lock held.
+    std::shared_ptr<NamespaceState> copyNamespaceUnlocked(const std::string& namespaceName) const {
+        auto it = namespaces.find(namespaceName);
+        if (it != namespaces.end() && it->second) {
+            return std::make_shared<NamespaceState>(*it->second);
+        }
+        return std::make_shared<NamespaceState>();
+    }
+
+    // Both must be called with the exclusive lock held.
+    static void putUnlocked(NamespaceState& namespaceState, const std::string& key, StateValue value, uint64_t version) {
+        namespaceState.removed.erase(key);
+        namespaceState.entries[key] = StateEntry{std::move(value), version};
+        namespaceState.version = version;
+    }
+
+    static bool eraseUnlocked(NamespaceState& namespaceState, const std::string& key, uint64_t version) {
+        if (namespaceState.entries.erase(key) == 0) {
+            return false;
+        }
+        namespaceState.removed[key] = version;
+        namespaceState.version = version;
+        pruneTombstonesUnlocked(namespaceState);
+        return true;
+    }
+
+    // Drops the older half of the tombstones once there are more than kMaxTombstones.
+    static void pruneTombstonesUnlocked(NamespaceState& namespaceState) {
+        if (namespaceState.removed.size() <= kMaxTombstones) {
+            return;
+        }
+        std::vector<uint64_t> versions;
+        versions.reserve(namespaceState.removed.size());
+        for (const auto& [key, removedVersion] : namespaceState.removed) {
+            versions.push_back(removedVersion);
+        }
+        auto cutoff = versions.begin() + static_cast<std::ptrdiff_t>(versions.size() - kMaxTombstones / 2);
+        std::nth_element(versions.begin(), cutoff, versions.end());
+        const uint64_t keepFrom = *cutoff;
+        for (auto it = namespaceState.removed.begin(); it != namespaceState.removed.end();) {
+            if (it->second < keepFrom) {
+                namespaceState.prunedVersion = std::max(namespaceState.prunedVersion, it->second);
+                it = namespaceState.removed.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Keys of |previous| missing from |loaded| get a tombstone at |version|, so readers
+    // of getChangesSince learn about them; the older tombstones are carried over.
+    static void carryOverRemovalsUnlocked(NamespaceState& loaded, const NamespaceSnapshot& previous, uint64_t version) {
+        if (!previous) {
+            return;
+        }
+        loaded.prunedVersion = previous->prunedVersion;
+        for (const auto& [key, removedVersion] : previous->removed) {
+            if (loaded.entries.find(key) == loaded.entries.end()) {
+                loaded.removed[key] = removedVersion;
+            }
+        }
+        for (const auto& [key, entry] : previous->entries) {
+            if (loaded.entries.find(key) == loaded.entries.end()) {
+                loaded.removed[key] = version;
+            }
+        }
+        pruneTombstonesUnlocked(loaded);
+    }
+
+    static nlohmann::json namespaceSnapshotToJson(const NamespaceSnapshot& snapshot) {
+        nlohmann::json jsonObj = nlohmann::json::object();
+        if (snapshot) {
+            for (const auto& [key, entry] : snapshot->entries) {
+                jsonObj[key] = *entry.value;
+            }
+        }
+        return jsonObj;
+    }
+
+    static CefValueWrapper namespaceSnapshotToCefValueWrapper(const NamespaceSnapshot& snapshot) {
+        // Create an empty CefValueWrapper object to hold the converted namespace
+        CefValueWrapper cefNamespace;
+        std::map<std::string, CefValueWrapper> cefObject;
+
+        // Iterate over each key-value pair in the namespace and convert it to CefValueWrapper
+        if (snapshot) {
+            for (const auto& [key, entry] : snapshot->entries) {
+                cefObject[key] = ApplicationStateManagerHelper::jsonToCefValueWrapper(*entry.value);
+            }
+        }
 
-    void ensureNamespaceExists(const std::string& namespaceName) {
-        if (namespaces.find(namespaceName) == namespaces.end()) {
-            namespaces[namespaceName] = std::unordered_map<std::string, nlohmann::json>();
+        // Set the object to the CefValueWrapper and return
+        cefNamespace.SetObject(cefObject);
+        return cefNamespace;
+    }
+
+    static std::shared_ptr<NamespaceState> namespaceFromJson(const nlohmann::json& namespaceJson, uint64_t version) {
+        auto namespaceMap = std::make_shared<NamespaceState>();
+        for (auto& [key, value] : namespaceJson.items()) {
+            namespaceMap->entries[key] = StateEntry{std::make_shared<const nlohmann::json>(value), version};
         }
+        namespaceMap->version = version;
+        return namespaceMap;
     }
 
 public:
-    void setState(const std::string& namespaceName, const std::string& key, const nlohmann::json& value) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        ensureNamespaceExists(namespaceName);
-        namespaces[namespaceName][key] = value;
+    // Returns the version assigned to the write.
+    uint64_t setState(const std::string& namespaceName, const std::string& key, const nlohmann::json& value) {
+        auto storedValue = std::make_shared<const nlohmann::json>(value);
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto updated = copyNamespaceUnlocked(namespaceName);
+        const uint64_t version = ++m_version;
+        putUnlocked(*updated, key, std::move(storedValue), version);
+        namespaces[namespaceName] = std::move(updated);
+        return version;
+    }
+
+    // Optimistic concurrency: writes only if the key is still at `expectedVersion`
+    // (0 means the key must not exist). Returns the new version, or 0 if the key
+    // was changed in the meantime.
+    uint64_t compareAndSetState(const std::string& namespaceName, const std::string& key,
+                                uint64_t expectedVersion, const nlohmann::json& value) {
+        auto storedValue = std::make_shared<const nlohmann::json>(value);
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        uint64_t currentVersion = 0;
+        auto it = namespaces.find(namespaceName);
+        if (it != namespaces.end() && it->second) {
+            auto entryIt = it->second->entries.find(key);
+            if (entryIt != it->second->entries.end()) {
+                currentVersion = entryIt->second.version;
+            }
+        }
+        if (currentVersion != expectedVersion) {
+            return 0;
+        }
+        auto updated = copyNamespaceUnlocked(namespaceName);
+        const uint64_t version = ++m_version;
+        putUnlocked(*updated, key, std::move(storedValue), version);
+        namespaces[namespaceName] = std::move(updated);
+        return version;
+    }
+
+    // Applies a whole batch as one atomic step. `updates` maps namespace -> {key: value} and
+    // `removals` maps namespace -> [key, ...]. Every touched namespace is copied once and all
+    // new snapshots are published under the same exclusive lock, so readers see either none
+    // or all of the batch. The whole batch shares one version.
+    uint64_t applyBatch(const nlohmann::json& updates, const nlohmann::json& removals = nlohmann::json::object()) {
+        // Prepare the shared values before taking the lock
+        std::unordered_map<std::string, std::vector<std::pair<std::string, StateValue>>> preparedUpdates;
+        if (updates.is_object()) {
+            for (const auto& [namespaceName, values] : updates.items()) {
+                if (!values.is_object()) {
+                    continue;
+                }
+                auto& entries = preparedUpdates[namespaceName];
+                for (const auto& [key, value] : values.items()) {
+                    entries.emplace_back(key, std::make_shared<const nlohmann::json>(value));
+                }
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        const uint64_t version = ++m_version;
+        std::unordered_map<std::string, std::shared_ptr<NamespaceState>> touched;
+        auto getTouched = [&](const std::string& namespaceName) -> NamespaceState& {
+            auto it = touched.find(namespaceName);
+            if (it == touched.end()) {
+                it = touched.emplace(namespaceName, copyNamespaceUnlocked(namespaceName)).first;
+            }
+            return *it->second;
+        };
+
+        if (removals.is_object()) {
+            for (const auto& [namespaceName, keys] : removals.items()) {
+                if (!keys.is_array()) {
+                    continue;
+                }
+                for (const auto& key : keys) {
+                    if (key.is_string()) {
+                        eraseUnlocked(getTouched(namespaceName), key.get<std::string>(), version);
+                    }
+                }
+            }
+        }
+        for (auto& [namespaceName, entries] : preparedUpdates) {
+            NamespaceState& namespaceState = getTouched(namespaceName);
+            for (auto& [key, value] : entries) {
+                putUnlocked(namespaceState, key, std::move(value), version);
+            }
+        }
+        for (auto& [namespaceName, namespaceState] : touched) {
+            namespaces[namespaceName] = std::move(namespaceState);
+        }
+        return version;
     }
 
+    uint64_t setStates(const std::string& namespaceName, const nlohmann::json& values) {
+        nlohmann::json updates = nlohmann::json::object();
+        updates[namespaceName] = values;
+        return applyBatch(updates);
+    }
 
-    nlohmann::json getState(const std::string& namespaceName, const std::string& key) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        ensureNamespaceExists(namespaceName);
-        if (namespaces[namespaceName].find(key) != namespaces[namespaceName].end()) {
-            return namespaces[namespaceName][key];
+    nlohmann::json getState(const std::string& namespaceName, const std::string& key) const {
+        NamespaceSnapshot snapshot = findNamespace(namespaceName);
+        if (snapshot) {
+            auto it = snapshot->entries.find(key);
+            if (it != snapshot->entries.end()) {
+                return *it->second.value;
+            }
         }
         return nullptr;  // Return null json if key not found
     }
 
     void removeState(const std::string& namespaceName, const std::string& key) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        ensureNamespaceExists(namespaceName);
-        if (namespaces[namespaceName].find(key) != namespaces[namespaceName].end()) {
-            namespaces[namespaceName].erase(key);
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = namespaces.find(namespaceName);
+        if (it == namespaces.end() || !it->second || it->second->entries.find(key) == it->second->entries.end()) {
+            return;
+        }
+        auto updated = std::make_shared<NamespaceState>(*it->second);
+        eraseUnlocked(*updated, key, ++m_version);
+        it->second = std::move(updated);
+    }
+
+    // Version of the last change to the namespace, 0 if it never existed.
+    uint64_t getVersion(const std::string& namespaceName) const {
+        NamespaceSnapshot snapshot = findNamespace(namespaceName);
+        return snapshot ? snapshot->version : 0;
+    }
+
+    // Version of the last write to the key, 0 if it does not exist.
+    uint64_t getStateVersion(const std::string& namespaceName, const std::string& key) const {
+        NamespaceSnapshot snapshot = findNamespace(namespaceName);
+        if (snapshot) {
+            auto it = snapshot->entries.find(key);
+            if (it != snapshot->entries.end()) {
+                return it->second.version;
+            }
+        }
+        return 0;
+    }
+
+    // Returns {"version": <namespace version>, "changes": {key: value}, "removed": [key],
+    // "reset": bool} with every key written or removed after `sinceVersion`. Pass the returned
+    // version on the next call to continue from there. If the tombstones since `sinceVersion`
+    // were pruned, "reset" is true and "changes" holds the whole namespace: keys not in it
+    // are gone.
+    nlohmann::json getChangesSince(const std::string& namespaceName, uint64_t sinceVersion) const {
+        NamespaceSnapshot snapshot = findNamespace(namespaceName);
+        nlohmann::json changes = nlohmann::json::object();
+        nlohmann::json removed = nlohmann::json::array();
+        uint64_t version = 0;
+        bool reset = false;
+        if (snapshot) {
+            version = snapshot->version;
+            if (sinceVersion > 0 && sinceVersion < snapshot->prunedVersion) {
+                reset = true;
+                sinceVersion = 0;
+            }
+            if (version > sinceVersion) {
+                for (const auto& [key, entry] : snapshot->entries) {
+                    if (entry.version > sinceVersion) {
+                        changes[key] = *entry.value;
+                    }
+                }
+                for (const auto& [key, removedVersion] : snapshot->removed) {
+                    if (!reset && removedVersion > sinceVersion) {
+                        removed.push_back(key);
+                    }
+                }
+            }
         }
+
+        nlohmann::json result = nlohmann::json::object();
+        // Stored as double so it survives the int32 conversion to CefValue/V8 unchanged
+        result["version"] = static_cast<double>(version);
+        result["changes"] = std::move(changes);
+        result["removed"] = std::move(removed);
+        result["reset"] = reset;
+        return result;
+    }
+
+    // Returns the current immutable snapshot of a namespace, or nullptr if it does not exist.
+    NamespaceSnapshot getNamespaceSnapshot(const std::string& namespaceName) const {
+        return findNamespace(namespaceName);
     }
 
-    std::string serializeToJson() {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        nlohmann::json jsonObj = namespaces;
+    // Returns a consistent view of the whole store. Only the table of namespace
+    // pointers is copied while the shared lock is held.
+    StoreSnapshot getSnapshot() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return namespaces;
+    }
+
+    std::string serializeToJson() const {
+        StoreSnapshot snapshot = getSnapshot();
+        nlohmann::json jsonObj = nlohmann::json::object();
+        for (const auto& [namespaceName, namespaceSnapshot] : snapshot) {
+            jsonObj[namespaceName] = namespaceSnapshotToJson(namespaceSnapshot);
+        }
         return jsonObj.dump();
     }
 
     void deserializeFromJson(const std::string& jsonStr) {
-        std::lock_guard<std::mutex> lock(m_mutex);
         nlohmann::json jsonObj = nlohmann::json::parse(jsonStr);
-        namespaces = jsonObj.get<decltype(namespaces)>();
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        // Loaded keys count as changed, so readers holding older versions resync
+        const uint64_t version = ++m_version;
+        StoreSnapshot loaded;
+        for (auto& [namespaceName, namespaceJson] : jsonObj.items()) {
+            auto namespaceState = namespaceFromJson(namespaceJson, version);
+            auto previous = namespaces.find(namespaceName);
+            if (previous != namespaces.end()) {
+                carryOverRemovalsUnlocked(*namespaceState, previous->second, version);
+            }
+            loaded[namespaceName] = std::move(namespaceState);
+        }
+        // Namespaces missing from the JSON stay, emptied, to keep their tombstones
+        for (const auto& [namespaceName, previous] : namespaces) {
+            if (loaded.find(namespaceName) == loaded.end() && previous) {
+                auto emptied = std::make_shared<NamespaceState>();
+                emptied->version = previous->entries.empty() ? previous->version : version;
+                carryOverRemovalsUnlocked(*emptied, previous, version);
+                loaded[namespaceName] = std::move(emptied);
+            }
+        }
+        namespaces = std::move(loaded);
     }
 
-    std::string serializeNamespaceToJson(const std::string& namespaceName) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        ensureNamespaceExists(namespaceName);  // Make sure the namespace exists
-        nlohmann::json jsonObj = namespaces[namespaceName];
-        return jsonObj.dump();
+    std::string serializeNamespaceToJson(const std::string& namespaceName) const {
+        return namespaceSnapshotToJson(findNamespace(namespaceName)).dump();
     }
 
     void deserializeNamespaceFromJson(const std::string& namespaceName, const std::string& jsonStr) {
-        std::lock_guard<std::mutex> lock(m_mutex);
         nlohmann::json jsonObj = nlohmann::json::parse(jsonStr);
-        auto namespaceMap = jsonObj.get<std::unordered_map<std::string, nlohmann::json>>();
-        namespaces[namespaceName] = namespaceMap;  // This will create or update the namespace
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        const uint64_t version = ++m_version;
+        auto namespaceState = namespaceFromJson(jsonObj, version);
+        auto previous = namespaces.find(namespaceName);
+        if (previous != namespaces.end()) {
+            carryOverRemovalsUnlocked(*namespaceState, previous->second, version);
+        }
+        namespaces[namespaceName] = std::move(namespaceState);  // This will create or update the namespace
     }
 
-    CefValueWrapper namespaceToCefValueWrapper(const std::string& namespaceName) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return namespaceToCefValueWrapperUnlocked(namespaceName);
+    CefValueWrapper namespaceToCefValueWrapper(const std::string& namespaceName) const {
+        return namespaceSnapshotToCefValueWrapper(findNamespace(namespaceName));
     }
 
-    CefValueWrapper allNamespacesToCefValueWrapper(const std::string& globalNamespaceName) {
-        std::lock_guard<std::mutex> lock(m_mutex);
+    CefValueWrapper allNamespacesToCefValueWrapper(const std::string& globalNamespaceName) const {
+        // Take a consistent snapshot and convert it without holding the lock
+        StoreSnapshot snapshot = getSnapshot();
 
         // Create an empty CefValueWrapper object to hold all namespaces
         CefValueWrapper globalCefNamespace;
         std::map<std::string, CefValueWrapper> globalCefObject;
 
-        // Iterate over each namespace in the StateManager and convert it to a CefValueWrapper
-        for (const auto& [namespaceName, namespaceMap] : namespaces) {
-            CefValueWrapper cefNamespace = namespaceToCefValueWrapperUnlocked(namespaceName);
-            globalCefObject[namespaceName] = cefNamespace;
+        // Iterate over each namespace in the snapshot and convert it to a CefValueWrapper
+        for (const auto& [namespaceName, namespaceSnapshot] : snapshot) {
+            globalCefObject[namespaceName] = namespaceSnapshotToCefValueWrapper(namespaceSnapshot);
         }
 
         // Set the global namespace name and bundle all the individual namespaces under it
@@ -321,25 +660,6 @@ public:
 
         return rootCefObject;
     }
-
-private:
-    CefValueWrapper namespaceToCefValueWrapperUnlocked(const std::string& namespaceName) {
-        ensureNamespaceExists(namespaceName);  // Make sure the namespace exists
-
-        // Create an empty CefValueWrapper object to hold the converted namespace
-        CefValueWrapper cefNamespace;
-        std::map<std::string, CefValueWrapper> cefObject;
-
-        // Iterate over each key-value pair in the namespace and convert it to CefValueWrapper
-        for (const auto& [key, value] : namespaces[namespaceName]) {
-            cefObject[key] = ApplicationStateManagerHelper::jsonToCefValueWrapper(value);
-        }
-
-        // Set the object to the CefValueWrapper and return
-        cefNamespace.SetObject(cefObject);
-        return cefNamespace;
-    }
-
 };
 
 
@@ -5,6 +5,7 @@
 #ifndef PYTONIUM_APPLICATION_STATE_PYTHON_H
 #define PYTONIUM_APPLICATION_STATE_PYTHON_H
 
+#include <cstdint>
 #include <utility>
 #include "cef_value_wrapper.h"
 
@@ -13,6 +14,24 @@ using state_handler_function_ptr = void (*)(state_callback_object_ptr python_cal
                                             std::string stateNamespace, std::string stateKey,
                                             CefValueWrapper callback_args);
 
+// Called once per batch with an object of namespace -> {key: value}, filtered to the
+// namespaces the handler is subscribed to.
+using state_batch_handler_function_ptr = void (*)(state_callback_object_ptr python_callback_object,
+                                                  CefValueWrapper changes);
+
+// Completion callback for state requests answered by the renderer (e.g. getChangesSince).
+// `success` is false if the browser closed before the reply arrived.
+using state_request_callback_ptr = void (*)(void* user_data, int request_id, bool success,
+                                            CefValueWrapper result);
+
+struct PendingStateRequest
+{
+    state_request_callback_ptr Callback = nullptr;
+    void* UserData = nullptr;
+    // The browser's state cache generation when the request was sent
+    uint64_t CacheGeneration = 0;
+};
+
 
 class StateHandlerPythonBinding
 {
@@ -20,13 +39,16 @@ public:
     state_handler_function_ptr StateHandlerCallbackFunction;
     state_callback_object_ptr StateHandlerCallbackObject;
     std::vector<std::string> StateNamespacesToSubscribeTo;
+    state_batch_handler_function_ptr StateBatchHandlerCallbackFunction = nullptr;
     StateHandlerPythonBinding()
     = default;
 
     StateHandlerPythonBinding(void (*stateHandlerCallbackFunction)(state_callback_object_ptr, std::string, std::string,
                                                                    CefValueWrapper),
-                              void *stateHandlerCallbackObject, std::vector<std::string> stateNamespacesToSubscribeTo) : StateHandlerCallbackFunction(
-            stateHandlerCallbackFunction), StateHandlerCallbackObject(stateHandlerCallbackObject), StateNamespacesToSubscribeTo(std::move(stateNamespacesToSubscribeTo))
+                              void *stateHandlerCallbackObject, std::vector<std::string> stateNamespacesToSubscribeTo,
+                              state_batch_handler_function_ptr stateBatchHandlerCallbackFunction = nullptr) : StateHandlerCallbackFunction(
+            stateHandlerCallbackFunction), StateHandlerCallbackObject(stateHandlerCallbackObject), StateNamespacesToSubscribeTo(std::move(stateNamespacesToSubscribeTo)),
+            StateBatchHandlerCallbackFunction(stateBatchHandlerCallbackFunction)
     {}
 
     void UpdateState(std::string stateNamespace, std::string stateKey, CefValueWrapper callback_args) const
@@ -43,6 +65,48 @@ public:
         }
 
     }
+
+    // Delivers a batch as one notification if the handler supports it, otherwise key by key.
+    void UpdateStates(CefValueWrapper changes) const
+    {
+        if (!changes.IsObject())
+        {
+            return;
+        }
+
+        std::map<std::string, CefValueWrapper> subscribedChanges;
+        for (auto& [stateNamespace, values]: changes.GetObject_())
+        {
+            for (const auto& namespaceName: StateNamespacesToSubscribeTo)
+            {
+                if(namespaceName == stateNamespace)
+                {
+                    subscribedChanges[stateNamespace] = values;
+                    break;
+                }
+            }
+        }
+        if (subscribedChanges.empty())
+        {
+            return;
+        }
+
+        if (StateBatchHandlerCallbackFunction)
+        {
+            CefValueWrapper filtered;
+            filtered.SetObject(subscribedChanges);
+            StateBatchHandlerCallbackFunction(StateHandlerCallbackObject, std::move(filtered));
+            return;
+        }
+
+        for (auto& [stateNamespace, values]: subscribedChanges)
+        {
+            for (auto& [key, value]: values.GetObject_())
+            {
+                StateHandlerCallbackFunction(StateHandlerCallbackObject, stateNamespace, key, value);
+            }
+        }
+    }
 };
 
 #endif //PYTONIUM_APPLICATION_STATE_PYTHON_H
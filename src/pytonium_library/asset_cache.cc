@@ -0,0 +1,217 @@
+#include "asset_cache.h"
+
+#include <fstream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+class MemoryAssetBlob : public AssetBlob
+{
+public:
+    explicit MemoryAssetBlob(std::string data) : m_Data(std::move(data)) {}
+
+    const char* Data() const override { return m_Data.data(); }
+    size_t Size() const override { return m_Data.size(); }
+
+private:
+    std::string m_Data;
+};
+
+// Read-only file mapping. Mapped pages are backed by the OS page cache, so a
+// mapped asset does not cost private memory. Files that get replaced (written
+// elsewhere and renamed over, as build tools do) stay valid for existing
+// readers; files truncated in place while they are served do not, which is why
+// only asset packs are mapped.
+class MappedAssetBlob : public AssetBlob
+{
+public:
+    static std::shared_ptr<const AssetBlob> Map(const std::filesystem::path& path, size_t size)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return nullptr;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+        // The view keeps the mapping alive.
+        CloseHandle(mapping);
+        if (view == nullptr)
+            return nullptr;
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+        void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps the file alive.
+        close(fd);
+        if (view == MAP_FAILED)
+            return nullptr;
+#endif
+        return std::shared_ptr<const AssetBlob>(new MappedAssetBlob(view, size));
+    }
+
+    ~MappedAssetBlob() override
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_View);
+#else
+        munmap(m_View, m_Size);
+#endif
+    }
+
+    const char* Data() const override { return static_cast<const char*>(m_View); }
+    size_t Size() const override { return m_Size; }
+
+private:
+    MappedAssetBlob(void* view, size_t size) : m_View(view), m_Size(size) {}
+
+    void* m_View;
+    size_t m_Size;
+};
+
+// A copy, so a file rewritten while it is served cannot take the blob with it.
+// A file that changed size while it was read is not cached.
+std::shared_ptr<const AssetBlob> LoadAssetBlob(const std::filesystem::path& path, size_t size)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return nullptr;
+    std::string data(size, '\0');
+    file.read(data.data(), static_cast<std::streamsize>(size));
+    if (file.gcount() != static_cast<std::streamsize>(size) || file.peek() != std::ifstream::traits_type::eof())
+        return nullptr;
+    return std::make_shared<MemoryAssetBlob>(std::move(data));
+}
+
+} // namespace
+
+std::shared_ptr<const AssetBlob> CreateMemoryAssetBlob(std::string data)
+{
+    return std::make_shared<MemoryAssetBlob>(std::move(data));
+}
+
+std::shared_ptr<const AssetBlob> MapAssetFile(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec || size == 0)
+        return nullptr;
+    return MappedAssetBlob::Map(path, static_cast<size_t>(size));
+}
+
+AssetCache& AssetCache::Instance()
+{
+    static AssetCache instance;
+    return instance;
+}
+
+std::shared_ptr<const AssetBlob> AssetCache::Acquire(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec)
+        return nullptr;
+    auto modifiedTime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return nullptr;
+    int64_t modified = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+    std::string key = path.string();
+
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Index.find(key);
+        if (it != m_Index.end() && it->second->FileSize == fileSize && it->second->ModifiedTime == modified)
+        {
+            m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+            m_Hits++;
+            return it->second->Blob;
+        }
+        m_Misses++;
+        budget = m_Budget;
+    }
+
+    if (fileSize > budget / 4)
+        return nullptr;
+
+    // Load outside the lock so a slow disk does not stall hits on other files.
+    std::shared_ptr<const AssetBlob> blob = LoadAssetBlob(path, static_cast<size_t>(fileSize));
+    if (!blob)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Index.find(key);
+    if (it != m_Index.end())
+    {
+        m_Bytes -= it->second->Blob->Size();
+        m_Entries.erase(it->second);
+        m_Index.erase(it);
+    }
+    if (blob->Size() <= m_Budget / 4)
+    {
+        m_Entries.push_front(Entry{key, blob, fileSize, modified});
+        m_Index[key] = m_Entries.begin();
+        m_Bytes += blob->Size();
+        EvictToBudget(m_Budget);
+    }
+    return blob;
+}
+
+void AssetCache::SetBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Budget = bytes;
+    EvictToBudget(m_Budget);
+}
+
+size_t AssetCache::GetBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Budget;
+}
+
+void AssetCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_Index.clear();
+    m_Bytes = 0;
+}
+
+AssetCacheStats AssetCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    AssetCacheStats stats;
+    stats.Hits = m_Hits;
+    stats.Misses = m_Misses;
+    stats.Evictions = m_Evictions;
+    stats.Entries = m_Entries.size();
+    stats.Bytes = m_Bytes;
+    stats.Budget = m_Budget;
+    return stats;
+}
+
+void AssetCache::EvictToBudget(size_t budget)
+{
+    while (m_Bytes > budget && !m_Entries.empty())
+    {
+        const Entry& last = m_Entries.back();
+        m_Bytes -= last.Blob->Size();
+        m_Index.erase(last.Key);
+        m_Entries.pop_back();
+        m_Evictions++;
+    }
+}
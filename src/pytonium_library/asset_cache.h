@@ -0,0 +1,93 @@
+#ifndef PYTONIUM_ASSET_CACHE_H
+#define PYTONIUM_ASSET_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Immutable bytes of a cached file, read into memory or memory mapped; either
+// way the bytes stay valid for as long as a reference is held, even if the
+// entry is evicted in the meantime.
+class AssetBlob
+{
+public:
+    virtual ~AssetBlob() = default;
+
+    virtual const char* Data() const = 0;
+    virtual size_t Size() const = 0;
+};
+
+std::shared_ptr<const AssetBlob> CreateMemoryAssetBlob(std::string data);
+
+// Memory maps a whole file. Returns nullptr if the file cannot be mapped. Only
+// for files that are replaced rather than rewritten (asset packs): on POSIX,
+// reading a mapping of a file truncated in place raises SIGBUS.
+std::shared_ptr<const AssetBlob> MapAssetFile(const std::filesystem::path& path);
+
+struct AssetCacheStats
+{
+    uint64_t Hits = 0;
+    uint64_t Misses = 0;
+    uint64_t Evictions = 0;
+    uint64_t Entries = 0;
+    uint64_t Bytes = 0;
+    uint64_t Budget = 0;
+};
+
+// Process-wide cache of files served through custom schemes, keyed by resolved
+// path. An entry is only reused while the file's size and modification time
+// are unchanged. The cache keeps at most Budget bytes and evicts the least
+// recently used entries first; files larger than a quarter of the budget are
+// not cached and get streamed from disk instead. Cached files are copied into
+// memory, never mapped, since hot reload rewrites them in place while they may
+// be served.
+class AssetCache
+{
+public:
+    static constexpr size_t DefaultBudget = 64 * 1024 * 1024;
+
+    static AssetCache& Instance();
+
+    // Returns the cached bytes of the file, loading it on a miss. Returns nullptr
+    // if the file cannot be read or is too large to be cached. Blocks on the
+    // file system, so only call it from a thread that may block.
+    std::shared_ptr<const AssetBlob> Acquire(const std::filesystem::path& path);
+
+    // Setting the budget to 0 disables the cache.
+    void SetBudget(size_t bytes);
+    size_t GetBudget() const;
+
+    void Clear();
+
+    AssetCacheStats GetStats() const;
+
+private:
+    AssetCache() = default;
+
+    struct Entry
+    {
+        std::string Key;
+        std::shared_ptr<const AssetBlob> Blob;
+        uintmax_t FileSize;
+        int64_t ModifiedTime;
+    };
+
+    void EvictToBudget(size_t budget);
+
+    mutable std::mutex m_Mutex;
+    // Front is the most recently used entry.
+    std::list<Entry> m_Entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_Index;
+    size_t m_Budget = DefaultBudget;
+    size_t m_Bytes = 0;
+    uint64_t m_Hits = 0;
+    uint64_t m_Misses = 0;
+    uint64_t m_Evictions = 0;
+};
+
+#endif // PYTONIUM_ASSET_CACHE_H
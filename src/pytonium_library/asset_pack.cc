@@ -0,0 +1,424 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr char PackMagic[8] = {'P', 'Y', 'T', 'P', 'A', 'K', '0', '1'};
+constexpr uint32_t PackVersion = 1;
+constexpr size_t HeaderSize = 40;
+constexpr size_t EntrySize = 48;
+
+template <typename T>
+T ReadLittleEndian(const char* data)
+{
+    // Packs are little-endian, as are all platforms Pytonium runs on.
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// A view on one entry's bytes that keeps the whole mapping alive.
+class AssetPackEntryBlob : public AssetBlob
+{
+public:
+    AssetPackEntryBlob(std::shared_ptr<const AssetBlob> file, const char* data, size_t size)
+        : m_File(std::move(file)), m_Data(data), m_Size(size) {}
+
+    const char* Data() const override { return m_Data; }
+    size_t Size() const override { return m_Size; }
+
+private:
+    std::shared_ptr<const AssetBlob> m_File;
+    const char* m_Data;
+    size_t m_Size;
+};
+
+// Canonical Huffman code of a deflate block: the number of codes per length
+// and the symbols ordered by code.
+struct HuffmanCode
+{
+    std::array<uint16_t, 16> Count{};
+    std::array<uint16_t, 288> Symbol{};
+};
+
+// Minimal deflate decoder (RFC 1951) for gzip compressed pack entries, which
+// are only decompressed for clients that do not accept gzip. Decoding stops
+// with an error once the output would exceed the expected size.
+class Inflater
+{
+public:
+    Inflater(const unsigned char* input, size_t size, size_t expectedSize, std::string& output)
+        : m_Input(input), m_Size(size), m_ExpectedSize(expectedSize), m_Output(output) {}
+
+    bool Run()
+    {
+        int last;
+        do
+        {
+            last = Bits(1);
+            int type = Bits(2);
+            bool ok = type == 0 ? Stored() : type == 1 ? Fixed() : type == 2 ? Dynamic() : false;
+            if (!ok || m_Error)
+                return false;
+        } while (!last);
+        return true;
+    }
+
+    // Position of the first byte after the deflate data.
+    size_t GetPosition() const { return m_Position; }
+
+private:
+    int Bits(int need)
+    {
+        uint32_t value = m_BitBuffer;
+        while (m_BitCount < need)
+        {
+            if (m_Position == m_Size)
+            {
+                m_Error = true;
+                return 0;
+            }
+            value |= uint32_t(m_Input[m_Position++]) << m_BitCount;
+            m_BitCount += 8;
+        }
+        m_BitBuffer = value >> need;
+        m_BitCount -= need;
+        return int(value & ((1u << need) - 1));
+    }
+
+    // Returns the number of unused codes (0 for a complete code), negative if
+    // the lengths are over-subscribed.
+    static int Construct(HuffmanCode& code, const uint16_t* lengths, int count)
+    {
+        code.Count.fill(0);
+        for (int symbol = 0; symbol < count; symbol++)
+            code.Count[lengths[symbol]]++;
+        if (code.Count[0] == count)
+            return 0;
+
+        int left = 1;
+        for (int length = 1; length < 16; length++)
+        {
+            left <<= 1;
+            left -= code.Count[length];
+            if (left < 0)
+                return left;
+        }
+
+        std::array<uint16_t, 16> offsets{};
+        for (int length = 1; length < 15; length++)
+            offsets[length + 1] = offsets[length] + code.Count[length];
+        for (int symbol = 0; symbol < count; symbol++)
+        {
+            if (lengths[symbol] != 0)
+                code.Symbol[offsets[lengths[symbol]]++] = uint16_t(symbol);
+        }
+        return left;
+    }
+
+    int Decode(const HuffmanCode& code)
+    {
+        int value = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length < 16; length++)
+        {
+            value |= Bits(1);
+            int count = code.Count[length];
+            if (value - count < first)
+                return code.Symbol[index + (value - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            value <<= 1;
+        }
+        return -1;
+    }
+
+    bool Stored()
+    {
+        // Stored blocks start on a byte boundary.
+        m_BitBuffer = 0;
+        m_BitCount = 0;
+        if (m_Size - m_Position < 4)
+            return false;
+        size_t length = m_Input[m_Position] | (m_Input[m_Position + 1] << 8);
+        size_t complement = m_Input[m_Position + 2] | (m_Input[m_Position + 3] << 8);
+        m_Position += 4;
+        if (length != (~complement & 0xffff) || m_Size - m_Position < length ||
+            m_ExpectedSize - m_Output.size() < length)
+            return false;
+        m_Output.append(reinterpret_cast<const char*>(m_Input + m_Position), length);
+        m_Position += length;
+        return true;
+    }
+
+    bool Codes(const HuffmanCode& lengthCode, const HuffmanCode& distanceCode)
+    {
+        static constexpr uint16_t LengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr uint8_t LengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr uint16_t DistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                      193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                                      6145, 8193, 12289, 16385, 24577};
+        static constexpr uint8_t DistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                      6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        while (!m_Error)
+        {
+            int symbol = Decode(lengthCode);
+            if (symbol < 0)
+                return false;
+            if (symbol == 256)
+                return true;
+            if (symbol < 256)
+            {
+                if (m_Output.size() == m_ExpectedSize)
+                    return false;
+                m_Output.push_back(static_cast<char>(symbol));
+                continue;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29)
+                return false;
+            size_t length = LengthBase[symbol] + Bits(LengthExtra[symbol]);
+            symbol = Decode(distanceCode);
+            if (symbol < 0 || symbol >= 30)
+                return false;
+            size_t distance = DistanceBase[symbol] + Bits(DistanceExtra[symbol]);
+            if (distance > m_Output.size() || m_ExpectedSize - m_Output.size() < length)
+                return false;
+            // Copies may overlap their own output, so go byte by byte.
+            size_t from = m_Output.size() - distance;
+            for (size_t i = 0; i < length; i++)
+                m_Output.push_back(m_Output[from + i]);
+        }
+        return false;
+    }
+
+    bool Fixed()
+    {
+        static const std::pair<HuffmanCode, HuffmanCode> codes = [] {
+            std::pair<HuffmanCode, HuffmanCode> fixed;
+            uint16_t lengths[288];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            Construct(fixed.first, lengths, 288);
+            std::fill(lengths, lengths + 30, 5);
+            Construct(fixed.second, lengths, 30);
+            return fixed;
+        }();
+        return Codes(codes.first, codes.second);
+    }
+
+    bool Dynamic()
+    {
+        static constexpr uint8_t Order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        int lengthCount = Bits(5) + 257;
+        int distanceCount = Bits(5) + 1;
+        int codeCount = Bits(4) + 4;
+        if (m_Error || lengthCount > 286 || distanceCount > 30)
+            return false;
+
+        uint16_t lengths[316]{};
+        for (int i = 0; i < codeCount; i++)
+            lengths[Order[i]] = uint16_t(Bits(3));
+        HuffmanCode lengthCode;
+        HuffmanCode distanceCode;
+        if (Construct(lengthCode, lengths, 19) != 0)
+            return false;
+
+        int index = 0;
+        while (index < lengthCount + distanceCount)
+        {
+            int symbol = Decode(lengthCode);
+            if (symbol < 0 || m_Error)
+                return false;
+            if (symbol < 16)
+            {
+                lengths[index++] = uint16_t(symbol);
+                continue;
+            }
+            uint16_t length = 0;
+            int repeat;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                    return false;
+                length = lengths[index - 1];
+                repeat = 3 + Bits(2);
+            }
+            else if (symbol == 17)
+                repeat = 3 + Bits(3);
+            else
+                repeat = 11 + Bits(7);
+            if (index + repeat > lengthCount + distanceCount)
+                return false;
+            while (repeat--)
+                lengths[index++] = length;
+        }
+        if (lengths[256] == 0)
+            return false;
+
+        // Incomplete codes are only allowed for a single length.
+        int left = Construct(lengthCode, lengths, lengthCount);
+        if (left < 0 || (left > 0 && lengthCount - lengthCode.Count[0] != 1))
+            return false;
+        left = Construct(distanceCode, lengths + lengthCount, distanceCount);
+        if (left < 0 || (left > 0 && distanceCount - distanceCode.Count[0] != 1))
+            return false;
+        return Codes(lengthCode, distanceCode);
+    }
+
+    const unsigned char* m_Input;
+    size_t m_Size;
+    size_t m_Position = 0;
+    uint32_t m_BitBuffer = 0;
+    int m_BitCount = 0;
+    bool m_Error = false;
+    size_t m_ExpectedSize;
+    std::string& m_Output;
+};
+
+} // namespace
+
+uint32_t AssetPack::Hash(std::string_view data, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool AssetPack::IsAssetPack(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec) && path.extension() == ".pytpak";
+}
+
+std::shared_ptr<const AssetPack> AssetPack::Open(const std::filesystem::path& path)
+{
+    std::shared_ptr<const AssetBlob> file = MapAssetFile(path);
+    if (!file || file->Size() < HeaderSize || std::memcmp(file->Data(), PackMagic, sizeof(PackMagic)) != 0)
+        return nullptr;
+
+    const char* header = file->Data();
+    if (ReadLittleEndian<uint32_t>(header + 8) != PackVersion)
+        return nullptr;
+
+    std::shared_ptr<AssetPack> pack(new AssetPack());
+    pack->m_File = file;
+    pack->m_EntryCount = ReadLittleEndian<uint32_t>(header + 12);
+    pack->m_BucketCount = ReadLittleEndian<uint32_t>(header + 16);
+    pack->m_SeedsOffset = ReadLittleEndian<uint64_t>(header + 24);
+    pack->m_EntriesOffset = ReadLittleEndian<uint64_t>(header + 32);
+
+    // Validate the tables once, so lookups need no bounds checks.
+    uint64_t size = file->Size();
+    if (pack->m_EntryCount > 0 && pack->m_BucketCount == 0)
+        return nullptr;
+    if (pack->m_SeedsOffset > size || uint64_t(pack->m_BucketCount) * 4 > size - pack->m_SeedsOffset)
+        return nullptr;
+    if (pack->m_EntriesOffset > size || uint64_t(pack->m_EntryCount) * EntrySize > size - pack->m_EntriesOffset)
+        return nullptr;
+    for (uint32_t i = 0; i < pack->m_EntryCount; i++)
+    {
+        EntryRecord record = pack->ReadEntry(i);
+        if (record.PathOffset > size || record.PathLength > size - record.PathOffset ||
+            record.DataOffset > size || record.StoredSize > size - record.DataOffset)
+            return nullptr;
+    }
+    return pack;
+}
+
+bool AssetPack::Find(std::string_view path, Entry& entry) const
+{
+    if (m_EntryCount == 0)
+        return false;
+
+    uint32_t bucket = Hash(path, 0) % m_BucketCount;
+    uint32_t seed = ReadLittleEndian<uint32_t>(m_File->Data() + m_SeedsOffset + uint64_t(bucket) * 4);
+    EntryRecord record = ReadEntry(Hash(path, seed) % m_EntryCount);
+
+    std::string_view storedPath(m_File->Data() + record.PathOffset, record.PathLength);
+    if (storedPath != path)
+        return false;
+
+    entry.Data = std::make_shared<AssetPackEntryBlob>(m_File, m_File->Data() + record.DataOffset,
+                                                      static_cast<size_t>(record.StoredSize));
+    entry.Gzip = (record.Flags & FlagGzip) != 0;
+    entry.OriginalSize = record.OriginalSize;
+    entry.ModifiedTime = record.ModifiedTime;
+    return true;
+}
+
+bool AssetPack::Decompress(Entry& entry)
+{
+    if (!entry.Gzip)
+        return true;
+
+    // gzip member (RFC 1952): 10 byte header, optional fields, deflate data and
+    // an 8 byte trailer ending in the uncompressed size.
+    const auto* data = reinterpret_cast<const unsigned char*>(entry.Data->Data());
+    size_t size = entry.Data->Size();
+    if (size < 18 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8)
+        return false;
+    uint8_t flags = data[3];
+    size_t position = 10;
+    if (flags & 4)
+    {
+        if (size - position < 2)
+            return false;
+        position += 2 + (data[position] | (data[position + 1] << 8));
+    }
+    for (uint8_t field : {uint8_t(8), uint8_t(16)})
+    {
+        if (!(flags & field))
+            continue;
+        while (position < size && data[position] != 0)
+            position++;
+        position++;
+    }
+    if (flags & 2)
+        position += 2;
+    if (position > size || entry.OriginalSize > size_t(-1))
+        return false;
+
+    std::string output;
+    output.reserve(static_cast<size_t>(entry.OriginalSize));
+    Inflater inflater(data + position, size - position, static_cast<size_t>(entry.OriginalSize), output);
+    if (!inflater.Run() || output.size() != entry.OriginalSize)
+        return false;
+    size_t trailer = position + inflater.GetPosition();
+    if (size - trailer < 8 || ReadLittleEndian<uint32_t>(entry.Data->Data() + trailer + 4) != uint32_t(output.size()))
+        return false;
+
+    entry.Data = CreateMemoryAssetBlob(std::move(output));
+    entry.Gzip = false;
+    return true;
+}
+
+AssetPack::EntryRecord AssetPack::ReadEntry(uint32_t index) const
+{
+    const char* data = m_File->Data() + m_EntriesOffset + uint64_t(index) * EntrySize;
+    EntryRecord record{};
+    record.PathOffset = ReadLittleEndian<uint64_t>(data);
+    record.PathLength = ReadLittleEndian<uint32_t>(data + 8);
+    record.Flags = ReadLittleEndian<uint32_t>(data + 12);
+    record.DataOffset = ReadLittleEndian<uint64_t>(data + 16);
+    record.StoredSize = ReadLittleEndian<uint64_t>(data + 24);
+    record.OriginalSize = ReadLittleEndian<uint64_t>(data + 32);
+    record.ModifiedTime = ReadLittleEndian<int64_t>(data + 40);
+    return record;
+}
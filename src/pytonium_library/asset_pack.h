@@ -0,0 +1,80 @@
+#ifndef PYTONIUM_ASSET_PACK_H
+#define PYTONIUM_ASSET_PACK_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "asset_cache.h"
+
+// Read-only, memory mapped asset archive (".pytpak") that a custom scheme can
+// serve instead of a folder. Archives are built with Pytonium/asset_pack.py.
+//
+// Layout, all integers little-endian:
+//   header   magic "PYTPAK01", u32 version, u32 entry count, u32 bucket count,
+//            u32 reserved, u64 seeds offset, u64 entries offset
+//   seeds    u32 per bucket
+//   entries  48 bytes each: u64 path offset, u32 path length, u32 flags,
+//            u64 data offset, u64 stored size, u64 original size,
+//            i64 modification time (unix seconds)
+//   strings and file data
+//
+// Paths are looked up with a minimal perfect hash (hash and displace with
+// FNV-1a): a path's bucket is fnv1a(path, 0) % buckets, and its entry is
+// fnv1a(path, seeds[bucket]) % entries. The stored path is compared afterwards,
+// so unknown paths are rejected.
+class AssetPack
+{
+public:
+    static constexpr uint32_t FlagGzip = 1;
+
+    struct Entry
+    {
+        // The stored bytes, gzip compressed if Gzip is set.
+        std::shared_ptr<const AssetBlob> Data;
+        bool Gzip = false;
+        uint64_t OriginalSize = 0;
+        int64_t ModifiedTime = 0;
+    };
+
+    // Maps and validates the archive. Returns nullptr if it is not a valid pack.
+    static std::shared_ptr<const AssetPack> Open(const std::filesystem::path& path);
+
+    static bool IsAssetPack(const std::filesystem::path& path);
+
+    static uint32_t Hash(std::string_view data, uint32_t seed);
+
+    // |path| is relative to the archive root, using '/' separators.
+    bool Find(std::string_view path, Entry& entry) const;
+
+    // Replaces the data of a gzip entry with its decompressed bytes and clears
+    // Gzip. Returns false if the data is not a gzip member of OriginalSize bytes.
+    static bool Decompress(Entry& entry);
+
+    uint32_t GetEntryCount() const { return m_EntryCount; }
+
+private:
+    struct EntryRecord
+    {
+        uint64_t PathOffset;
+        uint32_t PathLength;
+        uint32_t Flags;
+        uint64_t DataOffset;
+        uint64_t StoredSize;
+        uint64_t OriginalSize;
+        int64_t ModifiedTime;
+    };
+
+    AssetPack() = default;
+
+    EntryRecord ReadEntry(uint32_t index) const;
+
+    std::shared_ptr<const AssetBlob> m_File;
+    uint32_t m_EntryCount = 0;
+    uint32_t m_BucketCount = 0;
+    uint64_t m_SeedsOffset = 0;
+    uint64_t m_EntriesOffset = 0;
+};
+
+#endif // PYTONIUM_ASSET_PACK_H
@@ -0,0 +1,210 @@
+#include "browser_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "include/cef_task.h"
+#include "include/wrapper/cef_helpers.h"
+#include "cef_wrapper_client_handler.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+namespace {
+
+class RefillTask : public CefTask
+{
+public:
+    explicit RefillTask(CefRefPtr<BrowserPool> pool) : m_Pool(pool) {}
+
+    void Execute() override { m_Pool->OnRefill(); }
+
+private:
+    CefRefPtr<BrowserPool> m_Pool;
+
+    IMPLEMENT_REFCOUNTING(RefillTask);
+};
+
+std::string ToLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+// Scheme and host, stricter than Chromium's sites (scheme and registrable
+// domain), so URLs that match never change the renderer process.
+std::string SiteOf(const std::string& url)
+{
+    size_t colon = url.find(':');
+    if (colon == std::string::npos)
+        return "";
+    std::string scheme = ToLower(url.substr(0, colon));
+    if (scheme == "file")
+        return "file:";
+    size_t start = colon + 1;
+    if (url.compare(start, 2, "//") == 0)
+        start += 2;
+    size_t end = url.find_first_of("/?#", start);
+    std::string host = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t at = host.rfind('@');
+    if (at != std::string::npos)
+        host.erase(0, at + 1);
+    size_t port = host.rfind(':');
+    if (port != std::string::npos && host.find(']', port) == std::string::npos)
+        host.erase(port);
+    return scheme + "://" + ToLower(host);
+}
+
+} // namespace
+
+BrowserPool::BrowserPool(int size, const std::string& warmUrl, bool windowless,
+                         CefRefPtr<CefDictionaryValue> extraInfo)
+    : m_Size(std::max(size, 1)), m_WarmUrl(warmUrl), m_WarmSite(SiteOf(warmUrl)), m_Windowless(windowless),
+      m_ExtraInfo(extraInfo)
+{
+}
+
+bool BrowserPool::SupportsWindowed()
+{
+#if defined(_WIN32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BrowserPool::Start()
+{
+    CEF_REQUIRE_UI_THREAD();
+    Refill();
+}
+
+void BrowserPool::Shutdown()
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    m_ShuttingDown = true;
+    for (auto& browser : m_Browsers)
+        browser->GetHost()->CloseBrowser(true);
+    m_Browsers.clear();
+}
+
+bool BrowserPool::Serves(bool windowless, CefRefPtr<CefDictionaryValue> extraInfo) const
+{
+    return windowless == m_Windowless && extraInfo->IsEqual(m_ExtraInfo);
+}
+
+CefRefPtr<CefBrowser> BrowserPool::Take(const std::string& url, bool windowless,
+                                        CefRefPtr<CefDictionaryValue> extraInfo)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    if (!Serves(windowless, extraInfo))
+        return nullptr;
+    RemoveClosed();
+    auto* handler = CefWrapperClientHandler::GetInstance();
+    if (!m_ShuttingDown && handler && SiteOf(url) == m_WarmSite)
+    {
+        for (auto it = m_Browsers.begin(); it != m_Browsers.end(); ++it)
+        {
+            if (!handler->IsReadyToExecuteJs((*it)->GetIdentifier()))
+                continue;
+            CefRefPtr<CefBrowser> browser = *it;
+            m_Browsers.erase(it);
+            m_Stats.Taken++;
+            Refill();
+            return browser;
+        }
+    }
+    m_Stats.Missed++;
+    return nullptr;
+}
+
+BrowserPoolStats BrowserPool::GetStats() const
+{
+    BrowserPoolStats stats = m_Stats;
+    auto* handler = CefWrapperClientHandler::GetInstance();
+    for (const auto& browser : m_Browsers)
+    {
+        if (!browser->IsValid())
+            continue;
+        if (handler && handler->IsReadyToExecuteJs(browser->GetIdentifier()))
+            stats.Warm++;
+        else
+            stats.Starting++;
+    }
+    return stats;
+}
+
+void BrowserPool::Refill()
+{
+    if (m_RefillPending || m_ShuttingDown || static_cast<int>(m_Browsers.size()) >= m_Size)
+        return;
+    m_RefillPending = true;
+    CefPostTask(TID_UI, new RefillTask(this));
+}
+
+void BrowserPool::OnRefill()
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    m_RefillPending = false;
+    RemoveClosed();
+    if (m_ShuttingDown || static_cast<int>(m_Browsers.size()) >= m_Size)
+        return;
+
+    CefWrapperClientHandler* handler = CefWrapperClientHandler::GetOrCreateInstance();
+
+    cef_browser_settings_t cefBrowserSettings;
+    memset(&cefBrowserSettings, 0, sizeof(cef_browser_settings_t));
+    cefBrowserSettings.size = sizeof(cef_browser_settings_t);
+    if (m_Windowless)
+    {
+        // As CreateBrowserOsr; the frame rate is set when the browser is taken.
+        cefBrowserSettings.windowless_frame_rate = 1;
+        cefBrowserSettings.background_color = 0x00000000;
+    }
+    CefBrowserSettings browser_settings(cefBrowserSettings);
+
+    CefWindowInfo window_info;
+    window_info.runtime_style = CEF_RUNTIME_STYLE_ALLOY;
+    if (m_Windowless)
+    {
+        window_info.SetAsWindowless(kNullWindowHandle);
+    }
+#if defined(_WIN32)
+    else
+    {
+        // No WS_VISIBLE; style, size and position are set when it is taken.
+        window_info.style = WS_POPUP | WS_CLIPCHILDREN | WS_CLIPSIBLINGS;
+        window_info.parent_window = nullptr;
+        window_info.bounds.width = 800;
+        window_info.bounds.height = 600;
+    }
+#endif
+
+    // Synchronously, so the handler knows which browser is the pooled one.
+    // Only the window is created here; the renderer process starts afterwards.
+    handler->SetCreatingPooledBrowser(true);
+    CefRefPtr<CefBrowser> browser = CefBrowserHost::CreateBrowserSync(
+            window_info, handler, m_WarmUrl, browser_settings, m_ExtraInfo->Copy(false), nullptr);
+    handler->SetCreatingPooledBrowser(false);
+    if (browser)
+    {
+        if (m_Windowless)
+            browser->GetHost()->WasHidden(true);
+        m_Browsers.push_back(browser);
+        m_Stats.Created++;
+        Refill();
+    }
+}
+
+void BrowserPool::RemoveClosed()
+{
+    m_Browsers.erase(std::remove_if(m_Browsers.begin(), m_Browsers.end(),
+                                    [](const CefRefPtr<CefBrowser>& browser) { return !browser->IsValid(); }),
+                     m_Browsers.end());
+}
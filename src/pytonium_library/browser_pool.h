@@ -0,0 +1,81 @@
+#ifndef PYTONIUM_BROWSER_POOL_H
+#define PYTONIUM_BROWSER_POOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "include/cef_browser.h"
+#include "include/cef_values.h"
+
+struct BrowserPoolStats
+{
+    // Loaded the warm page and wait to be taken.
+    int Warm = 0;
+    int Starting = 0;
+    uint64_t Created = 0;
+    // Browsers of the pool's kind and bindings opened with a pooled browser,
+    // and without one because none was warm or the URL was on another site.
+    uint64_t Taken = 0;
+    uint64_t Missed = 0;
+};
+
+// Hidden browsers created ahead of time, so opening a window does not wait for
+// a renderer process and a V8 context. Each loads |warmUrl| and waits; Take
+// hands out a loaded one, which the caller navigates, and a replacement is
+// created in the background, one browser per UI thread task.
+//
+// The browsers belong to the shared CefWrapperClientHandler, which keeps them
+// out of the open windows until PytoniumLibrary adopts them. A navigation
+// stays in the warmed renderer process only within the site of |warmUrl| (all
+// file: URLs count as one), so Take refuses URLs of other sites, which would
+// gain nothing. Every new renderer process of a browser (another site, a
+// crash, a swapped BrowsingInstance) gets only the extra info the browser was
+// created with, so the pool creates its browsers with |extraInfo| (the
+// JavaScript bindings of an instance) and serves only callers with equal
+// extra info. UI thread only.
+class BrowserPool : public CefBaseRefCounted
+{
+public:
+    // Windowed browsers (|windowless| false) are hidden native windows, which
+    // only Windows supports.
+    BrowserPool(int size, const std::string& warmUrl, bool windowless, CefRefPtr<CefDictionaryValue> extraInfo);
+
+    // Starts creating the browsers.
+    void Start();
+
+    // Closes the browsers that were not taken.
+    void Shutdown();
+
+    // Whether the pool creates browsers of this kind and extra info.
+    bool Serves(bool windowless, CefRefPtr<CefDictionaryValue> extraInfo) const;
+
+    // A warm browser for |url|, no longer part of the pool; nullptr if there
+    // is none or the pool does not serve |windowless| and |extraInfo|.
+    CefRefPtr<CefBrowser> Take(const std::string& url, bool windowless, CefRefPtr<CefDictionaryValue> extraInfo);
+
+    BrowserPoolStats GetStats() const;
+
+    // Creates one browser and schedules the next, up to the pool size.
+    void OnRefill();
+
+    static bool SupportsWindowed();
+
+private:
+    void Refill();
+    void RemoveClosed();
+
+    int m_Size;
+    std::string m_WarmUrl;
+    std::string m_WarmSite;
+    bool m_Windowless;
+    CefRefPtr<CefDictionaryValue> m_ExtraInfo;
+    std::vector<CefRefPtr<CefBrowser>> m_Browsers;
+    bool m_RefillPending = false;
+    bool m_ShuttingDown = false;
+    BrowserPoolStats m_Stats;
+
+    IMPLEMENT_REFCOUNTING(BrowserPool);
+};
+
+#endif // PYTONIUM_BROWSER_POOL_H
@@ -0,0 +1,67 @@
+#include "cef_custom_scheme.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+
+const char kCustomSchemesSwitch[] = "pytonium-custom-schemes";
+const char kCustomSchemesEnvironment[] = "PYTONIUM_CUSTOM_SCHEMES";
+
+std::string SerializeCustomSchemes(const std::vector<CefCustomScheme>& customSchemes)
+{
+    std::string value;
+    for (const auto& scheme : customSchemes)
+    {
+        if (!value.empty())
+            value += ',';
+        value += scheme.SchemeIdentifier;
+        value += '=';
+        value += std::to_string(scheme.SchemeOptions);
+    }
+    return value;
+}
+
+std::vector<CefCustomScheme> ParseCustomSchemes(const std::string& value)
+{
+    std::vector<CefCustomScheme> customSchemes;
+    std::string_view remaining = value;
+    while (!remaining.empty())
+    {
+        size_t end = remaining.find(',');
+        std::string_view item = remaining.substr(0, end);
+        remaining = end == std::string_view::npos ? std::string_view() : remaining.substr(end + 1);
+
+        size_t separator = item.find('=');
+        if (separator == 0 || separator == std::string_view::npos)
+            continue;
+        CefCustomScheme scheme;
+        scheme.SchemeIdentifier = std::string(item.substr(0, separator));
+        std::string_view options = item.substr(separator + 1);
+        if (std::from_chars(options.data(), options.data() + options.size(), scheme.SchemeOptions).ec != std::errc())
+            continue;
+        customSchemes.push_back(std::move(scheme));
+    }
+    return customSchemes;
+}
+
+void ExportCustomSchemes(const std::vector<CefCustomScheme>& customSchemes)
+{
+    std::string value = SerializeCustomSchemes(customSchemes);
+#if defined(_WIN32)
+    // An empty value removes the variable.
+    _putenv_s(kCustomSchemesEnvironment, value.c_str());
+#else
+    if (value.empty())
+        unsetenv(kCustomSchemesEnvironment);
+    else
+        setenv(kCustomSchemesEnvironment, value.c_str(), 1);
+#endif
+}
+
+std::vector<CefCustomScheme> GetSubprocessCustomSchemes(const std::string& switchValue)
+{
+    if (!switchValue.empty())
+        return ParseCustomSchemes(switchValue);
+    const char* value = std::getenv(kCustomSchemesEnvironment);
+    return ParseCustomSchemes(value ? value : "");
+}
@@ -5,12 +5,48 @@
 #ifndef PYTONIUM_CEF_CUSTOM_SCHEME_H
 #define PYTONIUM_CEF_CUSTOM_SCHEME_H
 
+#include <map>
 #include <string>
+#include <vector>
+
+#include "include/internal/cef_types.h"
 
 class CefCustomScheme
 {
 public:
     std::string SchemeIdentifier;
     std::string SchemeRootContent;
+    // Cache-Control header sent with files of this scheme. "no-cache" lets
+    // Chromium keep responses but revalidate them with ETag/Last-Modified.
+    std::string CacheControl = "no-cache";
+    // cef_scheme_options_t flags the scheme is registered with, in every process.
+    int SchemeOptions = CEF_SCHEME_OPTION_STANDARD | CEF_SCHEME_OPTION_CORS_ENABLED;
+    // Headers added to every response of the scheme, e.g. the
+    // Cross-Origin-Opener-Policy/Cross-Origin-Embedder-Policy pair that
+    // SharedArrayBuffer requires. Headers sent by Python routes take precedence.
+    std::map<std::string, std::string> ResponseHeaders;
 };
+
+// Sub-processes are started without the Python side, so the browser process
+// passes the scheme registrations on the command line. OnRegisterCustomSchemes
+// must register the same schemes with the same options in every process.
+extern const char kCustomSchemesSwitch[];
+
+// On Linux, renderers are forked from the zygote, which is started before any
+// OnBeforeChildProcessLaunch and never sees the switch. The browser process
+// therefore also exports the schemes in this environment variable before
+// CefInitialize, and every sub-process inherits it.
+extern const char kCustomSchemesEnvironment[];
+
+// Encodes identifier and options as "app=81,data=17".
+std::string SerializeCustomSchemes(const std::vector<CefCustomScheme>& customSchemes);
+std::vector<CefCustomScheme> ParseCustomSchemes(const std::string& value);
+
+// Sets (or, without schemes, clears) kCustomSchemesEnvironment.
+void ExportCustomSchemes(const std::vector<CefCustomScheme>& customSchemes);
+
+// The schemes of a sub-process: from the switch if it was passed, else from
+// the environment.
+std::vector<CefCustomScheme> GetSubprocessCustomSchemes(const std::string& switchValue);
+
 #endif //PYTONIUM_CEF_CUSTOM_SCHEME_H
@@ -13,6 +13,18 @@
 
 void CefWrapperApp::OnBeforeCommandLineProcessing(
     const CefString &process_type, CefRefPtr<CefCommandLine> command_line) {
+  // Only the browser process decides, the switches are passed on to the
+  // sub-processes.
+  if (!process_type.empty() || !m_Headless)
+    return;
+
+#if defined(OS_LINUX)
+  // Render without X11 or Wayland.
+  command_line->AppendSwitchWithValue("ozone-platform", "headless");
+#endif
+  // Software compositing; OnPaint gets its frames from the CPU anyway.
+  command_line->AppendSwitch("disable-gpu");
+  command_line->AppendSwitch("disable-gpu-compositing");
 }
 
 CefWrapperApp::CefWrapperApp(std::string start_url, std::vector<JavascriptBinding> javascript_bindings, std::vector<JavascriptPythonBinding> javascript_python_bindings, std::vector<StateHandlerPythonBinding> stateHandlerPythonBindings,  std::vector<ContextMenuBinding> contextMenuBindings, std::vector<CefCustomScheme> customSchemes, std::unordered_map<std::string, std::string> mimeTypeMap, bool frameless) {
@@ -30,6 +42,6 @@ void CefWrapperApp::OnRegisterCustomSchemes(
     CefRawPtr<CefSchemeRegistrar> registrar) {
     for (const auto& scheme: m_CustomSchemes)
     {
-        registrar->AddCustomScheme(scheme.SchemeIdentifier, CEF_SCHEME_OPTION_STANDARD | CEF_SCHEME_OPTION_CORS_ENABLED);
+        registrar->AddCustomScheme(scheme.SchemeIdentifier, scheme.SchemeOptions);
     }
 }
@@ -34,7 +34,12 @@ public:
     void
     OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar) override;
 
+    // Run the browser process without display server and GPU. All browsers
+    // must then be windowless.
+    void SetHeadless(bool headless) { m_Headless = headless; }
+
 private:
+    bool m_Headless = false;
     std::vector<CefCustomScheme> m_CustomSchemes;
     std::vector<JavascriptBinding> m_Javascript_Bindings;
     std::vector<JavascriptPythonBinding> m_Javascript_Python_Bindings;
@@ -8,6 +8,7 @@
 #include "cef_wrapper_client_handler.h"
 #include "cef_wrapper_render_process_handler.h"
 #include "custom_protocol_scheme_handler.h"
+#include "message_pump.h"
 #include "javascript_binding.h"
 #include "cef_value_wrapper.h"
 
@@ -77,6 +78,20 @@ void CefWrapperBrowserProcessHandler::OnContextInitialized()
     }
 }
 
+void CefWrapperBrowserProcessHandler::OnBeforeChildProcessLaunch(
+        CefRefPtr<CefCommandLine> command_line)
+{
+    // The renderer has to register the custom schemes with the same options
+    // as the browser process, see ParseCustomSchemes.
+    if (!m_CustomSchemes.empty())
+        command_line->AppendSwitchWithValue(kCustomSchemesSwitch, SerializeCustomSchemes(m_CustomSchemes));
+}
+
+void CefWrapperBrowserProcessHandler::OnScheduleMessagePumpWork(int64_t delay_ms)
+{
+    MessagePump::Get().ScheduleWork(delay_ms);
+}
+
 void CefWrapperBrowserProcessHandler::SetStartUrl(std::string url)
 {
     CefWrapperBrowserProcessHandler::GetInstance()->StartUrl = url;
@@ -48,6 +48,11 @@ public:
 
     void OnContextInitialized() override;
 
+    void OnBeforeChildProcessLaunch(CefRefPtr<CefCommandLine> command_line) override;
+
+    // Any thread; CEF runs with external_message_pump, see MessagePump.
+    void OnScheduleMessagePumpWork(int64_t delay_ms) override;
+
     std::string StartUrl;
 
 IMPLEMENT_REFCOUNTING(CefWrapperBrowserProcessHandler);
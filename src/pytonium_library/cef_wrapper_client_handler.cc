@@ -9,6 +9,7 @@
 #include "global_vars.h"
 #include "include/base/cef_callback.h"
 #include "include/cef_app.h"
+#include "include/cef_command_line.h"
 #include "include/cef_parser.h"
 #include "include/views/cef_browser_view.h"
 #include "include/views/cef_window.h"
@@ -42,9 +43,7 @@ namespace
 CefWrapperClientHandler::CefWrapperClientHandler(bool use_views)
     : use_views_(use_views), is_closing_(false)
 {
-#if defined(OS_WIN)
     m_OsrDispatcher = new OsrRenderHandlerDispatcher();
-#endif
     g_instance.store(this, std::memory_order_release);
 }
 
@@ -61,11 +60,118 @@ CefWrapperClientHandler *CefWrapperClientHandler::GetInstance()
     return instance;
 }
 
+CefWrapperClientHandler *CefWrapperClientHandler::GetOrCreateInstance()
+{
+    CefWrapperClientHandler* handler = GetInstance();
+    if (!handler) {
+        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+        bool use_views = command_line->HasSwitch("use-views");
+        new CefWrapperClientHandler(use_views);
+        handler = GetInstance();
+    }
+    return handler;
+}
+
 PerBrowserState& CefWrapperClientHandler::GetBrowserState(int browserId)
 {
     return m_BrowserStates[browserId];
 }
 
+int CefWrapperClientHandler::RegisterStateRequest(int browserId, state_request_callback_ptr callback, void* user_data)
+{
+    int requestId = ++m_NextStateRequestId;
+    auto& state = GetBrowserState(browserId);
+    state.pendingStateRequests[requestId] = PendingStateRequest{callback, user_data, state.stateCacheGeneration};
+    return requestId;
+}
+
+void CefWrapperClientHandler::NoteCachedStateWrite(PerBrowserState& state, const std::string& stateNamespace,
+                                                   const std::string& key)
+{
+    state.stateCacheWrites[stateNamespace][key] = ++state.stateCacheGeneration;
+}
+
+void CefWrapperClientHandler::ClearStateCache(PerBrowserState& state)
+{
+    state.stateCache.clear();
+    state.stateCacheWrites.clear();
+    state.stateCacheClearedGeneration = ++state.stateCacheGeneration;
+}
+
+void CefWrapperClientHandler::SetStateCacheEnabled(int browserId, bool enabled)
+{
+    auto& state = GetBrowserState(browserId);
+    state.stateCacheEnabled = enabled;
+    ClearStateCache(state);
+}
+
+bool CefWrapperClientHandler::GetCachedState(int browserId, const std::string& stateNamespace,
+                                             const std::string& key, CefValueWrapper& value)
+{
+    auto browserIt = m_BrowserStates.find(browserId);
+    if (browserIt == m_BrowserStates.end() || !browserIt->second.stateCacheEnabled) {
+        return false;
+    }
+    auto namespaceIt = browserIt->second.stateCache.find(stateNamespace);
+    if (namespaceIt == browserIt->second.stateCache.end()) {
+        return false;
+    }
+    auto keyIt = namespaceIt->second.find(key);
+    if (keyIt == namespaceIt->second.end()) {
+        return false;
+    }
+    value = keyIt->second;
+    return true;
+}
+
+void CefWrapperClientHandler::UpdateCachedState(int browserId, const std::string& stateNamespace,
+                                                const std::string& key, const CefValueWrapper& value)
+{
+    auto browserIt = m_BrowserStates.find(browserId);
+    if (browserIt != m_BrowserStates.end() && browserIt->second.stateCacheEnabled) {
+        browserIt->second.stateCache[stateNamespace][key] = value;
+        NoteCachedStateWrite(browserIt->second, stateNamespace, key);
+    }
+}
+
+void CefWrapperClientHandler::FillCachedState(int browserId, const std::string& stateNamespace,
+                                              const std::string& key, const CefValueWrapper& value,
+                                              uint64_t generation)
+{
+    auto browserIt = m_BrowserStates.find(browserId);
+    if (browserIt == m_BrowserStates.end() || !browserIt->second.stateCacheEnabled) {
+        return;
+    }
+    auto& state = browserIt->second;
+    if (generation < state.stateCacheClearedGeneration) {
+        return;
+    }
+    auto namespaceIt = state.stateCacheWrites.find(stateNamespace);
+    if (namespaceIt != state.stateCacheWrites.end()) {
+        auto keyIt = namespaceIt->second.find(key);
+        if (keyIt != namespaceIt->second.end() && keyIt->second > generation) {
+            return;
+        }
+    }
+    state.stateCache[stateNamespace][key] = value;
+}
+
+void CefWrapperClientHandler::InvalidateCachedState(int browserId, const std::string& stateNamespace,
+                                                    const std::string& key)
+{
+    auto browserIt = m_BrowserStates.find(browserId);
+    if (browserIt == m_BrowserStates.end()) {
+        return;
+    }
+    auto namespaceIt = browserIt->second.stateCache.find(stateNamespace);
+    if (namespaceIt != browserIt->second.stateCache.end()) {
+        namespaceIt->second.erase(key);
+    }
+    if (browserIt->second.stateCacheEnabled) {
+        NoteCachedStateWrite(browserIt->second, stateNamespace, key);
+    }
+}
+
 void CefWrapperClientHandler::RegisterBrowserBindings(int browserId,
     std::vector<JavascriptBinding> jsBindings,
     std::vector<JavascriptPythonBinding> jsPythonBindings,
@@ -224,17 +330,37 @@ void CefWrapperClientHandler::OnAfterCreated(CefRefPtr<CefBrowser> browser)
 {
     CEF_REQUIRE_UI_THREAD();
 
-    // Add to the list of existing browsers.
-    browser_list_.push_back(browser);
-    g_BrowserCount.fetch_add(1, std::memory_order_release);
-
     // Initialize per-browser state
     m_BrowserStates[browser->GetIdentifier()] = PerBrowserState{};
 
+    if (m_CreatingPooledBrowser) {
+        m_BrowserStates[browser->GetIdentifier()].isPooled = true;
+        g_PooledBrowserCount.fetch_add(1, std::memory_order_release);
+    } else {
+        // Add to the list of existing browsers.
+        browser_list_.push_back(browser);
+        g_BrowserCount.fetch_add(1, std::memory_order_release);
+    }
+
     // Subclass the window for resize border handling
     PlatformSubclassWindow(browser);
 }
 
+void CefWrapperClientHandler::AdoptPooledBrowser(CefRefPtr<CefBrowser> browser)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    auto& state = GetBrowserState(browser->GetIdentifier());
+    if (!state.isPooled)
+        return;
+    state.isPooled = false;
+    // Ready again once the caller's page loaded, not the warm page.
+    state.isReadyToExecuteJs = false;
+    browser_list_.push_back(browser);
+    g_PooledBrowserCount.fetch_sub(1, std::memory_order_release);
+    g_BrowserCount.fetch_add(1, std::memory_order_release);
+}
+
 bool CefWrapperClientHandler::DoClose(CefRefPtr<CefBrowser> browser)
 {
     CEF_REQUIRE_UI_THREAD();
@@ -264,15 +390,29 @@ void CefWrapperClientHandler::OnBeforeClose(CefRefPtr<CefBrowser> browser)
     {
         auto it = m_BrowserStates.find(browser->GetIdentifier());
         if (it != m_BrowserStates.end() && it->second.isOsr) {
-#if defined(OS_WIN)
-            m_OsrDispatcher->UnregisterWindow(browser->GetIdentifier());
-#endif
+            m_OsrDispatcher->UnregisterHandler(browser->GetIdentifier());
         }
     }
 
-    // Remove per-browser state
+    // Fail requests that will never get a reply, then remove per-browser state
+    bool pooled = false;
+    {
+        auto it = m_BrowserStates.find(browser->GetIdentifier());
+        if (it != m_BrowserStates.end()) {
+            pooled = it->second.isPooled;
+            auto pending = std::move(it->second.pendingStateRequests);
+            for (auto& [requestId, request] : pending) {
+                request.Callback(request.UserData, requestId, false, CefValueWrapper());
+            }
+        }
+    }
     m_BrowserStates.erase(browser->GetIdentifier());
 
+    if (pooled) {
+        g_PooledBrowserCount.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
     // Remove from the list of existing browsers.
     BrowserList::iterator bit = browser_list_.begin();
     for (; bit != browser_list_.end(); ++bit)
@@ -410,7 +550,13 @@ void CefWrapperClientHandler::OnLoadStart(
         CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
         CefLoadHandler::TransitionType transition_type)
 {
-    GetBrowserState(browser->GetIdentifier()).isReadyToExecuteJs = false;
+    auto& state = GetBrowserState(browser->GetIdentifier());
+    state.isReadyToExecuteJs = false;
+
+    // A navigation may land in a new renderer process with an empty store
+    if (frame->IsMain()) {
+        ClearStateCache(state);
+    }
 }
 
 bool CefWrapperClientHandler::OnProcessMessageReceived(
@@ -481,6 +627,9 @@ bool CefWrapperClientHandler::OnProcessMessageReceived(
                 return false;
             }
             CefValueWrapper wrap = CefValueWrapperHelper::ConvertCefValueToWrapper(argList->GetValue(2));
+            // Python writes still on their way to the renderer are applied after this value, so
+            // it may be outdated already: drop the key, the next read asks the renderer.
+            InvalidateCachedState(browser->GetIdentifier(), namespaceName, key);
 
             for (const auto &stateHandler: state.stateHandlerPythonBindings)
             {
@@ -491,6 +640,89 @@ bool CefWrapperClientHandler::OnProcessMessageReceived(
         {
             return false;
         }
+    } else if (message_name == "push-app-state-batch-update")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 1 && argList->GetType(0) == VTYPE_DICTIONARY)
+        {
+            CefValueWrapper changes = CefValueWrapperHelper::ConvertCefValueToWrapper(argList->GetValue(0));
+            if (state.stateCacheEnabled)
+            {
+                // As for single updates, the values may be older than Python writes in flight.
+                for (auto& [stateNamespace, values]: changes.GetObject_())
+                {
+                    for (auto& [key, value]: values.GetObject_())
+                    {
+                        InvalidateCachedState(browser->GetIdentifier(), stateNamespace, key);
+                    }
+                }
+            }
+
+            for (const auto &stateHandler: state.stateHandlerPythonBindings)
+            {
+                stateHandler.UpdateStates(changes);
+            }
+            return true;
+        } else
+        {
+            return false;
+        }
+    } else if (message_name == "push-app-state-remove")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 2 && argList->GetType(0) == VTYPE_STRING && argList->GetType(1) == VTYPE_STRING)
+        {
+            InvalidateCachedState(browser->GetIdentifier(), argList->GetString(0), argList->GetString(1));
+            return true;
+        } else
+        {
+            return false;
+        }
+    } else if (message_name == "get-app-state-return")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 4 && argList->GetType(0) == VTYPE_INT)
+        {
+            int requestId = argList->GetInt(0);
+            std::string namespaceName = argList->GetString(1);
+            std::string key = argList->GetString(2);
+            CefValueWrapper value = CefValueWrapperHelper::ConvertCefValueToWrapper(argList->GetValue(3));
+
+            auto it = state.pendingStateRequests.find(requestId);
+            if (it != state.pendingStateRequests.end())
+            {
+                PendingStateRequest request = it->second;
+                // A write made while the read was in flight is newer than this answer
+                FillCachedState(browser->GetIdentifier(), namespaceName, key, value, request.CacheGeneration);
+                state.pendingStateRequests.erase(it);
+                request.Callback(request.UserData, requestId, true, value);
+            }
+            return true;
+        } else
+        {
+            return false;
+        }
+    } else if (message_name == "app-state-request-return")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 2 && argList->GetType(0) == VTYPE_INT)
+        {
+            int requestId = argList->GetInt(0);
+            auto it = state.pendingStateRequests.find(requestId);
+            if (it == state.pendingStateRequests.end())
+            {
+                return true;
+            }
+            PendingStateRequest request = it->second;
+            state.pendingStateRequests.erase(it);
+
+            request.Callback(request.UserData, requestId, true,
+                             CefValueWrapperHelper::ConvertCefValueToWrapper(argList->GetValue(1)));
+            return true;
+        } else
+        {
+            return false;
+        }
     } else if (message_name == "set-context-menu-namespace")
     {
         CefRefPtr<CefListValue> argList = message->GetArgumentList();
@@ -12,9 +12,7 @@
 #include "application_state_python.h"
 #include "application_context_menu_binding.h"
 
-#if defined(OS_WIN)
 #include "osr_render_handler_dispatcher.h"
-#endif
 
 // Callback typedefs for window events
 using window_event_string_callback_ptr = void (*)(void* user_data, const char* value);
@@ -23,6 +21,8 @@ using window_event_bool_callback_ptr = void (*)(void* user_data, bool value);
 // Per-browser state stored in the shared client handler, keyed by browser ID.
 struct PerBrowserState {
     bool isOsr = false;
+    // Waiting in the BrowserPool; not an open window until adopted.
+    bool isPooled = false;
     bool isReadyToExecuteJs = false;
     std::string currentContextMenuNamespace = "app";
     bool showDebugContextMenu = false;
@@ -34,6 +34,22 @@ struct PerBrowserState {
     std::vector<ContextMenuBinding> contextMenuBindings;
     std::unordered_map<std::string, std::vector<ContextMenuBinding>> contextMenuBindingsMap;
 
+    // State requests waiting for a reply from the renderer, keyed by request ID
+    std::unordered_map<int, PendingStateRequest> pendingStateRequests;
+
+    // Optional browser-side copy of the renderer's app state, namespace -> key -> value.
+    // Kept current by the state messages flowing through this handler, so Python reads
+    // can be answered without a round-trip to the renderer. Writes pushed by the renderer
+    // cannot be ordered against Python writes it has not applied yet, so they only drop
+    // their keys, which the next read fetches from the renderer.
+    bool stateCacheEnabled = false;
+    std::unordered_map<std::string, std::unordered_map<std::string, CefValueWrapper>> stateCache;
+    // Bumped by every cache write. Replies to reads only fill the cache if the key was not
+    // written, and the cache not cleared, since the read was sent.
+    uint64_t stateCacheGeneration = 0;
+    uint64_t stateCacheClearedGeneration = 0;
+    std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> stateCacheWrites;
+
     // Window event callbacks
     window_event_string_callback_ptr onTitleChangeCallback = nullptr;
     void* onTitleChangeUserData = nullptr;
@@ -60,6 +76,14 @@ public:
 
     // Provide access to the single global instance of this object.
     static CefWrapperClientHandler *GetInstance();
+    // Creates the instance on first use. UI thread only.
+    static CefWrapperClientHandler *GetOrCreateInstance();
+
+    // Browsers created while set belong to the BrowserPool: they are not
+    // counted as open windows until AdoptPooledBrowser.
+    void SetCreatingPooledBrowser(bool pooled)
+    { m_CreatingPooledBrowser = pooled; }
+    void AdoptPooledBrowser(CefRefPtr<CefBrowser> browser);
 
     // Register per-browser bindings after CreateBrowserSync
     void RegisterBrowserBindings(int browserId,
@@ -95,13 +119,11 @@ public:
     CefRefPtr<CefLoadHandler> GetLoadHandler() override
     { return this; }
 
-#if defined(OS_WIN)
     CefRefPtr<CefRenderHandler> GetRenderHandler() override
     { return m_OsrDispatcher; }
 
     OsrRenderHandlerDispatcher* GetOsrDispatcher()
     { return m_OsrDispatcher.get(); }
-#endif
 
     // CefDisplayHandler methods:
     void OnTitleChange(CefRefPtr<CefBrowser> browser,
@@ -182,7 +204,23 @@ public:
     // Access per-browser state
     PerBrowserState& GetBrowserState(int browserId);
 
+    // Registers a callback for a renderer round-trip and returns the request ID to send along.
+    // The renderer answers with "app-state-request-return" [request_id, result].
+    int RegisterStateRequest(int browserId, state_request_callback_ptr callback, void* user_data);
+
+    // Browser-side state cache. The update methods are no-ops while the cache is disabled.
+    void SetStateCacheEnabled(int browserId, bool enabled);
+    bool GetCachedState(int browserId, const std::string& stateNamespace, const std::string& key, CefValueWrapper& value);
+    void UpdateCachedState(int browserId, const std::string& stateNamespace, const std::string& key, const CefValueWrapper& value);
+    void InvalidateCachedState(int browserId, const std::string& stateNamespace, const std::string& key);
+    // Caches the answer of a read sent at |generation|, unless it is outdated by now.
+    void FillCachedState(int browserId, const std::string& stateNamespace, const std::string& key,
+                         const CefValueWrapper& value, uint64_t generation);
+
 private:
+    static void NoteCachedStateWrite(PerBrowserState& state, const std::string& stateNamespace, const std::string& key);
+    static void ClearStateCache(PerBrowserState& state);
+
     // Platform-specific implementation.
     void PlatformTitleChange(CefRefPtr<CefBrowser> browser,
                              const CefString &title);
@@ -200,13 +238,15 @@ private:
 
     bool is_closing_;
 
+    bool m_CreatingPooledBrowser = false;
+
+    int m_NextStateRequestId = 0;
+
     // Per-browser state map, keyed by browser->GetIdentifier()
     std::unordered_map<int, PerBrowserState> m_BrowserStates;
 
-#if defined(OS_WIN)
     // OSR render handler dispatcher (routes OnPaint by browser ID)
     CefRefPtr<OsrRenderHandlerDispatcher> m_OsrDispatcher;
-#endif
 
     // Include the default reference counting implementation.
 IMPLEMENT_REFCOUNTING(CefWrapperClientHandler);
@@ -1,11 +1,56 @@
 #include "cef_wrapper_render_process_handler.h"
 
+#include <algorithm>
+#include <chrono>
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#else
+#include <ctime>
+#include <unistd.h>
+#endif
+
 #include "include/cef_render_process_handler.h"
 #include "include/internal/cef_ptr.h"
 #include "javascript_binding.h"
 #include "javascript_bindings_handler.h"
 #include "javascript_python_binding_handler.h"
 
+namespace {
+
+// CPU time of this renderer process; several browsers may share one renderer.
+CefRefPtr<CefValue> GetProcessCpuUsage()
+{
+    double cpuTime = 0.0;
+    int pid;
+#if defined(OS_WIN)
+    pid = static_cast<int>(GetCurrentProcessId());
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        auto ticks = [](const FILETIME& time) {
+            return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        };
+        cpuTime = static_cast<double>(ticks(kernel) + ticks(user)) / 1e7;
+    }
+#else
+    pid = static_cast<int>(getpid());
+    timespec time{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) == 0)
+        cpuTime = static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+#endif
+    CefRefPtr<CefDictionaryValue> usage = CefDictionaryValue::Create();
+    usage->SetInt("pid", pid);
+    usage->SetDouble("cpu_time", cpuTime);
+    usage->SetDouble("timestamp", std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    CefRefPtr<CefValue> result = CefValue::Create();
+    result->SetDictionary(usage);
+    return result;
+}
+
+} // namespace
+
 void SimpleRenderProcessHandler::OnBrowserCreated(
         CefRefPtr<CefBrowser> browser, CefRefPtr<CefDictionaryValue> extra_info)
 {
@@ -14,11 +59,23 @@ void SimpleRenderProcessHandler::OnBrowserCreated(
     int id = browser->GetIdentifier();
     auto& state = m_BrowserStates[id];
 
-    if (extra_info->HasKey("JavascriptBindings"))
+    // Created up front so state pushed before the first V8 context is kept
+    state.applicationStateManager = std::make_shared<ApplicationStateManager>();
+
+    ReadBindings(state, extra_info);
+}
+
+void SimpleRenderProcessHandler::ReadBindings(PerBrowserRendererState& state,
+                                              CefRefPtr<CefDictionaryValue> bindings_info)
+{
+    state.javascriptBindings.clear();
+    state.javascriptPythonBindings.clear();
+
+    if (bindings_info->HasKey("JavascriptBindings"))
     {
         const CefRefPtr<CefListValue> bindings =
-                extra_info->GetList("JavascriptBindings");
-        const int size = extra_info->GetInt("JavascriptBindingsSize");
+                bindings_info->GetList("JavascriptBindings");
+        const int size = bindings_info->GetInt("JavascriptBindingsSize");
 
         for (int i = 0; i < size; ++i)
         {
@@ -36,11 +93,11 @@ void SimpleRenderProcessHandler::OnBrowserCreated(
         }
     }
 
-    if (extra_info->HasKey("JavascriptPythonBindings"))
+    if (bindings_info->HasKey("JavascriptPythonBindings"))
     {
         const CefRefPtr<CefListValue> bindings =
-                extra_info->GetList("JavascriptPythonBindings");
-        const int size = extra_info->GetInt("JavascriptPythonBindingsSize");
+                bindings_info->GetList("JavascriptPythonBindings");
+        const int size = bindings_info->GetInt("JavascriptPythonBindingsSize");
 
         for (int i = 0; i < size; ++i)
         {
@@ -85,6 +142,20 @@ PerBrowserRendererState& SimpleRenderProcessHandler::GetState(int browserId)
     return m_BrowserStates[browserId];
 }
 
+void SimpleRenderProcessHandler::SendStateRequestReply(CefRefPtr<CefFrame> frame, int requestId, CefRefPtr<CefValue> result)
+{
+    CefRefPtr<CefProcessMessage> messageReturn =
+            CefProcessMessage::Create("app-state-request-return");
+
+    CefRefPtr<CefListValue> message_args_return =
+            messageReturn->GetArgumentList();
+
+    message_args_return->SetSize(2);
+    message_args_return->SetInt(0, requestId);
+    message_args_return->SetValue(1, result);
+    frame->SendProcessMessage(PID_BROWSER, messageReturn);
+}
+
 void SimpleRenderProcessHandler::OnBrowserDestroyed(CefRefPtr<CefBrowser> browser)
 {
     m_BrowserStates.erase(browser->GetIdentifier());
@@ -102,20 +173,40 @@ void SimpleRenderProcessHandler::OnContextCreated(
     int id = browser->GetIdentifier();
     auto& state = GetState(id);
 
-    state.applicationStateManager = std::make_shared<ApplicationStateManager>();
-    state.appStateV8Handler = new AppStateV8Handler(state.applicationStateManager, browser);
+    // The state store belongs to the browser, not to the page: it is created once and
+    // reattached to every new context, so reloads and navigations keep their state.
+    // Event subscriptions are per page, so each context gets a fresh V8 handler.
+    if (!state.applicationStateManager)
+    {
+        state.applicationStateManager = std::make_shared<ApplicationStateManager>();
+    }
+    CefRefPtr<AppStateV8Handler> appStateV8Handler = new AppStateV8Handler(state.applicationStateManager, browser);
+    if (frame->IsMain() || !state.appStateV8Handler)
+    {
+        state.appStateV8Handler = appStateV8Handler;
+    }
 
     CefRefPtr<CefV8Value> stateObj = CefV8Value::CreateObject(nullptr, nullptr);
 
-    CefRefPtr<CefV8Value> funcRegisterForStateUpdates = CefV8Value::CreateFunction("registerForStateUpdates", state.appStateV8Handler);
-    CefRefPtr<CefV8Value> funcSetState = CefV8Value::CreateFunction("setState", state.appStateV8Handler);
-    CefRefPtr<CefV8Value> funcGetState = CefV8Value::CreateFunction("getState", state.appStateV8Handler);
-    CefRefPtr<CefV8Value> funcRemoveState = CefV8Value::CreateFunction("removeState", state.appStateV8Handler);
+    CefRefPtr<CefV8Value> funcRegisterForStateUpdates = CefV8Value::CreateFunction("registerForStateUpdates", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcSetState = CefV8Value::CreateFunction("setState", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcSetStates = CefV8Value::CreateFunction("setStates", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcGetState = CefV8Value::CreateFunction("getState", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcRemoveState = CefV8Value::CreateFunction("removeState", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcCompareAndSetState = CefV8Value::CreateFunction("compareAndSetState", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcGetVersion = CefV8Value::CreateFunction("getVersion", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcGetStateVersion = CefV8Value::CreateFunction("getStateVersion", appStateV8Handler);
+    CefRefPtr<CefV8Value> funcGetChangesSince = CefV8Value::CreateFunction("getChangesSince", appStateV8Handler);
 
     stateObj->SetValue("registerForStateUpdates", funcRegisterForStateUpdates, V8_PROPERTY_ATTRIBUTE_NONE);
     stateObj->SetValue("setState", funcSetState, V8_PROPERTY_ATTRIBUTE_NONE);
+    stateObj->SetValue("setStates", funcSetStates, V8_PROPERTY_ATTRIBUTE_NONE);
     stateObj->SetValue("getState", funcGetState, V8_PROPERTY_ATTRIBUTE_NONE);
     stateObj->SetValue("removeState", funcRemoveState, V8_PROPERTY_ATTRIBUTE_NONE);
+    stateObj->SetValue("compareAndSetState", funcCompareAndSetState, V8_PROPERTY_ATTRIBUTE_NONE);
+    stateObj->SetValue("getVersion", funcGetVersion, V8_PROPERTY_ATTRIBUTE_NONE);
+    stateObj->SetValue("getStateVersion", funcGetStateVersion, V8_PROPERTY_ATTRIBUTE_NONE);
+    stateObj->SetValue("getChangesSince", funcGetChangesSince, V8_PROPERTY_ATTRIBUTE_NONE);
 
     pytonium_namespace->SetValue("appState", stateObj, V8_PROPERTY_ATTRIBUTE_NONE);
 
@@ -241,7 +332,77 @@ bool SimpleRenderProcessHandler::OnProcessMessageReceived(CefRefPtr<CefBrowser>
             nlohmann::json value = ApplicationStateManagerHelper::cefValueToJson(argList->GetValue(2));
 
             state.applicationStateManager->setState(namespaceName, key, value);
-            state.appStateV8Handler->PushToJavascript(namespaceName, key);
+            if (state.appStateV8Handler) {
+                state.appStateV8Handler->PushToJavascript(namespaceName, key);
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "set-app-state-batch")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 2 && argList->GetType(0) == VTYPE_DICTIONARY && argList->GetType(1) == VTYPE_DICTIONARY) {
+            nlohmann::json updates = ApplicationStateManagerHelper::cefValueToJson(argList->GetValue(0));
+            nlohmann::json removals = ApplicationStateManagerHelper::cefValueToJson(argList->GetValue(1));
+
+            state.applicationStateManager->applyBatch(updates, removals);
+            if (state.appStateV8Handler) {
+                state.appStateV8Handler->PushBatchToJavascript(updates, removals);
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "get-app-state-changes")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 3 && argList->GetType(0) == VTYPE_INT && argList->GetType(1) == VTYPE_STRING) {
+            int requestId = argList->GetInt(0);
+            std::string namespaceName = argList->GetString(1);
+            uint64_t sinceVersion = static_cast<uint64_t>(std::max(0.0, argList->GetDouble(2)));
+
+            auto changes = state.applicationStateManager->getChangesSince(namespaceName, sinceVersion);
+            SendStateRequestReply(frame, requestId, ApplicationStateManagerHelper::jsonToCefValue(changes));
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "get-app-state-version")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 3 && argList->GetType(0) == VTYPE_INT && argList->GetType(1) == VTYPE_STRING && argList->GetType(2) == VTYPE_STRING) {
+            uint64_t version = state.applicationStateManager->getStateVersion(argList->GetString(1), argList->GetString(2));
+            // As double, like the other versions, so it survives beyond int32
+            CefRefPtr<CefValue> result = CefValue::Create();
+            result->SetDouble(static_cast<double>(version));
+            SendStateRequestReply(frame, argList->GetInt(0), result);
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "compare-and-set-app-state")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 5 && argList->GetType(0) == VTYPE_INT && argList->GetType(1) == VTYPE_STRING && argList->GetType(2) == VTYPE_STRING) {
+            int requestId = argList->GetInt(0);
+            std::string namespaceName = argList->GetString(1);
+            std::string key = argList->GetString(2);
+            uint64_t expectedVersion = static_cast<uint64_t>(std::max(0.0, argList->GetDouble(3)));
+            nlohmann::json value = ApplicationStateManagerHelper::cefValueToJson(argList->GetValue(4));
+
+            bool stored = state.applicationStateManager->compareAndSetState(namespaceName, key, expectedVersion, value) != 0;
+            if (stored && state.appStateV8Handler) {
+                state.appStateV8Handler->PushToJavascript(namespaceName, key);
+            }
+
+            CefRefPtr<CefValue> result = CefValue::Create();
+            result->SetBool(stored);
+            SendStateRequestReply(frame, requestId, result);
             return true;
         } else {
             return false;
@@ -250,9 +411,10 @@ bool SimpleRenderProcessHandler::OnProcessMessageReceived(CefRefPtr<CefBrowser>
     else if(message_name == "get-app-state")
     {
         CefRefPtr<CefListValue> argList = message->GetArgumentList();
-        if (argList->GetSize() == 2 ) {
-            std::string namespaceName = argList->GetValue(0)->GetType() == VTYPE_STRING ? argList->GetValue(0)->GetString() : "";
-            std::string key = argList->GetValue(1)->GetType() == VTYPE_STRING ? argList->GetValue(1)->GetString() : "";
+        if (argList->GetSize() == 3 && argList->GetType(0) == VTYPE_INT) {
+            int requestId = argList->GetInt(0);
+            std::string namespaceName = argList->GetValue(1)->GetType() == VTYPE_STRING ? argList->GetValue(1)->GetString() : "";
+            std::string key = argList->GetValue(2)->GetType() == VTYPE_STRING ? argList->GetValue(2)->GetString() : "";
             if(namespaceName.empty() || key.empty())
             {
                 return false;
@@ -266,16 +428,90 @@ bool SimpleRenderProcessHandler::OnProcessMessageReceived(CefRefPtr<CefBrowser>
             CefRefPtr<CefListValue> message_args_return =
                     messageReturn->GetArgumentList();
 
-            message_args_return->SetSize(3);
-            message_args_return->SetString(0, namespaceName);
-            message_args_return->SetString(1, key);
-            message_args_return->SetValue(2, cefState);
+            message_args_return->SetSize(4);
+            message_args_return->SetInt(0, requestId);
+            message_args_return->SetString(1, namespaceName);
+            message_args_return->SetString(2, key);
+            message_args_return->SetValue(3, cefState);
             frame->SendProcessMessage(PID_BROWSER, messageReturn);
             return true;
         } else {
             return false;
         }
     }
+    else if(message_name == "get-renderer-cpu-usage")
+    {
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 1 && argList->GetType(0) == VTYPE_INT) {
+            SendStateRequestReply(frame, argList->GetInt(0), GetProcessCpuUsage());
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "evaluate-javascript")
+    {
+        // The result goes through JSON.stringify, so it arrives in Python as
+        // it would from JSON; undefined and functions become None.
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 2 && argList->GetType(0) == VTYPE_INT && argList->GetType(1) == VTYPE_STRING) {
+            nlohmann::json reply = nlohmann::json::object();
+            CefRefPtr<CefV8Context> context = frame->GetV8Context();
+            if (context && context->Enter()) {
+                CefRefPtr<CefV8Value> returnValue;
+                CefRefPtr<CefV8Exception> exception;
+                if (context->Eval(argList->GetString(1), frame->GetURL(), 0, returnValue, exception)) {
+                    CefRefPtr<CefV8Value> json = context->GetGlobal()->GetValue("JSON");
+                    CefRefPtr<CefV8Value> stringify = json ? json->GetValue("stringify") : nullptr;
+                    CefRefPtr<CefV8Value> text;
+                    if (stringify && stringify->IsFunction()) {
+                        text = stringify->ExecuteFunction(json, {returnValue});
+                    }
+                    if (text && text->IsString()) {
+                        reply["value"] = nlohmann::json::parse(text->GetStringValue().ToString(), nullptr, false);
+                    } else if (stringify && stringify->HasException()) {
+                        reply["error"] = stringify->GetException()->GetMessage().ToString();
+                        stringify->ClearException();
+                    } else {
+                        reply["value"] = nullptr;
+                    }
+                } else {
+                    reply["error"] = exception ? exception->GetMessage().ToString() : "Evaluation failed.";
+                }
+                context->Exit();
+            } else {
+                reply["error"] = "The frame has no JavaScript context.";
+            }
+            SendStateRequestReply(frame, argList->GetInt(0), ApplicationStateManagerHelper::jsonToCefValue(reply));
+            return true;
+        } else {
+            return false;
+        }
+    }
+    else if(message_name == "pdf-inject-data")
+    {
+        // Data of a PDF job: set as window.pytoniumPdfData, announced with an
+        // event, and confirmed so the browser prints afterwards.
+        CefRefPtr<CefListValue> argList = message->GetArgumentList();
+        if (argList->GetSize() == 2 && argList->GetType(0) == VTYPE_INT && argList->GetType(1) == VTYPE_STRING) {
+            std::string code = "window.pytoniumPdfData = " + argList->GetString(1).ToString() + ";\n"
+                               "window.dispatchEvent(new CustomEvent('PytoniumPdfData', {detail: window.pytoniumPdfData}));";
+            bool ok = false;
+            CefRefPtr<CefV8Context> context = frame->GetV8Context();
+            if (context && context->Enter()) {
+                CefRefPtr<CefV8Value> returnValue;
+                CefRefPtr<CefV8Exception> exception;
+                ok = context->Eval(code, frame->GetURL(), 0, returnValue, exception);
+                context->Exit();
+            }
+            CefRefPtr<CefValue> result = CefValue::Create();
+            result->SetBool(ok);
+            SendStateRequestReply(frame, argList->GetInt(0), result);
+            return true;
+        } else {
+            return false;
+        }
+    }
     else if(message_name == "remove-app-state")
     {
         CefRefPtr<CefListValue> argList = message->GetArgumentList();
@@ -30,6 +30,12 @@ private:
 
     PerBrowserRendererState& GetState(int browserId);
 
+    // Replaces the bindings of |state| with those in |bindings_info|, as
+    // PytoniumLibrary::CreateBindingsInfo builds it.
+    static void ReadBindings(PerBrowserRendererState& state, CefRefPtr<CefDictionaryValue> bindings_info);
+
+    static void SendStateRequestReply(CefRefPtr<CefFrame> frame, int requestId, CefRefPtr<CefValue> result);
+
 public:
     /* Static access method. */
     static CefRefPtr<SimpleRenderProcessHandler> getInstance();
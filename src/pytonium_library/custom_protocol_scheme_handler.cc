@@ -2,143 +2,609 @@
 // Created by maxim on 19.10.2022.
 //
 #include "custom_protocol_scheme_handler.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "mime_types.h"
+#include "scheme_route.h"
 #include "file_util.h"
 #include "include/cef_parser.h"
 #include "include/cef_resource_handler.h"
 #include "include/cef_scheme.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
 #include "cef_custom_scheme.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <utility>
 
+namespace {
+
+using SchemeHeaders = std::map<std::string, std::string>;
+
+std::time_t ToTimeT(std::filesystem::file_time_type time) {
+#if defined(_MSC_VER)
+  auto systemTime = std::chrono::clock_cast<std::chrono::system_clock>(time);
+#else
+  auto systemTime = std::chrono::file_clock::to_sys(time);
+#endif
+  return std::chrono::system_clock::to_time_t(
+      std::chrono::time_point_cast<std::chrono::system_clock::duration>(systemTime));
+}
+
+// Formats an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT". Not using
+// strftime, which would follow the process locale.
+std::string FormatHttpDate(std::time_t time) {
+  static const char* const days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  std::tm utc{};
+#if defined(_WIN32)
+  gmtime_s(&utc, &time);
+#else
+  gmtime_r(&time, &utc);
+#endif
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%s, %02d %s %04d %02d:%02d:%02d GMT", days[utc.tm_wday], utc.tm_mday,
+           months[utc.tm_mon], utc.tm_year + 1900, utc.tm_hour, utc.tm_min, utc.tm_sec);
+  return buffer;
+}
+
+std::string Trim(const std::string& text) {
+  size_t begin = text.find_first_not_of(" \t");
+  if (begin == std::string::npos)
+    return {};
+  size_t end = text.find_last_not_of(" \t");
+  return text.substr(begin, end - begin + 1);
+}
+
+// Returns true if the Accept-Encoding header lists |encoding| without q=0.
+bool AcceptsEncoding(const std::string& acceptEncoding, const std::string& encoding) {
+  size_t begin = 0;
+  while (begin <= acceptEncoding.length()) {
+    size_t end = acceptEncoding.find(',', begin);
+    if (end == std::string::npos)
+      end = acceptEncoding.length();
+    std::string item = acceptEncoding.substr(begin, end - begin);
+    size_t params = item.find(';');
+    std::string coding = Trim(item.substr(0, params));
+    if (coding == encoding) {
+      if (params == std::string::npos)
+        return true;
+      std::string quality = Trim(item.substr(params + 1));
+      return !(quality.starts_with("q=0") && quality.find_first_of("123456789", 3) == std::string::npos);
+    }
+    begin = end + 1;
+  }
+  return false;
+}
+
+// Gzip entries of an asset pack stay compressed for clients that accept gzip
+// and are decompressed for all others. Returns false if decompression fails.
+bool SelectPackEncoding(AssetPack::Entry& entry, const std::string& acceptEncoding) {
+  return !entry.Gzip || AcceptsEncoding(acceptEncoding, "gzip") || AssetPack::Decompress(entry);
+}
+
+// Returns true if the If-None-Match header matches |etag|. Uses the weak
+// comparison RFC 9110 prescribes for If-None-Match.
+bool MatchesETag(const std::string& ifNoneMatch, const std::string& etag) {
+  size_t begin = 0;
+  while (begin <= ifNoneMatch.length()) {
+    size_t end = ifNoneMatch.find(',', begin);
+    if (end == std::string::npos)
+      end = ifNoneMatch.length();
+    std::string candidate = Trim(ifNoneMatch.substr(begin, end - begin));
+    if (candidate.starts_with("W/"))
+      candidate = candidate.substr(2);
+    if (candidate == "*" || candidate == etag)
+      return true;
+    begin = end + 1;
+  }
+  return false;
+}
+
+// Collects the in-memory parts of a request body. File uploads are not passed on.
+std::string ReadPostData(CefRefPtr<CefPostData> postData) {
+  std::string body;
+  if (!postData)
+    return body;
+  CefPostData::ElementVector elements;
+  postData->GetElements(elements);
+  for (const auto& element : elements) {
+    if (element->GetType() != PDE_TYPE_BYTES)
+      continue;
+    size_t offset = body.size();
+    body.resize(offset + element->GetBytesCount());
+    element->GetBytes(element->GetBytesCount(), body.data() + offset);
+  }
+  return body;
+}
+
+SchemeRouteRequest BuildRouteRequest(CefRefPtr<CefRequest> request, std::string path) {
+  SchemeRouteRequest routeRequest;
+  routeRequest.Method = request->GetMethod().ToString();
+  routeRequest.Url = request->GetURL().ToString();
+  routeRequest.Path = std::move(path);
+  CefRequest::HeaderMap headers;
+  request->GetHeaderMap(headers);
+  for (const auto& [name, value] : headers)
+    routeRequest.Headers[name.ToString()] = value.ToString();
+  routeRequest.Body = ReadPostData(request->GetPostData());
+  return routeRequest;
+}
+
+} // namespace
+
+// Serves files below a scheme's content root.
+//
+// All file system work happens on the FILE_USER_BLOCKING thread: Open() posts the
+// lookup there and continues the request once the file is open. Files that fit the
+// AssetCache are served from the cached bytes. Larger ones are streamed: Read()
+// posts each chunk read to the file thread and writes straight into CEF's buffer,
+// so only one chunk is in flight at a time and memory use does not depend on the
+// file size.
 class ClientSchemeHandler : public CefResourceHandler {
 public:
-  explicit ClientSchemeHandler(std::string schemeRootFolder, std::string schemeIdent, std::unordered_map<std::string, std::string> mimeTypeMap) :
-  offset_(0), status_(0), contentRootFolder(std::move(schemeRootFolder)), schemeIdentifier(std::move(schemeIdent)), m_MimeTypeMap(std::move(mimeTypeMap)){
+  explicit ClientSchemeHandler(std::string schemeRootFolder, std::string schemeIdent, std::shared_ptr<const MimeTypeTable> mimeTypes, std::string cacheControl, std::shared_ptr<const SchemeHeaders> headers, std::shared_ptr<const AssetPack> pack) :
+  offset_(0), status_(0), file_size_(0), contentRootFolder(std::move(schemeRootFolder)), schemeIdentifier(std::move(schemeIdent)), m_MimeTypes(std::move(mimeTypes)), cache_control_(std::move(cacheControl)), headers_(std::move(headers)), pack_(std::move(pack)){
 
   }
 
-  bool ProcessRequest(CefRefPtr<CefRequest> request,
-                      CefRefPtr<CefCallback> callback) override {
-    CEF_REQUIRE_IO_THREAD();
-
-    bool handled = false;
+  bool Open(CefRefPtr<CefRequest> request,
+            bool &handle_request,
+            CefRefPtr<CefCallback> callback) override {
+    DCHECK(!CefCurrentlyOn(TID_UI) && !CefCurrentlyOn(TID_IO));
 
     std::string url = request->GetURL();
+    range_header_ = request->GetHeaderByName("Range").ToString();
+    accept_encoding_ = request->GetHeaderByName("Accept-Encoding").ToString();
+    if_none_match_ = request->GetHeaderByName("If-None-Match").ToString();
+    if_modified_since_ = request->GetHeaderByName("If-Modified-Since").ToString();
 
     if(url.ends_with("/"))
     {
         url = url.substr(0, url.length() - 1);
     }
 
-    if (url.starts_with(schemeIdentifier + "://")) {
+    if (!url.starts_with(schemeIdentifier + "://")) {
+      // Cancel the request immediately.
+      handle_request = true;
+      return false;
+    }
 
-      std::string filePath = url.substr(schemeIdentifier.length() + 3);
-      size_t sep = filePath.find_last_of('.');
-      if (sep != std::string::npos) {
-        mime_type_ = CefGetMimeType(filePath.substr(sep + 1));
-      }
-      if(mime_type_.empty() && m_MimeTypeMap.contains(filePath.substr(sep + 1)))
-      {
-          mime_type_ = m_MimeTypeMap[filePath.substr(sep + 1)];
-      }
-      if (sep == std::string::npos || mime_type_.empty()) {
-        handled = true;
-        data_ = "Error: Mime type not found!";
-        mime_type_ = "text/html";
-        status_ = 500;
-      } else {
-        // Use std::filesystem::path for cross-platform path handling
-        std::filesystem::path rootPath = std::filesystem::path(contentRootFolder).lexically_normal();
-        std::filesystem::path resolvedPath = (rootPath / filePath).lexically_normal();
-
-        // Path traversal check: resolved path must stay within root
-        std::string rootStr = rootPath.string();
-        std::string resolvedStr = resolvedPath.string();
-
-        if (resolvedStr.find(rootStr) != 0) {
-            // Path escape attempt blocked
-            handled = true;
-            data_ = "Error: Access denied!";
-            mime_type_ = "text/html";
-            status_ = 403;
-        } else if (std::filesystem::exists(resolvedPath)) {
-            // File size limit: 100MB
-            constexpr std::uintmax_t MAX_FILE_SIZE = 100 * 1024 * 1024;
-            auto fileSize = std::filesystem::file_size(resolvedPath);
-            if (fileSize > MAX_FILE_SIZE) {
-                handled = true;
-                data_ = "Error: File too large!";
-                mime_type_ = "text/html";
-                status_ = 413;
-            } else {
-                data_ = file_contents_binary(resolvedPath);
-                handled = true;
-                status_ = 200;
-            }
-        } else {
-            handled = true;
-            data_ = "Error: File not found!";
-            mime_type_ = "text/html";
-            status_ = 500;
-        }
+    std::string filePath = url.substr(schemeIdentifier.length() + 3);
+
+    // Virtual files and Python routes take precedence over the content root.
+    SchemeRouteRegistry& routes = SchemeRouteRegistry::Instance();
+    std::string routePath = SchemeRouteRegistry::NormalizePath(filePath);
+    if (routes.FindVirtualFile(schemeIdentifier, routePath, blob_, mime_type_)) {
+      file_size_ = static_cast<int64_t>(blob_->Size());
+      ApplyRange();
+      handle_request = true;
+      return true;
+    }
+    if (routes.MatchesRoute(schemeIdentifier, routePath)) {
+      route_ = routes.Dispatch(schemeIdentifier, BuildRouteRequest(request, routePath));
+      if (route_) {
+        // Continue once the route handler has sent its headers.
+        handle_request = route_->WaitForHeaders(callback);
+        return true;
       }
     }
 
-    if (handled) {
-      // Indicate that the headers are available.
-      callback->Continue();
+    mime_type_ = m_MimeTypes->Resolve(filePath);
+    if (mime_type_.empty()) {
+      SetError(500, "Error: Mime type not found!");
+      handle_request = true;
       return true;
     }
 
-    return false;
+    if (pack_) {
+      ServeFromPack(filePath);
+      handle_request = true;
+      return true;
+    }
+
+    // The file system lookup may block, continue on the file thread.
+    handle_request = false;
+    CefPostTask(TID_FILE_USER_BLOCKING, base::BindOnce(&ClientSchemeHandler::OpenFile, this, filePath, callback));
+    return true;
   }
 
   void GetResponseHeaders(CefRefPtr<CefResponse> response,
                           int64_t &response_length,
                           CefString &redirectUrl) override {
-    CEF_REQUIRE_IO_THREAD();
-
-    DCHECK(!data_.empty());
+    if (route_) {
+      std::map<std::string, std::string> headers;
+      route_->GetHeaders(status_, mime_type_, headers);
+      response->SetMimeType(mime_type_);
+      response->SetStatus(status_);
+      SetSchemeHeaders(response);
+      for (const auto& [name, value] : headers)
+        response->SetHeaderByName(name, value, true);
+      // The body is streamed by the route handler, its length is unknown.
+      response_length = -1;
+      return;
+    }
 
     response->SetMimeType(mime_type_);
     response->SetStatus(status_);
-    response->SetHeaderByName("Access-Control-Allow-Origin", "null", true);
+    SetSchemeHeaders(response);
+    if (blob_ || streaming_ || status_ == 304) {
+      if (!etag_.empty()) {
+        response->SetHeaderByName("ETag", etag_, true);
+        response->SetHeaderByName("Last-Modified", last_modified_, true);
+      }
+      if (!cache_control_.empty())
+        response->SetHeaderByName("Cache-Control", cache_control_, true);
+      if (!content_encoding_.empty())
+        response->SetHeaderByName("Content-Encoding", content_encoding_, true);
+      if (has_encoded_variant_)
+        response->SetHeaderByName("Vary", "Accept-Encoding", true);
+    }
+    if (blob_ || streaming_)
+      response->SetHeaderByName("Accept-Ranges", "bytes", true);
+    if (status_ == 206) {
+      response->SetHeaderByName("Content-Range",
+                                "bytes " + std::to_string(body_start_) + "-" +
+                                    std::to_string(body_start_ + body_length_ - 1) + "/" +
+                                    std::to_string(file_size_), true);
+    } else if (status_ == 416) {
+      response->SetHeaderByName("Content-Range", "bytes */" + std::to_string(file_size_), true);
+    }
     // Set the resulting response length.
-    response_length = data_.length();
+    response_length = (blob_ || streaming_) ? body_length_ : static_cast<int64_t>(data_.length());
   }
 
-  void Cancel() override { CEF_REQUIRE_IO_THREAD(); }
-
-  bool ReadResponse(void *data_out, int bytes_to_read, int &bytes_read,
-                    CefRefPtr<CefCallback> callback) override {
-    CEF_REQUIRE_IO_THREAD();
+  void Cancel() override {
+    canceled_ = true;
+    if (route_) {
+      route_->Cancel();
+      SchemeRouteRegistry::Instance().ReleaseResponse(route_->GetRequestId());
+    }
+  }
 
-    bool has_data = false;
+  bool Read(void *data_out, int bytes_to_read, int &bytes_read,
+            CefRefPtr<CefResourceReadCallback> callback) override {
     bytes_read = 0;
 
-    if (offset_ < data_.length()) {
-      // Copy the next block of data into the buffer.
-      int transfer_size =
-          std::min(bytes_to_read, static_cast<int>(data_.length() - offset_));
-      memcpy(data_out, data_.c_str() + offset_, transfer_size);
-      offset_ += transfer_size;
+    if (route_)
+      return route_->Read(data_out, bytes_to_read, bytes_read, callback);
+
+    if (blob_) {
+      if (offset_ < static_cast<size_t>(body_length_)) {
+        int transfer_size = static_cast<int>(
+            std::min(static_cast<size_t>(bytes_to_read), static_cast<size_t>(body_length_) - offset_));
+        memcpy(data_out, blob_->Data() + body_start_ + offset_, transfer_size);
+        offset_ += transfer_size;
+        bytes_read = transfer_size;
+        return true;
+      }
+      return false;
+    }
+
+    if (!streaming_) {
+      // Error responses are small and already in memory.
+      if (offset_ < data_.length()) {
+        int transfer_size =
+            std::min(bytes_to_read, static_cast<int>(data_.length() - offset_));
+        memcpy(data_out, data_.c_str() + offset_, transfer_size);
+        offset_ += transfer_size;
+        bytes_read = transfer_size;
+        return true;
+      }
+      return false;
+    }
 
-      bytes_read = transfer_size;
-      has_data = true;
+    if (offset_ >= static_cast<size_t>(body_length_)) {
+      // Response complete.
+      return false;
     }
 
-    return has_data;
+    // Read the next chunk on the file thread, directly into CEF's buffer.
+    CefPostTask(TID_FILE_USER_BLOCKING, base::BindOnce(&ClientSchemeHandler::ReadChunk, this,
+                                                       data_out, bytes_to_read, callback));
+    return true;
   }
 
 private:
+  // Headers every response of the scheme carries. The configured headers may
+  // replace the default Access-Control-Allow-Origin.
+  void SetSchemeHeaders(CefRefPtr<CefResponse> response) {
+    response->SetHeaderByName("Access-Control-Allow-Origin", "null", true);
+    for (const auto& [name, value] : *headers_)
+      response->SetHeaderByName(name, value, true);
+  }
+
+  void SetError(int status, const std::string& message) {
+    data_ = message;
+    mime_type_ = "text/html";
+    status_ = status;
+  }
+
+  // Sets status and body bounds from the request's Range header once the file size
+  // is known. Only a single byte range is supported; multiple ranges and
+  // malformed headers are ignored and answered with the whole file, as RFC 9110
+  // allows.
+  void ApplyRange() {
+    status_ = 200;
+    body_start_ = 0;
+    body_length_ = file_size_;
+
+    switch (ParseRange(range_header_, file_size_, body_start_, body_length_)) {
+      case RangeResult::Satisfiable:
+        status_ = 206;
+        break;
+      case RangeResult::Unsatisfiable:
+        blob_ = nullptr;
+        file_.close();
+        streaming_ = false;
+        SetError(416, "Error: Range not satisfiable!");
+        break;
+      case RangeResult::Ignore:
+        body_start_ = 0;
+        body_length_ = file_size_;
+        break;
+    }
+  }
+
+  enum class RangeResult { Ignore, Satisfiable, Unsatisfiable };
+
+  // Parses "bytes=first-last", "bytes=first-" and "bytes=-suffixLength".
+  static RangeResult ParseRange(const std::string& header, int64_t size, int64_t& start, int64_t& length) {
+    const std::string unit = "bytes=";
+    if (!header.starts_with(unit))
+      return RangeResult::Ignore;
+    std::string spec = header.substr(unit.length());
+    spec.erase(std::remove(spec.begin(), spec.end(), ' '), spec.end());
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos || spec.find(',') != std::string::npos)
+      return RangeResult::Ignore;
+
+    auto parse = [](const std::string& text, int64_t& value) {
+      if (text.empty())
+        return false;
+      auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+      return error == std::errc() && end == text.data() + text.size() && value >= 0;
+    };
+    std::string firstText = spec.substr(0, dash);
+    std::string lastText = spec.substr(dash + 1);
+    int64_t first = 0;
+    int64_t last = 0;
+
+    if (firstText.empty()) {
+      // Suffix range: the last N bytes.
+      if (!parse(lastText, last))
+        return RangeResult::Ignore;
+      if (last == 0 || size == 0)
+        return RangeResult::Unsatisfiable;
+      start = std::max<int64_t>(0, size - last);
+      length = size - start;
+      return RangeResult::Satisfiable;
+    }
+
+    if (!parse(firstText, first))
+      return RangeResult::Ignore;
+    if (lastText.empty()) {
+      last = size - 1;
+    } else if (!parse(lastText, last) || last < first) {
+      return RangeResult::Ignore;
+    }
+    if (first >= size)
+      return RangeResult::Unsatisfiable;
+    last = std::min(last, size - 1);
+    start = first;
+    length = last - first + 1;
+    return RangeResult::Satisfiable;
+  }
+
+  // Picks a precompressed sibling (file.js.br, file.js.gz) if the client accepts
+  // its encoding and the sibling is not older than the file itself. Range
+  // requests always get the identity encoding.
+  std::filesystem::path SelectEncoding(const std::filesystem::path& path) {
+    static const std::pair<const char*, const char*> encodings[] = {{"br", ".br"}, {"gzip", ".gz"}};
+
+    std::error_code ec;
+    auto modified = std::filesystem::last_write_time(path, ec);
+    for (const auto& [encoding, extension] : encodings) {
+      std::filesystem::path sibling = path;
+      sibling += extension;
+      if (!std::filesystem::is_regular_file(sibling, ec))
+        continue;
+      auto siblingModified = std::filesystem::last_write_time(sibling, ec);
+      if (ec || siblingModified < modified)
+        continue;
+      has_encoded_variant_ = true;
+      if (range_header_.empty() && AcceptsEncoding(accept_encoding_, encoding)) {
+        content_encoding_ = encoding;
+        return sibling;
+      }
+    }
+    return path;
+  }
+
+  // Computes a strong ETag from the size and modification time of the served
+  // file, plus the content coding, so each representation has its own tag.
+  bool SetValidators(const std::filesystem::path& path) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec)
+      return false;
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (ec)
+      return false;
+
+    SetValidators(size, static_cast<uint64_t>(modified.time_since_epoch().count()), ToTimeT(modified));
+    served_path_ = path;
+    return true;
+  }
+
+  void SetValidators(uint64_t size, uint64_t modifiedTicks, std::time_t modified) {
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx", static_cast<unsigned long long>(size),
+             static_cast<unsigned long long>(modifiedTicks));
+    etag_ = etag;
+    if (!content_encoding_.empty())
+      etag_ += "-" + content_encoding_;
+    etag_ += "\"";
+    last_modified_ = FormatHttpDate(modified);
+  }
+
+  // Serves a file from the scheme's asset pack. The archive is memory mapped and
+  // indexed, so this needs no file system calls and runs synchronously.
+  void ServeFromPack(std::string filePath) {
+    while (filePath.starts_with("/"))
+      filePath.erase(0, 1);
+
+    AssetPack::Entry entry;
+    if (!pack_->Find(filePath, entry)) {
+      SetError(500, "Error: File not found!");
+      return;
+    }
+    if (entry.Gzip) {
+      // Clients that do not accept gzip get the entry decompressed. Chromium
+      // always sends gzip, so that is only the case for explicit fetch headers.
+      has_encoded_variant_ = true;
+      if (!SelectPackEncoding(entry, accept_encoding_)) {
+        SetError(500, "Error: Corrupt asset pack entry!");
+        return;
+      }
+      if (entry.Gzip) {
+        content_encoding_ = "gzip";
+        range_header_.clear();
+      }
+    }
+
+    SetValidators(entry.OriginalSize, static_cast<uint64_t>(entry.ModifiedTime), static_cast<std::time_t>(entry.ModifiedTime));
+    if (IsNotModified()) {
+      status_ = 304;
+      return;
+    }
+    blob_ = std::move(entry.Data);
+    file_size_ = static_cast<int64_t>(blob_->Size());
+    ApplyRange();
+  }
+
+  // If-None-Match takes precedence over If-Modified-Since. The latter is
+  // compared exactly against Last-Modified, since Chromium echoes the value it
+  // received.
+  bool IsNotModified() const {
+    if (!if_none_match_.empty())
+      return MatchesETag(if_none_match_, etag_);
+    return !if_modified_since_.empty() && if_modified_since_ == last_modified_;
+  }
+
+  void OpenFile(const std::string& filePath, CefRefPtr<CefCallback> callback) {
+    CEF_REQUIRE_FILE_USER_BLOCKING_THREAD();
+
+    if (canceled_) {
+      callback->Cancel();
+      return;
+    }
+
+    // Use std::filesystem::path for cross-platform path handling
+    std::filesystem::path rootPath = std::filesystem::path(contentRootFolder).lexically_normal();
+    std::filesystem::path resolvedPath = (rootPath / filePath).lexically_normal();
+
+    // Path traversal check: resolved path must stay within root
+    std::string rootStr = rootPath.string();
+    std::string resolvedStr = resolvedPath.string();
+
+    std::error_code ec;
+    if (resolvedStr.find(rootStr) != 0) {
+      // Path escape attempt blocked
+      SetError(403, "Error: Access denied!");
+    } else if (!std::filesystem::is_regular_file(resolvedPath, ec)) {
+      SetError(500, "Error: File not found!");
+    } else if (!SetValidators(SelectEncoding(resolvedPath))) {
+      SetError(500, "Error: File could not be read!");
+    } else if (IsNotModified()) {
+      status_ = 304;
+    } else if ((blob_ = AssetCache::Instance().Acquire(served_path_))) {
+      file_size_ = static_cast<int64_t>(blob_->Size());
+      ApplyRange();
+    } else {
+      file_size_ = static_cast<int64_t>(std::filesystem::file_size(served_path_, ec));
+      file_.open(served_path_, std::ios::in | std::ios::binary);
+      if (ec || !file_.is_open()) {
+        file_.close();
+        SetError(500, "Error: File could not be read!");
+      } else {
+        streaming_ = true;
+        ApplyRange();
+        // Only the requested range is read from disk.
+        if (streaming_ && body_start_ > 0)
+          file_.seekg(body_start_);
+      }
+    }
+
+    // Indicate that the headers are available.
+    callback->Continue();
+  }
+
+  void ReadChunk(void *data_out, int bytes_to_read, CefRefPtr<CefResourceReadCallback> callback) {
+    CEF_REQUIRE_FILE_USER_BLOCKING_THREAD();
+
+    if (canceled_) {
+      file_.close();
+      callback->Continue(-1 /* ERR_FAILED */);
+      return;
+    }
+
+    std::streamsize remaining = static_cast<std::streamsize>(body_length_) - static_cast<std::streamsize>(offset_);
+    file_.read(static_cast<char *>(data_out), std::min(static_cast<std::streamsize>(bytes_to_read), remaining));
+    std::streamsize transferred = file_.gcount();
+    if (transferred <= 0) {
+      // Unexpected end of file, e.g. the file was truncated while streaming.
+      file_.close();
+      callback->Continue(transferred < 0 ? -1 : 0);
+      return;
+    }
+
+    offset_ += static_cast<size_t>(transferred);
+    if (offset_ >= static_cast<size_t>(body_length_)) {
+      file_.close();
+    }
+    callback->Continue(static_cast<int>(transferred));
+  }
+
   std::string data_;
   std::string mime_type_;
+  std::shared_ptr<const AssetBlob> blob_;
+  // Set when a Python route answers the request.
+  CefRefPtr<SchemeRouteResponse> route_;
   size_t offset_;
   int status_;
+  std::ifstream file_;
+  int64_t file_size_;
+  // Bounds of the served byte range within the file.
+  int64_t body_start_ = 0;
+  int64_t body_length_ = 0;
+  std::string range_header_;
+  std::string accept_encoding_;
+  std::string if_none_match_;
+  std::string if_modified_since_;
+  std::filesystem::path served_path_;
+  std::string content_encoding_;
+  bool has_encoded_variant_ = false;
+  std::string etag_;
+  std::string last_modified_;
+  bool streaming_ = false;
+  std::atomic<bool> canceled_{false};
   std::string contentRootFolder;
     std::string schemeIdentifier;
-    std::unordered_map<std::string, std::string> m_MimeTypeMap;
+    std::shared_ptr<const MimeTypeTable> m_MimeTypes;
+  std::string cache_control_;
+  std::shared_ptr<const SchemeHeaders> headers_;
+  // Set when the scheme serves an asset pack instead of a folder.
+  std::shared_ptr<const AssetPack> pack_;
   IMPLEMENT_REFCOUNTING(ClientSchemeHandler);
   DISALLOW_COPY_AND_ASSIGN(ClientSchemeHandler);
 };
@@ -146,10 +612,18 @@ private:
 // Implementation of the factory for creating scheme handlers.
 class ClientSchemeHandlerFactory : public CefSchemeHandlerFactory {
 public:
-  explicit ClientSchemeHandlerFactory(const CefCustomScheme& customScheme, std::unordered_map<std::string, std::string> mimeTypeMap)
+  explicit ClientSchemeHandlerFactory(const CefCustomScheme& customScheme, std::shared_ptr<const MimeTypeTable> mimeTypes)
   {
       m_SchemeContentRootFolder = customScheme.SchemeRootContent;
-      m_MimeTypeMap = std::move(mimeTypeMap);
+      m_CacheControl = customScheme.CacheControl;
+      m_Headers = std::make_shared<const SchemeHeaders>(customScheme.ResponseHeaders);
+      m_MimeTypes = std::move(mimeTypes);
+      if (AssetPack::IsAssetPack(m_SchemeContentRootFolder)) {
+          m_Pack = AssetPack::Open(m_SchemeContentRootFolder);
+          if (!m_Pack)
+              std::cerr << "Invalid asset pack for scheme " << customScheme.SchemeIdentifier << ": "
+                        << m_SchemeContentRootFolder << std::endl;
+      }
   }
 
   // Return a new scheme handler instance to handle the request.
@@ -159,20 +633,41 @@ public:
                                        CefRefPtr<CefRequest> request) override {
     CEF_REQUIRE_IO_THREAD();
 
-    return new ClientSchemeHandler(m_SchemeContentRootFolder, scheme_name, m_MimeTypeMap);
+    return new ClientSchemeHandler(m_SchemeContentRootFolder, scheme_name, m_MimeTypes, m_CacheControl, m_Headers, m_Pack);
   }
 
 private:
-    std::unordered_map<std::string, std::string> m_MimeTypeMap;
+    // Shared with every handler, so creating a handler does not copy the table.
+    std::shared_ptr<const MimeTypeTable> m_MimeTypes;
     std::string m_SchemeContentRootFolder;
+    std::string m_CacheControl;
+    std::shared_ptr<const SchemeHeaders> m_Headers;
+    std::shared_ptr<const AssetPack> m_Pack;
   IMPLEMENT_REFCOUNTING(ClientSchemeHandlerFactory);
   DISALLOW_COPY_AND_ASSIGN(ClientSchemeHandlerFactory);
 };
 
+CefRefPtr<CefSchemeHandlerFactory> CreateSchemeHandlerFactory(const CefCustomScheme& customScheme, std::shared_ptr<const MimeTypeTable> mimeTypes) {
+    return new ClientSchemeHandlerFactory(customScheme, std::move(mimeTypes));
+}
+
 void RegisterSchemeHandlerFactory(const std::vector<CefCustomScheme>& customSchemes, const std::unordered_map<std::string, std::string>& mimeTypeMap) {
+    // Built once; all schemes and handlers share it.
+    auto mimeTypes = std::make_shared<const MimeTypeTable>(mimeTypeMap);
     for (const auto& scheme: customSchemes)
     {
-        CefRegisterSchemeHandlerFactory(scheme.SchemeIdentifier, "", new ClientSchemeHandlerFactory(scheme, mimeTypeMap));
+        CefRegisterSchemeHandlerFactory(scheme.SchemeIdentifier, "", CreateSchemeHandlerFactory(scheme, mimeTypes));
     }
 
 }
+
+bool ReadAssetPackEntry(const std::string& archive, const std::string& path, const std::string& acceptEncoding,
+                        std::string& body, std::string& contentEncoding) {
+  std::shared_ptr<const AssetPack> pack = AssetPack::Open(archive);
+  AssetPack::Entry entry;
+  if (!pack || !pack->Find(path, entry) || !SelectPackEncoding(entry, acceptEncoding))
+    return false;
+  body.assign(entry.Data->Data(), entry.Data->Size());
+  contentEncoding = entry.Gzip ? "gzip" : "";
+  return true;
+}
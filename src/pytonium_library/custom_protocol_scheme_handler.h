@@ -4,9 +4,22 @@
 
 #ifndef CEF_WRAPPER_CUSTOM_PROTOCOL_SCHEME_HANDLER_H
 #define CEF_WRAPPER_CUSTOM_PROTOCOL_SCHEME_HANDLER_H
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
+#include "include/cef_scheme.h"
 #include "cef_custom_scheme.h"
+#include "mime_types.h"
+
+CefRefPtr<CefSchemeHandlerFactory> CreateSchemeHandlerFactory(const CefCustomScheme& customScheme, std::shared_ptr<const MimeTypeTable> mimeTypes);
 void RegisterSchemeHandlerFactory(const std::vector<CefCustomScheme>& customSchemes, const std::unordered_map<std::string, std::string>& mimeTypeMap);
 
+// Reads |path| from the asset pack |archive| as a custom scheme serves it to a
+// request with the given Accept-Encoding header. |contentEncoding| is set to
+// "gzip" if |body| is sent compressed. Returns false if the archive or the
+// entry cannot be read.
+bool ReadAssetPackEntry(const std::string& archive, const std::string& path, const std::string& acceptEncoding,
+                        std::string& body, std::string& contentEncoding);
+
 #endif // CEF_WRAPPER_CUSTOM_PROTOCOL_SCHEME_HANDLER_H
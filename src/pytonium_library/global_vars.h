@@ -4,6 +4,10 @@
 #include <atomic>
 
 inline std::atomic<int> g_BrowserCount{0};
+// Pooled browsers (BrowserPool) not adopted yet, not part of g_BrowserCount.
+inline std::atomic<int> g_PooledBrowserCount{0};
+// Hidden browsers of PdfRenderPools, from CreateBrowser until OnBeforeClose.
+inline std::atomic<int> g_PdfBrowserCount{0};
 inline bool g_CefInitialized = false;
 
 #endif // GLOBAL_VARS_H
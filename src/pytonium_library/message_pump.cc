@@ -0,0 +1,261 @@
+#include "message_pump.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "include/cef_app.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int64_t kNotScheduled = std::numeric_limits<int64_t>::max();
+
+// cefclient's kMaxTimerDelay.
+const int64_t kDefaultMaxDelayMs = 1000 / 30;
+
+#if defined(_WIN32) || defined(__APPLE__)
+const int64_t kNativeWindowMaxDelayMs = kDefaultMaxDelayMs;
+#else
+// Native window input waits for the next work on Linux; keep it within a frame.
+const int64_t kNativeWindowMaxDelayMs = 1000 / 60;
+#endif
+
+} // namespace
+
+MessagePump& MessagePump::Get()
+{
+    static MessagePump instance;
+    return instance;
+}
+
+MessagePump::MessagePump()
+    // Due right away: the first wait must not block before CEF scheduled anything.
+    : m_DueUs(0), m_MaxDelayMs(kNativeWindowMaxDelayMs)
+{
+#if defined(_WIN32)
+    // Auto-reset; MsgWaitForMultipleObjectsEx consumes it.
+    m_Event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#else
+    int fds[2];
+    if (pipe(fds) == 0)
+    {
+        for (int fd : fds)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        m_ReadFd = fds[0];
+        m_WriteFd = fds[1];
+    }
+#endif
+}
+
+MessagePump::~MessagePump()
+{
+#if defined(_WIN32)
+    if (m_Event)
+        CloseHandle(m_Event);
+#else
+    if (m_ReadFd >= 0)
+    {
+        close(m_ReadFd);
+        close(m_WriteFd);
+    }
+#endif
+}
+
+int64_t MessagePump::NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MessagePump::ScheduleWork(int64_t delayMs)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.Scheduled++;
+    if (!m_Enabled)
+        return;
+    int64_t dueUs = NowUs() + std::clamp<int64_t>(delayMs, 0, m_MaxDelayMs) * 1000;
+    if (dueUs >= m_DueUs)
+        return;
+    m_DueUs = dueUs;
+    Signal();
+    m_Wakeup.notify_all();
+}
+
+void MessagePump::DoWork()
+{
+    if (m_InWork)
+    {
+        // Called from a callback of CefDoMessageLoopWork, which must not be
+        // re-entered; the work continues on the next call.
+        ScheduleWork(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Enabled)
+            return;
+        m_DueUs = kNotScheduled;
+        ClearSignal();
+        m_Stats.Work++;
+    }
+    m_InWork = true;
+    CefDoMessageLoopWork();
+    m_InWork = false;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_DueUs == kNotScheduled && m_Enabled)
+        m_DueUs = NowUs() + m_MaxDelayMs * 1000;
+}
+
+bool MessagePump::WaitForWork(int64_t timeoutMs)
+{
+    const int64_t deadlineUs = timeoutMs < 0 ? kNotScheduled : NowUs() + timeoutMs * 1000;
+#if defined(_WIN32)
+    for (;;)
+    {
+        int64_t nowUs = NowUs();
+        int64_t wakeUs;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_DueUs <= nowUs)
+            {
+                m_Stats.Wakeups++;
+                return true;
+            }
+            if (deadlineUs <= nowUs)
+            {
+                m_Stats.Timeouts++;
+                return false;
+            }
+            wakeUs = std::min(m_DueUs, deadlineUs);
+        }
+        DWORD waitMs = wakeUs == kNotScheduled ? INFINITE : static_cast<DWORD>((wakeUs - nowUs + 999) / 1000);
+        // Window messages are handled by CefDoMessageLoopWork, but do not
+        // schedule work by themselves.
+        if (MsgWaitForMultipleObjectsEx(1, &m_Event, waitMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_OBJECT_0 + 1)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.Wakeups++;
+            return true;
+        }
+    }
+#else
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;)
+    {
+        int64_t nowUs = NowUs();
+        if (m_DueUs <= nowUs)
+        {
+            m_Stats.Wakeups++;
+            return true;
+        }
+        if (deadlineUs <= nowUs)
+        {
+            m_Stats.Timeouts++;
+            return false;
+        }
+        int64_t wakeUs = std::min(m_DueUs, deadlineUs);
+        if (wakeUs == kNotScheduled)
+            m_Wakeup.wait(lock);
+        else
+            m_Wakeup.wait_for(lock, std::chrono::microseconds(wakeUs - nowUs));
+    }
+#endif
+}
+
+int64_t MessagePump::GetDelayMs()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ClearSignal();
+    if (m_DueUs == kNotScheduled)
+        return m_MaxDelayMs;
+    return std::max<int64_t>(0, (m_DueUs - NowUs() + 999) / 1000);
+}
+
+int MessagePump::GetWakeupFd()
+{
+#if defined(_WIN32)
+    return -1;
+#else
+    return m_ReadFd;
+#endif
+}
+
+void MessagePump::SetEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Enabled = enabled;
+    m_DueUs = enabled ? 0 : kNotScheduled;
+    ClearSignal();
+    m_Wakeup.notify_all();
+}
+
+void MessagePump::SetMaxDelayMs(int64_t delayMs)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MaxDelaySet = true;
+    m_MaxDelayMs = std::max<int64_t>(1, delayMs);
+    if (!m_Enabled)
+        return;
+    int64_t dueUs = NowUs() + m_MaxDelayMs * 1000;
+    if (dueUs < m_DueUs)
+    {
+        m_DueUs = dueUs;
+        m_Wakeup.notify_all();
+    }
+}
+
+int64_t MessagePump::GetMaxDelayMs()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_MaxDelayMs;
+}
+
+void MessagePump::SetNativeWindows(bool nativeWindows)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_MaxDelaySet)
+        m_MaxDelayMs = nativeWindows ? kNativeWindowMaxDelayMs : kDefaultMaxDelayMs;
+}
+
+MessagePumpStats MessagePump::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void MessagePump::Signal()
+{
+#if defined(_WIN32)
+    if (m_Event)
+        SetEvent(m_Event);
+#else
+    // One pending byte is enough; the pipe never fills up.
+    if (m_Signaled || m_WriteFd < 0)
+        return;
+    char byte = 1;
+    m_Signaled = write(m_WriteFd, &byte, 1) == 1;
+#endif
+}
+
+void MessagePump::ClearSignal()
+{
+#if !defined(_WIN32)
+    if (!m_Signaled)
+        return;
+    char buffer[16];
+    while (read(m_ReadFd, buffer, sizeof(buffer)) > 0)
+    {
+    }
+    m_Signaled = false;
+#endif
+}
@@ -0,0 +1,94 @@
+#ifndef PYTONIUM_MESSAGE_PUMP_H
+#define PYTONIUM_MESSAGE_PUMP_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+struct MessagePumpStats
+{
+    // OnScheduleMessagePumpWork calls.
+    uint64_t Scheduled = 0;
+    // CefDoMessageLoopWork calls.
+    uint64_t Work = 0;
+    // Waits that ended because work was scheduled or became due, and waits
+    // that ran into their timeout.
+    uint64_t Wakeups = 0;
+    uint64_t Timeouts = 0;
+};
+
+// Schedules CefDoMessageLoopWork for CEF's external message pump instead of
+// calling it at a fixed rate. CEF reports through OnScheduleMessagePumpWork
+// when it needs the next call; waiting threads are woken exactly then.
+//
+// Like cefclient's MainMessageLoopExternalPump, the work is also done at
+// least every GetMaxDelayMs milliseconds, for work CEF does not announce
+// (and, on Linux, for native window input, which cannot wake the wait: the
+// X11 connection belongs to Chromium). On Windows, waits also end when the
+// thread receives window messages.
+class MessagePump
+{
+public:
+    static MessagePump& Get();
+
+    // Any thread. |delayMs| <= 0 means the work is due now.
+    void ScheduleWork(int64_t delayMs);
+
+    // UI thread. Runs CefDoMessageLoopWork and schedules the next call.
+    void DoWork();
+
+    // Blocks until work is due, at most |timeoutMs| (negative for no timeout).
+    // Returns true if work is due.
+    bool WaitForWork(int64_t timeoutMs);
+
+    // Milliseconds until the next work is due; 0 if it is due now. Also
+    // consumes the wakeup fd's signal.
+    int64_t GetDelayMs();
+
+    // Becomes readable when work is scheduled sooner than before, for event
+    // loops that wait on file descriptors: call GetDelayMs and DoWork once the
+    // delay passed. -1 on Windows.
+    int GetWakeupFd();
+
+    // Disabled while CEF runs its own UI thread (background-thread mode):
+    // DoWork does nothing and no work becomes due.
+    void SetEnabled(bool enabled);
+
+    void SetMaxDelayMs(int64_t delayMs);
+    int64_t GetMaxDelayMs();
+
+    // Until SetMaxDelayMs is called, the max delay follows whether native
+    // windows get input: on Linux they do not wake the wait, so it is one 60 Hz
+    // frame then instead of cefclient's 33 ms.
+    void SetNativeWindows(bool nativeWindows);
+
+    MessagePumpStats GetStats();
+
+private:
+    MessagePump();
+    ~MessagePump();
+
+    static int64_t NowUs();
+    void Signal();
+    void ClearSignal();
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wakeup;
+    int64_t m_DueUs;
+    int64_t m_MaxDelayMs;
+    bool m_MaxDelaySet = false;
+    bool m_Enabled = true;
+    bool m_Signaled = false;
+    // UI thread only.
+    bool m_InWork = false;
+    MessagePumpStats m_Stats;
+
+#if defined(_WIN32)
+    void* m_Event = nullptr;
+#else
+    int m_ReadFd = -1;
+    int m_WriteFd = -1;
+#endif
+};
+
+#endif // PYTONIUM_MESSAGE_PUMP_H
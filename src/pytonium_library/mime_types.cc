@@ -0,0 +1,185 @@
+#include "mime_types.h"
+
+#include <array>
+#include <cstdint>
+
+#include "include/cef_parser.h"
+
+namespace {
+
+struct MimeTypeEntry
+{
+    std::string_view Extension;
+    std::string_view MimeType;
+};
+
+constexpr MimeTypeEntry BuiltinMimeTypes[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"cjs", "text/javascript"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"xml", "application/xml"},
+    {"txt", "text/plain"},
+    {"md", "text/markdown"},
+    {"csv", "text/csv"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"bin", "application/octet-stream"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"svg", "image/svg+xml"},
+    {"ico", "image/x-icon"},
+    {"bmp", "image/bmp"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"mp3", "audio/mpeg"},
+    {"wav", "audio/wav"},
+    {"ogg", "audio/ogg"},
+    {"oga", "audio/ogg"},
+    {"flac", "audio/flac"},
+    {"m4a", "audio/mp4"},
+    {"aac", "audio/aac"},
+    {"opus", "audio/opus"},
+    {"mp4", "video/mp4"},
+    {"m4v", "video/mp4"},
+    {"webm", "video/webm"},
+    {"ogv", "video/ogg"},
+    {"mov", "video/quicktime"},
+    {"glb", "model/gltf-binary"},
+    {"gltf", "model/gltf+json"},
+    {"obj", "model/obj"},
+    {"stl", "model/stl"},
+    {"babylon", "application/json"},
+    {"env", "application/octet-stream"},
+    {"ktx", "image/ktx"},
+    {"ktx2", "image/ktx2"},
+    {"hdr", "image/vnd.radiance"},
+    {"dds", "image/vnd-ms.dds"},
+    {"vtt", "text/vtt"},
+};
+
+constexpr size_t BuiltinCount = std::size(BuiltinMimeTypes);
+// Power of two, about eight slots per entry, so a collision free seed is found
+// after a few dozen attempts.
+constexpr size_t SlotCount = 512;
+constexpr uint8_t EmptySlot = 0xFF;
+static_assert(BuiltinCount < EmptySlot);
+
+constexpr uint32_t Fnv1a(std::string_view data, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct PerfectHash
+{
+    uint32_t Seed = 0;
+    std::array<uint8_t, SlotCount> Slots{};
+};
+
+constexpr PerfectHash BuildPerfectHash()
+{
+    for (uint32_t seed = 0;; seed++)
+    {
+        PerfectHash hash;
+        hash.Seed = seed;
+        hash.Slots.fill(EmptySlot);
+        bool collision = false;
+        for (size_t i = 0; i < BuiltinCount && !collision; i++)
+        {
+            uint8_t& slot = hash.Slots[Fnv1a(BuiltinMimeTypes[i].Extension, seed) % SlotCount];
+            collision = slot != EmptySlot;
+            slot = static_cast<uint8_t>(i);
+        }
+        if (!collision)
+            return hash;
+    }
+}
+
+constexpr PerfectHash BuiltinIndex = BuildPerfectHash();
+
+std::string ToLower(std::string_view text)
+{
+    std::string lower(text);
+    for (char& c : lower)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    return lower;
+}
+
+std::string NormalizeExtension(std::string_view extension)
+{
+    if (extension.starts_with("."))
+        extension.remove_prefix(1);
+    return ToLower(extension);
+}
+
+} // namespace
+
+MimeTypeTable::MimeTypeTable(const std::unordered_map<std::string, std::string>& userMappings)
+{
+    for (const auto& [extension, mimeType] : userMappings)
+        m_UserMappings[NormalizeExtension(extension)] = mimeType;
+}
+
+std::string_view MimeTypeTable::FindBuiltin(std::string_view extension)
+{
+    uint8_t index = BuiltinIndex.Slots[Fnv1a(extension, BuiltinIndex.Seed) % SlotCount];
+    if (index == EmptySlot || BuiltinMimeTypes[index].Extension != extension)
+        return {};
+    return BuiltinMimeTypes[index].MimeType;
+}
+
+std::string_view MimeTypeTable::ExtensionOf(std::string_view path)
+{
+    path = path.substr(0, path.find_first_of("?#"));
+    size_t dot = path.find_last_of("./");
+    if (dot == std::string_view::npos || path[dot] != '.')
+        return {};
+    return path.substr(dot + 1);
+}
+
+std::string_view MimeTypeTable::Find(std::string_view extension) const
+{
+    std::string lower = ToLower(extension);
+    if (!m_UserMappings.empty())
+    {
+        auto it = m_UserMappings.find(lower);
+        if (it != m_UserMappings.end())
+            return it->second;
+    }
+    return FindBuiltin(lower);
+}
+
+std::string MimeTypeTable::Resolve(std::string_view path) const
+{
+    std::string_view extension = ExtensionOf(path);
+    if (extension.empty())
+        return {};
+    std::string_view mimeType = Find(extension);
+    if (!mimeType.empty())
+        return std::string(mimeType);
+    return CefGetMimeType(std::string(extension)).ToString();
+}
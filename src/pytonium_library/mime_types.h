@@ -0,0 +1,36 @@
+#ifndef PYTONIUM_MIME_TYPES_H
+#define PYTONIUM_MIME_TYPES_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Immutable extension to MIME type table, built once when the custom schemes are
+// registered and shared by all scheme handlers.
+//
+// Lookup order: user mappings (add_mime_type_mapping), the built-in table, and
+// finally CefGetMimeType. The built-in table is indexed by a perfect hash that
+// is computed at compile time, so a lookup is one hash and one compare.
+class MimeTypeTable
+{
+public:
+    // Extensions may be given with or without leading dot and in any case.
+    explicit MimeTypeTable(const std::unordered_map<std::string, std::string>& userMappings = {});
+
+    // Returns the MIME type for the extension of |path| (ignoring query and
+    // fragment), or an empty string if the type is unknown.
+    std::string Resolve(std::string_view path) const;
+
+    // Looks up an extension without dot, user mappings first. Does not consult CEF.
+    std::string_view Find(std::string_view extension) const;
+
+    // Looks up a lower case extension in the built-in table.
+    static std::string_view FindBuiltin(std::string_view extension);
+
+    static std::string_view ExtensionOf(std::string_view path);
+
+private:
+    std::unordered_map<std::string, std::string> m_UserMappings;
+};
+
+#endif // PYTONIUM_MIME_TYPES_H
@@ -0,0 +1,90 @@
+#ifndef PYTONIUM_MPSC_QUEUE_H
+#define PYTONIUM_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free multi-producer single-consumer queue (Dmitry Vyukov's
+// intrusive MPSC node queue). Push is wait-free: one exchange and one store.
+// Pop must only be called by one thread at a time.
+//
+// A producer that was preempted between the two steps of Push hides the
+// values pushed after it until it continues; Pop then returns false although
+// the queue is not empty, and the consumer retries later.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : m_Head(&m_Stub), m_Tail(&m_Stub) {}
+
+    ~MpscQueue()
+    {
+        T value;
+        while (Pop(value))
+        {
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread.
+    void Push(T value)
+    {
+        PushNode(new Node(std::move(value)));
+    }
+
+    // Consumer thread only. Moves the oldest value into |value|; returns false
+    // if there is none (yet).
+    bool Pop(T& value)
+    {
+        Node* tail = m_Tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_Stub)
+        {
+            if (!next)
+                return false;
+            m_Tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (!next)
+        {
+            if (tail != m_Head.load(std::memory_order_acquire))
+                return false;
+            // |tail| is the last node; put the stub behind it so it can go.
+            PushNode(&m_Stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return false;
+        }
+        m_Tail = next;
+        value = std::move(tail->value);
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    void PushNode(Node* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* previous = m_Head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    Node m_Stub;
+    // Producers swap themselves in at the head; the consumer walks from the tail.
+    alignas(64) std::atomic<Node*> m_Head;
+    alignas(64) Node* m_Tail;
+};
+
+#endif // PYTONIUM_MPSC_QUEUE_H
@@ -0,0 +1,538 @@
+#include "osr_frame_encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#endif
+
+namespace {
+
+int64_t NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FILE* OpenPipe(const std::string& command)
+{
+#if defined(_WIN32)
+    return _popen(command.c_str(), "wb");
+#else
+    return popen(command.c_str(), "w");
+#endif
+}
+
+int ClosePipe(FILE* pipe)
+{
+#if defined(_WIN32)
+    return _pclose(pipe);
+#else
+    return pclose(pipe);
+#endif
+}
+
+constexpr std::array<uint32_t, 256> MakeCrcTable()
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CrcTable = MakeCrcTable();
+
+uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = CrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t Adler32(const uint8_t* data, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0)
+    {
+        // Largest block whose sums cannot overflow before the modulo.
+        size_t block = std::min<size_t>(size, 5552);
+        size -= block;
+        for (size_t i = 0; i < block; i++)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.insert(out.end(), {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                           static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)});
+}
+
+void AppendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+{
+    AppendBigEndian(out, static_cast<uint32_t>(size));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    AppendBigEndian(out, Crc32(0, out.data() + typeOffset, size + 4));
+}
+
+uint8_t ClampByte(int value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+// Full range BT.601 4:2:0. The premultiplied colors are the page composited
+// over black, which is what a video without alpha shows.
+void ConvertBgraToI420(const uint8_t* bgra, int width, int height, uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane)
+{
+    const int chromaWidth = (width + 1) / 2;
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = bgra + static_cast<size_t>(y) * width * 4;
+        uint8_t* yRow = yPlane + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t* px = row + x * 4;
+            yRow[x] = static_cast<uint8_t>((77 * px[2] + 150 * px[1] + 29 * px[0] + 128) >> 8);
+        }
+    }
+    for (int cy = 0; cy < (height + 1) / 2; cy++)
+    {
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int y = cy * 2; y < std::min(cy * 2 + 2, height); y++)
+            {
+                for (int x = cx * 2; x < std::min(cx * 2 + 2, width); x++)
+                {
+                    const uint8_t* px = bgra + (static_cast<size_t>(y) * width + x) * 4;
+                    b += px[0];
+                    g += px[1];
+                    r += px[2];
+                    count++;
+                }
+            }
+            r = (r + count / 2) / count;
+            g = (g + count / 2) / count;
+            b = (b + count / 2) / count;
+            size_t index = static_cast<size_t>(cy) * chromaWidth + cx;
+            uPlane[index] = ClampByte(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+            vPlane[index] = ClampByte(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+} // namespace
+
+// Output of the encoder thread. Open runs on the thread that starts the
+// encoder, so errors are reported to the caller; everything else runs on the
+// encoder thread.
+class FrameWriter
+{
+public:
+    virtual ~FrameWriter() = default;
+    virtual bool Open() = 0;
+    // False if the frame cannot be part of the output, e.g. another size.
+    virtual bool Accepts(int width, int height) const { return true; }
+    virtual bool WriteFrame(const uint8_t* bgra, int width, int height) = 0;
+    // Writes the previous frame again.
+    virtual bool RepeatFrame() { return true; }
+    virtual bool Close() = 0;
+
+    uint64_t BytesWritten = 0;
+};
+
+namespace {
+
+// Y4M or raw frames, to a file or the stdin of a process.
+class StreamWriter : public FrameWriter
+{
+public:
+    explicit StreamWriter(const FrameEncoderSettings& settings) : m_Settings(settings) {}
+
+    ~StreamWriter() override { Close(); }
+
+    bool Open() override
+    {
+        m_File = m_Settings.Pipe ? OpenPipe(m_Settings.Target) : std::fopen(m_Settings.Target.c_str(), "wb");
+        if (!m_File)
+        {
+            std::cerr << "Frame encoder: cannot open " << m_Settings.Target << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Accepts(int width, int height) const override
+    {
+        return m_Width == 0 || (width == m_Width && height == m_Height);
+    }
+
+    bool WriteFrame(const uint8_t* bgra, int width, int height) override
+    {
+        if (m_Width == 0)
+        {
+            m_Width = width;
+            m_Height = height;
+            if (m_Settings.Format == FRAME_ENCODER_Y4M)
+            {
+                char header[128];
+                int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                                           width, height, m_Settings.FrameRate);
+                if (!WriteBytes(reinterpret_cast<const uint8_t*>(header), static_cast<size_t>(length)))
+                    return false;
+            }
+        }
+
+        if (m_Settings.Format == FRAME_ENCODER_Y4M)
+        {
+            static const char frameHeader[] = "FRAME\n";
+            const size_t headerSize = sizeof(frameHeader) - 1;
+            size_t lumaSize = static_cast<size_t>(width) * height;
+            size_t chromaSize = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+            m_Frame.resize(headerSize + lumaSize + chromaSize * 2);
+            std::memcpy(m_Frame.data(), frameHeader, headerSize);
+            uint8_t* planes = m_Frame.data() + headerSize;
+            ConvertBgraToI420(bgra, width, height, planes, planes + lumaSize, planes + lumaSize + chromaSize);
+        }
+        else
+        {
+            int stride = width * PixelFormatBytes(m_Settings.RawFormat);
+            m_Frame.resize(static_cast<size_t>(stride) * height);
+            ConvertPixels(bgra, width * 4, PIXEL_FORMAT_BGRA, 0, 0, width, height,
+                          m_Frame.data(), stride, m_Settings.RawFormat);
+        }
+        return WriteBytes(m_Frame.data(), m_Frame.size());
+    }
+
+    bool RepeatFrame() override
+    {
+        return m_Frame.empty() || WriteBytes(m_Frame.data(), m_Frame.size());
+    }
+
+    bool Close() override
+    {
+        if (!m_File)
+            return true;
+        int result = m_Settings.Pipe ? ClosePipe(m_File) : std::fclose(m_File);
+        m_File = nullptr;
+        return result == 0;
+    }
+
+private:
+    bool WriteBytes(const uint8_t* data, size_t size)
+    {
+        if (std::fwrite(data, 1, size, m_File) != size)
+            return false;
+        BytesWritten += size;
+        return true;
+    }
+
+    const FrameEncoderSettings& m_Settings;
+    FILE* m_File = nullptr;
+    int m_Width = 0;
+    int m_Height = 0;
+    // The last frame as written, for repeats.
+    std::vector<uint8_t> m_Frame;
+};
+
+// Uncompressed PNGs: deflate "stored" blocks keep up with 60 fps at any size,
+// the files can be compressed later.
+class PngSequenceWriter : public FrameWriter
+{
+public:
+    explicit PngSequenceWriter(const FrameEncoderSettings& settings) : m_Directory(settings.Target) {}
+
+    bool Open() override
+    {
+        std::error_code error;
+        std::filesystem::create_directories(m_Directory, error);
+        if (!std::filesystem::is_directory(m_Directory, error))
+        {
+            std::cerr << "Frame encoder: cannot create " << m_Directory << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool WriteFrame(const uint8_t* bgra, int width, int height) override
+    {
+        // Scanlines of filter type 0 followed by straight alpha RGBA.
+        size_t rowSize = static_cast<size_t>(width) * 4 + 1;
+        m_Scanlines.resize(rowSize * height);
+        for (int y = 0; y < height; y++)
+        {
+            m_Scanlines[y * rowSize] = 0;
+            ConvertPixels(bgra + static_cast<size_t>(y) * width * 4, width * 4, PIXEL_FORMAT_BGRA, 0, 0, width, 1,
+                          m_Scanlines.data() + y * rowSize + 1, width * 4, PIXEL_FORMAT_RGBA_STRAIGHT);
+        }
+
+        m_Deflate.clear();
+        m_Deflate.insert(m_Deflate.end(), {0x78, 0x01});
+        for (size_t offset = 0; offset < m_Scanlines.size() || offset == 0;)
+        {
+            size_t block = std::min<size_t>(m_Scanlines.size() - offset, 65535);
+            bool last = offset + block == m_Scanlines.size();
+            m_Deflate.insert(m_Deflate.end(), {static_cast<uint8_t>(last ? 1 : 0),
+                                               static_cast<uint8_t>(block), static_cast<uint8_t>(block >> 8),
+                                               static_cast<uint8_t>(~block), static_cast<uint8_t>(~block >> 8)});
+            m_Deflate.insert(m_Deflate.end(), m_Scanlines.begin() + offset, m_Scanlines.begin() + offset + block);
+            offset += block;
+            if (last)
+                break;
+        }
+        AppendBigEndian(m_Deflate, Adler32(m_Scanlines.data(), m_Scanlines.size()));
+
+        m_File.clear();
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        m_File.insert(m_File.end(), signature, signature + sizeof(signature));
+        std::vector<uint8_t> header;
+        AppendBigEndian(header, static_cast<uint32_t>(width));
+        AppendBigEndian(header, static_cast<uint32_t>(height));
+        // 8 bit RGBA, deflate, adaptive filtering, no interlace.
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+        AppendPngChunk(m_File, "IHDR", header.data(), header.size());
+        AppendPngChunk(m_File, "IDAT", m_Deflate.data(), m_Deflate.size());
+        AppendPngChunk(m_File, "IEND", nullptr, 0);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(m_Index++));
+        FILE* file = std::fopen((m_Directory / name).string().c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = std::fwrite(m_File.data(), 1, m_File.size(), file) == m_File.size();
+        written = std::fclose(file) == 0 && written;
+        if (written)
+            BytesWritten += m_File.size();
+        return written;
+    }
+
+    bool Close() override { return true; }
+
+private:
+    std::filesystem::path m_Directory;
+    uint64_t m_Index = 0;
+    std::vector<uint8_t> m_Scanlines;
+    std::vector<uint8_t> m_Deflate;
+    std::vector<uint8_t> m_File;
+};
+
+} // namespace
+
+OsrFrameEncoder::OsrFrameEncoder(FrameEncoderSettings settings)
+    : m_Settings(std::move(settings))
+{
+}
+
+OsrFrameEncoder::~OsrFrameEncoder()
+{
+    Stop();
+}
+
+bool OsrFrameEncoder::Start()
+{
+    if (m_Running || m_Settings.FrameRate <= 0 || m_Settings.QueueSize == 0)
+        return false;
+    if (m_Settings.Format == FRAME_ENCODER_PNG)
+    {
+        if (m_Settings.Pipe)
+            return false;
+        m_Writer = std::make_unique<PngSequenceWriter>(m_Settings);
+    }
+    else
+    {
+        m_Writer = std::make_unique<StreamWriter>(m_Settings);
+    }
+    if (!m_Writer->Open())
+    {
+        m_Writer = nullptr;
+        return false;
+    }
+    m_Running = true;
+    m_Thread = std::thread(&OsrFrameEncoder::Run, this);
+    return true;
+}
+
+void OsrFrameEncoder::Submit(const void* buffer, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    std::unique_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Running || m_Stopping)
+            return;
+        m_Stats.Submitted++;
+        if (m_Queue.size() >= m_Settings.QueueSize)
+        {
+            m_Stats.Dropped++;
+            return;
+        }
+        if (!m_FreeJobs.empty())
+        {
+            job = std::move(m_FreeJobs.back());
+            m_FreeJobs.pop_back();
+        }
+    }
+    if (!job)
+        job = std::make_unique<Job>();
+
+    // The only work on the paint path: one copy into a recycled buffer.
+    job->Pixels.resize(static_cast<size_t>(width) * height * 4);
+    std::memcpy(job->Pixels.data(), buffer, job->Pixels.size());
+    job->Width = width;
+    job->Height = height;
+    job->TimestampUs = NowUs();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(job));
+        m_Stats.QueueDepth = static_cast<int>(m_Queue.size());
+        m_Stats.MaxQueueDepth = std::max(m_Stats.MaxQueueDepth, m_Stats.QueueDepth);
+    }
+    m_Wakeup.notify_one();
+}
+
+void OsrFrameEncoder::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Running)
+            return;
+        m_Stopping = true;
+    }
+    m_Wakeup.notify_one();
+    m_Thread.join();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Running = false;
+    m_Stopping = false;
+    m_FreeJobs.clear();
+}
+
+FrameEncoderStats OsrFrameEncoder::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void OsrFrameEncoder::Run()
+{
+#if !defined(_WIN32)
+    // A piped process that exits early must fail the write, not kill the app.
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+#endif
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_Wakeup.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+        if (m_Queue.empty())
+            break;
+        std::unique_ptr<Job> job = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        m_Stats.QueueDepth = static_cast<int>(m_Queue.size());
+        lock.unlock();
+
+        Encode(*job);
+
+        lock.lock();
+        m_FreeJobs.push_back(std::move(job));
+    }
+    lock.unlock();
+
+    bool closed = m_Writer->Close();
+    lock.lock();
+    if (!closed)
+        m_Stats.Errors++;
+    m_Stats.BytesWritten = m_Writer->BytesWritten;
+    lock.unlock();
+
+#if !defined(_WIN32)
+    // Consume the SIGPIPE of a failed write, it must not reach other threads.
+    timespec noWait{};
+    while (sigtimedwait(&sigpipe, nullptr, &noWait) > 0) {}
+#endif
+}
+
+void OsrFrameEncoder::Encode(const Job& job)
+{
+    uint64_t duplicated = 0;
+    bool skipped = false;
+    bool written = false;
+    if (!m_Failed && m_Writer->Accepts(job.Width, job.Height))
+    {
+        if (m_Settings.Format != FRAME_ENCODER_PNG)
+        {
+            // Constant frame rate: the slot of a frame follows from its paint time.
+            if (m_FramesWritten == 0)
+                m_FirstTimestampUs = job.TimestampUs;
+            auto slot = static_cast<uint64_t>(std::llround(
+                    static_cast<double>(job.TimestampUs - m_FirstTimestampUs) * m_Settings.FrameRate / 1e6));
+            if (m_FramesWritten > 0 && slot < m_FramesWritten)
+                skipped = true;
+            while (!skipped && !m_Failed && m_FramesWritten < slot)
+            {
+                m_Failed = !m_Writer->RepeatFrame();
+                m_FramesWritten++;
+                duplicated++;
+            }
+        }
+        if (!skipped && !m_Failed)
+        {
+            m_Failed = !m_Writer->WriteFrame(job.Pixels.data(), job.Width, job.Height);
+            written = !m_Failed;
+            m_FramesWritten++;
+        }
+    }
+    else if (!m_Failed)
+    {
+        skipped = true;
+    }
+
+    uint64_t latency = static_cast<uint64_t>(std::max<int64_t>(NowUs() - job.TimestampUs, 0));
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.Duplicated += duplicated;
+    m_Stats.BytesWritten = m_Writer->BytesWritten;
+    if (skipped)
+    {
+        m_Stats.Skipped++;
+    }
+    else if (written)
+    {
+        m_Stats.Encoded++;
+        m_Stats.TotalLatencyUs += latency;
+        m_Stats.MaxLatencyUs = std::max(m_Stats.MaxLatencyUs, latency);
+    }
+    else
+    {
+        // The output failed; every further frame is lost.
+        m_Stats.Errors++;
+    }
+}
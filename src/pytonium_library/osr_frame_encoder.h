@@ -0,0 +1,117 @@
+#ifndef PYTONIUM_OSR_FRAME_ENCODER_H
+#define PYTONIUM_OSR_FRAME_ENCODER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pixel_convert.h"
+
+enum FrameEncoderFormat
+{
+    // YUV4MPEG2, 4:2:0 full range BT.601 ("C420jpeg"), readable by ffmpeg and most players.
+    FRAME_ENCODER_Y4M = 0,
+    // One uncompressed RGBA PNG per frame, frame_000000.png, ... in a directory.
+    FRAME_ENCODER_PNG,
+    // Headerless pixels in FrameEncoderSettings::RawFormat.
+    FRAME_ENCODER_RAW,
+};
+
+struct FrameEncoderSettings
+{
+    FrameEncoderFormat Format = FRAME_ENCODER_Y4M;
+    // File (Y4M, raw), directory (PNG), or shell command if |Pipe| is set.
+    std::string Target;
+    // Y4M and raw streams are written to the stdin of the |Target| command,
+    // e.g. "ffmpeg -i - out.mp4".
+    bool Pipe = false;
+    // Y4M and raw streams have a constant frame rate: frames are repeated while
+    // the page does not paint and skipped when it paints faster.
+    int FrameRate = 30;
+    // Frames waiting for the encoder thread; further frames are dropped.
+    size_t QueueSize = 8;
+    // Pixel layout of raw streams.
+    PixelFormat RawFormat = PIXEL_FORMAT_RGBA;
+};
+
+struct FrameEncoderStats
+{
+    uint64_t Submitted = 0;
+    uint64_t Encoded = 0;
+    // Frames not queued because the queue was full.
+    uint64_t Dropped = 0;
+    // Frames repeated to keep the frame rate of a Y4M or raw stream while the
+    // page does not paint.
+    uint64_t Duplicated = 0;
+    // Frames painted faster than the frame rate, or with another size than the
+    // first frame of a Y4M or raw stream.
+    uint64_t Skipped = 0;
+    uint64_t Errors = 0;
+    uint64_t BytesWritten = 0;
+    int QueueDepth = 0;
+    int MaxQueueDepth = 0;
+    // From Submit until the frame is written.
+    uint64_t TotalLatencyUs = 0;
+    uint64_t MaxLatencyUs = 0;
+};
+
+class FrameWriter;
+
+// Encodes OSR frames on its own thread. Submit is called from OnPaint and only
+// copies the frame into a pooled buffer; when the encoder falls behind, frames
+// are dropped instead of stalling the paint path.
+class OsrFrameEncoder
+{
+public:
+    explicit OsrFrameEncoder(FrameEncoderSettings settings);
+    ~OsrFrameEncoder();
+
+    // Opens the output and starts the thread. Returns false if the output
+    // cannot be opened.
+    bool Start();
+
+    // Queues a tightly packed premultiplied BGRA frame.
+    void Submit(const void* buffer, int width, int height);
+
+    // Encodes the frames still queued, closes the output (waiting for a piped
+    // process to exit) and joins the thread.
+    void Stop();
+
+    FrameEncoderStats GetStats() const;
+
+private:
+    struct Job
+    {
+        std::vector<uint8_t> Pixels;
+        int Width = 0;
+        int Height = 0;
+        int64_t TimestampUs = 0;
+    };
+
+    void Run();
+    void Encode(const Job& job);
+
+    const FrameEncoderSettings m_Settings;
+    std::unique_ptr<FrameWriter> m_Writer;
+    std::thread m_Thread;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wakeup;
+    bool m_Running = false;
+    bool m_Stopping = false;
+    std::deque<std::unique_ptr<Job>> m_Queue;
+    std::vector<std::unique_ptr<Job>> m_FreeJobs;
+    FrameEncoderStats m_Stats;
+
+    // Encoder thread only.
+    int64_t m_FirstTimestampUs = 0;
+    uint64_t m_FramesWritten = 0;
+    bool m_Failed = false;
+};
+
+#endif // PYTONIUM_OSR_FRAME_ENCODER_H
@@ -0,0 +1,138 @@
+#include "osr_frame_handler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+OsrFrameHandler::OsrFrameHandler(int width, int height)
+    : m_Width(std::max(width, 1)),
+      m_Height(std::max(height, 1)) {
+}
+
+void OsrFrameHandler::SetBrowser(CefRefPtr<CefBrowser> browser) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Browser = browser;
+}
+
+void OsrFrameHandler::SetFrameCallback(osr_frame_callback_ptr callback, void* user_data) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FrameCallback = callback;
+    m_FrameCallbackUserData = user_data;
+}
+
+void OsrFrameHandler::SetFrameStore(std::shared_ptr<OsrFrameStore> store) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FrameStore = std::move(store);
+}
+
+void OsrFrameHandler::SetFrameEncoder(std::shared_ptr<OsrFrameEncoder> encoder) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FrameEncoder = std::move(encoder);
+}
+
+void OsrFrameHandler::SetFrameRateGovernor(CefRefPtr<OsrFrameRateGovernor> governor) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FrameRateGovernor = governor;
+}
+
+void OsrFrameHandler::SetSize(int width, int height) {
+    CefRefPtr<CefBrowser> browser;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Width = std::max(width, 1);
+        m_Height = std::max(height, 1);
+        browser = m_Browser;
+    }
+    if (browser)
+        browser->GetHost()->WasResized();
+}
+
+void OsrFrameHandler::GetSize(int& width, int& height) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    width = m_Width;
+    height = m_Height;
+}
+
+void OsrFrameHandler::SetDeviceScaleFactor(float scale) {
+    CefRefPtr<CefBrowser> browser;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_DeviceScaleFactor = scale > 0.0f ? scale : 1.0f;
+        browser = m_Browser;
+    }
+    if (browser)
+        browser->GetHost()->NotifyScreenInfoChanged();
+}
+
+OsrPaintStats OsrFrameHandler::GetPaintStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void OsrFrameHandler::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    rect.Set(0, 0, m_Width, m_Height);
+}
+
+bool OsrFrameHandler::GetScreenInfo(CefRefPtr<CefBrowser> browser, CefScreenInfo& screen_info) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Without a display there is no monitor to ask, report the view as screen.
+    screen_info.device_scale_factor = m_DeviceScaleFactor;
+    screen_info.depth = 32;
+    screen_info.depth_per_component = 8;
+    screen_info.rect = CefRect(0, 0, m_Width, m_Height);
+    screen_info.available_rect = screen_info.rect;
+    return true;
+}
+
+void OsrFrameHandler::OnPaint(CefRefPtr<CefBrowser> browser,
+                              PaintElementType type,
+                              const RectList& dirtyRects,
+                              const void* buffer,
+                              int width, int height) {
+    // Popups (e.g. <select> dropdowns) are separate buffers; only the view is
+    // exported.
+    if (type != PET_VIEW)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    osr_frame_callback_ptr callback;
+    void* userData;
+    std::shared_ptr<OsrFrameStore> store;
+    std::shared_ptr<OsrFrameEncoder> encoder;
+    CefRefPtr<OsrFrameRateGovernor> governor;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        callback = m_FrameCallback;
+        userData = m_FrameCallbackUserData;
+        store = m_FrameStore;
+        encoder = m_FrameEncoder;
+        governor = m_FrameRateGovernor;
+        // Nothing is retained here, the consumer decides what to copy.
+        m_Stats.Frames++;
+        for (const auto& rect : dirtyRects) {
+            OsrRect clipped = ClipRect(rect, width, height);
+            m_Stats.DirtyPixels += static_cast<uint64_t>(clipped.Width) * clipped.Height;
+        }
+        m_Stats.Width = width;
+        m_Stats.Height = height;
+    }
+    if (store)
+        store->Publish(buffer, width, height, dirtyRects);
+    if (encoder)
+        encoder->Submit(buffer, width, height);
+    if (callback) {
+        // OnPaint always runs on the UI thread, so the rect buffer is reused.
+        m_DirtyRects.clear();
+        for (const auto& rect : dirtyRects)
+            m_DirtyRects.push_back(ClipRect(rect, width, height));
+
+        OsrFrame frame{buffer, width, height, width * 4, m_DirtyRects.data(), static_cast<int>(m_DirtyRects.size()),
+                       DamageBounds(dirtyRects, width, height)};
+        callback(userData, &frame);
+    }
+    if (governor) {
+        governor->OnPaint(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef OSR_FRAME_HANDLER_H_
+#define OSR_FRAME_HANDLER_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "include/cef_browser.h"
+#include "include/cef_render_handler.h"
+#include "osr_frame_encoder.h"
+#include "osr_frame_rate.h"
+#include "osr_frame_store.h"
+#include "osr_surface.h"
+
+// One painted frame. |Buffer| is CEF's premultiplied BGRA view buffer
+// (Stride == Width * 4) and is only valid for the duration of the callback.
+struct OsrFrame
+{
+    const void* Buffer;
+    int Width;
+    int Height;
+    int Stride;
+    const OsrRect* DirtyRects;
+    int DirtyRectCount;
+    // Bounding box of the dirty rects; consumers that keep the previous frame
+    // only need to read this area.
+    OsrRect Damage;
+};
+
+// Called on the CEF UI thread from OnPaint.
+typedef void (*osr_frame_callback_ptr)(void* user_data, const OsrFrame* frame);
+
+// Platform-neutral render handler for windowless browsers that have no native
+// window to draw into, e.g. headless rendering on Linux boxes without X or GPU.
+// Frames and their dirty rectangles are handed to a consumer callback.
+class OsrFrameHandler : public CefRenderHandler {
+public:
+    OsrFrameHandler(int width, int height);
+
+    void SetBrowser(CefRefPtr<CefBrowser> browser);
+    void SetFrameCallback(osr_frame_callback_ptr callback, void* user_data);
+    // Frames are also published to |store|, if set, for capture from any thread.
+    void SetFrameStore(std::shared_ptr<OsrFrameStore> store);
+    // Frames are also submitted to |encoder|, if set, for recording.
+    void SetFrameEncoder(std::shared_ptr<OsrFrameEncoder> encoder);
+    // Paints are reported to |governor|, if set.
+    void SetFrameRateGovernor(CefRefPtr<OsrFrameRateGovernor> governor);
+
+    // Resizes the view; the browser repaints at the new size.
+    void SetSize(int width, int height);
+    void GetSize(int& width, int& height);
+    void SetDeviceScaleFactor(float scale);
+
+    OsrPaintStats GetPaintStats();
+
+    // CefRenderHandler overrides
+    void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override;
+    bool GetScreenInfo(CefRefPtr<CefBrowser> browser, CefScreenInfo& screen_info) override;
+    void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type,
+                 const RectList& dirtyRects, const void* buffer,
+                 int width, int height) override;
+
+private:
+    std::mutex m_Mutex;
+    int m_Width;
+    int m_Height;
+    float m_DeviceScaleFactor = 1.0f;
+    osr_frame_callback_ptr m_FrameCallback = nullptr;
+    void* m_FrameCallbackUserData = nullptr;
+    std::shared_ptr<OsrFrameStore> m_FrameStore;
+    std::shared_ptr<OsrFrameEncoder> m_FrameEncoder;
+    CefRefPtr<OsrFrameRateGovernor> m_FrameRateGovernor;
+    CefRefPtr<CefBrowser> m_Browser;
+    std::vector<OsrRect> m_DirtyRects;
+    OsrPaintStats m_Stats;
+
+    IMPLEMENT_REFCOUNTING(OsrFrameHandler);
+};
+
+#endif // OSR_FRAME_HANDLER_H_
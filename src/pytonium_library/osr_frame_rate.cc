@@ -0,0 +1,188 @@
+#include "osr_frame_rate.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+
+OsrFrameRateGovernor::OsrFrameRateGovernor(int frameRate)
+    : m_FrameRate(ClampFrameRate(frameRate))
+{
+    m_Stats.FrameRate = m_FrameRate;
+}
+
+int OsrFrameRateGovernor::ClampFrameRate(int frameRate)
+{
+    return std::clamp(frameRate, kMinFrameRate, kMaxFrameRate);
+}
+
+int64_t OsrFrameRateGovernor::NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void OsrFrameRateGovernor::SetBrowser(CefRefPtr<CefBrowser> browser)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Browser = browser;
+    m_LastStepUs = NowUs();
+    m_PaintsSinceStep = 0;
+    ScheduleTick();
+}
+
+void OsrFrameRateGovernor::SetFrameRate(int frameRate)
+{
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Adaptive = false;
+        m_Stats.Adaptive = false;
+        changed = ChangeRate(frameRate);
+    }
+    if (changed)
+        Apply();
+}
+
+void OsrFrameRateGovernor::SetAdaptive(int minFrameRate, int maxFrameRate)
+{
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_MinFrameRate = ClampFrameRate(minFrameRate);
+        m_MaxFrameRate = std::max(ClampFrameRate(maxFrameRate), m_MinFrameRate);
+        m_Adaptive = true;
+        m_Stats.Adaptive = true;
+        // Start fast, the governor lowers the rate once the page settles.
+        changed = ChangeRate(m_MaxFrameRate);
+        m_LastStepUs = NowUs();
+        m_PaintsSinceStep = 0;
+        ScheduleTick();
+    }
+    if (changed)
+        Apply();
+}
+
+int OsrFrameRateGovernor::GetFrameRate() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FrameRate;
+}
+
+void OsrFrameRateGovernor::OnPaint(uint64_t paintTimeUs)
+{
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.Paints++;
+        m_Stats.PaintTimeUs += paintTimeUs;
+        if (!m_Adaptive)
+            return;
+
+        int64_t now = NowUs();
+        int64_t frameInterval = 1000000 / m_FrameRate;
+        if (m_LastPaintUs != 0 && now - m_LastPaintUs <= frameInterval * 5 / 4)
+            m_PaintsAtRate++;
+        else
+            m_PaintsAtRate = 0;
+        m_LastPaintUs = now;
+        m_PaintsSinceStep++;
+
+        if (m_PaintsAtRate >= 3 && m_FrameRate < m_MaxFrameRate)
+        {
+            changed = ChangeRate(m_MaxFrameRate);
+            m_LastStepUs = now;
+            m_PaintsSinceStep = 0;
+            ScheduleTick();
+        }
+    }
+    if (changed)
+        Apply();
+}
+
+void OsrFrameRateGovernor::OnInput()
+{
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Adaptive)
+            return;
+        int64_t now = NowUs();
+        m_BoostUntilUs = now + kInputBoostUs;
+        changed = ChangeRate(m_MaxFrameRate);
+        if (changed)
+        {
+            m_LastStepUs = now;
+            m_PaintsSinceStep = 0;
+        }
+        ScheduleTick();
+    }
+    if (changed)
+        Apply();
+}
+
+OsrFrameRateStats OsrFrameRateGovernor::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+bool OsrFrameRateGovernor::ChangeRate(int frameRate)
+{
+    frameRate = ClampFrameRate(frameRate);
+    if (frameRate == m_FrameRate)
+        return false;
+    m_FrameRate = frameRate;
+    m_Stats.FrameRate = frameRate;
+    m_Stats.RateChanges++;
+    return true;
+}
+
+void OsrFrameRateGovernor::Apply()
+{
+    CefRefPtr<CefBrowser> browser;
+    int frameRate;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        browser = m_Browser;
+        frameRate = m_FrameRate;
+    }
+    if (browser)
+        browser->GetHost()->SetWindowlessFrameRate(frameRate);
+}
+
+void OsrFrameRateGovernor::ScheduleTick()
+{
+    // Only needed while the rate can still go down.
+    if (m_TickScheduled || !m_Adaptive || !m_Browser || m_FrameRate <= m_MinFrameRate)
+        return;
+    m_TickScheduled = true;
+    CefPostDelayedTask(TID_UI, base::BindOnce(&OsrFrameRateGovernor::Tick, this), kTickIntervalMs);
+}
+
+void OsrFrameRateGovernor::Tick()
+{
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_TickScheduled = false;
+        if (!m_Adaptive || !m_Browser)
+            return;
+
+        int64_t now = NowUs();
+        int64_t elapsed = now - m_LastStepUs;
+        if (elapsed >= kStepIntervalUs)
+        {
+            // Fewer than a quarter of the possible frames were painted.
+            bool idle = static_cast<int64_t>(m_PaintsSinceStep) * 4 * 1000000 < m_FrameRate * elapsed;
+            if (idle && now >= m_BoostUntilUs)
+                changed = ChangeRate(std::max(m_MinFrameRate, m_FrameRate / 2));
+            m_LastStepUs = now;
+            m_PaintsSinceStep = 0;
+        }
+        ScheduleTick();
+    }
+    if (changed)
+        Apply();
+}
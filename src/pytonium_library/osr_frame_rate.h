@@ -0,0 +1,85 @@
+#ifndef PYTONIUM_OSR_FRAME_RATE_H
+#define PYTONIUM_OSR_FRAME_RATE_H
+
+#include <cstdint>
+#include <mutex>
+
+#include "include/cef_browser.h"
+
+struct OsrFrameRateStats
+{
+    // Rate the browser currently renders at.
+    int FrameRate = 0;
+    bool Adaptive = false;
+    uint64_t Paints = 0;
+    // Time the browser process spent in OnPaint (copies and frame consumers).
+    uint64_t PaintTimeUs = 0;
+    uint64_t RateChanges = 0;
+};
+
+// Per-browser windowless frame rate. Either fixed, or adaptive: the rate is
+// halved while the page paints less than a quarter of the frames it could, and
+// jumps to the maximum on input or when the page paints every frame, i.e.
+// animates. A page that paints at N fps settles between 2N and 4N fps. The rate
+// is applied with CefBrowserHost::SetWindowlessFrameRate.
+//
+// Thread-safe; the adaptive mode re-evaluates the rate from a delayed task on
+// the UI thread while the rate is above the minimum.
+class OsrFrameRateGovernor : public CefBaseRefCounted
+{
+public:
+    static constexpr int kMinFrameRate = 1;
+    static constexpr int kMaxFrameRate = 60;
+
+    explicit OsrFrameRateGovernor(int frameRate);
+
+    // Clamps |frameRate| to the range Chromium accepts.
+    static int ClampFrameRate(int frameRate);
+
+    void SetBrowser(CefRefPtr<CefBrowser> browser);
+
+    // Fixed rate, turns the adaptive mode off.
+    void SetFrameRate(int frameRate);
+    void SetAdaptive(int minFrameRate, int maxFrameRate);
+    int GetFrameRate() const;
+
+    // Reported by the render handlers.
+    void OnPaint(uint64_t paintTimeUs);
+    void OnInput();
+
+    OsrFrameRateStats GetStats() const;
+
+private:
+    // Paints are counted over windows of this length before the rate is lowered.
+    static constexpr int64_t kStepIntervalUs = 500000;
+    // How long input keeps the maximum rate.
+    static constexpr int64_t kInputBoostUs = 1000000;
+    static constexpr int64_t kTickIntervalMs = 250;
+
+    static int64_t NowUs();
+    // Requires m_Mutex. Returns true if the rate changed.
+    bool ChangeRate(int frameRate);
+    void Apply();
+    // Requires m_Mutex.
+    void ScheduleTick();
+    void Tick();
+
+    mutable std::mutex m_Mutex;
+    CefRefPtr<CefBrowser> m_Browser;
+    int m_FrameRate;
+    bool m_Adaptive = false;
+    int m_MinFrameRate = kMinFrameRate;
+    int m_MaxFrameRate = kMaxFrameRate;
+    bool m_TickScheduled = false;
+    int64_t m_LastPaintUs = 0;
+    int64_t m_LastStepUs = 0;
+    int m_PaintsSinceStep = 0;
+    int64_t m_BoostUntilUs = 0;
+    // Consecutive paints one frame interval apart.
+    int m_PaintsAtRate = 0;
+    OsrFrameRateStats m_Stats;
+
+    IMPLEMENT_REFCOUNTING(OsrFrameRateGovernor);
+};
+
+#endif // PYTONIUM_OSR_FRAME_RATE_H
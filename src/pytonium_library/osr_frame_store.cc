@@ -0,0 +1,132 @@
+#include "osr_frame_store.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+OsrRect UnionRect(const OsrRect& a, const OsrRect& b)
+{
+    if (a.Width <= 0 || a.Height <= 0)
+        return b;
+    if (b.Width <= 0 || b.Height <= 0)
+        return a;
+    int left = std::min(a.X, b.X);
+    int top = std::min(a.Y, b.Y);
+    int right = std::max(a.X + a.Width, b.X + b.Width);
+    int bottom = std::max(a.Y + a.Height, b.Y + b.Height);
+    return OsrRect{left, top, right - left, bottom - top};
+}
+
+OsrRect ClipRect(const OsrRect& rect, int width, int height)
+{
+    int left = std::max(rect.X, 0);
+    int top = std::max(rect.Y, 0);
+    int right = std::min(rect.X + rect.Width, width);
+    int bottom = std::min(rect.Y + rect.Height, height);
+    if (right <= left || bottom <= top)
+        return OsrRect{};
+    return OsrRect{left, top, right - left, bottom - top};
+}
+
+} // namespace
+
+OsrFrameStore::OsrFrameStore()
+{
+    for (auto& buffer : m_Buffers)
+        buffer = std::make_shared<OsrFrameBuffer>();
+}
+
+void OsrFrameStore::Publish(const void* buffer, int width, int height, const CefRenderHandler::RectList& dirtyRects)
+{
+    std::shared_ptr<OsrFrameBuffer>& back = m_Buffers[m_Back];
+
+    // A consumer still holds this buffer from an earlier capture; leave it
+    // alone and paint into a new one.
+    bool held = back.use_count() > 1;
+    // Pairs with the release of the consumer's reference, its reads of the
+    // pixels happen before the writes below.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool fullFrame = held || back->Width != width || back->Height != height;
+    if (held)
+        back = std::make_shared<OsrFrameBuffer>();
+    if (back->Width != width || back->Height != height)
+    {
+        back->Width = width;
+        back->Height = height;
+        back->Stride = width * 4;
+        back->Pixels.resize(static_cast<size_t>(back->Stride) * height);
+    }
+
+    OsrRect damage = DamageBounds(dirtyRects, width, height);
+    const uint8_t* src = static_cast<const uint8_t*>(buffer);
+    if (fullFrame)
+    {
+        CopyDirtyRects(back->Pixels.data(), back->Stride, src, width, height, {CefRect(0, 0, width, height)});
+    }
+    else
+    {
+        CopyDirtyRects(back->Pixels.data(), back->Stride, src, width, height, dirtyRects);
+        const OsrRect& stale = m_StaleDamage[m_Back];
+        if (stale.Width > 0 && stale.Height > 0)
+            CopyDirtyRects(back->Pixels.data(), back->Stride, src, width, height,
+                           {CefRect(stale.X, stale.Y, stale.Width, stale.Height)});
+    }
+
+    back->Sequence = ++m_Sequence;
+    back->TimestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Report the damage since the last captured frame, not just this paint's,
+    // so consumers that skipped frames can still update only the damage. A
+    // capture racing with this only makes the damage larger than needed.
+    uint64_t captured = m_CapturedSequence.load(std::memory_order_acquire);
+    while (!m_PaintDamage.empty() && m_PaintDamage.front().first <= captured)
+        m_PaintDamage.pop_front();
+    if (m_PaintDamage.size() == MaxPaintDamage)
+    {
+        m_PaintDamage[1].second = UnionRect(m_PaintDamage[0].second, m_PaintDamage[1].second);
+        m_PaintDamage.pop_front();
+    }
+    m_PaintDamage.emplace_back(back->Sequence, damage);
+    OsrRect accumulated{};
+    for (const auto& paint : m_PaintDamage)
+        accumulated = UnionRect(accumulated, paint.second);
+    // Damage of paints before a resize may lie outside of the frame.
+    back->Damage = ClipRect(accumulated, width, height);
+    back->DamageSince = captured;
+
+    // The other two buffers have not seen this paint yet.
+    for (uint32_t i = 0; i < m_StaleDamage.size(); i++)
+        m_StaleDamage[i] = i == m_Back ? OsrRect{} : UnionRect(m_StaleDamage[i], damage);
+
+    uint32_t previous = m_Middle.exchange(m_Back | FreshBit, std::memory_order_acq_rel);
+    if (previous & FreshBit)
+        m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    m_Back = previous & ~FreshBit;
+    m_Published.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const OsrFrameBuffer> OsrFrameStore::Acquire(bool onlyNew)
+{
+    std::lock_guard<std::mutex> lock(m_ReaderMutex);
+    if (m_Middle.load(std::memory_order_acquire) & FreshBit)
+    {
+        m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & ~FreshBit;
+        m_Captured.fetch_add(1, std::memory_order_relaxed);
+        m_CapturedSequence.store(m_Buffers[m_Front]->Sequence, std::memory_order_release);
+        return m_Buffers[m_Front];
+    }
+    if (onlyNew || m_Buffers[m_Front]->Sequence == 0)
+        return nullptr;
+    return m_Buffers[m_Front];
+}
+
+OsrFrameCaptureStats OsrFrameStore::GetStats() const
+{
+    OsrFrameCaptureStats stats;
+    stats.Published = m_Published.load(std::memory_order_relaxed);
+    stats.Captured = m_Captured.load(std::memory_order_relaxed);
+    stats.Dropped = m_Dropped.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,93 @@
+#ifndef OSR_FRAME_STORE_H_
+#define OSR_FRAME_STORE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "include/cef_render_handler.h"
+#include "osr_surface.h"
+
+// One captured frame: premultiplied BGRA, rows |Stride| bytes apart.
+struct OsrFrameBuffer
+{
+    std::vector<uint8_t> Pixels;
+    int Width = 0;
+    int Height = 0;
+    int Stride = 0;
+    // Paint counter of the browser, starting at 1. Gaps mean dropped frames.
+    uint64_t Sequence = 0;
+    // steady_clock time of the paint, in microseconds.
+    int64_t TimestampUs = 0;
+    // Area that changed after the paint with sequence |DamageSince|, so it also
+    // covers the paints of frames that were dropped. |DamageSince| is the last
+    // frame a consumer captured before this one was painted, or earlier.
+    OsrRect Damage{};
+    uint64_t DamageSince = 0;
+};
+
+struct OsrFrameCaptureStats
+{
+    uint64_t Published = 0;
+    uint64_t Captured = 0;
+    // Frames replaced by a newer one before any consumer captured them.
+    uint64_t Dropped = 0;
+};
+
+// Triple-buffered frame surface between the paint path and frame consumers.
+//
+// OnPaint (the single writer) fills the back buffer and swaps it with the
+// middle one using one atomic exchange, so it never waits for a consumer.
+// Consumers swap the middle buffer to the front. Captured frames are handed
+// out as shared_ptr and are never written again: if a consumer still holds a
+// buffer when it comes back to the writer, the writer allocates a new one.
+// Consumers only lock against each other.
+class OsrFrameStore
+{
+public:
+    OsrFrameStore();
+
+    // Writer side, called from OnPaint. Copies the dirty rects, plus what the
+    // back buffer missed while it was in use, out of CEF's buffer.
+    void Publish(const void* buffer, int width, int height, const CefRenderHandler::RectList& dirtyRects);
+
+    // Returns the latest published frame. With |onlyNew|, returns nullptr if
+    // nothing was published since the last capture. Safe from any thread.
+    std::shared_ptr<const OsrFrameBuffer> Acquire(bool onlyNew);
+
+    OsrFrameCaptureStats GetStats() const;
+
+private:
+    static constexpr uint32_t FreshBit = 4;
+
+    std::array<std::shared_ptr<OsrFrameBuffer>, 3> m_Buffers;
+
+    // Writer only: the back buffer index and, per buffer, the bounds of the
+    // paints it has not seen yet.
+    uint32_t m_Back = 0;
+    std::array<OsrRect, 3> m_StaleDamage{};
+    uint64_t m_Sequence = 0;
+    // Writer only: sequence and damage of the paints after the last captured
+    // frame, oldest first. Beyond the limit, the oldest two are merged.
+    static constexpr size_t MaxPaintDamage = 16;
+    std::deque<std::pair<uint64_t, OsrRect>> m_PaintDamage;
+
+    // Sequence of the latest frame a consumer captured.
+    std::atomic<uint64_t> m_CapturedSequence{0};
+
+    // Index of the middle buffer, plus FreshBit while it holds an unconsumed frame.
+    std::atomic<uint32_t> m_Middle{1};
+
+    std::mutex m_ReaderMutex;
+    uint32_t m_Front = 2;
+
+    std::atomic<uint64_t> m_Published{0};
+    std::atomic<uint64_t> m_Captured{0};
+    std::atomic<uint64_t> m_Dropped{0};
+};
+
+#endif // OSR_FRAME_STORE_H_
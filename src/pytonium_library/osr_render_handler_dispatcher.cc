@@ -1,20 +1,18 @@
 #include "osr_render_handler_dispatcher.h"
 
-#if defined(_WIN32)
-
-void OsrRenderHandlerDispatcher::RegisterWindow(int browserId,
-                                                  CefRefPtr<OsrWindowWin> window) {
-    m_Windows[browserId] = window;
+void OsrRenderHandlerDispatcher::RegisterHandler(int browserId,
+                                                 CefRefPtr<CefRenderHandler> handler) {
+    m_Handlers[browserId] = handler;
 }
 
-void OsrRenderHandlerDispatcher::UnregisterWindow(int browserId) {
-    m_Windows.erase(browserId);
+void OsrRenderHandlerDispatcher::UnregisterHandler(int browserId) {
+    m_Handlers.erase(browserId);
 }
 
 void OsrRenderHandlerDispatcher::GetViewRect(CefRefPtr<CefBrowser> browser,
                                               CefRect& rect) {
-    auto it = m_Windows.find(browser->GetIdentifier());
-    if (it != m_Windows.end()) {
+    auto it = m_Handlers.find(browser->GetIdentifier());
+    if (it != m_Handlers.end()) {
         it->second->GetViewRect(browser, rect);
     } else {
         // Fallback: return a default size
@@ -22,15 +20,22 @@ void OsrRenderHandlerDispatcher::GetViewRect(CefRefPtr<CefBrowser> browser,
     }
 }
 
+bool OsrRenderHandlerDispatcher::GetScreenInfo(CefRefPtr<CefBrowser> browser,
+                                                CefScreenInfo& screen_info) {
+    auto it = m_Handlers.find(browser->GetIdentifier());
+    if (it != m_Handlers.end()) {
+        return it->second->GetScreenInfo(browser, screen_info);
+    }
+    return false;
+}
+
 void OsrRenderHandlerDispatcher::OnPaint(CefRefPtr<CefBrowser> browser,
                                           PaintElementType type,
                                           const RectList& dirtyRects,
                                           const void* buffer,
                                           int width, int height) {
-    auto it = m_Windows.find(browser->GetIdentifier());
-    if (it != m_Windows.end()) {
+    auto it = m_Handlers.find(browser->GetIdentifier());
+    if (it != m_Handlers.end()) {
         it->second->OnPaint(browser, type, dirtyRects, buffer, width, height);
     }
 }
-
-#endif // _WIN32
@@ -0,0 +1,89 @@
+#include "osr_surface.h"
+
+#include <algorithm>
+#include <cstring>
+
+OsrRect ClipRect(const CefRect& rect, int width, int height)
+{
+    int left = std::clamp(rect.x, 0, width);
+    int top = std::clamp(rect.y, 0, height);
+    int right = std::clamp(rect.x + rect.width, left, width);
+    int bottom = std::clamp(rect.y + rect.height, top, height);
+    return OsrRect{left, top, right - left, bottom - top};
+}
+
+OsrRect DamageBounds(const CefRenderHandler::RectList& dirtyRects, int width, int height)
+{
+    int left = width, top = height, right = 0, bottom = 0;
+    for (const auto& dirty : dirtyRects)
+    {
+        OsrRect rect = ClipRect(dirty, width, height);
+        if (rect.Width <= 0 || rect.Height <= 0)
+            continue;
+        left = std::min(left, rect.X);
+        top = std::min(top, rect.Y);
+        right = std::max(right, rect.X + rect.Width);
+        bottom = std::max(bottom, rect.Y + rect.Height);
+    }
+    if (right <= left || bottom <= top)
+        return OsrRect{0, 0, 0, 0};
+    return OsrRect{left, top, right - left, bottom - top};
+}
+
+size_t CopyDirtyRects(uint8_t* dst, int dstStride, const uint8_t* src, int width, int height,
+                      const CefRenderHandler::RectList& dirtyRects)
+{
+    const size_t srcStride = static_cast<size_t>(width) * 4;
+    size_t copied = 0;
+    for (const auto& dirty : dirtyRects)
+    {
+        OsrRect rect = ClipRect(dirty, width, height);
+        if (rect.Width <= 0 || rect.Height <= 0)
+            continue;
+        const size_t rowBytes = static_cast<size_t>(rect.Width) * 4;
+        const uint8_t* from = src + static_cast<size_t>(rect.Y) * srcStride + static_cast<size_t>(rect.X) * 4;
+        uint8_t* to = dst + static_cast<size_t>(rect.Y) * dstStride + static_cast<size_t>(rect.X) * 4;
+        if (rowBytes == srcStride && static_cast<size_t>(dstStride) == srcStride)
+        {
+            // Full width rows are contiguous.
+            std::memcpy(to, from, rowBytes * rect.Height);
+        }
+        else
+        {
+            for (int row = 0; row < rect.Height; row++)
+                std::memcpy(to + static_cast<size_t>(row) * dstStride, from + static_cast<size_t>(row) * srcStride, rowBytes);
+        }
+        copied += rowBytes * rect.Height;
+    }
+    return copied;
+}
+
+size_t PaintSurface(uint8_t* dst, int dstStride, const void* buffer, int width, int height,
+                    const CefRenderHandler::RectList& dirtyRects, bool fullFrame, OsrPaintStats& stats)
+{
+    const uint8_t* src = static_cast<const uint8_t*>(buffer);
+    size_t copied;
+    uint64_t dirtyPixels = 0;
+    if (fullFrame)
+    {
+        CefRenderHandler::RectList all{CefRect(0, 0, width, height)};
+        copied = CopyDirtyRects(dst, dstStride, src, width, height, all);
+        dirtyPixels = static_cast<uint64_t>(width) * height;
+        stats.FullFrames++;
+    }
+    else
+    {
+        copied = CopyDirtyRects(dst, dstStride, src, width, height, dirtyRects);
+        for (const auto& dirty : dirtyRects)
+        {
+            OsrRect rect = ClipRect(dirty, width, height);
+            dirtyPixels += static_cast<uint64_t>(rect.Width) * rect.Height;
+        }
+    }
+    stats.Frames++;
+    stats.BytesCopied += copied;
+    stats.DirtyPixels += dirtyPixels;
+    stats.Width = width;
+    stats.Height = height;
+    return copied;
+}
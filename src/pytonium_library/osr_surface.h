@@ -0,0 +1,49 @@
+#ifndef OSR_SURFACE_H_
+#define OSR_SURFACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "include/cef_render_handler.h"
+
+struct OsrRect
+{
+    int X;
+    int Y;
+    int Width;
+    int Height;
+};
+
+// Counters of the OnPaint path. A paint copies the dirty rectangles of CEF's
+// buffer into a retained surface; FullFrames counts paints that had to copy
+// everything because the size changed.
+struct OsrPaintStats
+{
+    uint64_t Frames = 0;
+    uint64_t FullFrames = 0;
+    uint64_t BytesCopied = 0;
+    uint64_t DirtyPixels = 0;
+    // Size of the last frame, for bytes per frame ratios.
+    int Width = 0;
+    int Height = 0;
+};
+
+// Clips |rect| to a width x height frame; the result may be empty.
+OsrRect ClipRect(const CefRect& rect, int width, int height);
+
+// Bounding box of the dirty rectangles, clipped to the frame.
+OsrRect DamageBounds(const CefRenderHandler::RectList& dirtyRects, int width, int height);
+
+// Copies the |dirtyRects| of a tightly packed width x height BGRA frame from
+// |src| into |dst|, whose rows are |dstStride| bytes apart. Overlapping rects
+// are copied twice, which is cheaper than splitting them for the few rects
+// Chromium reports. Returns the number of bytes copied.
+size_t CopyDirtyRects(uint8_t* dst, int dstStride, const uint8_t* src, int width, int height,
+                      const CefRenderHandler::RectList& dirtyRects);
+
+// Copies one paint into a retained surface of the same size and updates
+// |stats|. Copies the whole frame when |fullFrame| is set, e.g. after the
+// surface was reallocated.
+size_t PaintSurface(uint8_t* dst, int dstStride, const void* buffer, int width, int height,
+                    const CefRenderHandler::RectList& dirtyRects, bool fullFrame, OsrPaintStats& stats);
+
+#endif // OSR_SURFACE_H_
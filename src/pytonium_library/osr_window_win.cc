@@ -2,6 +2,7 @@
 
 #if defined(_WIN32)
 
+#include <chrono>
 #include <iostream>
 
 const wchar_t* OsrWindowWin::kWindowClass = L"PytoniumOsrWindow";
@@ -14,7 +15,8 @@ OsrWindowWin::OsrWindowWin(int width, int height, bool click_through)
       m_ClickThrough(click_through),
       m_MemDC(nullptr),
       m_Bitmap(nullptr),
-      m_BitmapBits(nullptr) {
+      m_BitmapBits(nullptr),
+      m_SurfaceValid(false) {
 }
 
 OsrWindowWin::~OsrWindowWin() {
@@ -84,6 +86,9 @@ HWND OsrWindowWin::Create(HWND parent) {
     m_Bitmap = CreateDIBSection(m_MemDC, &bmi, DIB_RGB_COLORS,
                                  &m_BitmapBits, nullptr, 0);
     SelectObject(m_MemDC, m_Bitmap);
+    m_BitmapWidth = m_Width;
+    m_BitmapHeight = m_Height;
+    m_SurfaceValid = false;
 
     ShowWindow(m_Hwnd, SW_SHOWNOACTIVATE);
 
@@ -119,13 +124,26 @@ void OsrWindowWin::OnPaint(CefRefPtr<CefBrowser> browser,
                             const RectList& dirtyRects,
                             const void* buffer,
                             int width, int height) {
-    if (!m_Hwnd || !m_MemDC || !m_BitmapBits)
+    // The retained DIB only holds the view; popups would need compositing.
+    if (type != PET_VIEW || !m_Hwnd || !m_MemDC || !m_BitmapBits)
         return;
 
-    // If the size changed, recreate the DIB
-    if (width != m_Width || height != m_Height) {
+    auto start = std::chrono::steady_clock::now();
+    PaintView(dirtyRects, buffer, width, height);
+    if (m_FrameRateGovernor) {
+        m_FrameRateGovernor->OnPaint(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+void OsrWindowWin::PaintView(const RectList& dirtyRects, const void* buffer, int width, int height) {
+    // If the size changed, recreate the DIB. Compared against the DIB size,
+    // SetSize() already updates m_Width/m_Height before the browser repaints.
+    if (width != m_BitmapWidth || height != m_BitmapHeight) {
         m_Width = width;
         m_Height = height;
+        m_BitmapWidth = width;
+        m_BitmapHeight = height;
 
         if (m_Bitmap) {
             DeleteObject(m_Bitmap);
@@ -142,15 +160,35 @@ void OsrWindowWin::OnPaint(CefRefPtr<CefBrowser> browser,
         m_Bitmap = CreateDIBSection(m_MemDC, &bmi, DIB_RGB_COLORS,
                                      &m_BitmapBits, nullptr, 0);
         SelectObject(m_MemDC, m_Bitmap);
+        m_SurfaceValid = false;
+        if (!m_BitmapBits)
+            return;
     }
 
-    // Copy CEF's BGRA buffer to our DIB
-    memcpy(m_BitmapBits, buffer, width * height * 4);
+    // Copy only the dirty parts of CEF's BGRA buffer into the retained DIB,
+    // and only push the damaged area to the layered window.
+    bool fullFrame = !m_SurfaceValid;
+    PaintSurface(static_cast<uint8_t*>(m_BitmapBits), width * 4, buffer, width, height,
+                 dirtyRects, fullFrame, m_Stats);
+    m_SurfaceValid = true;
 
-    UpdateLayeredBitmap(buffer, width, height);
+    if (m_FrameStore)
+        m_FrameStore->Publish(buffer, width, height, dirtyRects);
+    if (m_FrameEncoder)
+        m_FrameEncoder->Submit(buffer, width, height);
+
+    if (fullFrame) {
+        UpdateLayeredBitmap(width, height, nullptr);
+        return;
+    }
+    OsrRect damage = DamageBounds(dirtyRects, width, height);
+    if (damage.Width <= 0 || damage.Height <= 0)
+        return;
+    RECT dirty = {damage.X, damage.Y, damage.X + damage.Width, damage.Y + damage.Height};
+    UpdateLayeredBitmap(width, height, &dirty);
 }
 
-void OsrWindowWin::UpdateLayeredBitmap(const void* buffer, int width, int height) {
+void OsrWindowWin::UpdateLayeredBitmap(int width, int height, const RECT* dirty) {
     if (!m_Hwnd || !m_MemDC)
         return;
 
@@ -168,8 +206,18 @@ void OsrWindowWin::UpdateLayeredBitmap(const void* buffer, int width, int height
     GetWindowRect(m_Hwnd, &rect);
     POINT ptDst = {rect.left, rect.top};
 
-    UpdateLayeredWindow(m_Hwnd, nullptr, &ptDst, &sizeWnd,
-                        m_MemDC, &ptSrc, 0, &blend, ULW_ALPHA);
+    // With prcDirty only the damaged area is read from the DIB; nullptr
+    // updates the whole window.
+    UPDATELAYEREDWINDOWINFO info = {};
+    info.cbSize = sizeof(UPDATELAYEREDWINDOWINFO);
+    info.pptDst = &ptDst;
+    info.psize = &sizeWnd;
+    info.hdcSrc = m_MemDC;
+    info.pptSrc = &ptSrc;
+    info.pblend = &blend;
+    info.dwFlags = ULW_ALPHA;
+    info.prcDirty = dirty;
+    UpdateLayeredWindowIndirect(m_Hwnd, &info);
 }
 
 void OsrWindowWin::SetAlwaysOnTop(bool on_top) {
@@ -251,6 +299,8 @@ uint32_t OsrWindowWin::GetCefKeyboardModifiers(WPARAM wParam, LPARAM lParam) {
 
 void OsrWindowWin::ForwardMouseEvent(UINT msg, WPARAM wParam, LPARAM lParam) {
     if (!m_Browser) return;
+    if (m_FrameRateGovernor)
+        m_FrameRateGovernor->OnInput();
 
     CefMouseEvent event;
     event.x = LOWORD(lParam);
@@ -302,6 +352,8 @@ void OsrWindowWin::ForwardMouseEvent(UINT msg, WPARAM wParam, LPARAM lParam) {
 
 void OsrWindowWin::ForwardKeyEvent(UINT msg, WPARAM wParam, LPARAM lParam) {
     if (!m_Browser) return;
+    if (m_FrameRateGovernor)
+        m_FrameRateGovernor->OnInput();
 
     CefKeyEvent event;
     event.windows_key_code = static_cast<int>(wParam);
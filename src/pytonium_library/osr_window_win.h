@@ -4,8 +4,13 @@
 #if defined(_WIN32)
 
 #include <Windows.h>
+#include <memory>
 #include "include/cef_render_handler.h"
 #include "include/cef_browser.h"
+#include "osr_frame_encoder.h"
+#include "osr_frame_rate.h"
+#include "osr_frame_store.h"
+#include "osr_surface.h"
 
 class OsrWindowWin : public CefRenderHandler {
 public:
@@ -35,6 +40,17 @@ public:
     void SetPosition(int x, int y);
     void SetSize(int width, int height);
 
+    OsrPaintStats GetPaintStats() const { return m_Stats; }
+
+    // Frames are also published to |store|, if set, for capture from any thread.
+    void SetFrameStore(std::shared_ptr<OsrFrameStore> store) { m_FrameStore = std::move(store); }
+
+    // Frames are also submitted to |encoder|, if set, for recording.
+    void SetFrameEncoder(std::shared_ptr<OsrFrameEncoder> encoder) { m_FrameEncoder = std::move(encoder); }
+
+    // Paints and input are reported to |governor|, if set.
+    void SetFrameRateGovernor(CefRefPtr<OsrFrameRateGovernor> governor) { m_FrameRateGovernor = governor; }
+
 private:
     static const wchar_t* kWindowClass;
     static bool s_ClassRegistered;
@@ -49,11 +65,23 @@ private:
     HDC m_MemDC;
     HBITMAP m_Bitmap;
     void* m_BitmapBits;
+    int m_BitmapWidth = 0;
+    int m_BitmapHeight = 0;
+    // False until the DIB holds a complete frame; the next paint copies
+    // everything instead of only the dirty rects.
+    bool m_SurfaceValid;
+    OsrPaintStats m_Stats;
+    std::shared_ptr<OsrFrameStore> m_FrameStore;
+    std::shared_ptr<OsrFrameEncoder> m_FrameEncoder;
+    CefRefPtr<OsrFrameRateGovernor> m_FrameRateGovernor;
+
+    // Copies a view frame into the DIB and updates the layered window.
+    void PaintView(const RectList& dirtyRects, const void* buffer, int width, int height);
 
     static void RegisterWindowClass();
     static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-    void UpdateLayeredBitmap(const void* buffer, int width, int height);
+    void UpdateLayeredBitmap(int width, int height, const RECT* dirty);
     void ForwardMouseEvent(UINT msg, WPARAM wParam, LPARAM lParam);
     void ForwardKeyEvent(UINT msg, WPARAM wParam, LPARAM lParam);
 
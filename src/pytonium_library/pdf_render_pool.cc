@@ -0,0 +1,370 @@
+#include "pdf_render_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+#include "include/cef_browser.h"
+#include "include/cef_parser.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "include/wrapper/cef_helpers.h"
+#include "global_vars.h"
+
+namespace {
+
+// Chromium refuses to navigate to longer URLs.
+constexpr size_t kMaxUrlLength = 2 * 1024 * 1024;
+
+class PdfPrintCallback : public CefPdfPrintCallback
+{
+public:
+    PdfPrintCallback(CefRefPtr<PdfRenderPool> pool, int browserId, int jobId)
+        : m_Pool(pool), m_BrowserId(browserId), m_JobId(jobId)
+    {
+    }
+
+    void OnPdfPrintFinished(const CefString& path, bool ok) override
+    {
+        m_Pool->OnPrintFinished(m_BrowserId, m_JobId, path.ToString(), ok);
+    }
+
+private:
+    CefRefPtr<PdfRenderPool> m_Pool;
+    int m_BrowserId;
+    int m_JobId;
+
+    IMPLEMENT_REFCOUNTING(PdfPrintCallback);
+};
+
+} // namespace
+
+PdfRenderPool::PdfRenderPool(int size, int viewWidth, int viewHeight)
+    : m_Size(std::max(size, 1)), m_ViewWidth(viewWidth), m_ViewHeight(viewHeight)
+{
+}
+
+int64_t PdfRenderPool::NowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PdfRenderPool::Start()
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    cef_browser_settings_t cefBrowserSettings;
+    memset(&cefBrowserSettings, 0, sizeof(cef_browser_settings_t));
+    cefBrowserSettings.size = sizeof(cef_browser_settings_t);
+    // Printing does not need frames.
+    cefBrowserSettings.windowless_frame_rate = 1;
+    CefBrowserSettings browser_settings(cefBrowserSettings);
+
+    // Created asynchronously, so starting the pool does not wait for the
+    // renderer processes. No bindings; the renderer expects extra info anyway.
+    for (int i = 0; i < m_Size; i++)
+    {
+        CefWindowInfo window_info;
+        window_info.SetAsWindowless(kNullWindowHandle);
+        window_info.runtime_style = CEF_RUNTIME_STYLE_ALLOY;
+        // Counted from here, so CefShutdown also waits for browsers still being created.
+        g_PdfBrowserCount.fetch_add(1, std::memory_order_release);
+        if (!CefBrowserHost::CreateBrowser(window_info, this, "about:blank", browser_settings,
+                                           CefDictionaryValue::Create(), nullptr))
+            g_PdfBrowserCount.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+int PdfRenderPool::Submit(PdfRenderJob job, state_request_callback_ptr callback, void* userData)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    QueuedJob queued;
+    queued.Id = ++m_NextJobId;
+    queued.Job = std::move(job);
+    queued.Callback = callback;
+    queued.UserData = userData;
+    int jobId = queued.Id;
+    m_Queue.push_back(std::move(queued));
+    Dispatch();
+    return jobId;
+}
+
+void PdfRenderPool::Shutdown()
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    if (m_ShuttingDown)
+        return;
+    m_ShuttingDown = true;
+
+    std::deque<QueuedJob> queue = std::move(m_Queue);
+    m_Queue.clear();
+    std::vector<QueuedJob> running;
+    for (auto& slot : m_Slots)
+    {
+        if (slot.State == SlotState::Loading || slot.State == SlotState::Injecting ||
+            slot.State == SlotState::Printing)
+            running.push_back(std::move(slot.Job));
+        slot.State = SlotState::Idle;
+        slot.Job = {};
+        slot.Browser->GetHost()->CloseBrowser(true);
+    }
+    for (auto& job : running)
+        job.Callback(job.UserData, job.Id, false, CefValueWrapper());
+    for (auto& job : queue)
+        job.Callback(job.UserData, job.Id, false, CefValueWrapper());
+}
+
+PdfRenderPoolStats PdfRenderPool::GetStats() const
+{
+    PdfRenderPoolStats stats = m_Stats;
+    for (const auto& slot : m_Slots)
+    {
+        if (slot.State != SlotState::Starting)
+            stats.Browsers++;
+        if (slot.State != SlotState::Starting && slot.State != SlotState::Idle)
+            stats.Busy++;
+    }
+    stats.Queued = static_cast<int>(m_Queue.size());
+    return stats;
+}
+
+PdfRenderPool::Slot* PdfRenderPool::FindSlot(int browserId)
+{
+    for (auto& slot : m_Slots)
+    {
+        if (slot.Browser->GetIdentifier() == browserId)
+            return &slot;
+    }
+    return nullptr;
+}
+
+void PdfRenderPool::Dispatch()
+{
+    for (auto& slot : m_Slots)
+    {
+        if (m_Queue.empty() || m_ShuttingDown)
+            return;
+        if (slot.State != SlotState::Idle)
+            continue;
+        slot.Job = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        Load(slot);
+    }
+}
+
+void PdfRenderPool::Load(Slot& slot)
+{
+    std::string url = slot.Job.Job.Url;
+    if (url.empty())
+    {
+        const std::string& html = slot.Job.Job.Html;
+        url = "data:text/html;charset=utf-8;base64," + CefBase64Encode(html.data(), html.size()).ToString();
+    }
+    slot.StartUs = NowUs();
+    if (url.size() > kMaxUrlLength)
+    {
+        Finish(slot, "", "The HTML is too large for a data: URL, load it from a file or custom scheme instead.");
+        return;
+    }
+
+    slot.State = SlotState::Loading;
+    slot.LoadStarted = false;
+    slot.Browser->GetMainFrame()->LoadURL(url);
+
+    int timeoutMs = slot.Job.Job.TimeoutMs;
+    if (timeoutMs > 0)
+    {
+        CefPostDelayedTask(TID_UI, base::BindOnce(&PdfRenderPool::CheckTimeout, this,
+                                                  slot.Browser->GetIdentifier(), slot.Job.Id), timeoutMs);
+    }
+}
+
+void PdfRenderPool::Print(Slot& slot)
+{
+    const PdfRenderJob& job = slot.Job.Job;
+    std::string path = job.OutputPath;
+    if (path.empty())
+    {
+        auto name = "pytonium_" + std::to_string(NowUs()) + "_" + std::to_string(slot.Job.Id) + ".pdf";
+        path = (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    CefPdfPrintSettings settings;
+    settings.landscape = job.Landscape;
+    settings.print_background = job.PrintBackground;
+    settings.scale = job.Scale;
+    settings.paper_width = job.PaperWidth;
+    settings.paper_height = job.PaperHeight;
+    settings.prefer_css_page_size = job.PreferCssPageSize;
+    if (job.MarginTop >= 0 || job.MarginRight >= 0 || job.MarginBottom >= 0 || job.MarginLeft >= 0)
+    {
+        settings.margin_type = PDF_PRINT_MARGIN_CUSTOM;
+        settings.margin_top = std::max(job.MarginTop, 0.0);
+        settings.margin_right = std::max(job.MarginRight, 0.0);
+        settings.margin_bottom = std::max(job.MarginBottom, 0.0);
+        settings.margin_left = std::max(job.MarginLeft, 0.0);
+    }
+    if (!job.PageRanges.empty())
+        CefString(&settings.page_ranges) = job.PageRanges;
+
+    slot.State = SlotState::Printing;
+    slot.Browser->GetHost()->PrintToPDF(path, settings,
+                                        new PdfPrintCallback(this, slot.Browser->GetIdentifier(), slot.Job.Id));
+}
+
+void PdfRenderPool::Finish(Slot& slot, const std::string& path, const std::string& error)
+{
+    // The slot is free again before the callback runs, which may submit.
+    QueuedJob job = std::move(slot.Job);
+    slot.Job = {};
+    slot.State = SlotState::Idle;
+
+    uint64_t renderUs = static_cast<uint64_t>(NowUs() - slot.StartUs);
+    CefValueWrapper result;
+    std::map<std::string, CefValueWrapper> values;
+    if (error.empty())
+    {
+        m_Stats.Completed++;
+        m_Stats.TotalRenderUs += renderUs;
+        m_Stats.MaxRenderUs = std::max(m_Stats.MaxRenderUs, renderUs);
+        values["path"].SetString(path);
+    }
+    else
+    {
+        m_Stats.Failed++;
+        values["error"].SetString(error);
+    }
+    result.SetObject(values);
+    job.Callback(job.UserData, job.Id, true, result);
+    Dispatch();
+}
+
+void PdfRenderPool::CheckTimeout(int browserId, int jobId)
+{
+    Slot* slot = FindSlot(browserId);
+    if (!slot || slot->Job.Id != jobId || slot->State == SlotState::Idle)
+        return;
+    // A late load or print of this job is ignored, its job ID no longer matches.
+    slot->Browser->StopLoad();
+    Finish(*slot, "", "Timed out");
+}
+
+void PdfRenderPool::OnPrintFinished(int browserId, int jobId, const std::string& path, bool ok)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    Slot* slot = FindSlot(browserId);
+    if (!slot || slot->Job.Id != jobId || slot->State != SlotState::Printing)
+        return;
+    Finish(*slot, path, ok ? "" : "Printing failed");
+}
+
+bool PdfRenderPool::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+                                             CefProcessId source_process, CefRefPtr<CefProcessMessage> message)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    // The renderer confirms the data of a job with the reply of a state request.
+    if (message->GetName() != "app-state-request-return")
+        return false;
+    CefRefPtr<CefListValue> argList = message->GetArgumentList();
+    Slot* slot = FindSlot(browser->GetIdentifier());
+    if (!slot || argList->GetSize() != 2 || argList->GetType(0) != VTYPE_INT)
+        return false;
+    if (slot->State != SlotState::Injecting || argList->GetInt(0) != slot->Job.Id)
+        return true;
+    if (argList->GetType(1) != VTYPE_BOOL || !argList->GetBool(1))
+    {
+        Finish(*slot, "", "The page threw while receiving its data");
+        return true;
+    }
+    Print(*slot);
+    return true;
+}
+
+void PdfRenderPool::OnAfterCreated(CefRefPtr<CefBrowser> browser)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    Slot slot;
+    slot.Browser = browser;
+    m_Slots.push_back(std::move(slot));
+    if (m_ShuttingDown)
+        browser->GetHost()->CloseBrowser(true);
+}
+
+void PdfRenderPool::OnBeforeClose(CefRefPtr<CefBrowser> browser)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    int browserId = browser->GetIdentifier();
+    m_Slots.remove_if([browserId](const Slot& slot) { return slot.Browser->GetIdentifier() == browserId; });
+    g_PdfBrowserCount.fetch_sub(1, std::memory_order_release);
+}
+
+void PdfRenderPool::OnLoadingStateChange(CefRefPtr<CefBrowser> browser, bool isLoading,
+                                         bool canGoBack, bool canGoForward)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    Slot* slot = FindSlot(browser->GetIdentifier());
+    if (!slot)
+        return;
+    if (slot->State == SlotState::Starting)
+    {
+        if (!isLoading && !m_ShuttingDown)
+        {
+            slot->State = SlotState::Idle;
+            Dispatch();
+        }
+        return;
+    }
+    if (slot->State != SlotState::Loading)
+        return;
+    if (isLoading)
+    {
+        slot->LoadStarted = true;
+        return;
+    }
+    if (!slot->LoadStarted)
+        return;
+
+    const std::string& data = slot->Job.Job.DataJson;
+    if (data.empty())
+    {
+        Print(*slot);
+        return;
+    }
+    slot->State = SlotState::Injecting;
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("pdf-inject-data");
+    msg->GetArgumentList()->SetInt(0, slot->Job.Id);
+    msg->GetArgumentList()->SetString(1, data);
+    browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+}
+
+void PdfRenderPool::OnLoadError(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+                                ErrorCode errorCode, const CefString& errorText,
+                                const CefString& failedUrl)
+{
+    CEF_REQUIRE_UI_THREAD();
+
+    // Aborted loads are replaced by another navigation; subframes may fail
+    // without spoiling the page.
+    if (errorCode == ERR_ABORTED || !frame->IsMain())
+        return;
+    Slot* slot = FindSlot(browser->GetIdentifier());
+    if (!slot || slot->State != SlotState::Loading)
+        return;
+    Finish(*slot, "", "Failed to load " + failedUrl.ToString() + ": " + errorText.ToString());
+}
+
+void PdfRenderPool::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect)
+{
+    rect = CefRect(0, 0, m_ViewWidth, m_ViewHeight);
+}
@@ -0,0 +1,164 @@
+#ifndef PYTONIUM_PDF_RENDER_POOL_H
+#define PYTONIUM_PDF_RENDER_POOL_H
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+
+#include "include/cef_client.h"
+#include "include/cef_render_handler.h"
+#include "application_state_python.h"
+
+struct PdfRenderJob
+{
+    // Page to print: |Url|, or |Html| loaded as a data: URL.
+    std::string Url;
+    std::string Html;
+    // JSON assigned to window.pytoniumPdfData once the page loaded; a
+    // "PytoniumPdfData" event is dispatched before printing. Empty for none.
+    std::string DataJson;
+    // PDF file to write. Empty for a file in the temp directory.
+    std::string OutputPath;
+
+    bool Landscape = false;
+    bool PrintBackground = true;
+    double Scale = 1.0;
+    // Inches; 0 for US Letter.
+    double PaperWidth = 0.0;
+    double PaperHeight = 0.0;
+    // Inches; negative for Chromium's default margins.
+    double MarginTop = -1.0;
+    double MarginRight = -1.0;
+    double MarginBottom = -1.0;
+    double MarginLeft = -1.0;
+    // E.g. "1-3, 5"; empty for all pages.
+    std::string PageRanges;
+    bool PreferCssPageSize = false;
+    // The job fails if loading and printing take longer.
+    int TimeoutMs = 30000;
+};
+
+struct PdfRenderPoolStats
+{
+    // Browsers that finished starting.
+    int Browsers = 0;
+    int Busy = 0;
+    int Queued = 0;
+    uint64_t Completed = 0;
+    uint64_t Failed = 0;
+    // From dispatch to the written PDF.
+    uint64_t TotalRenderUs = 0;
+    uint64_t MaxRenderUs = 0;
+};
+
+// Renders HTML to PDF with a pool of hidden windowless browsers, created once
+// and reused for every job. Jobs are queued and handed to the next idle
+// browser; each job loads its page, optionally receives its data, and is
+// printed with CefBrowserHost::PrintToPDF. Browsers of separate jobs run in
+// separate renderer processes, so jobs print in parallel.
+//
+// The pool is its own CefClient: its browsers are not counted as open windows
+// and never show up in the application's handlers. UI thread only.
+//
+// Completion is reported through |callback| with the job ID and a dictionary
+// {"path": <pdf>} on success or {"error": <message>} on failure; |success| is
+// false only if the pool shut down before the job ran.
+class PdfRenderPool : public CefClient,
+                      public CefLifeSpanHandler,
+                      public CefLoadHandler,
+                      public CefRenderHandler
+{
+public:
+    PdfRenderPool(int size, int viewWidth, int viewHeight);
+
+    // Starts creating the browsers; jobs can be submitted right away.
+    void Start();
+
+    // Returns the job ID.
+    int Submit(PdfRenderJob job, state_request_callback_ptr callback, void* userData);
+
+    // Fails queued and running jobs and closes the browsers.
+    void Shutdown();
+
+    PdfRenderPoolStats GetStats() const;
+
+    // Called by the print callback.
+    void OnPrintFinished(int browserId, int jobId, const std::string& path, bool ok);
+
+    // CefClient methods:
+    CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override { return this; }
+    CefRefPtr<CefLoadHandler> GetLoadHandler() override { return this; }
+    CefRefPtr<CefRenderHandler> GetRenderHandler() override { return this; }
+    bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+                                  CefProcessId source_process, CefRefPtr<CefProcessMessage> message) override;
+
+    // CefLifeSpanHandler methods:
+    void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
+    void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+
+    // CefLoadHandler methods:
+    void OnLoadingStateChange(CefRefPtr<CefBrowser> browser, bool isLoading,
+                              bool canGoBack, bool canGoForward) override;
+    void OnLoadError(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame,
+                     ErrorCode errorCode, const CefString& errorText,
+                     const CefString& failedUrl) override;
+
+    // CefRenderHandler methods; nothing is painted anywhere.
+    void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override;
+    void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type,
+                 const RectList& dirtyRects, const void* buffer,
+                 int width, int height) override {}
+
+private:
+    enum class SlotState
+    {
+        // Loading the initial blank page.
+        Starting,
+        Idle,
+        Loading,
+        // Waiting for the renderer to take the job's data.
+        Injecting,
+        Printing,
+    };
+
+    struct QueuedJob
+    {
+        int Id = 0;
+        PdfRenderJob Job;
+        state_request_callback_ptr Callback = nullptr;
+        void* UserData = nullptr;
+    };
+
+    struct Slot
+    {
+        CefRefPtr<CefBrowser> Browser;
+        SlotState State = SlotState::Starting;
+        // The navigation of the job has started; earlier loading state changes
+        // belong to the previous page.
+        bool LoadStarted = false;
+        QueuedJob Job;
+        int64_t StartUs = 0;
+    };
+
+    static int64_t NowUs();
+    Slot* FindSlot(int browserId);
+    void Dispatch();
+    void Load(Slot& slot);
+    void Print(Slot& slot);
+    void Finish(Slot& slot, const std::string& path, const std::string& error);
+    void CheckTimeout(int browserId, int jobId);
+
+    const int m_Size;
+    const int m_ViewWidth;
+    const int m_ViewHeight;
+    bool m_ShuttingDown = false;
+    int m_NextJobId = 0;
+    std::list<Slot> m_Slots;
+    std::deque<QueuedJob> m_Queue;
+    PdfRenderPoolStats m_Stats;
+
+    IMPLEMENT_REFCOUNTING(PdfRenderPool);
+};
+
+#endif // PYTONIUM_PDF_RENDER_POOL_H
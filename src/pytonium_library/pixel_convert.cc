@@ -0,0 +1,632 @@
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PYTONIUM_PIXEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PYTONIUM_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit SIMD instructions beyond the build's baseline in
+// functions that ask for them; MSVC always does.
+#if defined(PYTONIUM_PIXEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PYTONIUM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PYTONIUM_TARGET(isa)
+#endif
+
+namespace {
+
+// Converts one row of |pixels| pixels.
+typedef void (*RowKernel)(uint8_t* dst, const uint8_t* src, int pixels);
+
+struct RowKernels
+{
+    // Indexed by "swap red and blue".
+    RowKernel Swizzle;
+    RowKernel Premultiply[2];
+    RowKernel Unpremultiply[2];
+    RowKernel Strip[2];
+};
+
+// Rounded c * a / 255, exact for all 8 bit inputs.
+inline uint8_t Div255(unsigned value)
+{
+    value += 128;
+    return static_cast<uint8_t>((value + (value >> 8)) >> 8);
+}
+
+inline uint8_t UnpremultiplyChannel(unsigned c, unsigned a)
+{
+    if (a == 0)
+        return 0;
+    return static_cast<uint8_t>(std::min(255u, (c * 255 + a / 2) / a));
+}
+
+// --- Scalar -----------------------------------------------------------------
+
+void SwizzleRowScalar(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    for (int i = 0; i < pixels; i++, src += 4, dst += 4)
+    {
+        uint8_t b = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = b;
+        dst[3] = src[3];
+    }
+}
+
+template <bool Swap>
+void PremultiplyRowScalar(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    for (int i = 0; i < pixels; i++, src += 4, dst += 4)
+    {
+        unsigned a = src[3];
+        uint8_t c0 = Div255(src[0] * a);
+        uint8_t c2 = Div255(src[2] * a);
+        dst[0] = Swap ? c2 : c0;
+        dst[1] = Div255(src[1] * a);
+        dst[2] = Swap ? c0 : c2;
+        dst[3] = static_cast<uint8_t>(a);
+    }
+}
+
+template <bool Swap>
+void UnpremultiplyRowScalar(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    for (int i = 0; i < pixels; i++, src += 4, dst += 4)
+    {
+        unsigned a = src[3];
+        uint8_t c0 = UnpremultiplyChannel(src[0], a);
+        uint8_t c2 = UnpremultiplyChannel(src[2], a);
+        dst[0] = Swap ? c2 : c0;
+        dst[1] = UnpremultiplyChannel(src[1], a);
+        dst[2] = Swap ? c0 : c2;
+        dst[3] = static_cast<uint8_t>(a);
+    }
+}
+
+template <bool Swap>
+void StripRowScalar(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    for (int i = 0; i < pixels; i++, src += 4, dst += 3)
+    {
+        uint8_t c0 = src[0];
+        uint8_t c2 = src[2];
+        dst[0] = Swap ? c2 : c0;
+        dst[1] = src[1];
+        dst[2] = Swap ? c0 : c2;
+    }
+}
+
+constexpr RowKernels ScalarKernels = {
+    SwizzleRowScalar,
+    {PremultiplyRowScalar<false>, PremultiplyRowScalar<true>},
+    {UnpremultiplyRowScalar<false>, UnpremultiplyRowScalar<true>},
+    {StripRowScalar<false>, StripRowScalar<true>},
+};
+
+#if defined(PYTONIUM_PIXEL_X86)
+
+// --- SSSE3, 4 pixels per step -----------------------------------------------
+
+PYTONIUM_TARGET("ssse3")
+inline __m128i SwizzleMask128()
+{
+    return _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+}
+
+PYTONIUM_TARGET("ssse3")
+inline __m128i StripMask128(bool swap)
+{
+    return swap ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+}
+
+// Multiplies two pixels of 16 bit channels by their alpha, alpha by 255.
+PYTONIUM_TARGET("ssse3")
+inline __m128i PremultiplyPixels128(__m128i pixels)
+{
+    const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alphaFactor = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xFF), 0xFF);
+    __m128i factor = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaFactor);
+    __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, factor), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+// Unpremultiplies one pixel of 32 bit channels, alpha included (fixed later).
+PYTONIUM_TARGET("ssse3")
+inline __m128i UnpremultiplyPixel128(__m128i pixel)
+{
+    __m128 value = _mm_cvtepi32_ps(pixel);
+    __m128 alpha = _mm_max_ps(_mm_shuffle_ps(value, value, 0xFF), _mm_set1_ps(1.0f));
+    __m128 result = _mm_div_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), alpha);
+    return _mm_cvttps_epi32(_mm_add_ps(result, _mm_set1_ps(0.5f)));
+}
+
+PYTONIUM_TARGET("ssse3")
+void SwizzleRowSsse3(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m128i mask = SwizzleMask128();
+    int i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(px, mask));
+    }
+    SwizzleRowScalar(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("ssse3")
+void PremultiplyRowSsse3(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = SwizzleMask128();
+    int i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        __m128i lo = PremultiplyPixels128(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = PremultiplyPixels128(_mm_unpackhi_epi8(px, zero));
+        __m128i out = _mm_packus_epi16(lo, hi);
+        if (Swap)
+            out = _mm_shuffle_epi8(out, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), out);
+    }
+    PremultiplyRowScalar<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("ssse3")
+void UnpremultiplyRowSsse3(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i mask = SwizzleMask128();
+    int i = 0;
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        __m128i p01 = _mm_packs_epi32(UnpremultiplyPixel128(_mm_unpacklo_epi16(lo, zero)),
+                                      UnpremultiplyPixel128(_mm_unpackhi_epi16(lo, zero)));
+        __m128i p23 = _mm_packs_epi32(UnpremultiplyPixel128(_mm_unpacklo_epi16(hi, zero)),
+                                      UnpremultiplyPixel128(_mm_unpackhi_epi16(hi, zero)));
+        __m128i alpha = _mm_and_si128(px, alphaMask);
+        __m128i out = _mm_or_si128(_mm_andnot_si128(alphaMask, _mm_packus_epi16(p01, p23)), alpha);
+        out = _mm_andnot_si128(_mm_cmpeq_epi32(alpha, zero), out);
+        if (Swap)
+            out = _mm_shuffle_epi8(out, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), out);
+    }
+    UnpremultiplyRowScalar<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("ssse3")
+void StripRowSsse3(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m128i mask = StripMask128(Swap);
+    int i = 0;
+    // Each step stores 16 bytes of which 12 are pixels; the next step
+    // overwrites the rest, so stop while the store still fits the row.
+    for (; i + 6 <= pixels; i += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(px, mask));
+    }
+    StripRowScalar<Swap>(dst + i * 3, src + i * 4, pixels - i);
+}
+
+constexpr RowKernels Ssse3Kernels = {
+    SwizzleRowSsse3,
+    {PremultiplyRowSsse3<false>, PremultiplyRowSsse3<true>},
+    {UnpremultiplyRowSsse3<false>, UnpremultiplyRowSsse3<true>},
+    {StripRowSsse3<false>, StripRowSsse3<true>},
+};
+
+// --- AVX2, 8 pixels per step ------------------------------------------------
+// The byte shuffles and packs work per 128 bit lane, which keeps the pixel
+// order of the SSSE3 kernels.
+
+PYTONIUM_TARGET("avx2")
+inline __m256i SwizzleMask256()
+{
+    return _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+}
+
+PYTONIUM_TARGET("avx2")
+inline __m256i PremultiplyPixels256(__m256i pixels)
+{
+    const __m256i colorMask = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+    const __m256i alphaFactor = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, 0xFF), 0xFF);
+    __m256i factor = _mm256_or_si256(_mm256_and_si256(alpha, colorMask), alphaFactor);
+    __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, factor), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+PYTONIUM_TARGET("avx2")
+inline __m256i UnpremultiplyPixels256(__m256i pixels)
+{
+    __m256 value = _mm256_cvtepi32_ps(pixels);
+    __m256 alpha = _mm256_max_ps(_mm256_shuffle_ps(value, value, 0xFF), _mm256_set1_ps(1.0f));
+    __m256 result = _mm256_div_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), alpha);
+    return _mm256_cvttps_epi32(_mm256_add_ps(result, _mm256_set1_ps(0.5f)));
+}
+
+PYTONIUM_TARGET("avx2")
+void SwizzleRowAvx2(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m256i mask = SwizzleMask256();
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(px, mask));
+    }
+    SwizzleRowSsse3(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("avx2")
+void PremultiplyRowAvx2(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mask = SwizzleMask256();
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        __m256i lo = PremultiplyPixels256(_mm256_unpacklo_epi8(px, zero));
+        __m256i hi = PremultiplyPixels256(_mm256_unpackhi_epi8(px, zero));
+        __m256i out = _mm256_packus_epi16(lo, hi);
+        if (Swap)
+            out = _mm256_shuffle_epi8(out, mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), out);
+    }
+    PremultiplyRowSsse3<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("avx2")
+void UnpremultiplyRowAvx2(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i mask = SwizzleMask256();
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        __m256i lo = _mm256_unpacklo_epi8(px, zero);
+        __m256i hi = _mm256_unpackhi_epi8(px, zero);
+        __m256i p01 = _mm256_packs_epi32(UnpremultiplyPixels256(_mm256_unpacklo_epi16(lo, zero)),
+                                         UnpremultiplyPixels256(_mm256_unpackhi_epi16(lo, zero)));
+        __m256i p23 = _mm256_packs_epi32(UnpremultiplyPixels256(_mm256_unpacklo_epi16(hi, zero)),
+                                         UnpremultiplyPixels256(_mm256_unpackhi_epi16(hi, zero)));
+        __m256i alpha = _mm256_and_si256(px, alphaMask);
+        __m256i out = _mm256_or_si256(_mm256_andnot_si256(alphaMask, _mm256_packus_epi16(p01, p23)), alpha);
+        out = _mm256_andnot_si256(_mm256_cmpeq_epi32(alpha, zero), out);
+        if (Swap)
+            out = _mm256_shuffle_epi8(out, mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), out);
+    }
+    UnpremultiplyRowSsse3<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+PYTONIUM_TARGET("avx2")
+void StripRowAvx2(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    const __m128i mask128 = StripMask128(Swap);
+    const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+    int i = 0;
+    // Two overlapping 16 byte stores of 12 pixel bytes each, see StripRowSsse3.
+    for (; i + 10 <= pixels; i += 8)
+    {
+        __m256i px = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4)), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm256_castsi256_si128(px));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3 + 12), _mm256_extracti128_si256(px, 1));
+    }
+    StripRowSsse3<Swap>(dst + i * 3, src + i * 4, pixels - i);
+}
+
+constexpr RowKernels Avx2Kernels = {
+    SwizzleRowAvx2,
+    {PremultiplyRowAvx2<false>, PremultiplyRowAvx2<true>},
+    {UnpremultiplyRowAvx2<false>, UnpremultiplyRowAvx2<true>},
+    {StripRowAvx2<false>, StripRowAvx2<true>},
+};
+
+#endif // PYTONIUM_PIXEL_X86
+
+#if defined(PYTONIUM_PIXEL_NEON)
+
+// --- NEON, 16 pixels per step -----------------------------------------------
+// vld4q/vst4q deinterleave the channels, so the kernels work on planes.
+
+inline uint8x16_t PremultiplyChannelNeon(uint8x16_t color, uint8x16_t alpha)
+{
+    // vraddhn(x, (x + 128) >> 8) is the same rounding as Div255.
+    uint16x8_t lo = vmull_u8(vget_low_u8(color), vget_low_u8(alpha));
+    uint16x8_t hi = vmull_high_u8(color, alpha);
+    return vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)), vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+}
+
+inline uint16x4_t UnpremultiplyQuarterNeon(uint16x4_t color, float32x4_t alpha)
+{
+    float32x4_t value = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(color)), 255.0f);
+    float32x4_t result = vaddq_f32(vdivq_f32(value, alpha), vdupq_n_f32(0.5f));
+    return vqmovn_u32(vcvtq_u32_f32(result));
+}
+
+inline uint8x16_t UnpremultiplyChannelNeon(uint8x16_t color, const float32x4_t alpha[4], uint8x16_t zeroAlpha)
+{
+    uint16x8_t lo = vmovl_u8(vget_low_u8(color));
+    uint16x8_t hi = vmovl_high_u8(color);
+    uint16x8_t lo16 = vcombine_u16(UnpremultiplyQuarterNeon(vget_low_u16(lo), alpha[0]),
+                                   UnpremultiplyQuarterNeon(vget_high_u16(lo), alpha[1]));
+    uint16x8_t hi16 = vcombine_u16(UnpremultiplyQuarterNeon(vget_low_u16(hi), alpha[2]),
+                                   UnpremultiplyQuarterNeon(vget_high_u16(hi), alpha[3]));
+    return vbicq_u8(vcombine_u8(vqmovn_u16(lo16), vqmovn_u16(hi16)), zeroAlpha);
+}
+
+void SwizzleRowNeon(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint8x16_t b = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = b;
+        vst4q_u8(dst + i * 4, px);
+    }
+    SwizzleRowScalar(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+void PremultiplyRowNeon(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint8x16x4_t out;
+        out.val[Swap ? 2 : 0] = PremultiplyChannelNeon(px.val[0], px.val[3]);
+        out.val[1] = PremultiplyChannelNeon(px.val[1], px.val[3]);
+        out.val[Swap ? 0 : 2] = PremultiplyChannelNeon(px.val[2], px.val[3]);
+        out.val[3] = px.val[3];
+        vst4q_u8(dst + i * 4, out);
+    }
+    PremultiplyRowScalar<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+void UnpremultiplyRowNeon(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint16x8_t alphaLo = vmovl_u8(vget_low_u8(px.val[3]));
+        uint16x8_t alphaHi = vmovl_high_u8(px.val[3]);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t alpha[4] = {
+            vmaxq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(alphaLo))), one),
+            vmaxq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(alphaLo))), one),
+            vmaxq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(alphaHi))), one),
+            vmaxq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(alphaHi))), one),
+        };
+        uint8x16_t zeroAlpha = vceqq_u8(px.val[3], vdupq_n_u8(0));
+        uint8x16x4_t out;
+        out.val[Swap ? 2 : 0] = UnpremultiplyChannelNeon(px.val[0], alpha, zeroAlpha);
+        out.val[1] = UnpremultiplyChannelNeon(px.val[1], alpha, zeroAlpha);
+        out.val[Swap ? 0 : 2] = UnpremultiplyChannelNeon(px.val[2], alpha, zeroAlpha);
+        out.val[3] = px.val[3];
+        vst4q_u8(dst + i * 4, out);
+    }
+    UnpremultiplyRowScalar<Swap>(dst + i * 4, src + i * 4, pixels - i);
+}
+
+template <bool Swap>
+void StripRowNeon(uint8_t* dst, const uint8_t* src, int pixels)
+{
+    int i = 0;
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint8x16x3_t out;
+        out.val[0] = px.val[Swap ? 2 : 0];
+        out.val[1] = px.val[1];
+        out.val[2] = px.val[Swap ? 0 : 2];
+        vst3q_u8(dst + i * 3, out);
+    }
+    StripRowScalar<Swap>(dst + i * 3, src + i * 4, pixels - i);
+}
+
+constexpr RowKernels NeonKernels = {
+    SwizzleRowNeon,
+    {PremultiplyRowNeon<false>, PremultiplyRowNeon<true>},
+    {UnpremultiplyRowNeon<false>, UnpremultiplyRowNeon<true>},
+    {StripRowNeon<false>, StripRowNeon<true>},
+};
+
+#endif // PYTONIUM_PIXEL_NEON
+
+PixelConvertIsa DetectIsa()
+{
+#if defined(PYTONIUM_PIXEL_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    // AVX state must be enabled by the OS (OSXSAVE and XCR0 bits 1 and 2).
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (avx && maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return PIXEL_CONVERT_AVX2;
+    if (ssse3)
+        return PIXEL_CONVERT_SSSE3;
+    return PIXEL_CONVERT_SCALAR;
+#elif defined(PYTONIUM_PIXEL_NEON)
+    // NEON is part of the AArch64 baseline.
+    return PIXEL_CONVERT_NEON;
+#else
+    return PIXEL_CONVERT_SCALAR;
+#endif
+}
+
+const RowKernels& KernelsFor(PixelConvertIsa isa)
+{
+    switch (isa)
+    {
+#if defined(PYTONIUM_PIXEL_X86)
+        case PIXEL_CONVERT_AVX2:
+            return Avx2Kernels;
+        case PIXEL_CONVERT_SSSE3:
+            return Ssse3Kernels;
+#endif
+#if defined(PYTONIUM_PIXEL_NEON)
+        case PIXEL_CONVERT_NEON:
+            return NeonKernels;
+#endif
+        default:
+            return ScalarKernels;
+    }
+}
+
+bool IsStraight(PixelFormat format)
+{
+    return format == PIXEL_FORMAT_BGRA_STRAIGHT || format == PIXEL_FORMAT_RGBA_STRAIGHT;
+}
+
+bool IsRgbOrder(PixelFormat format)
+{
+    return format == PIXEL_FORMAT_RGBA || format == PIXEL_FORMAT_RGBA_STRAIGHT || format == PIXEL_FORMAT_RGB;
+}
+
+} // namespace
+
+int PixelFormatBytes(PixelFormat format)
+{
+    switch (format)
+    {
+        case PIXEL_FORMAT_BGRA:
+        case PIXEL_FORMAT_RGBA:
+        case PIXEL_FORMAT_BGRA_STRAIGHT:
+        case PIXEL_FORMAT_RGBA_STRAIGHT:
+            return 4;
+        case PIXEL_FORMAT_BGR:
+        case PIXEL_FORMAT_RGB:
+            return 3;
+    }
+    return 0;
+}
+
+bool PixelFormatHasAlpha(PixelFormat format)
+{
+    return PixelFormatBytes(format) == 4;
+}
+
+PixelConvertIsa GetPixelConvertIsa()
+{
+    static const PixelConvertIsa isa = DetectIsa();
+    return isa;
+}
+
+bool IsPixelConvertIsaSupported(PixelConvertIsa isa)
+{
+    PixelConvertIsa best = GetPixelConvertIsa();
+    if (isa == PIXEL_CONVERT_SCALAR || isa == best)
+        return true;
+    // AVX2 CPUs also run the SSSE3 kernels.
+    return isa == PIXEL_CONVERT_SSSE3 && best == PIXEL_CONVERT_AVX2;
+}
+
+const char* GetPixelConvertIsaName(PixelConvertIsa isa)
+{
+    switch (isa)
+    {
+        case PIXEL_CONVERT_SCALAR:
+            return "scalar";
+        case PIXEL_CONVERT_SSSE3:
+            return "ssse3";
+        case PIXEL_CONVERT_AVX2:
+            return "avx2";
+        case PIXEL_CONVERT_NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+bool ConvertPixels(const uint8_t* src, int srcStride, PixelFormat srcFormat,
+                   int x, int y, int width, int height,
+                   uint8_t* dst, int dstStride, PixelFormat dstFormat)
+{
+    return ConvertPixels(src, srcStride, srcFormat, x, y, width, height, dst, dstStride, dstFormat,
+                         GetPixelConvertIsa());
+}
+
+bool ConvertPixels(const uint8_t* src, int srcStride, PixelFormat srcFormat,
+                   int x, int y, int width, int height,
+                   uint8_t* dst, int dstStride, PixelFormat dstFormat,
+                   PixelConvertIsa isa)
+{
+    int dstBytes = PixelFormatBytes(dstFormat);
+    if (!src || !dst || !PixelFormatHasAlpha(srcFormat) || dstBytes == 0 ||
+        x < 0 || y < 0 || width < 0 || height < 0 ||
+        srcStride < (x + width) * 4 || dstStride < width * dstBytes)
+        return false;
+    if (width == 0 || height == 0)
+        return true;
+
+    const RowKernels& kernels = KernelsFor(IsPixelConvertIsaSupported(isa) ? isa : PIXEL_CONVERT_SCALAR);
+    bool swap = IsRgbOrder(srcFormat) != IsRgbOrder(dstFormat);
+    RowKernel kernel = nullptr;
+    if (dstBytes == 3)
+        kernel = kernels.Strip[swap];
+    else if (IsStraight(srcFormat) == IsStraight(dstFormat))
+        kernel = swap ? kernels.Swizzle : nullptr;
+    else if (IsStraight(dstFormat))
+        kernel = kernels.Unpremultiply[swap];
+    else
+        kernel = kernels.Premultiply[swap];
+
+    src += static_cast<size_t>(y) * srcStride + static_cast<size_t>(x) * 4;
+    for (int row = 0; row < height; row++)
+    {
+        const uint8_t* srcRow = src + static_cast<size_t>(row) * srcStride;
+        uint8_t* dstRow = dst + static_cast<size_t>(row) * dstStride;
+        if (kernel)
+            kernel(dstRow, srcRow, width);
+        else
+            std::memcpy(dstRow, srcRow, static_cast<size_t>(width) * 4);
+    }
+    return true;
+}
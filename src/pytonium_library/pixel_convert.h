@@ -0,0 +1,53 @@
+#ifndef PYTONIUM_PIXEL_CONVERT_H
+#define PYTONIUM_PIXEL_CONVERT_H
+
+#include <cstdint>
+
+// Pixel layouts for exporting OSR frames. CEF paints PIXEL_FORMAT_BGRA.
+// The 4 byte formats keep alpha, either premultiplied (as painted) or straight.
+// BGR and RGB drop alpha; taken from a premultiplied frame this is the page
+// composited over black.
+enum PixelFormat
+{
+    PIXEL_FORMAT_BGRA = 0,
+    PIXEL_FORMAT_RGBA,
+    PIXEL_FORMAT_BGRA_STRAIGHT,
+    PIXEL_FORMAT_RGBA_STRAIGHT,
+    PIXEL_FORMAT_BGR,
+    PIXEL_FORMAT_RGB,
+};
+
+// Instruction sets of the conversion kernels, in order of preference.
+enum PixelConvertIsa
+{
+    PIXEL_CONVERT_SCALAR = 0,
+    PIXEL_CONVERT_SSSE3,
+    PIXEL_CONVERT_AVX2,
+    PIXEL_CONVERT_NEON,
+};
+
+int PixelFormatBytes(PixelFormat format);
+bool PixelFormatHasAlpha(PixelFormat format);
+
+// Best instruction set of this CPU, detected once at runtime.
+PixelConvertIsa GetPixelConvertIsa();
+bool IsPixelConvertIsaSupported(PixelConvertIsa isa);
+const char* GetPixelConvertIsaName(PixelConvertIsa isa);
+
+// Converts the |width| x |height| region at |x|, |y| of |src| into |dst|. The
+// source must be one of the 4 byte formats; rows are |srcStride| and
+// |dstStride| bytes apart. Unpremultiplied colors are rounded to nearest and
+// pixels with zero alpha become transparent black. Returns false for invalid
+// arguments. |dst| must not overlap |src|.
+bool ConvertPixels(const uint8_t* src, int srcStride, PixelFormat srcFormat,
+                   int x, int y, int width, int height,
+                   uint8_t* dst, int dstStride, PixelFormat dstFormat);
+
+// Same, with the kernels of |isa| (for tests and benchmarks). Falls back to the
+// scalar kernels if this CPU lacks |isa|.
+bool ConvertPixels(const uint8_t* src, int srcStride, PixelFormat srcFormat,
+                   int x, int y, int width, int height,
+                   uint8_t* dst, int dstStride, PixelFormat dstFormat,
+                   PixelConvertIsa isa);
+
+#endif // PYTONIUM_PIXEL_CONVERT_H
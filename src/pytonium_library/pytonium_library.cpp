@@ -5,9 +5,14 @@
 #include "cef_value_wrapper.h"
 #include "include/internal/cef_types.h"
 #include "custom_protocol_scheme_handler.h"
+#include "ui_thread.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 #undef CEF_USE_SANDBOX
@@ -19,7 +24,9 @@
 // Static member definitions
 bool PytoniumLibrary::s_CefInitialized = false;
 int PytoniumLibrary::s_InstanceCount = 0;
+bool PytoniumLibrary::s_BackgroundThread = false;
 CefRefPtr<CefWrapperApp> PytoniumLibrary::s_App = nullptr;
+std::vector<CefRefPtr<BrowserPool>> PytoniumLibrary::s_BrowserPools;
 
 std::string ExePath() {
 #if OS_WIN
@@ -69,6 +76,18 @@ std::string CachePath() {
 
 PytoniumLibrary::PytoniumLibrary() = default;
 
+PytoniumLibrary::~PytoniumLibrary()
+{
+    // Tasks posted for this instance run before it is gone.
+    RunOnUiThread([] {});
+}
+
+void PytoniumLibrary::SetBackgroundThread(bool background)
+{
+    if (!s_CefInitialized)
+        s_BackgroundThread = background;
+}
+
 void PytoniumLibrary::InitPytonium(std::string start_url, int init_width, int init_height) {
   if (!s_CefInitialized) {
 #if defined(OS_WIN)
@@ -119,6 +138,7 @@ void PytoniumLibrary::InitPytonium(std::string start_url, int init_width, int in
     s_App = CefRefPtr<CefWrapperApp>(new CefWrapperApp(
         start_url, m_Javascript_Bindings, m_Javascript_Python_Bindings,
         m_StateHandlerPythonBindings, m_ContextMenuBindings, m_CustomSchemes, m_MimeTypeMap, m_FramelessWindow));
+    s_App->SetHeadless(m_Headless);
     CefWrapperBrowserProcessHandler::SetInitialResolution(init_width, init_height);
     CefExecuteProcess(main_args, s_App.get(), sandbox_info);
 
@@ -150,6 +170,11 @@ void PytoniumLibrary::InitPytonium(std::string start_url, int init_width, int in
 
     settings.no_sandbox = true;
     settings.windowless_rendering_enabled = true;
+    // CEF tells through OnScheduleMessagePumpWork when UpdateMessageLoop is
+    // due, so loops can wait for it instead of polling. In background-thread
+    // mode CEF pumps its own UI thread instead.
+    settings.external_message_pump = !s_BackgroundThread;
+    settings.multi_threaded_message_loop = s_BackgroundThread;
 
     if(m_UseCustomCefSubPath)
     {
@@ -160,12 +185,21 @@ void PytoniumLibrary::InitPytonium(std::string start_url, int init_width, int in
       CefString(&settings.browser_subprocess_path).FromASCII(ExePath().c_str());
     }
 
+    // Before CefInitialize, so the Linux zygote inherits it.
+    ExportCustomSchemes(m_CustomSchemes);
+
     if (!CefInitialize(main_args, settings, s_App.get(), sandbox_info)) {
       std::cerr << "CefInitialize failed!" << std::endl;
       return;
     }
     s_CefInitialized = true;
     g_CefInitialized = true;
+    // Headless, no native window input waits for the message loop.
+    MessagePump::Get().SetNativeWindows(!m_Headless);
+    if (s_BackgroundThread) {
+      MessagePump::Get().SetEnabled(false);
+    }
+    SetUiThreadRunning(true);
   }
 
   // Create the browser window (works for first and subsequent instances)
@@ -173,51 +207,8 @@ void PytoniumLibrary::InitPytonium(std::string start_url, int init_width, int in
                 m_UseCustomIcon ? m_CustomIconPath : "");
 }
 
-int PytoniumLibrary::CreateBrowser(const std::string& url, int width, int height,
-                                    bool frameless, const std::string& iconPath)
+CefRefPtr<CefDictionaryValue> PytoniumLibrary::CreateBindingsInfo() const
 {
-#if defined(OS_WIN)
-    if (m_OsrMode) {
-        return CreateBrowserOsr(url, width, height, iconPath, false);
-    }
-#endif
-
-    // Get or create the shared client handler
-    CefWrapperClientHandler* handler = CefWrapperClientHandler::GetInstance();
-    if (!handler) {
-        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
-        bool use_views = command_line->HasSwitch("use-views");
-        new CefWrapperClientHandler(use_views);
-        handler = CefWrapperClientHandler::GetInstance();
-    }
-
-    // Initialize browser settings
-    cef_browser_settings_t cefBrowserSettings;
-    memset(&cefBrowserSettings, 0, sizeof(cef_browser_settings_t));
-    cefBrowserSettings.size = sizeof(cef_browser_settings_t);
-    cefBrowserSettings.windowless_frame_rate = 30;
-    CefBrowserSettings browser_settings(cefBrowserSettings);
-
-    CefWindowInfo window_info;
-
-#if defined(OS_WIN)
-    window_info.runtime_style = CEF_RUNTIME_STYLE_ALLOY;
-
-    if (frameless) {
-        window_info.style = WS_POPUP | WS_VISIBLE | WS_CLIPCHILDREN | WS_CLIPSIBLINGS;
-        window_info.parent_window = nullptr;
-        window_info.bounds.x = CW_USEDEFAULT;
-        window_info.bounds.y = CW_USEDEFAULT;
-    } else {
-        window_info.SetAsPopup(nullptr, "");
-    }
-#elif defined(OS_LINUX)
-    if (frameless) {
-        window_info.SetAsWindowless(nullptr, true);
-    }
-#endif
-
-    // Serialize bindings into extra_info for the renderer
     CefRefPtr<CefDictionaryValue> extra = CefDictionaryValue::Create();
     if (!m_Javascript_Bindings.empty())
     {
@@ -264,12 +255,171 @@ int PytoniumLibrary::CreateBrowser(const std::string& url, int width, int height
         extra->SetInt("JavascriptPythonBindingsSize",
                       static_cast<int>(m_Javascript_Python_Bindings.size()));
     }
+    return extra;
+}
+
+CefRefPtr<CefBrowser> PytoniumLibrary::TakePooledBrowser(const std::string& url, bool windowless,
+                                                         CefRefPtr<CefDictionaryValue> bindings)
+{
+    for (auto& pool : s_BrowserPools)
+    {
+        CefRefPtr<CefBrowser> browser = pool->Take(url, windowless, bindings);
+        if (!browser)
+            continue;
+        CefWrapperClientHandler::GetInstance()->AdoptPooledBrowser(browser);
+        browser->GetMainFrame()->LoadURL(url);
+        return browser;
+    }
+    return nullptr;
+}
+
+bool PytoniumLibrary::StartBrowserPool(int size, const std::string& warmUrl, bool windowless)
+{
+    return StartBrowserPool(size, warmUrl, windowless, CefDictionaryValue::Create());
+}
+
+bool PytoniumLibrary::StartBindingsBrowserPool(int size, const std::string& warmUrl, bool windowless)
+{
+    return StartBrowserPool(size, warmUrl, windowless, CreateBindingsInfo());
+}
+
+bool PytoniumLibrary::StartBrowserPool(int size, const std::string& warmUrl, bool windowless,
+                                       CefRefPtr<CefDictionaryValue> bindings)
+{
+    bool result = false;
+    if (RunOnUiThread([&] { result = StartBrowserPool(size, warmUrl, windowless, bindings); }))
+        return result;
+    if (!s_CefInitialized || (!windowless && !BrowserPool::SupportsWindowed()))
+        return false;
+    for (auto it = s_BrowserPools.begin(); it != s_BrowserPools.end(); ++it)
+    {
+        if ((*it)->Serves(windowless, bindings))
+        {
+            (*it)->Shutdown();
+            s_BrowserPools.erase(it);
+            break;
+        }
+    }
+    CefRefPtr<BrowserPool> pool = new BrowserPool(size, warmUrl, windowless, bindings);
+    s_BrowserPools.push_back(pool);
+    pool->Start();
+    return true;
+}
+
+void PytoniumLibrary::StopBrowserPool()
+{
+    if (RunOnUiThread([] { StopBrowserPool(); }))
+        return;
+    for (auto& pool : s_BrowserPools)
+        pool->Shutdown();
+    s_BrowserPools.clear();
+}
+
+void PytoniumLibrary::StopBindingsBrowserPool()
+{
+    StopBrowserPool(CreateBindingsInfo());
+}
+
+void PytoniumLibrary::StopBrowserPool(CefRefPtr<CefDictionaryValue> bindings)
+{
+    if (RunOnUiThread([&] { StopBrowserPool(bindings); }))
+        return;
+    for (auto it = s_BrowserPools.begin(); it != s_BrowserPools.end();)
+    {
+        if ((*it)->Serves(false, bindings) || (*it)->Serves(true, bindings))
+        {
+            (*it)->Shutdown();
+            it = s_BrowserPools.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+BrowserPoolStats PytoniumLibrary::GetBrowserPoolStats()
+{
+    BrowserPoolStats result;
+    if (RunOnUiThread([&] { result = GetBrowserPoolStats(); }))
+        return result;
+    for (const auto& pool : s_BrowserPools)
+    {
+        BrowserPoolStats stats = pool->GetStats();
+        result.Warm += stats.Warm;
+        result.Starting += stats.Starting;
+        result.Created += stats.Created;
+        result.Taken += stats.Taken;
+        result.Missed += stats.Missed;
+    }
+    return result;
+}
+
+int PytoniumLibrary::CreateBrowser(const std::string& url, int width, int height,
+                                    bool frameless, const std::string& iconPath)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = CreateBrowser(url, width, height, frameless, iconPath); }))
+        return result;
+#if defined(OS_LINUX)
+    // Linux has no layered OSR window; frameless browsers were windowless
+    // before and now render through the frame handler.
+    if (m_OsrMode || frameless) {
+#else
+    if (m_OsrMode) {
+#endif
+        return CreateBrowserOsr(url, width, height, iconPath, false);
+    }
+
+    // Get or create the shared client handler
+    CefWrapperClientHandler* handler = CefWrapperClientHandler::GetOrCreateInstance();
+
+    // Initialize browser settings
+    cef_browser_settings_t cefBrowserSettings;
+    memset(&cefBrowserSettings, 0, sizeof(cef_browser_settings_t));
+    cefBrowserSettings.size = sizeof(cef_browser_settings_t);
+    cefBrowserSettings.windowless_frame_rate = m_FrameRate;
+    CefBrowserSettings browser_settings(cefBrowserSettings);
+
+    CefWindowInfo window_info;
+
+#if defined(OS_WIN)
+    window_info.runtime_style = CEF_RUNTIME_STYLE_ALLOY;
+
+    if (frameless) {
+        window_info.style = WS_POPUP | WS_VISIBLE | WS_CLIPCHILDREN | WS_CLIPSIBLINGS;
+        window_info.parent_window = nullptr;
+        window_info.bounds.x = CW_USEDEFAULT;
+        window_info.bounds.y = CW_USEDEFAULT;
+    } else {
+        window_info.SetAsPopup(nullptr, "");
+    }
+#endif
+
+    // Serialize bindings into extra_info for the renderer
+    CefRefPtr<CefDictionaryValue> extra = CreateBindingsInfo();
 
     window_info.bounds.width = width;
     window_info.bounds.height = height;
 
-    m_Browser = CefBrowserHost::CreateBrowserSync(window_info, handler, url,
-                                                   browser_settings, extra, nullptr);
+    m_Browser = TakePooledBrowser(url, false, extra);
+#if defined(OS_WIN)
+    if (m_Browser) {
+        // Pooled windows are hidden popups; give them the style they would
+        // have been created with, centered on the work area.
+        HWND hwnd = m_Browser->GetHost()->GetWindowHandle();
+        LONG_PTR style = WS_CLIPCHILDREN | WS_CLIPSIBLINGS | (frameless ? WS_POPUP : WS_OVERLAPPEDWINDOW);
+        SetWindowLongPtrW(hwnd, GWL_STYLE, style);
+        RECT workArea;
+        SystemParametersInfoW(SPI_GETWORKAREA, 0, &workArea, 0);
+        int x = workArea.left + std::max(0, static_cast<int>(workArea.right - workArea.left) - width) / 2;
+        int y = workArea.top + std::max(0, static_cast<int>(workArea.bottom - workArea.top) - height) / 2;
+        SetWindowPos(hwnd, nullptr, x, y, width, height, SWP_NOZORDER | SWP_FRAMECHANGED | SWP_SHOWWINDOW);
+    }
+#endif
+    if (!m_Browser)
+        m_Browser = CefBrowserHost::CreateBrowserSync(window_info, handler, url,
+                                                       browser_settings, extra, nullptr);
     if (!m_Browser) {
         std::cerr << "CreateBrowserSync failed!" << std::endl;
         return -1;
@@ -282,6 +432,7 @@ int PytoniumLibrary::CreateBrowser(const std::string& url, int width, int height
     handler->RegisterBrowserBindings(m_BrowserId,
         m_Javascript_Bindings, m_Javascript_Python_Bindings,
         m_StateHandlerPythonBindings, m_ContextMenuBindings);
+    handler->SetStateCacheEnabled(m_BrowserId, m_StateCacheEnabled);
 
     // Set icon if specified
     if (!iconPath.empty())
@@ -303,29 +454,66 @@ int PytoniumLibrary::CreateBrowser(const std::string& url, int width, int height
 
 void PytoniumLibrary::CloseBrowser()
 {
+    if (RunOnUiThread([&] { CloseBrowser(); }))
+        return;
     if (m_Browser) {
         m_Browser->GetHost()->CloseBrowser(true);
         m_Browser = nullptr;
         m_BrowserId = -1;
+        m_OsrFrameHandler = nullptr;
+        if (m_FrameRateGovernor) {
+            m_FrameRateGovernor->SetBrowser(nullptr);
+            m_FrameRateGovernor = nullptr;
+        }
         s_InstanceCount--;
     }
 }
 
 bool PytoniumLibrary::IsBrowserRunning() const
 {
+    // m_Browser and m_BrowserId are only written on the UI thread.
+    bool result = false;
+    if (RunOnUiThread([&] { result = IsBrowserRunning(); }))
+        return result;
     return m_Browser != nullptr && m_BrowserId >= 0 &&
            g_BrowserCount.load(std::memory_order_acquire) > 0;
 }
 
 void PytoniumLibrary::ShutdownCef()
 {
+    StopBrowserPool();
+    // Browsers nobody waits for otherwise: the pooled ones and those of PDF pools.
+    auto hiddenBrowsers = [] {
+        return g_PooledBrowserCount.load(std::memory_order_acquire) + g_PdfBrowserCount.load(std::memory_order_acquire);
+    };
+    if (s_BackgroundThread && IsUiThreadRunning())
+    {
+        // CefShutdown needs the browsers closed, which happens on the UI thread.
+        WaitForUiThread([&hiddenBrowsers] {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (g_BrowserCount.load(std::memory_order_acquire) + hiddenBrowsers() > 0 &&
+                   std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        });
+    }
+    else if (!s_BackgroundThread)
+    {
+        // The hidden browsers were closed just now; let them finish.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (hiddenBrowsers() > 0 && std::chrono::steady_clock::now() < deadline)
+            CefDoMessageLoopWork();
+    }
+    SetUiThreadRunning(false);
     g_CefInitialized = false;
     s_CefInitialized = false;
     s_App = nullptr;
     CefShutdown();
+    DiscardUiThreadTasks();
+    MessagePump::Get().SetEnabled(true);
 }
 
 void PytoniumLibrary::ExecuteJavascript(const std::string& code) {
+  if (PostToUiThread([=, this] { ExecuteJavascript(code); })) return;
   if (!m_Browser) return;
   CefRefPtr<CefFrame> frame = m_Browser->GetMainFrame();
   if (g_BrowserCount.load(std::memory_order_acquire) > 0) {
@@ -336,7 +524,23 @@ void PytoniumLibrary::ExecuteJavascript(const std::string& code) {
   }
 }
 
+int PytoniumLibrary::EvaluateJavascript(const std::string& code, state_request_callback_ptr callback, void* user_data) {
+  int result = -1;
+  if (RunOnUiThread([&] { result = EvaluateJavascript(code, callback, user_data); })) return result;
+  auto* client = CefWrapperClientHandler::GetInstance();
+  if (!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+  int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+  CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("evaluate-javascript");
+  msg->GetArgumentList()->SetInt(0, requestId);
+  msg->GetArgumentList()->SetString(1, code);
+  m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+  return requestId;
+}
+
 void PytoniumLibrary::ShutdownPytonium() {
+  StopPdfPool();
   CloseBrowser();
   if (s_InstanceCount <= 0 && s_CefInitialized) {
     ShutdownCef();
@@ -345,9 +549,23 @@ void PytoniumLibrary::ShutdownPytonium() {
 
 bool PytoniumLibrary::IsRunning() { return g_BrowserCount.load(std::memory_order_acquire) > 0; }
 
-void PytoniumLibrary::UpdateMessageLoop() { CefDoMessageLoopWork(); }
+void PytoniumLibrary::UpdateMessageLoop() { MessagePump::Get().DoWork(); }
+
+bool PytoniumLibrary::WaitForMessageLoopWork(int64_t timeoutMs) { return MessagePump::Get().WaitForWork(timeoutMs); }
+
+int64_t PytoniumLibrary::GetMessageLoopDelay() { return MessagePump::Get().GetDelayMs(); }
+
+int PytoniumLibrary::GetMessageLoopWakeupFd() { return MessagePump::Get().GetWakeupFd(); }
+
+void PytoniumLibrary::SetMessageLoopMaxDelay(int64_t delayMs) { MessagePump::Get().SetMaxDelayMs(delayMs); }
+
+int64_t PytoniumLibrary::GetMessageLoopMaxDelay() { return MessagePump::Get().GetMaxDelayMs(); }
+
+MessagePumpStats PytoniumLibrary::GetMessageLoopStats() { return MessagePump::Get().GetStats(); }
 
 bool PytoniumLibrary::IsReadyToExecuteJavascript() {
+  bool result = false;
+  if (RunOnUiThread([&] { result = IsReadyToExecuteJavascript(); })) return result;
   auto* client = CefWrapperClientHandler::GetInstance();
   if (!client || !m_Browser) return false;
   return client->IsReadyToExecuteJs(m_BrowserId);
@@ -355,6 +573,7 @@ bool PytoniumLibrary::IsReadyToExecuteJavascript() {
 
 void PytoniumLibrary::AddJavascriptBinding(std::string name, js_binding_function_ptr jsNativeApiFunctionPtr, std::string javascript_object)
 {
+  if (PostToUiThread([=, this] { AddJavascriptBinding(name, jsNativeApiFunctionPtr, javascript_object); })) return;
   m_Javascript_Bindings.emplace_back(std::move(name), jsNativeApiFunctionPtr, std::move(javascript_object));
 }
 
@@ -362,6 +581,7 @@ void PytoniumLibrary::AddJavascriptPythonBinding(
     const std::string& name,
     js_python_bindings_handler_function_ptr python_bindings_handler ,
     js_python_callback_object_ptr python_callback_object, const std::string& javascript_object, bool returns_value) {
+  if (PostToUiThread([=, this] { AddJavascriptPythonBinding(name, python_bindings_handler, python_callback_object, javascript_object, returns_value); })) return;
   m_Javascript_Python_Bindings.emplace_back(python_bindings_handler, name, python_callback_object, javascript_object, returns_value);
 }
 
@@ -376,6 +596,7 @@ void PytoniumLibrary::SetCustomCachePath(std::string cef_cache_path) {
 }
 
 void PytoniumLibrary::LoadUrl(std::string url) {
+  if (PostToUiThread([=, this] { LoadUrl(url); })) return;
   if (m_Browser && m_Browser->GetMainFrame()) {
     m_Browser->GetMainFrame()->LoadURL(url);
   }
@@ -398,6 +619,8 @@ void PytoniumLibrary::SetCustomIconPath(std::string icon_path) {
 
 void PytoniumLibrary::ReturnValueToJavascript(int message_id, CefValueWrapper returnValue)
 {
+    if (PostToUiThread([=, this] { ReturnValueToJavascript(message_id, returnValue); }))
+        return;
     if (!m_Browser) return;
 
     CefRefPtr<CefProcessMessage> return_to_javascript_message =
@@ -413,15 +636,37 @@ void PytoniumLibrary::ReturnValueToJavascript(int message_id, CefValueWrapper re
 }
 
 void PytoniumLibrary::AddStateHandlerPythonBinding(state_handler_function_ptr stateHandlerFunctionPtr,
-                                                   state_callback_object_ptr stateCallbackObjectPtr, const std::vector<std::string>& namespacesToSubscribeTo)
+                                                   state_callback_object_ptr stateCallbackObjectPtr, const std::vector<std::string>& namespacesToSubscribeTo,
+                                                   state_batch_handler_function_ptr stateBatchHandlerFunctionPtr)
 {
-    m_StateHandlerPythonBindings.emplace_back(stateHandlerFunctionPtr, stateCallbackObjectPtr, namespacesToSubscribeTo);
+    if (PostToUiThread([=, this] { AddStateHandlerPythonBinding(stateHandlerFunctionPtr, stateCallbackObjectPtr, namespacesToSubscribeTo, stateBatchHandlerFunctionPtr); }))
+        return;
+    m_StateHandlerPythonBindings.emplace_back(stateHandlerFunctionPtr, stateCallbackObjectPtr, namespacesToSubscribeTo, stateBatchHandlerFunctionPtr);
 }
 
 void PytoniumLibrary::SetState(const std::string& stateNamespace, const std::string& key, CefValueWrapper value)
 {
+    SetState(std::this_thread::get_id(), stateNamespace, key, std::move(value));
+}
+
+void PytoniumLibrary::SetState(std::thread::id caller, const std::string& stateNamespace, const std::string& key,
+                               CefValueWrapper value)
+{
+    if (PostToUiThread([=, this] { SetState(caller, stateNamespace, key, value); }))
+        return;
+    if(PendingStateBatch* batch = OpenStateBatch(caller))
+    {
+        batch->Removals[stateNamespace].erase(key);
+        batch->Updates[stateNamespace][key] = std::move(value);
+        return;
+    }
+
     if(!m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return;
 
+    if (auto* client = CefWrapperClientHandler::GetInstance()) {
+        client->UpdateCachedState(m_BrowserId, stateNamespace, key, value);
+    }
+
     CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("set-app-state");
     CefRefPtr<CefListValue> args = msg->GetArgumentList();
     args->SetString(0, stateNamespace);
@@ -430,10 +675,53 @@ void PytoniumLibrary::SetState(const std::string& stateNamespace, const std::str
     m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
 }
 
+void PytoniumLibrary::SetStates(const std::string& stateNamespace, const std::map<std::string, CefValueWrapper>& values)
+{
+    SetStates(std::this_thread::get_id(), stateNamespace, values);
+}
+
+void PytoniumLibrary::SetStates(std::thread::id caller, const std::string& stateNamespace,
+                                const std::map<std::string, CefValueWrapper>& values)
+{
+    if (PostToUiThread([=, this] { SetStates(caller, stateNamespace, values); }))
+        return;
+    if(values.empty()) return;
+
+    if(PendingStateBatch* batch = OpenStateBatch(caller))
+    {
+        for (const auto& [key, value] : values)
+        {
+            batch->Removals[stateNamespace].erase(key);
+            batch->Updates[stateNamespace][key] = value;
+        }
+        return;
+    }
+
+    SendStateBatch({{stateNamespace, values}}, {});
+}
+
 void PytoniumLibrary::RemoveState(const std::string& stateNamespace, const std::string& key)
 {
+    RemoveState(std::this_thread::get_id(), stateNamespace, key);
+}
+
+void PytoniumLibrary::RemoveState(std::thread::id caller, const std::string& stateNamespace, const std::string& key)
+{
+    if (PostToUiThread([=, this] { RemoveState(caller, stateNamespace, key); }))
+        return;
+    if(PendingStateBatch* batch = OpenStateBatch(caller))
+    {
+        batch->Updates[stateNamespace].erase(key);
+        batch->Removals[stateNamespace].insert(key);
+        return;
+    }
+
     if(!m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return;
 
+    if (auto* client = CefWrapperClientHandler::GetInstance()) {
+        client->InvalidateCachedState(m_BrowserId, stateNamespace, key);
+    }
+
     CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("remove-app-state");
     CefRefPtr<CefListValue> args = msg->GetArgumentList();
     args->SetString(0, stateNamespace);
@@ -441,16 +729,266 @@ void PytoniumLibrary::RemoveState(const std::string& stateNamespace, const std::
     m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
 }
 
+int PytoniumLibrary::GetState(const std::string& stateNamespace, const std::string& key,
+                              state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = GetState(stateNamespace, key, callback, user_data); }))
+        return result;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if(!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+    CefValueWrapper cached;
+    if (client->GetCachedState(m_BrowserId, stateNamespace, key, cached))
+    {
+        callback(user_data, 0, true, cached);
+        return 0;
+    }
+
+    int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("get-app-state");
+    CefRefPtr<CefListValue> args = msg->GetArgumentList();
+    args->SetInt(0, requestId);
+    args->SetString(1, stateNamespace);
+    args->SetString(2, key);
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+    return requestId;
+}
+
+void PytoniumLibrary::SetStateCacheEnabled(bool enabled)
+{
+    if (PostToUiThread([=, this] { SetStateCacheEnabled(enabled); }))
+        return;
+    m_StateCacheEnabled = enabled;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if (client && m_BrowserId >= 0) {
+        client->SetStateCacheEnabled(m_BrowserId, enabled);
+    }
+}
+
+int PytoniumLibrary::GetStateChangesSince(const std::string& stateNamespace, uint64_t sinceVersion,
+                                          state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = GetStateChangesSince(stateNamespace, sinceVersion, callback, user_data); }))
+        return result;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if(!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+    int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("get-app-state-changes");
+    CefRefPtr<CefListValue> args = msg->GetArgumentList();
+    args->SetInt(0, requestId);
+    args->SetString(1, stateNamespace);
+    args->SetDouble(2, static_cast<double>(sinceVersion));
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+    return requestId;
+}
+
+int PytoniumLibrary::CompareAndSetState(const std::string& stateNamespace, const std::string& key, uint64_t expectedVersion,
+                                        CefValueWrapper value, state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = CompareAndSetState(stateNamespace, key, expectedVersion, value, callback, user_data); }))
+        return result;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if(!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+    // The outcome is only known in the renderer, so the cached value can no longer be trusted
+    client->InvalidateCachedState(m_BrowserId, stateNamespace, key);
+    int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("compare-and-set-app-state");
+    CefRefPtr<CefListValue> args = msg->GetArgumentList();
+    args->SetInt(0, requestId);
+    args->SetString(1, stateNamespace);
+    args->SetString(2, key);
+    args->SetDouble(3, static_cast<double>(expectedVersion));
+    args->SetValue(4, CefValueWrapperHelper::ConvertWrapperToCefValue(value));
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+    return requestId;
+}
+
+int PytoniumLibrary::GetStateVersion(const std::string& stateNamespace, const std::string& key,
+                                     state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = GetStateVersion(stateNamespace, key, callback, user_data); }))
+        return result;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if(!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+    int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("get-app-state-version");
+    CefRefPtr<CefListValue> args = msg->GetArgumentList();
+    args->SetInt(0, requestId);
+    args->SetString(1, stateNamespace);
+    args->SetString(2, key);
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+    return requestId;
+}
+
+void PytoniumLibrary::BeginStateBatch()
+{
+    BeginStateBatch(std::this_thread::get_id());
+}
+
+void PytoniumLibrary::BeginStateBatch(std::thread::id caller)
+{
+    if (PostToUiThread([=, this] { BeginStateBatch(caller); }))
+        return;
+    m_StateBatches[caller].emplace_back();
+}
+
+void PytoniumLibrary::CommitStateBatch()
+{
+    CommitStateBatch(std::this_thread::get_id());
+}
+
+void PytoniumLibrary::CommitStateBatch(std::thread::id caller)
+{
+    if (PostToUiThread([=, this] { CommitStateBatch(caller); }))
+        return;
+    auto levels = m_StateBatches.find(caller);
+    if(levels == m_StateBatches.end()) return;
+
+    PendingStateBatch batch = std::move(levels->second.back());
+    levels->second.pop_back();
+    if(levels->second.empty())
+    {
+        m_StateBatches.erase(levels);
+        SendStateBatch(batch.Updates, batch.Removals);
+        return;
+    }
+
+    // Nested: the changes become part of the enclosing batch, later ones win.
+    auto& outer = levels->second.back();
+    for (auto& [stateNamespace, values] : batch.Updates)
+    {
+        for (auto& [key, value] : values)
+        {
+            outer.Removals[stateNamespace].erase(key);
+            outer.Updates[stateNamespace][key] = std::move(value);
+        }
+    }
+    for (const auto& [stateNamespace, keys] : batch.Removals)
+    {
+        for (const auto& key : keys)
+        {
+            outer.Updates[stateNamespace].erase(key);
+            outer.Removals[stateNamespace].insert(key);
+        }
+    }
+}
+
+void PytoniumLibrary::DiscardStateBatch()
+{
+    DiscardStateBatch(std::this_thread::get_id());
+}
+
+void PytoniumLibrary::DiscardStateBatch(std::thread::id caller)
+{
+    if (PostToUiThread([=, this] { DiscardStateBatch(caller); }))
+        return;
+    auto levels = m_StateBatches.find(caller);
+    if(levels == m_StateBatches.end()) return;
+    levels->second.pop_back();
+    if(levels->second.empty())
+        m_StateBatches.erase(levels);
+}
+
+bool PytoniumLibrary::GetPendingStateBatch(PendingStateBatch& batch)
+{
+    return GetPendingStateBatch(std::this_thread::get_id(), batch);
+}
+
+bool PytoniumLibrary::GetPendingStateBatch(std::thread::id caller, PendingStateBatch& batch)
+{
+    bool result = false;
+    if (RunOnUiThread([&] { result = GetPendingStateBatch(caller, batch); }))
+        return result;
+    const PendingStateBatch* open = OpenStateBatch(caller);
+    if(!open) return false;
+    batch = *open;
+    return true;
+}
+
+PendingStateBatch* PytoniumLibrary::OpenStateBatch(std::thread::id caller)
+{
+    auto levels = m_StateBatches.find(caller);
+    return levels == m_StateBatches.end() ? nullptr : &levels->second.back();
+}
+
+void PytoniumLibrary::SendStateBatch(const std::map<std::string, std::map<std::string, CefValueWrapper>>& updates,
+                                     const std::map<std::string, std::set<std::string>>& removals)
+{
+    if(!m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return;
+
+    CefRefPtr<CefDictionaryValue> updatesDict = CefDictionaryValue::Create();
+    for (const auto& [stateNamespace, values] : updates)
+    {
+        if (values.empty()) continue;
+        CefRefPtr<CefDictionaryValue> namespaceDict = CefDictionaryValue::Create();
+        for (const auto& [key, value] : values)
+        {
+            CefValueWrapper wrapper = value;
+            namespaceDict->SetValue(key, CefValueWrapperHelper::ConvertWrapperToCefValue(wrapper));
+        }
+        updatesDict->SetDictionary(stateNamespace, namespaceDict);
+    }
+
+    CefRefPtr<CefDictionaryValue> removalsDict = CefDictionaryValue::Create();
+    for (const auto& [stateNamespace, keys] : removals)
+    {
+        if (keys.empty()) continue;
+        CefRefPtr<CefListValue> keyList = CefListValue::Create();
+        size_t index = 0;
+        for (const auto& key : keys)
+        {
+            keyList->SetString(index++, key);
+        }
+        removalsDict->SetList(stateNamespace, keyList);
+    }
+
+    if (updatesDict->GetSize() == 0 && removalsDict->GetSize() == 0) return;
+
+    if (auto* client = CefWrapperClientHandler::GetInstance()) {
+        for (const auto& [stateNamespace, keys] : removals) {
+            for (const auto& key : keys) {
+                client->InvalidateCachedState(m_BrowserId, stateNamespace, key);
+            }
+        }
+        for (const auto& [stateNamespace, values] : updates) {
+            for (const auto& [key, value] : values) {
+                client->UpdateCachedState(m_BrowserId, stateNamespace, key, value);
+            }
+        }
+    }
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("set-app-state-batch");
+    CefRefPtr<CefListValue> args = msg->GetArgumentList();
+    args->SetDictionary(0, updatesDict);
+    args->SetDictionary(1, removalsDict);
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+}
+
 void PytoniumLibrary::AddContextMenuEntry(context_menu_handler_function_ptr context_menuHandlerFunctionPtr,
                                           context_menu_handler_object_ptr context_menuCallbackObjectPtr,
                                           const std::string& contextMenuNameSpace, const std::string& contextMenuDisplayName,
                                           int contextMenuId)
 {
+    if (PostToUiThread([=, this] { AddContextMenuEntry(context_menuHandlerFunctionPtr, context_menuCallbackObjectPtr, contextMenuNameSpace, contextMenuDisplayName, contextMenuId); }))
+        return;
     m_ContextMenuBindings.emplace_back(contextMenuDisplayName, contextMenuId, context_menuHandlerFunctionPtr, context_menuCallbackObjectPtr, contextMenuNameSpace);
 }
 
 void PytoniumLibrary::SetCurrentContextMenuNamespace(const std::string& contextMenuNamespace)
 {
+    if (PostToUiThread([=, this] { SetCurrentContextMenuNamespace(contextMenuNamespace); }))
+        return;
     auto* client = CefWrapperClientHandler::GetInstance();
     if (client && m_BrowserId >= 0) {
         client->SetCurrentContextMenuName(m_BrowserId, contextMenuNamespace);
@@ -459,29 +997,110 @@ void PytoniumLibrary::SetCurrentContextMenuNamespace(const std::string& contextM
 
 void PytoniumLibrary::SetShowDebugContextMenu(bool show)
 {
+    if (PostToUiThread([=, this] { SetShowDebugContextMenu(show); }))
+        return;
     auto* client = CefWrapperClientHandler::GetInstance();
     if (client && m_BrowserId >= 0) {
         client->SetShowDebugContextMenu(m_BrowserId, show);
     }
 }
 
-void PytoniumLibrary::AddCustomScheme(std::string schemeIdentifier, std::string contentRootFolder)
+void PytoniumLibrary::AddCustomScheme(std::string schemeIdentifier, std::string contentRootFolder, std::string cacheControl,
+                                      int schemeOptions, std::map<std::string, std::string> responseHeaders)
 {
-    m_CustomSchemes.emplace_back(schemeIdentifier, contentRootFolder);
+    if (PostToUiThread([=, this] { AddCustomScheme(schemeIdentifier, contentRootFolder, cacheControl, schemeOptions, responseHeaders); }))
+        return;
+    // The handlers parse "scheme://path" URLs, so the scheme is always standard.
+    m_CustomSchemes.emplace_back(std::move(schemeIdentifier), std::move(contentRootFolder), std::move(cacheControl),
+                                 schemeOptions | CEF_SCHEME_OPTION_STANDARD, std::move(responseHeaders));
 }
 
 void PytoniumLibrary::AddMimeTypeMapping(const std::string& fileExtension, std::string mimeType)
 {
+    if (PostToUiThread([=, this] { AddMimeTypeMapping(fileExtension, mimeType); }))
+        return;
     m_MimeTypeMap[fileExtension] = std::move(mimeType);
 }
 
+void PytoniumLibrary::AddSchemeRoute(const std::string& schemeIdentifier, const std::string& prefix,
+                                     scheme_route_handler_ptr handler, void* userData)
+{
+    SchemeRouteRegistry::Instance().AddRoute(schemeIdentifier, prefix, handler, userData);
+}
+
+void PytoniumLibrary::RemoveSchemeRoute(const std::string& schemeIdentifier, const std::string& prefix)
+{
+    SchemeRouteRegistry::Instance().RemoveRoute(schemeIdentifier, prefix);
+}
+
+void PytoniumLibrary::AddVirtualFile(const std::string& schemeIdentifier, const std::string& path, std::string data, std::string mimeType)
+{
+    SchemeRouteRegistry::Instance().AddVirtualFile(schemeIdentifier, path, std::move(data), std::move(mimeType));
+}
+
+void PytoniumLibrary::RemoveVirtualFile(const std::string& schemeIdentifier, const std::string& path)
+{
+    SchemeRouteRegistry::Instance().RemoveVirtualFile(schemeIdentifier, path);
+}
+
+bool PytoniumLibrary::RespondSchemeRequest(int requestId, int status, const std::string& mimeType,
+                                           const std::map<std::string, std::string>& headers)
+{
+    CefRefPtr<SchemeRouteResponse> response = SchemeRouteRegistry::Instance().GetResponse(requestId);
+    return response && response->Respond(status, mimeType, headers);
+}
+
+bool PytoniumLibrary::WriteSchemeRequest(int requestId, const std::string& data)
+{
+    CefRefPtr<SchemeRouteResponse> response = SchemeRouteRegistry::Instance().GetResponse(requestId);
+    return response && response->Write(data);
+}
+
+bool PytoniumLibrary::FinishSchemeRequest(int requestId)
+{
+    CefRefPtr<SchemeRouteResponse> response = SchemeRouteRegistry::Instance().GetResponse(requestId);
+    if (!response)
+        return false;
+    SchemeRouteRegistry::Instance().ReleaseResponse(requestId);
+    return response->Finish();
+}
+
+void PytoniumLibrary::SetSchemeRouteTimeout(int milliseconds)
+{
+    SchemeRouteRegistry::Instance().SetResponseTimeout(milliseconds);
+}
+
+int PytoniumLibrary::GetSchemeRouteTimeout()
+{
+    return SchemeRouteRegistry::Instance().GetResponseTimeout();
+}
+
+void PytoniumLibrary::SetAssetCacheBudget(size_t bytes)
+{
+    AssetCache::Instance().SetBudget(bytes);
+}
+
+void PytoniumLibrary::ClearAssetCache()
+{
+    AssetCache::Instance().Clear();
+}
+
+AssetCacheStats PytoniumLibrary::GetAssetCacheStats()
+{
+    return AssetCache::Instance().GetStats();
+}
+
 void PytoniumLibrary::SetFramelessWindow(bool frameless)
 {
+    if (PostToUiThread([=, this] { SetFramelessWindow(frameless); }))
+        return;
     m_FramelessWindow = frameless;
 }
 
 void PytoniumLibrary::MinimizeWindow()
 {
+    if (PostToUiThread([this] { MinimizeWindow(); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
     CefWindowHandle hwnd = m_Browser->GetHost()->GetWindowHandle();
@@ -493,6 +1112,8 @@ void PytoniumLibrary::MinimizeWindow()
 
 void PytoniumLibrary::MaximizeWindow()
 {
+    if (PostToUiThread([this] { MaximizeWindow(); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
     m_Browser->GetHost()->SetFocus(true);
@@ -505,6 +1126,8 @@ void PytoniumLibrary::MaximizeWindow()
 
 void PytoniumLibrary::RestoreWindow()
 {
+    if (PostToUiThread([this] { RestoreWindow(); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
     CefWindowHandle hwnd = m_Browser->GetHost()->GetWindowHandle();
@@ -516,6 +1139,8 @@ void PytoniumLibrary::RestoreWindow()
 
 void PytoniumLibrary::CloseWindow()
 {
+    if (PostToUiThread([this] { CloseWindow(); }))
+        return;
     if (m_Browser) {
         m_Browser->GetHost()->CloseBrowser(false);
     }
@@ -523,6 +1148,9 @@ void PytoniumLibrary::CloseWindow()
 
 bool PytoniumLibrary::IsMaximized()
 {
+    bool result = false;
+    if (RunOnUiThread([&] { result = IsMaximized(); }))
+        return result;
 #if defined(OS_WIN)
     if (!m_Browser) return false;
     CefWindowHandle hwnd = m_Browser->GetHost()->GetWindowHandle();
@@ -539,6 +1167,8 @@ bool PytoniumLibrary::IsMaximized()
 
 void PytoniumLibrary::DragWindow(int deltaX, int deltaY)
 {
+    if (PostToUiThread([=, this] { DragWindow(deltaX, deltaY); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
     CefWindowHandle hwnd = m_Browser->GetHost()->GetWindowHandle();
@@ -555,6 +1185,8 @@ void PytoniumLibrary::DragWindow(int deltaX, int deltaY)
 
 void PytoniumLibrary::GetWindowPosition(int& x, int& y)
 {
+    if (RunOnUiThread([&] { GetWindowPosition(x, y); }))
+        return;
     x = 0;
     y = 0;
 #if defined(OS_WIN)
@@ -572,6 +1204,8 @@ void PytoniumLibrary::GetWindowPosition(int& x, int& y)
 
 void PytoniumLibrary::SetWindowPosition(int x, int y)
 {
+    if (PostToUiThread([=, this] { SetWindowPosition(x, y); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
     CefWindowHandle hwnd = m_Browser->GetHost()->GetWindowHandle();
@@ -583,9 +1217,16 @@ void PytoniumLibrary::SetWindowPosition(int x, int y)
 
 void PytoniumLibrary::GetWindowSize(int& width, int& height)
 {
+    if (RunOnUiThread([&] { GetWindowSize(width, height); }))
+        return;
     width = 0;
     height = 0;
 
+    if (m_OsrFrameHandler) {
+        m_OsrFrameHandler->GetSize(width, height);
+        return;
+    }
+
 #if defined(OS_WIN)
     if (!m_Browser) return;
 
@@ -602,6 +1243,13 @@ void PytoniumLibrary::GetWindowSize(int& width, int& height)
 
 void PytoniumLibrary::SetWindowSize(int width, int height)
 {
+    if (PostToUiThread([=, this] { SetWindowSize(width, height); }))
+        return;
+    if (m_OsrFrameHandler) {
+        m_OsrFrameHandler->SetSize(width, height);
+        return;
+    }
+
 #if defined(OS_WIN)
     if (!m_Browser) return;
 
@@ -616,6 +1264,8 @@ void PytoniumLibrary::SetWindowSize(int width, int height)
 
 void PytoniumLibrary::SetOnTitleChangeCallback(void (*callback)(void*, const char*), void* user_data)
 {
+    if (PostToUiThread([=, this] { SetOnTitleChangeCallback(callback, user_data); }))
+        return;
     auto* client = CefWrapperClientHandler::GetInstance();
     if (client && m_BrowserId >= 0) {
         client->SetOnTitleChangeCallback(m_BrowserId, callback, user_data);
@@ -624,6 +1274,8 @@ void PytoniumLibrary::SetOnTitleChangeCallback(void (*callback)(void*, const cha
 
 void PytoniumLibrary::SetOnAddressChangeCallback(void (*callback)(void*, const char*), void* user_data)
 {
+    if (PostToUiThread([=, this] { SetOnAddressChangeCallback(callback, user_data); }))
+        return;
     auto* client = CefWrapperClientHandler::GetInstance();
     if (client && m_BrowserId >= 0) {
         client->SetOnAddressChangeCallback(m_BrowserId, callback, user_data);
@@ -632,6 +1284,8 @@ void PytoniumLibrary::SetOnAddressChangeCallback(void (*callback)(void*, const c
 
 void PytoniumLibrary::SetOnFullscreenChangeCallback(void (*callback)(void*, bool), void* user_data)
 {
+    if (PostToUiThread([=, this] { SetOnFullscreenChangeCallback(callback, user_data); }))
+        return;
     auto* client = CefWrapperClientHandler::GetInstance();
     if (client && m_BrowserId >= 0) {
         client->SetOnFullscreenChangeCallback(m_BrowserId, callback, user_data);
@@ -640,6 +1294,9 @@ void PytoniumLibrary::SetOnFullscreenChangeCallback(void (*callback)(void*, bool
 
 void* PytoniumLibrary::GetNativeWindowHandle()
 {
+    void* result = nullptr;
+    if (RunOnUiThread([&] { result = GetNativeWindowHandle(); }))
+        return result;
 #if defined(OS_WIN)
     // For OSR browsers, return the layered window handle
     if (m_OsrMode && m_OsrWindow) {
@@ -654,6 +1311,8 @@ void* PytoniumLibrary::GetNativeWindowHandle()
 
 void PytoniumLibrary::ResizeWindow(int newWidth, int newHeight, int anchor)
 {
+    if (PostToUiThread([=, this] { ResizeWindow(newWidth, newHeight, anchor); }))
+        return;
 #if defined(OS_WIN)
     if (!m_Browser) return;
 
@@ -685,116 +1344,326 @@ void PytoniumLibrary::ResizeWindow(int newWidth, int newHeight, int anchor)
 }
 
 void PytoniumLibrary::SetOsrMode(bool osr) {
+    if (PostToUiThread([=, this] { SetOsrMode(osr); }))
+        return;
     m_OsrMode = osr;
 }
 
+void PytoniumLibrary::SetHeadless(bool headless) {
+    if (PostToUiThread([=, this] { SetHeadless(headless); }))
+        return;
+    m_Headless = headless;
+    if (headless)
+        m_OsrMode = true;
+}
+
+void PytoniumLibrary::SetFrameCallback(osr_frame_callback_ptr callback, void* user_data)
+{
+    if (PostToUiThread([=, this] { SetFrameCallback(callback, user_data); }))
+        return;
+    m_FrameCallback = callback;
+    m_FrameCallbackUserData = user_data;
+    if (m_OsrFrameHandler)
+        m_OsrFrameHandler->SetFrameCallback(callback, user_data);
+}
+
+OsrPaintStats PytoniumLibrary::GetOsrPaintStats()
+{
+    OsrPaintStats result;
+    if (RunOnUiThread([&] { result = GetOsrPaintStats(); }))
+        return result;
+    if (m_OsrFrameHandler)
+        return m_OsrFrameHandler->GetPaintStats();
+#if defined(OS_WIN)
+    if (m_OsrWindow)
+        return m_OsrWindow->GetPaintStats();
+#endif
+    return {};
+}
+
+void PytoniumLibrary::EnableFrameCapture(bool enable)
+{
+    if (RunOnUiThread([&] { EnableFrameCapture(enable); }))
+        return;
+    // The store is created once and kept, so capturing threads never see it
+    // replaced; disabling only stops publishing.
+    if (!m_FrameStore)
+        m_FrameStore = std::make_shared<OsrFrameStore>();
+    m_FrameCaptureEnabled = enable;
+    std::shared_ptr<OsrFrameStore> store = enable ? m_FrameStore : nullptr;
+    if (m_OsrFrameHandler)
+        m_OsrFrameHandler->SetFrameStore(store);
+#if defined(OS_WIN)
+    if (m_OsrWindow)
+        m_OsrWindow->SetFrameStore(store);
+#endif
+    // Repaint, so the store gets a frame without waiting for the page.
+    if (enable && m_Browser)
+        m_Browser->GetHost()->Invalidate(PET_VIEW);
+}
+
+std::shared_ptr<const OsrFrameBuffer> PytoniumLibrary::CaptureFrame(bool onlyNew)
+{
+    return m_FrameStore ? m_FrameStore->Acquire(onlyNew) : nullptr;
+}
+
+OsrFrameCaptureStats PytoniumLibrary::GetFrameCaptureStats()
+{
+    return m_FrameStore ? m_FrameStore->GetStats() : OsrFrameCaptureStats{};
+}
+
+bool PytoniumLibrary::StartRecording(const FrameEncoderSettings& settings)
+{
+    bool result = false;
+    if (RunOnUiThread([&] { result = StartRecording(settings); }))
+        return result;
+    StopRecording();
+    auto encoder = std::make_shared<OsrFrameEncoder>(settings);
+    if (!encoder->Start())
+        return false;
+    m_FrameEncoder = encoder;
+    m_RecordingStats = {};
+    if (m_OsrFrameHandler)
+        m_OsrFrameHandler->SetFrameEncoder(encoder);
+#if defined(OS_WIN)
+    if (m_OsrWindow)
+        m_OsrWindow->SetFrameEncoder(encoder);
+#endif
+    // Repaint, so the recording starts with the current page.
+    if (m_Browser)
+        m_Browser->GetHost()->Invalidate(PET_VIEW);
+    return true;
+}
+
+void PytoniumLibrary::StopRecording()
+{
+    if (RunOnUiThread([&] { StopRecording(); }))
+        return;
+    if (!m_FrameEncoder)
+        return;
+    if (m_OsrFrameHandler)
+        m_OsrFrameHandler->SetFrameEncoder(nullptr);
 #if defined(OS_WIN)
+    if (m_OsrWindow)
+        m_OsrWindow->SetFrameEncoder(nullptr);
+#endif
+    m_FrameEncoder->Stop();
+    m_RecordingStats = m_FrameEncoder->GetStats();
+    m_FrameEncoder = nullptr;
+}
+
+FrameEncoderStats PytoniumLibrary::GetRecordingStats()
+{
+    FrameEncoderStats result;
+    if (RunOnUiThread([&] { result = GetRecordingStats(); }))
+        return result;
+    return m_FrameEncoder ? m_FrameEncoder->GetStats() : m_RecordingStats;
+}
+
+void PytoniumLibrary::SetFrameRate(int frameRate)
+{
+    if (PostToUiThread([=, this] { SetFrameRate(frameRate); }))
+        return;
+    m_FrameRate = OsrFrameRateGovernor::ClampFrameRate(frameRate);
+    m_AdaptiveFrameRate = false;
+    if (m_FrameRateGovernor)
+        m_FrameRateGovernor->SetFrameRate(m_FrameRate);
+}
+
+void PytoniumLibrary::SetAdaptiveFrameRate(int minFrameRate, int maxFrameRate)
+{
+    if (PostToUiThread([=, this] { SetAdaptiveFrameRate(minFrameRate, maxFrameRate); }))
+        return;
+    m_MinFrameRate = OsrFrameRateGovernor::ClampFrameRate(minFrameRate);
+    m_MaxFrameRate = std::max(OsrFrameRateGovernor::ClampFrameRate(maxFrameRate), m_MinFrameRate);
+    m_AdaptiveFrameRate = true;
+    if (m_FrameRateGovernor)
+        m_FrameRateGovernor->SetAdaptive(m_MinFrameRate, m_MaxFrameRate);
+}
+
+OsrFrameRateStats PytoniumLibrary::GetFrameRateStats()
+{
+    OsrFrameRateStats result;
+    if (RunOnUiThread([&] { result = GetFrameRateStats(); }))
+        return result;
+    if (m_FrameRateGovernor)
+        return m_FrameRateGovernor->GetStats();
+    OsrFrameRateStats stats;
+    stats.FrameRate = m_AdaptiveFrameRate ? m_MaxFrameRate : m_FrameRate;
+    stats.Adaptive = m_AdaptiveFrameRate;
+    return stats;
+}
+
+int PytoniumLibrary::GetRendererCpuUsage(state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = GetRendererCpuUsage(callback, user_data); }))
+        return result;
+    auto* client = CefWrapperClientHandler::GetInstance();
+    if(!client || !m_Browser || g_BrowserCount.load(std::memory_order_acquire) <= 0) return -1;
+
+    int requestId = client->RegisterStateRequest(m_BrowserId, callback, user_data);
+
+    CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("get-renderer-cpu-usage");
+    msg->GetArgumentList()->SetInt(0, requestId);
+    m_Browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, msg);
+    return requestId;
+}
+
+bool PytoniumLibrary::StartPdfPool(int size)
+{
+    bool result = false;
+    if (RunOnUiThread([&] { result = StartPdfPool(size); }))
+        return result;
+    if (!s_CefInitialized)
+        return false;
+    StopPdfPool();
+    // The view size only matters for layout before printing; pages are laid
+    // out again at the paper size of each job.
+    m_PdfRenderPool = new PdfRenderPool(size, 1280, 1024);
+    m_PdfRenderPool->Start();
+    return true;
+}
+
+void PytoniumLibrary::StopPdfPool()
+{
+    if (RunOnUiThread([&] { StopPdfPool(); }))
+        return;
+    if (!m_PdfRenderPool)
+        return;
+    m_PdfRenderPool->Shutdown();
+    m_PdfRenderPool = nullptr;
+}
+
+int PytoniumLibrary::RenderPdf(PdfRenderJob job, state_request_callback_ptr callback, void* user_data)
+{
+    int result = -1;
+    if (RunOnUiThread([&] { result = RenderPdf(std::move(job), callback, user_data); }))
+        return result;
+    if (!m_PdfRenderPool)
+        return -1;
+    return m_PdfRenderPool->Submit(std::move(job), callback, user_data);
+}
+
+PdfRenderPoolStats PytoniumLibrary::GetPdfPoolStats()
+{
+    PdfRenderPoolStats result;
+    if (RunOnUiThread([&] { result = GetPdfPoolStats(); }))
+        return result;
+    return m_PdfRenderPool ? m_PdfRenderPool->GetStats() : PdfRenderPoolStats{};
+}
+
 int PytoniumLibrary::CreateBrowserOsr(const std::string& url, int width, int height,
                                        const std::string& iconPath, bool clickThrough)
 {
+    int result = -1;
+    if (RunOnUiThread([&] { result = CreateBrowserOsr(url, width, height, iconPath, clickThrough); }))
+        return result;
     // Get or create the shared client handler
-    CefWrapperClientHandler* handler = CefWrapperClientHandler::GetInstance();
-    if (!handler) {
-        CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
-        bool use_views = command_line->HasSwitch("use-views");
-        new CefWrapperClientHandler(use_views);
-        handler = CefWrapperClientHandler::GetInstance();
-    }
-
-    // Create the OSR window (layered Win32 window)
-    m_OsrWindow = new OsrWindowWin(width, height, clickThrough);
-    HWND osrHwnd = m_OsrWindow->Create();
-    if (!osrHwnd) {
-        std::cerr << "CreateBrowserOsr: Failed to create OSR window!" << std::endl;
-        m_OsrWindow = nullptr;
-        return -1;
+    CefWrapperClientHandler* handler = CefWrapperClientHandler::GetOrCreateInstance();
+
+    m_FrameRateGovernor = new OsrFrameRateGovernor(m_FrameRate);
+    if (m_AdaptiveFrameRate)
+        m_FrameRateGovernor->SetAdaptive(m_MinFrameRate, m_MaxFrameRate);
+
+    CefRefPtr<CefRenderHandler> renderHandler;
+    CefWindowHandle parentWindow = kNullWindowHandle;
+#if defined(OS_WIN)
+    if (!m_Headless) {
+        // Create the OSR window (layered Win32 window)
+        m_OsrWindow = new OsrWindowWin(width, height, clickThrough);
+        HWND osrHwnd = m_OsrWindow->Create();
+        if (!osrHwnd) {
+            std::cerr << "CreateBrowserOsr: Failed to create OSR window!" << std::endl;
+            m_OsrWindow = nullptr;
+            return -1;
+        }
+        if (m_FrameCaptureEnabled)
+            m_OsrWindow->SetFrameStore(m_FrameStore);
+        m_OsrWindow->SetFrameEncoder(m_FrameEncoder);
+        m_OsrWindow->SetFrameRateGovernor(m_FrameRateGovernor);
+        renderHandler = m_OsrWindow;
+        parentWindow = osrHwnd;
+    }
+#endif
+    if (!renderHandler) {
+        // No native window, frames go to the frame callback.
+        m_OsrFrameHandler = new OsrFrameHandler(width, height);
+        m_OsrFrameHandler->SetFrameCallback(m_FrameCallback, m_FrameCallbackUserData);
+        if (m_FrameCaptureEnabled)
+            m_OsrFrameHandler->SetFrameStore(m_FrameStore);
+        m_OsrFrameHandler->SetFrameEncoder(m_FrameEncoder);
+        m_OsrFrameHandler->SetFrameRateGovernor(m_FrameRateGovernor);
+        renderHandler = m_OsrFrameHandler;
     }
 
     // Configure browser settings for OSR
     cef_browser_settings_t cefBrowserSettings;
     memset(&cefBrowserSettings, 0, sizeof(cef_browser_settings_t));
     cefBrowserSettings.size = sizeof(cef_browser_settings_t);
-    cefBrowserSettings.windowless_frame_rate = 60;
+    cefBrowserSettings.windowless_frame_rate = m_FrameRateGovernor->GetFrameRate();
     cefBrowserSettings.background_color = 0x00000000;  // Fully transparent
     CefBrowserSettings browser_settings(cefBrowserSettings);
 
     // Configure window info for windowless (OSR) rendering
     CefWindowInfo window_info;
-    window_info.SetAsWindowless(osrHwnd);
+    window_info.SetAsWindowless(parentWindow);
     window_info.runtime_style = CEF_RUNTIME_STYLE_ALLOY;
 
     // Serialize bindings into extra_info for the renderer
-    CefRefPtr<CefDictionaryValue> extra = CefDictionaryValue::Create();
-    if (!m_Javascript_Bindings.empty())
-    {
-        CefRefPtr<CefListValue> bindings = CefListValue::Create();
-        bindings->SetSize(m_Javascript_Bindings.size());
-        int listIndex = 0;
-        for (const auto &binding: m_Javascript_Bindings)
-        {
-            CefRefPtr<CefDictionaryValue> dic = CefDictionaryValue::Create();
-            dic->SetString("MessageTopic", binding.functionName);
-            dic->SetString("JavascriptObject", binding.JavascriptObject);
-            CefRefPtr<CefBinaryValue> functionPointer = CefBinaryValue::Create(
-                    &binding.function, sizeof(binding.function));
-            dic->SetBinary("FunctionPointer", functionPointer);
-            bindings->SetDictionary(listIndex, dic);
-            listIndex++;
-        }
-        extra->SetList("JavascriptBindings", bindings);
-        extra->SetInt("JavascriptBindingsSize",
-                      static_cast<int>(m_Javascript_Bindings.size()));
-    }
-
-    if (!m_Javascript_Python_Bindings.empty())
-    {
-        CefRefPtr<CefListValue> bindings = CefListValue::Create();
-        bindings->SetSize(m_Javascript_Python_Bindings.size());
-        int listIndex = 0;
-        for (const auto &binding: m_Javascript_Python_Bindings)
-        {
-            CefRefPtr<CefDictionaryValue> dic = CefDictionaryValue::Create();
-            dic->SetString("MessageTopic", binding.FunctionName);
-            dic->SetString("JavascriptObject", binding.JavascriptObject);
-            dic->SetBool("ReturnsValue", binding.ReturnsValue);
-            CefRefPtr<CefBinaryValue> handlerFunc = CefBinaryValue::Create(
-                    &binding.HandlerFunction, sizeof(binding.HandlerFunction));
-            CefRefPtr<CefBinaryValue> pythonObject = CefBinaryValue::Create(
-                    &binding.PythonCallbackObject, sizeof(binding.PythonCallbackObject));
-            dic->SetBinary("HandlerFunction", handlerFunc);
-            dic->SetBinary("PythonFunctionObject", pythonObject);
-            bindings->SetDictionary(listIndex, dic);
-            listIndex++;
-        }
-        extra->SetList("JavascriptPythonBindings", bindings);
-        extra->SetInt("JavascriptPythonBindingsSize",
-                      static_cast<int>(m_Javascript_Python_Bindings.size()));
-    }
-
-    m_Browser = CefBrowserHost::CreateBrowserSync(window_info, handler, url,
-                                                   browser_settings, extra, nullptr);
+    CefRefPtr<CefDictionaryValue> extra = CreateBindingsInfo();
+
+    // Pooled browsers have no parent window; the layered OSR window on
+    // Windows parents its browser, so it creates one.
+    if (parentWindow == kNullWindowHandle)
+        m_Browser = TakePooledBrowser(url, true, extra);
+    bool pooled = m_Browser != nullptr;
+    if (!m_Browser)
+        m_Browser = CefBrowserHost::CreateBrowserSync(window_info, handler, url,
+                                                       browser_settings, extra, nullptr);
     if (!m_Browser) {
         std::cerr << "CreateBrowserOsr: CreateBrowserSync failed!" << std::endl;
-        m_OsrWindow->Destroy();
-        m_OsrWindow = nullptr;
+#if defined(OS_WIN)
+        if (m_OsrWindow) {
+            m_OsrWindow->Destroy();
+            m_OsrWindow = nullptr;
+        }
+#endif
+        m_OsrFrameHandler = nullptr;
+        m_FrameRateGovernor = nullptr;
         return -1;
     }
 
     m_BrowserId = m_Browser->GetIdentifier();
     s_InstanceCount++;
 
-    // Connect the browser to the OSR window
-    m_OsrWindow->SetBrowser(m_Browser);
+    // Connect the browser to the render handler
+#if defined(OS_WIN)
+    if (m_OsrWindow)
+        m_OsrWindow->SetBrowser(m_Browser);
+#endif
+    if (m_OsrFrameHandler)
+        m_OsrFrameHandler->SetBrowser(m_Browser);
+    m_FrameRateGovernor->SetBrowser(m_Browser);
 
     // Register with the OSR dispatcher
-    handler->GetOsrDispatcher()->RegisterWindow(m_BrowserId, m_OsrWindow);
+    handler->GetOsrDispatcher()->RegisterHandler(m_BrowserId, renderHandler);
 
     // Register per-browser bindings and mark as OSR
     handler->RegisterBrowserBindings(m_BrowserId,
         m_Javascript_Bindings, m_Javascript_Python_Bindings,
         m_StateHandlerPythonBindings, m_ContextMenuBindings);
+    handler->SetStateCacheEnabled(m_BrowserId, m_StateCacheEnabled);
     handler->GetBrowserState(m_BrowserId).isOsr = true;
 
+    if (pooled) {
+        // It was created hidden and without a render handler.
+        CefRefPtr<CefBrowserHost> host = m_Browser->GetHost();
+        host->SetWindowlessFrameRate(m_FrameRateGovernor->GetFrameRate());
+        host->WasHidden(false);
+        host->WasResized();
+        host->Invalidate(PET_VIEW);
+    }
+
     return m_BrowserId;
 }
-#endif
@@ -11,15 +11,42 @@
 #include "include/cef_sandbox_win.h"
 #include "osr_window_win.h"
 #endif
+#include "osr_frame_handler.h"
+#include "pdf_render_pool.h"
+#include "browser_pool.h"
+#include "message_pump.h"
 
 
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "javascript_binding.h"
 #include "cef_value_wrapper.h"
+#include "asset_cache.h"
+#include "scheme_route.h"
+
+// The buffered changes of one nesting level of a state batch
+// (namespace -> key -> value / removed keys).
+struct PendingStateBatch
+{
+    std::map<std::string, std::map<std::string, CefValueWrapper>> Updates;
+    std::map<std::string, std::set<std::string>> Removals;
+};
 
 class PytoniumLibrary
 {
 public:
     PytoniumLibrary();
+    ~PytoniumLibrary();
+
+    // Background-thread mode, set before CEF is initialized: CEF runs its UI
+    // thread itself (multi_threaded_message_loop) and the methods below may be
+    // called from any thread. Calls with results wait for the UI thread, the
+    // others are posted to it in order. UpdateMessageLoop does nothing then.
+    static void SetBackgroundThread(bool background);
+    static bool IsBackgroundThread() { return s_BackgroundThread; }
 
     // Backward-compatible: init CEF + create first browser in one call
     void InitPytonium(std::string start_url, int init_width, int init_height);
@@ -35,6 +62,11 @@ public:
     static void ShutdownCef();
 
     void ExecuteJavascript(const std::string &code);
+    // Evaluates |code| in the main frame and answers through |callback| like
+    // the state requests, with {"value": result} (JSON-compatible values only)
+    // or {"error": message}. Returns the request ID, or -1 if there is no
+    // browser to ask.
+    int EvaluateJavascript(const std::string &code, state_request_callback_ptr callback, void* user_data);
 
     void ShutdownPytonium();
 
@@ -44,7 +76,17 @@ public:
 
     bool IsReadyToExecuteJavascript();
 
-    void UpdateMessageLoop();
+    static void UpdateMessageLoop();
+
+    // MessagePump. Instead of calling UpdateMessageLoop at a fixed rate, wait
+    // until it is due: WaitForMessageLoopWork blocks (any thread), the wakeup
+    // fd suits event loops. Shared by all instances.
+    static bool WaitForMessageLoopWork(int64_t timeoutMs);
+    static int64_t GetMessageLoopDelay();
+    static int GetMessageLoopWakeupFd();
+    static void SetMessageLoopMaxDelay(int64_t delayMs);
+    static int64_t GetMessageLoopMaxDelay();
+    static MessagePumpStats GetMessageLoopStats();
 
     void AddJavascriptBinding(std::string name,
                               js_binding_function_ptr jsNativeApiFunctionPtr, std::string javascript_object);
@@ -54,13 +96,50 @@ public:
                                     js_python_callback_object_ptr python_callback_object,
                                     const std::string &javascript_object, bool returns_value);
 
-    void AddStateHandlerPythonBinding(state_handler_function_ptr stateHandlerFunctionPtr, state_callback_object_ptr stateCallbackObjectPtr, const std::vector<std::string>& namespacesToSubscribeTo);
+    void AddStateHandlerPythonBinding(state_handler_function_ptr stateHandlerFunctionPtr, state_callback_object_ptr stateCallbackObjectPtr, const std::vector<std::string>& namespacesToSubscribeTo,
+                                      state_batch_handler_function_ptr stateBatchHandlerFunctionPtr = nullptr);
 
 
     void SetState(const std::string& stateNamespace, const std::string& key, CefValueWrapper value);
 
+    // Sets several keys of one namespace as a single atomic update.
+    void SetStates(const std::string& stateNamespace, const std::map<std::string, CefValueWrapper>& values);
+
     void RemoveState(const std::string& stateNamespace, const std::string& key);
 
+    // Reads a state value asynchronously. If the browser-side cache holds the key, `callback`
+    // runs right away and 0 is returned; otherwise the renderer is asked and the request ID is
+    // returned. Returns -1 if there is no browser to ask.
+    int GetState(const std::string& stateNamespace, const std::string& key,
+                 state_request_callback_ptr callback, void* user_data);
+
+    // Keeps a browser-side copy of the state so GetState can be answered without IPC.
+    void SetStateCacheEnabled(bool enabled);
+
+    // Versioned state queries, answered asynchronously by the renderer through `callback`.
+    // Return the request ID, or -1 if there is no browser to ask.
+    int GetStateChangesSince(const std::string& stateNamespace, uint64_t sinceVersion,
+                             state_request_callback_ptr callback, void* user_data);
+
+    int CompareAndSetState(const std::string& stateNamespace, const std::string& key, uint64_t expectedVersion,
+                           CefValueWrapper value, state_request_callback_ptr callback, void* user_data);
+
+    // The version of the key's last write (0 if it does not exist), for CompareAndSetState.
+    int GetStateVersion(const std::string& stateNamespace, const std::string& key,
+                        state_request_callback_ptr callback, void* user_data);
+
+    // State batches: between BeginStateBatch and CommitStateBatch, SetState/SetStates/RemoveState
+    // are buffered and sent to the renderer as one message, applied atomically there.
+    // Batches nest; only the outermost CommitStateBatch sends, and DiscardStateBatch drops
+    // only the changes of the innermost batch. Batches belong to the calling thread: writes
+    // from other threads are not buffered in them.
+    void BeginStateBatch();
+    void CommitStateBatch();
+    void DiscardStateBatch();
+
+    // Copies the innermost open batch of the calling thread; false if it has none.
+    bool GetPendingStateBatch(PendingStateBatch& batch);
+
     void SetCustomSubprocessPath(std::string cefsub_path);
 
     void SetCustomCachePath(std::string cef_cache_path);
@@ -79,18 +158,109 @@ public:
 
     void SetShowDebugContextMenu(bool show);
 
-    void AddCustomScheme(std::string schemeIdentifier, std::string contentRootFolder);
+    // |schemeOptions| are cef_scheme_options_t flags, |responseHeaders| are added
+    // to every response of the scheme.
+    void AddCustomScheme(std::string schemeIdentifier, std::string contentRootFolder, std::string cacheControl = "no-cache",
+                         int schemeOptions = CEF_SCHEME_OPTION_STANDARD | CEF_SCHEME_OPTION_CORS_ENABLED,
+                         std::map<std::string, std::string> responseHeaders = {});
 
     void AddMimeTypeMapping(const std::string& fileExtension, std::string mimeType);
 
+    // Python route handlers and in-memory files on custom schemes. Routes and
+    // virtual files are process-wide, like the schemes themselves.
+    void AddSchemeRoute(const std::string& schemeIdentifier, const std::string& prefix,
+                        scheme_route_handler_ptr handler, void* userData);
+    void RemoveSchemeRoute(const std::string& schemeIdentifier, const std::string& prefix);
+    void AddVirtualFile(const std::string& schemeIdentifier, const std::string& path, std::string data, std::string mimeType);
+    void RemoveVirtualFile(const std::string& schemeIdentifier, const std::string& path);
+
+    // Answer a route request. May be called from any thread.
+    static bool RespondSchemeRequest(int requestId, int status, const std::string& mimeType,
+                                     const std::map<std::string, std::string>& headers);
+    static bool WriteSchemeRequest(int requestId, const std::string& data);
+    static bool FinishSchemeRequest(int requestId);
+    // Route requests without headers after |milliseconds| get a 504, 0 disables it.
+    static void SetSchemeRouteTimeout(int milliseconds);
+    static int GetSchemeRouteTimeout();
+
+    // Process-wide cache for files served through custom schemes.
+    static void SetAssetCacheBudget(size_t bytes);
+    static void ClearAssetCache();
+    static AssetCacheStats GetAssetCacheStats();
+
     void SetFramelessWindow(bool frameless);
 
     // OSR (off-screen rendering) mode for transparent windows
     void SetOsrMode(bool osr);
-#if defined(OS_WIN)
     int CreateBrowserOsr(const std::string& url, int width, int height,
                          const std::string& iconPath, bool clickThrough);
-#endif
+
+    // Headless rendering: no window, display server or GPU. Implies OSR mode;
+    // frames are only delivered to the frame callback. Must be set before the
+    // first browser is created.
+    void SetHeadless(bool headless);
+    bool IsHeadless() const { return m_Headless; }
+
+    // Receives every painted frame of a headless browser, on the UI thread.
+    void SetFrameCallback(osr_frame_callback_ptr callback, void* user_data);
+
+    // Paint counters of the OSR browser; all zero for windowed browsers.
+    OsrPaintStats GetOsrPaintStats();
+
+    // Frame capture for OSR browsers. Once enabled, every paint is published to
+    // a triple-buffered store; CaptureFrame returns the latest frame without
+    // copying and may be called from any thread once capture was enabled.
+    void EnableFrameCapture(bool enable);
+    std::shared_ptr<const OsrFrameBuffer> CaptureFrame(bool onlyNew);
+    OsrFrameCaptureStats GetFrameCaptureStats();
+
+    // Records the frames of an OSR browser on an encoder thread. Returns false
+    // if the output cannot be opened. A running recording is stopped first.
+    // StopRecording waits for the queued frames and, for a pipe, for the
+    // process to exit.
+    bool StartRecording(const FrameEncoderSettings& settings);
+    void StopRecording();
+    FrameEncoderStats GetRecordingStats();
+
+    // Windowless frame rate of this instance's browser, 1-60 fps. Can be changed
+    // while the browser runs. SetFrameRate fixes the rate, SetAdaptiveFrameRate
+    // lets OsrFrameRateGovernor pick it from paints and input. Windowed browsers
+    // render at the display rate and ignore both.
+    void SetFrameRate(int frameRate);
+    void SetAdaptiveFrameRate(int minFrameRate, int maxFrameRate);
+    OsrFrameRateStats GetFrameRateStats();
+
+    // Asks the renderer process of the browser for its process id and CPU time.
+    // Answered through |callback| like the state requests; returns the request
+    // ID, or -1 if there is no browser to ask.
+    int GetRendererCpuUsage(state_request_callback_ptr callback, void* user_data);
+
+    // Pre-warmed hidden browsers for CreateBrowser/CreateBrowserOsr of all
+    // instances without JavaScript bindings, see BrowserPool. Browsers of the
+    // pool's kind (|windowless|, windowed only on Windows) for URLs on the site
+    // of |warmUrl| are taken from it. Needs an initialized CEF; returns false
+    // otherwise. A running pool of the same kind and bindings is stopped first.
+    static bool StartBrowserPool(int size, const std::string& warmUrl, bool windowless);
+    // As StartBrowserPool, for instances with the JavaScript bindings of this
+    // one (the same bound functions and Python callables), which its pooled
+    // browsers carry as their extra info.
+    bool StartBindingsBrowserPool(int size, const std::string& warmUrl, bool windowless);
+    // Stops the pools for the bindings of this instance, e.g. once the window
+    // they were warmed for is open.
+    void StopBindingsBrowserPool();
+    // Stops all pools; the stats are the sums over the running pools.
+    static void StopBrowserPool();
+    static BrowserPoolStats GetBrowserPoolStats();
+
+    // Batch PDF rendering with a pool of |size| hidden browsers, see
+    // PdfRenderPool. Needs an initialized CEF; returns false otherwise. A
+    // running pool is stopped first, failing its jobs.
+    bool StartPdfPool(int size);
+    void StopPdfPool();
+    // Queues a job; |callback| receives its result. Returns the job ID, or -1
+    // if no pool is running.
+    int RenderPdf(PdfRenderJob job, state_request_callback_ptr callback, void* user_data);
+    PdfRenderPoolStats GetPdfPoolStats();
 
     // Window control methods for frameless windows
     void MinimizeWindow();
@@ -130,7 +300,9 @@ private:
     // Shared across all PytoniumLibrary instances (one CEF process)
     static bool s_CefInitialized;
     static int s_InstanceCount;
+    static bool s_BackgroundThread;
     static CefRefPtr<CefWrapperApp> s_App;
+    static std::vector<CefRefPtr<BrowserPool>> s_BrowserPools;
 
     // Per-instance browser reference
     int m_BrowserId = -1;
@@ -157,6 +329,58 @@ private:
 #if defined(OS_WIN)
     CefRefPtr<OsrWindowWin> m_OsrWindow;
 #endif
+    bool m_Headless = false;
+    CefRefPtr<OsrFrameHandler> m_OsrFrameHandler;
+    std::shared_ptr<OsrFrameStore> m_FrameStore;
+    bool m_FrameCaptureEnabled = false;
+    std::shared_ptr<OsrFrameEncoder> m_FrameEncoder;
+    // Stats of the last recording once it was stopped.
+    FrameEncoderStats m_RecordingStats;
+    int m_FrameRate = 60;
+    bool m_AdaptiveFrameRate = false;
+    int m_MinFrameRate = 5;
+    int m_MaxFrameRate = 60;
+    CefRefPtr<OsrFrameRateGovernor> m_FrameRateGovernor;
+    osr_frame_callback_ptr m_FrameCallback = nullptr;
+    void* m_FrameCallbackUserData = nullptr;
+
+    CefRefPtr<PdfRenderPool> m_PdfRenderPool;
+
+    bool m_StateCacheEnabled = false;
+
+    // Open state batches of each calling thread, one per nesting level. An inner level
+    // merges into the outer one on commit, or is dropped alone on discard.
+    std::map<std::thread::id, std::vector<PendingStateBatch>> m_StateBatches;
+
+    // The state calls after marshaling, with the thread that made them.
+    void SetState(std::thread::id caller, const std::string& stateNamespace, const std::string& key,
+                  CefValueWrapper value);
+    void SetStates(std::thread::id caller, const std::string& stateNamespace,
+                   const std::map<std::string, CefValueWrapper>& values);
+    void RemoveState(std::thread::id caller, const std::string& stateNamespace, const std::string& key);
+    void BeginStateBatch(std::thread::id caller);
+    void CommitStateBatch(std::thread::id caller);
+    void DiscardStateBatch(std::thread::id caller);
+    bool GetPendingStateBatch(std::thread::id caller, PendingStateBatch& batch);
+
+    // The innermost open batch of |caller|, or nullptr.
+    PendingStateBatch* OpenStateBatch(std::thread::id caller);
+
+    // The bindings of this instance, as the renderer reads them from the
+    // extra info of a new browser.
+    CefRefPtr<CefDictionaryValue> CreateBindingsInfo() const;
+
+    // A browser of a pool for |url| with equal |bindings|, adopted as an open
+    // window and loading |url|; nullptr if no pool has one (see
+    // BrowserPool::Take).
+    CefRefPtr<CefBrowser> TakePooledBrowser(const std::string& url, bool windowless,
+                                            CefRefPtr<CefDictionaryValue> bindings);
+    static bool StartBrowserPool(int size, const std::string& warmUrl, bool windowless,
+                                 CefRefPtr<CefDictionaryValue> bindings);
+    static void StopBrowserPool(CefRefPtr<CefDictionaryValue> bindings);
+
+    void SendStateBatch(const std::map<std::string, std::map<std::string, CefValueWrapper>>& updates,
+                        const std::map<std::string, std::set<std::string>>& removals);
 
     std::vector<JavascriptBinding> m_Javascript_Bindings;
     std::vector<JavascriptPythonBinding> m_Javascript_Python_Bindings;
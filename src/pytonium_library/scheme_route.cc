@@ -0,0 +1,328 @@
+#include "scheme_route.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "include/wrapper/cef_helpers.h"
+
+bool SchemeRouteResponse::Respond(int status, const std::string& mimeType, const std::map<std::string, std::string>& headers)
+{
+    CefRefPtr<CefCallback> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Responded || m_Canceled)
+            return false;
+        m_Responded = true;
+        m_Status = status;
+        m_MimeType = mimeType;
+        m_Headers = headers;
+        callback = std::move(m_HeadersCallback);
+    }
+    if (callback)
+        callback->Continue();
+    return true;
+}
+
+bool SchemeRouteResponse::Write(const std::string& data)
+{
+    if (data.empty())
+        return true;
+
+    CefRefPtr<CefResourceReadCallback> callback;
+    int transferred = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Responded || m_Finished || m_Canceled)
+            return false;
+        m_Buffer.push_back(data);
+        if (m_PendingReadCallback)
+        {
+            transferred = DrainBuffer(m_PendingReadBuffer, m_PendingReadSize);
+            callback = std::move(m_PendingReadCallback);
+            m_PendingReadBuffer = nullptr;
+        }
+    }
+    if (callback)
+        callback->Continue(transferred);
+    return true;
+}
+
+bool SchemeRouteResponse::Finish()
+{
+    CefRefPtr<CefResourceReadCallback> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Responded || m_Finished || m_Canceled)
+            return false;
+        m_Finished = true;
+        // A pending read means the buffer is empty, complete the response.
+        if (m_PendingReadCallback)
+        {
+            callback = std::move(m_PendingReadCallback);
+            m_PendingReadBuffer = nullptr;
+        }
+    }
+    if (callback)
+        callback->Continue(0);
+    return true;
+}
+
+bool SchemeRouteResponse::Fail(int status, const std::string& message)
+{
+    CefRefPtr<CefCallback> headersCallback;
+    CefRefPtr<CefResourceReadCallback> readCallback;
+    int transferred = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Finished || m_Canceled)
+            return false;
+        if (!m_Responded)
+        {
+            m_Responded = true;
+            m_Status = status;
+            m_MimeType = "text/plain";
+            m_Headers.clear();
+            m_Buffer.push_back(message);
+            headersCallback = std::move(m_HeadersCallback);
+        }
+        m_Finished = true;
+        if (m_PendingReadCallback)
+        {
+            transferred = DrainBuffer(m_PendingReadBuffer, m_PendingReadSize);
+            readCallback = std::move(m_PendingReadCallback);
+            m_PendingReadBuffer = nullptr;
+        }
+    }
+    if (headersCallback)
+        headersCallback->Continue();
+    if (readCallback)
+        readCallback->Continue(transferred);
+    return true;
+}
+
+bool SchemeRouteResponse::HasResponded()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Responded;
+}
+
+bool SchemeRouteResponse::WaitForHeaders(CefRefPtr<CefCallback> callback)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Responded)
+        return true;
+    m_HeadersCallback = std::move(callback);
+    return false;
+}
+
+void SchemeRouteResponse::GetHeaders(int& status, std::string& mimeType, std::map<std::string, std::string>& headers)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    status = m_Status;
+    mimeType = m_MimeType;
+    headers = m_Headers;
+}
+
+bool SchemeRouteResponse::Read(void* data_out, int bytes_to_read, int& bytes_read,
+                               CefRefPtr<CefResourceReadCallback> callback)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    bytes_read = 0;
+    if (m_Canceled)
+        return false;
+    if (!m_Buffer.empty())
+    {
+        bytes_read = DrainBuffer(data_out, bytes_to_read);
+        return true;
+    }
+    if (m_Finished)
+        return false;
+
+    // Wait for the handler to write more data.
+    m_PendingReadBuffer = data_out;
+    m_PendingReadSize = bytes_to_read;
+    m_PendingReadCallback = std::move(callback);
+    return true;
+}
+
+void SchemeRouteResponse::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Canceled = true;
+    m_Buffer.clear();
+    m_HeadersCallback = nullptr;
+    m_PendingReadCallback = nullptr;
+    m_PendingReadBuffer = nullptr;
+}
+
+int SchemeRouteResponse::DrainBuffer(void* data_out, int bytes_to_read)
+{
+    int transferred = 0;
+    char* out = static_cast<char*>(data_out);
+    while (transferred < bytes_to_read && !m_Buffer.empty())
+    {
+        const std::string& chunk = m_Buffer.front();
+        size_t size = std::min(chunk.size() - m_BufferOffset, static_cast<size_t>(bytes_to_read - transferred));
+        std::memcpy(out + transferred, chunk.data() + m_BufferOffset, size);
+        transferred += static_cast<int>(size);
+        m_BufferOffset += size;
+        if (m_BufferOffset == chunk.size())
+        {
+            m_Buffer.pop_front();
+            m_BufferOffset = 0;
+        }
+    }
+    return transferred;
+}
+
+namespace {
+
+std::string VirtualFileKey(const std::string& scheme, const std::string& path)
+{
+    return scheme + "://" + SchemeRouteRegistry::NormalizePath(path);
+}
+
+void RunRouteHandler(scheme_route_handler_ptr handler, void* userData, int requestId, SchemeRouteRequest request)
+{
+    CEF_REQUIRE_UI_THREAD();
+    if (!handler(userData, requestId, std::move(request)))
+        SchemeRouteRegistry::Instance().FailResponse(requestId, 500, "Error: The route handler did not respond.");
+}
+
+void ExpireResponse(int requestId)
+{
+    CefRefPtr<SchemeRouteResponse> response = SchemeRouteRegistry::Instance().GetResponse(requestId);
+    if (response && !response->HasResponded())
+        SchemeRouteRegistry::Instance().FailResponse(requestId, 504, "Error: The route handler did not respond in time.");
+}
+
+} // namespace
+
+SchemeRouteRegistry& SchemeRouteRegistry::Instance()
+{
+    static SchemeRouteRegistry instance;
+    return instance;
+}
+
+std::string SchemeRouteRegistry::NormalizePath(const std::string& path)
+{
+    size_t begin = path.find_first_not_of('/');
+    if (begin == std::string::npos)
+        return {};
+    size_t end = path.find_first_of("?#", begin);
+    return path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+void SchemeRouteRegistry::AddRoute(const std::string& scheme, const std::string& prefix, scheme_route_handler_ptr handler, void* userData)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::string normalizedPrefix = NormalizePath(prefix);
+    std::erase_if(m_Routes, [&](const Route& route) { return route.Scheme == scheme && route.Prefix == normalizedPrefix; });
+    m_Routes.push_back(Route{scheme, normalizedPrefix, handler, userData});
+}
+
+void SchemeRouteRegistry::RemoveRoute(const std::string& scheme, const std::string& prefix)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::string normalizedPrefix = NormalizePath(prefix);
+    std::erase_if(m_Routes, [&](const Route& route) { return route.Scheme == scheme && route.Prefix == normalizedPrefix; });
+}
+
+void SchemeRouteRegistry::AddVirtualFile(const std::string& scheme, const std::string& path, std::string data, std::string mimeType)
+{
+    VirtualFile file{CreateMemoryAssetBlob(std::move(data)), std::move(mimeType)};
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_VirtualFiles[VirtualFileKey(scheme, path)] = std::move(file);
+}
+
+void SchemeRouteRegistry::RemoveVirtualFile(const std::string& scheme, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_VirtualFiles.erase(VirtualFileKey(scheme, path));
+}
+
+bool SchemeRouteRegistry::FindVirtualFile(const std::string& scheme, const std::string& path,
+                                          std::shared_ptr<const AssetBlob>& data, std::string& mimeType) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_VirtualFiles.find(VirtualFileKey(scheme, path));
+    if (it == m_VirtualFiles.end())
+        return false;
+    data = it->second.Data;
+    mimeType = it->second.MimeType;
+    return true;
+}
+
+bool SchemeRouteRegistry::MatchesRoute(const std::string& scheme, const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return std::any_of(m_Routes.begin(), m_Routes.end(), [&](const Route& route) {
+        return route.Scheme == scheme && path.starts_with(route.Prefix);
+    });
+}
+
+CefRefPtr<SchemeRouteResponse> SchemeRouteRegistry::Dispatch(const std::string& scheme, SchemeRouteRequest request)
+{
+    const Route* match = nullptr;
+    CefRefPtr<SchemeRouteResponse> response;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (const auto& route : m_Routes)
+        {
+            if (route.Scheme == scheme && request.Path.starts_with(route.Prefix) &&
+                (!match || route.Prefix.length() > match->Prefix.length()))
+                match = &route;
+        }
+        if (!match)
+            return nullptr;
+
+        int requestId = m_NextRequestId++;
+        response = new SchemeRouteResponse(requestId);
+        m_Responses[requestId] = response;
+        CefPostTask(TID_UI, base::BindOnce(&RunRouteHandler, match->Handler, match->UserData, requestId, std::move(request)));
+        if (m_ResponseTimeoutMs > 0)
+            CefPostDelayedTask(TID_IO, base::BindOnce(&ExpireResponse, requestId), m_ResponseTimeoutMs);
+    }
+    return response;
+}
+
+CefRefPtr<SchemeRouteResponse> SchemeRouteRegistry::GetResponse(int requestId) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Responses.find(requestId);
+    return it == m_Responses.end() ? nullptr : it->second;
+}
+
+void SchemeRouteRegistry::ReleaseResponse(int requestId)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Responses.erase(requestId);
+}
+
+void SchemeRouteRegistry::FailResponse(int requestId, int status, const std::string& message)
+{
+    CefRefPtr<SchemeRouteResponse> response;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Responses.find(requestId);
+        if (it == m_Responses.end())
+            return;
+        response = std::move(it->second);
+        m_Responses.erase(it);
+    }
+    response->Fail(status, message);
+}
+
+void SchemeRouteRegistry::SetResponseTimeout(int milliseconds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_ResponseTimeoutMs = milliseconds;
+}
+
+int SchemeRouteRegistry::GetResponseTimeout() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_ResponseTimeoutMs;
+}
@@ -0,0 +1,149 @@
+#ifndef PYTONIUM_SCHEME_ROUTE_H
+#define PYTONIUM_SCHEME_ROUTE_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/cef_callback.h"
+#include "include/cef_resource_handler.h"
+#include "asset_cache.h"
+
+struct SchemeRouteRequest
+{
+    std::string Method;
+    std::string Url;
+    // The part of the URL after "scheme://", without query string.
+    std::string Path;
+    std::map<std::string, std::string> Headers;
+    std::string Body;
+};
+
+// Called on the UI thread for every request that matches a route. The handler
+// answers now or later, from any thread, through the request id. It returns
+// false if it failed or nothing is left to answer the request, which then gets
+// a 500 response.
+typedef bool (*scheme_route_handler_ptr)(void* user_data, int request_id, SchemeRouteRequest request);
+
+// The response of a request that is answered by a route handler. Headers and
+// body chunks are pushed by the handler and pulled by ClientSchemeHandler; when
+// the handler is slower than CEF, the pending CefCallback/CefResourceReadCallback
+// is kept and continued once data arrives, so no CEF thread ever waits.
+class SchemeRouteResponse : public CefBaseRefCounted
+{
+public:
+    explicit SchemeRouteResponse(int requestId) : m_RequestId(requestId) {}
+
+    int GetRequestId() const { return m_RequestId; }
+
+    // Returns false if headers were already sent or the request was canceled.
+    bool Respond(int status, const std::string& mimeType, const std::map<std::string, std::string>& headers);
+    bool Write(const std::string& data);
+    bool Finish();
+
+    // Answers with |status| and |message| if no headers were sent yet, otherwise
+    // ends the body. Returns false if the response was finished or canceled.
+    bool Fail(int status, const std::string& message);
+
+    bool HasResponded();
+
+    // Called by ClientSchemeHandler.
+    bool WaitForHeaders(CefRefPtr<CefCallback> callback);
+    void GetHeaders(int& status, std::string& mimeType, std::map<std::string, std::string>& headers);
+    bool Read(void* data_out, int bytes_to_read, int& bytes_read, CefRefPtr<CefResourceReadCallback> callback);
+    void Cancel();
+
+private:
+    // Copies buffered data into |data_out|. Requires m_Mutex.
+    int DrainBuffer(void* data_out, int bytes_to_read);
+
+    const int m_RequestId;
+    std::mutex m_Mutex;
+    bool m_Responded = false;
+    bool m_Finished = false;
+    bool m_Canceled = false;
+    int m_Status = 200;
+    std::string m_MimeType;
+    std::map<std::string, std::string> m_Headers;
+    std::deque<std::string> m_Buffer;
+    size_t m_BufferOffset = 0;
+
+    CefRefPtr<CefCallback> m_HeadersCallback;
+    void* m_PendingReadBuffer = nullptr;
+    int m_PendingReadSize = 0;
+    CefRefPtr<CefResourceReadCallback> m_PendingReadCallback;
+
+    IMPLEMENT_REFCOUNTING(SchemeRouteResponse);
+};
+
+// Process-wide registry of Python routes and in-memory virtual files for custom
+// schemes. Consulted by ClientSchemeHandler before it looks at the file system.
+class SchemeRouteRegistry
+{
+public:
+    static SchemeRouteRegistry& Instance();
+
+    // Requests whose path starts with |prefix| are passed to |handler|. The
+    // longest matching prefix wins.
+    void AddRoute(const std::string& scheme, const std::string& prefix, scheme_route_handler_ptr handler, void* userData);
+    void RemoveRoute(const std::string& scheme, const std::string& prefix);
+
+    void AddVirtualFile(const std::string& scheme, const std::string& path, std::string data, std::string mimeType);
+    void RemoveVirtualFile(const std::string& scheme, const std::string& path);
+
+    bool FindVirtualFile(const std::string& scheme, const std::string& path,
+                         std::shared_ptr<const AssetBlob>& data, std::string& mimeType) const;
+
+    bool MatchesRoute(const std::string& scheme, const std::string& path) const;
+
+    // Returns nullptr if no route matches. Otherwise the request has been posted
+    // to the UI thread and the returned response will be filled by the handler.
+    CefRefPtr<SchemeRouteResponse> Dispatch(const std::string& scheme, SchemeRouteRequest request);
+
+    // Looks up a response that is still in flight. Finished and canceled
+    // responses are forgotten.
+    CefRefPtr<SchemeRouteResponse> GetResponse(int requestId) const;
+    void ReleaseResponse(int requestId);
+
+    // Fails a response that is still in flight with |status| and forgets it.
+    void FailResponse(int requestId, int status, const std::string& message);
+
+    // Requests whose handler has not sent headers within the timeout are failed
+    // with 504. 0 disables the timeout.
+    void SetResponseTimeout(int milliseconds);
+    int GetResponseTimeout() const;
+
+    static constexpr int DefaultResponseTimeoutMs = 30000;
+
+    static std::string NormalizePath(const std::string& path);
+
+private:
+    SchemeRouteRegistry() = default;
+
+    struct Route
+    {
+        std::string Scheme;
+        std::string Prefix;
+        scheme_route_handler_ptr Handler;
+        void* UserData;
+    };
+
+    struct VirtualFile
+    {
+        std::shared_ptr<const AssetBlob> Data;
+        std::string MimeType;
+    };
+
+    mutable std::mutex m_Mutex;
+    std::vector<Route> m_Routes;
+    std::unordered_map<std::string, VirtualFile> m_VirtualFiles;
+    std::unordered_map<int, CefRefPtr<SchemeRouteResponse>> m_Responses;
+    int m_NextRequestId = 1;
+    int m_ResponseTimeoutMs = DefaultResponseTimeoutMs;
+};
+
+#endif // PYTONIUM_SCHEME_ROUTE_H
@@ -0,0 +1,142 @@
+#include "ui_thread.h"
+
+#include <atomic>
+#include <future>
+#include <utility>
+
+#include "include/cef_task.h"
+#include "mpsc_queue.h"
+
+namespace {
+
+// Tasks run per drain before CEF gets a turn again.
+const int64_t kDrainBatchSize = 64;
+
+std::atomic<bool> g_UiThreadRunning{false};
+std::atomic<ui_thread_wait_release_ptr> g_WaitRelease{nullptr};
+std::atomic<ui_thread_wait_reacquire_ptr> g_WaitReacquire{nullptr};
+
+MpscQueue<std::function<void()>> g_Tasks;
+// Pushed but not yet run. Counted after the push, so a drain that sees it
+// above zero finds the task, or retries until its producer finished.
+std::atomic<int64_t> g_Pending{0};
+
+std::atomic<int64_t> g_Posted{0};
+std::atomic<int64_t> g_Executed{0};
+std::atomic<int64_t> g_Batches{0};
+
+void ScheduleDrain();
+
+class DrainTask : public CefTask
+{
+public:
+    void Execute() override
+    {
+        g_Batches.fetch_add(1, std::memory_order_relaxed);
+        int64_t ran = 0;
+        std::function<void()> task;
+        while (ran < kDrainBatchSize && g_Tasks.Pop(task))
+        {
+            task();
+            task = nullptr;
+            ran++;
+        }
+        g_Executed.fetch_add(ran, std::memory_order_relaxed);
+        if (g_Pending.fetch_sub(ran, std::memory_order_acq_rel) - ran > 0)
+            ScheduleDrain();
+    }
+
+private:
+    IMPLEMENT_REFCOUNTING(DrainTask);
+};
+
+void ScheduleDrain()
+{
+    CefPostTask(TID_UI, new DrainTask());
+}
+
+bool NeedsMarshaling()
+{
+    return g_UiThreadRunning.load(std::memory_order_acquire) && !CefCurrentlyOn(TID_UI);
+}
+
+void Enqueue(std::function<void()> task)
+{
+    g_Posted.fetch_add(1, std::memory_order_relaxed);
+    g_Tasks.Push(std::move(task));
+    // Only the push that finds the queue idle posts a drain; the drain keeps
+    // reposting itself while tasks are pending.
+    if (g_Pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+        ScheduleDrain();
+}
+
+} // namespace
+
+void SetUiThreadRunning(bool running)
+{
+    g_UiThreadRunning.store(running, std::memory_order_release);
+}
+
+bool IsUiThreadRunning()
+{
+    return g_UiThreadRunning.load(std::memory_order_acquire);
+}
+
+void SetUiThreadWaitHooks(ui_thread_wait_release_ptr release, ui_thread_wait_reacquire_ptr reacquire)
+{
+    g_WaitRelease.store(release);
+    g_WaitReacquire.store(reacquire);
+}
+
+bool PostToUiThread(std::function<void()> task)
+{
+    if (!NeedsMarshaling())
+        return false;
+    Enqueue(std::move(task));
+    return true;
+}
+
+bool RunOnUiThread(const std::function<void()>& task)
+{
+    if (!NeedsMarshaling())
+        return false;
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> finished = done->get_future();
+    Enqueue([&task, done] {
+        task();
+        done->set_value();
+    });
+    // Only the queued task owns the promise now: if it is discarded on
+    // shutdown, the promise breaks and the wait ends; the caller keeps its
+    // defaults.
+    done.reset();
+    WaitForUiThread([&finished] { finished.wait(); });
+    return true;
+}
+
+void WaitForUiThread(const std::function<void()>& wait)
+{
+    ui_thread_wait_release_ptr release = g_WaitRelease.load();
+    ui_thread_wait_reacquire_ptr reacquire = g_WaitReacquire.load();
+    void* token = release ? release() : nullptr;
+    wait();
+    if (reacquire && token)
+        reacquire(token);
+}
+
+void DiscardUiThreadTasks()
+{
+    std::function<void()> task;
+    while (g_Tasks.Pop(task))
+        task = nullptr;
+    g_Pending.store(0, std::memory_order_release);
+}
+
+UiThreadQueueStats GetUiThreadQueueStats()
+{
+    UiThreadQueueStats stats;
+    stats.Posted = g_Posted.load(std::memory_order_relaxed);
+    stats.Executed = g_Executed.load(std::memory_order_relaxed);
+    stats.Batches = g_Batches.load(std::memory_order_relaxed);
+    return stats;
+}
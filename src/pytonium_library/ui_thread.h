@@ -0,0 +1,57 @@
+#ifndef PYTONIUM_UI_THREAD_H
+#define PYTONIUM_UI_THREAD_H
+
+#include <cstdint>
+#include <functional>
+
+// PytoniumLibrary calls from threads other than CEF's UI thread are marshaled
+// onto it. In the default mode the UI thread is the thread that initialized
+// CEF and pumps the message loop; in background-thread mode
+// (multi_threaded_message_loop) CEF runs it itself. Before CEF is initialized
+// there is no UI thread and calls run where they are made.
+//
+// Marshaled calls go through one lock-free MPSC queue (see MpscQueue), so
+// producers never contend on a lock and calls run in the order they were
+// made. The UI thread drains it in batches, giving CEF's own work a turn in
+// between.
+
+// Set once CEF is initialized, cleared before it shuts down.
+void SetUiThreadRunning(bool running);
+bool IsUiThreadRunning();
+
+// Blocking marshaled calls release the caller's lock (the Python GIL) while
+// they wait, since the UI thread may need it for callbacks. |release| returns
+// a token for |reacquire|, or nullptr if the caller did not hold the lock.
+using ui_thread_wait_release_ptr = void* (*)();
+using ui_thread_wait_reacquire_ptr = void (*)(void* token);
+void SetUiThreadWaitHooks(ui_thread_wait_release_ptr release, ui_thread_wait_reacquire_ptr reacquire);
+
+// If the call has to be marshaled, queues |task| for the UI thread and
+// returns true; otherwise returns false and the caller continues on this
+// thread:
+//
+//   if (PostToUiThread([=, this] { LoadUrl(url); }))
+//       return;
+bool PostToUiThread(std::function<void()> task);
+
+// Like PostToUiThread, but waits until |task| ran, for calls with results.
+// Tasks posted before run first.
+bool RunOnUiThread(const std::function<void()>& task);
+
+// Runs |wait| with the wait hooks applied, for other waits on the UI thread.
+void WaitForUiThread(const std::function<void()>& wait);
+
+// Drops the tasks that did not run, after CEF shut down. Blocked
+// RunOnUiThread callers return with their defaults.
+void DiscardUiThreadTasks();
+
+struct UiThreadQueueStats
+{
+    int64_t Posted = 0;
+    int64_t Executed = 0;
+    // Drains of the queue; each runs at most one batch.
+    int64_t Batches = 0;
+};
+UiThreadQueueStats GetUiThreadQueueStats();
+
+#endif // PYTONIUM_UI_THREAD_H
@@ -0,0 +1,38 @@
+#ifndef PYTONIUM_BENCHMARK_UTIL_H
+#define PYTONIUM_BENCHMARK_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Keeps the optimizer from discarding a benchmarked result.
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+// Runs |body| |iterations| times and prints the mean time per iteration.
+template <typename Body>
+double Measure(const std::string& name, size_t iterations, Body&& body)
+{
+    // Warm up caches and allocators.
+    for (size_t i = 0; i < iterations / 10 + 1; i++)
+        body();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        body();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    std::printf("%-48s %12.1f ns/op\n", name.c_str(), nanoseconds);
+    return nanoseconds;
+}
+
+#endif // PYTONIUM_BENCHMARK_UTIL_H
@@ -0,0 +1,74 @@
+#include "benchmark_util.h"
+#include "../pytonium_library/osr_frame_encoder.h"
+
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void RecordBurst(const char* name, FrameEncoderFormat format, const std::filesystem::path& target,
+                 const std::vector<uint8_t>& frame, int width, int height)
+{
+    FrameEncoderSettings settings;
+    settings.Format = format;
+    settings.Target = target.string();
+    settings.FrameRate = 60;
+    if (format != FRAME_ENCODER_PNG)
+        std::filesystem::remove(target);
+    OsrFrameEncoder encoder(settings);
+    if (!encoder.Start())
+    {
+        std::printf("%-48s %12s\n", name, "cannot open output");
+        return;
+    }
+
+    // Paints at 60 fps for two seconds; what the encoder cannot keep up with
+    // is dropped.
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 120; i++)
+    {
+        encoder.Submit(frame.data(), width, height);
+        std::this_thread::sleep_until(start + std::chrono::microseconds(16667 * (i + 1)));
+    }
+    encoder.Stop();
+
+    FrameEncoderStats stats = encoder.GetStats();
+    double averageLatency = stats.Encoded ? static_cast<double>(stats.TotalLatencyUs) / stats.Encoded / 1e3 : 0.0;
+    std::printf("%-48s %4llu encoded %4llu dropped, latency %.1f ms avg %.1f ms max, queue %d\n", name,
+                static_cast<unsigned long long>(stats.Encoded), static_cast<unsigned long long>(stats.Dropped),
+                averageLatency, stats.MaxLatencyUs / 1e3, stats.MaxQueueDepth);
+}
+
+} // namespace
+
+// Cost of Submit on the paint path, and what the encoder thread sustains
+// for 1080p frames painted at 60 fps.
+void RunFrameEncoderBenchmarks()
+{
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4, 0x80);
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "pytonium_encoder_benchmark";
+    std::filesystem::create_directories(directory);
+
+    {
+        FrameEncoderSettings settings;
+        settings.Format = FRAME_ENCODER_RAW;
+        settings.Target = (directory / "submit.raw").string();
+        // Frames beyond the queue are dropped, so this measures the full-queue path too.
+        OsrFrameEncoder encoder(settings);
+        if (encoder.Start())
+        {
+            Measure("encoder submit 1080p", 200, [&] { encoder.Submit(frame.data(), width, height); });
+            encoder.Stop();
+        }
+    }
+
+    RecordBurst("encoder y4m 1080p @ 60 fps", FRAME_ENCODER_Y4M, directory / "out.y4m", frame, width, height);
+    RecordBurst("encoder raw 1080p @ 60 fps", FRAME_ENCODER_RAW, directory / "out.raw", frame, width, height);
+    RecordBurst("encoder png 1080p @ 60 fps", FRAME_ENCODER_PNG, directory / "png", frame, width, height);
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,20 @@
+// Micro-benchmarks for hot paths of pytonium_library. Build in Release: the
+// CEF thread checks are only compiled out there, and Debug timings are
+// meaningless anyway.
+
+#include <cstdio>
+
+void RunSchemeHandlerBenchmarks();
+void RunOsrPaintBenchmarks();
+bool RunPixelConvertBenchmarks();
+void RunFrameEncoderBenchmarks();
+
+int main()
+{
+    RunSchemeHandlerBenchmarks();
+    RunOsrPaintBenchmarks();
+    // The pixel kernels are also verified against the scalar reference.
+    bool ok = RunPixelConvertBenchmarks();
+    RunFrameEncoderBenchmarks();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#include "benchmark_util.h"
+#include "../pytonium_library/osr_surface.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+void MeasurePaint(const std::string& name, const std::vector<uint8_t>& frame, std::vector<uint8_t>& surface,
+                  int width, int height, const CefRenderHandler::RectList& dirtyRects, bool fullFrame)
+{
+    OsrPaintStats stats;
+    Measure(name, 200, [&] {
+        size_t copied = PaintSurface(surface.data(), width * 4, frame.data(), width, height, dirtyRects, fullFrame, stats);
+        DoNotOptimize(copied);
+    });
+    std::printf("%-48s %12llu bytes/frame\n", "",
+                static_cast<unsigned long long>(stats.BytesCopied / stats.Frames));
+}
+
+} // namespace
+
+// A 4K transparent widget. Before dirty rect copies, every paint copied the full
+// frame; a blinking caret or a small counter now only copies its own rect.
+void RunOsrPaintBenchmarks()
+{
+    const int width = 3840;
+    const int height = 2160;
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4, 0x7F);
+    std::vector<uint8_t> surface(frame.size());
+
+    std::printf("OSR paint, %dx%d BGRA\n", width, height);
+    Measure("memcpy full frame (former OnPaint)", 200, [&] {
+        std::memcpy(surface.data(), frame.data(), frame.size());
+        DoNotOptimize(surface);
+    });
+    MeasurePaint("paint full frame", frame, surface, width, height, {}, true);
+    MeasurePaint("paint caret (2x24)", frame, surface, width, height, {CefRect(600, 400, 2, 24)}, false);
+    MeasurePaint("paint counter (160x48)", frame, surface, width, height, {CefRect(3600, 40, 160, 48)}, false);
+    MeasurePaint("paint 8 scattered rects (256x128)", frame, surface, width, height,
+                 {CefRect(0, 0, 256, 128), CefRect(512, 256, 256, 128), CefRect(1024, 512, 256, 128),
+                  CefRect(1536, 768, 256, 128), CefRect(2048, 1024, 256, 128), CefRect(2560, 1280, 256, 128),
+                  CefRect(3072, 1536, 256, 128), CefRect(3584, 2032, 256, 128)},
+                 false);
+    MeasurePaint("paint full width band (3840x270)", frame, surface, width, height, {CefRect(0, 900, width, 270)}, false);
+}
@@ -0,0 +1,144 @@
+#include "benchmark_util.h"
+#include "../pytonium_library/pixel_convert.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const PixelConvertIsa AllIsas[] = {PIXEL_CONVERT_SCALAR, PIXEL_CONVERT_SSSE3, PIXEL_CONVERT_AVX2, PIXEL_CONVERT_NEON};
+
+const PixelFormat AllFormats[] = {PIXEL_FORMAT_BGRA, PIXEL_FORMAT_RGBA, PIXEL_FORMAT_BGRA_STRAIGHT,
+                                  PIXEL_FORMAT_RGBA_STRAIGHT, PIXEL_FORMAT_BGR, PIXEL_FORMAT_RGB};
+
+const char* FormatName(PixelFormat format)
+{
+    const char* names[] = {"bgra", "rgba", "bgra_straight", "rgba_straight", "bgr", "rgb"};
+    return names[format];
+}
+
+// Every (color, alpha) pair, followed by random pixels, so the SIMD kernels are
+// checked against the scalar ones on all values and on every tail length.
+std::vector<uint8_t> MakeTestPixels(size_t randomPixels)
+{
+    std::vector<uint8_t> pixels;
+    for (int a = 0; a < 256; a++)
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            uint8_t color = static_cast<uint8_t>(c);
+            pixels.insert(pixels.end(), {color, static_cast<uint8_t>(255 - c), color, static_cast<uint8_t>(a)});
+        }
+    }
+    std::mt19937 random(42);
+    for (size_t i = 0; i < randomPixels * 4; i++)
+        pixels.push_back(static_cast<uint8_t>(random()));
+    return pixels;
+}
+
+bool VerifyIsa(PixelConvertIsa isa, const std::vector<uint8_t>& pixels)
+{
+    const int width = static_cast<int>(pixels.size() / 4);
+    std::vector<uint8_t> expected(pixels.size());
+    std::vector<uint8_t> actual(pixels.size());
+    bool ok = true;
+    for (PixelFormat srcFormat : AllFormats)
+    {
+        if (!PixelFormatHasAlpha(srcFormat))
+            continue;
+        for (PixelFormat dstFormat : AllFormats)
+        {
+            // Whole buffer as one row, then odd region widths for the tails.
+            for (int regionWidth : {width, 1, 3, 5, 7, 9, 15, 17, 31, 33, 63})
+            {
+                int rows = width / regionWidth;
+                int dstStride = regionWidth * PixelFormatBytes(dstFormat);
+                ConvertPixels(pixels.data(), regionWidth * 4, srcFormat, 0, 0, regionWidth, rows,
+                              expected.data(), dstStride, dstFormat, PIXEL_CONVERT_SCALAR);
+                ConvertPixels(pixels.data(), regionWidth * 4, srcFormat, 0, 0, regionWidth, rows,
+                              actual.data(), dstStride, dstFormat, isa);
+                if (std::memcmp(expected.data(), actual.data(), static_cast<size_t>(dstStride) * rows) != 0)
+                {
+                    std::printf("MISMATCH %s: %s -> %s, width %d\n", GetPixelConvertIsaName(isa),
+                                FormatName(srcFormat), FormatName(dstFormat), regionWidth);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// Spot checks of the scalar reference itself.
+bool VerifyScalar()
+{
+    const uint8_t src[] = {64, 128, 255, 128, 10, 20, 30, 0};
+    uint8_t straight[8];
+    uint8_t premultiplied[8];
+    uint8_t rgb[6];
+    ConvertPixels(src, 8, PIXEL_FORMAT_BGRA, 0, 0, 2, 1, straight, 8, PIXEL_FORMAT_RGBA_STRAIGHT, PIXEL_CONVERT_SCALAR);
+    ConvertPixels(src, 8, PIXEL_FORMAT_BGRA_STRAIGHT, 0, 0, 2, 1, premultiplied, 8, PIXEL_FORMAT_BGRA, PIXEL_CONVERT_SCALAR);
+    ConvertPixels(src, 8, PIXEL_FORMAT_BGRA, 0, 0, 2, 1, rgb, 6, PIXEL_FORMAT_RGB, PIXEL_CONVERT_SCALAR);
+    const uint8_t expectedStraight[] = {255, 255, 128, 128, 0, 0, 0, 0};
+    const uint8_t expectedPremultiplied[] = {32, 64, 128, 128, 0, 0, 0, 0};
+    const uint8_t expectedRgb[] = {255, 128, 64, 30, 20, 10};
+    bool ok = std::memcmp(straight, expectedStraight, 8) == 0 &&
+              std::memcmp(premultiplied, expectedPremultiplied, 8) == 0 &&
+              std::memcmp(rgb, expectedRgb, 6) == 0;
+    if (!ok)
+        std::printf("MISMATCH scalar reference\n");
+    return ok;
+}
+
+} // namespace
+
+// Checks every kernel this CPU supports against the scalar kernels, then
+// measures a 1080p frame export. Returns false on a mismatch.
+bool RunPixelConvertBenchmarks()
+{
+    std::printf("Pixel conversion, best kernels: %s\n", GetPixelConvertIsaName(GetPixelConvertIsa()));
+    bool ok = VerifyScalar();
+    std::vector<uint8_t> testPixels = MakeTestPixels(4099);
+    for (PixelConvertIsa isa : AllIsas)
+    {
+        if (isa != PIXEL_CONVERT_SCALAR && IsPixelConvertIsaSupported(isa))
+            ok = VerifyIsa(isa, testPixels) && ok;
+    }
+    std::printf("%-48s %12s\n", "kernel verification", ok ? "ok" : "FAILED");
+
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4);
+    std::mt19937 random(7);
+    for (size_t i = 0; i < frame.size(); i += 4)
+    {
+        uint8_t alpha = static_cast<uint8_t>(random());
+        frame[i] = static_cast<uint8_t>(random() % (alpha + 1));
+        frame[i + 1] = static_cast<uint8_t>(random() % (alpha + 1));
+        frame[i + 2] = static_cast<uint8_t>(random() % (alpha + 1));
+        frame[i + 3] = alpha;
+    }
+    std::vector<uint8_t> out(frame.size());
+
+    for (PixelFormat dstFormat : {PIXEL_FORMAT_RGBA, PIXEL_FORMAT_RGBA_STRAIGHT, PIXEL_FORMAT_RGB})
+    {
+        for (PixelConvertIsa isa : AllIsas)
+        {
+            if (!IsPixelConvertIsaSupported(isa))
+                continue;
+            std::string name = std::string("bgra -> ") + FormatName(dstFormat) + " 1080p (" +
+                               GetPixelConvertIsaName(isa) + ")";
+            double ns = Measure(name, 50, [&] {
+                ConvertPixels(frame.data(), width * 4, PIXEL_FORMAT_BGRA, 0, 0, width, height,
+                              out.data(), width * PixelFormatBytes(dstFormat), dstFormat, isa);
+                DoNotOptimize(out);
+            });
+            std::printf("%-48s %12.0f Mpx/s\n", "", static_cast<double>(width) * height / ns * 1e3);
+        }
+    }
+    return ok;
+}
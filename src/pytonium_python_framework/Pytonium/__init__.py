@@ -49,6 +49,7 @@ if os.name == 'posix':
     cdll.LoadLibrary(f'{pytonium_path}/{bin_folder}/libcef.so')
 
 from .pytonium import Pytonium as Pytonium
+from .pytonium import convert_pixels, get_pixel_convert_isa, read_asset_pack_entry
 
 # Initialize the class-level attribute upon import
 Pytonium.set_subprocess_path(pytonium_process_path)
@@ -59,11 +60,12 @@ async def run_pytonium_async(pytonium, interval=0.016):
 
     This allows integrating Pytonium into an asyncio event loop.
     Call this from an async context instead of writing your own
-    ``while is_running: update_message_loop; sleep`` loop.
+    ``while is_running: update_message_loop; sleep`` loop. The loop is
+    updated when CEF has work due, see ``Pytonium.aio``.
 
     Args:
         pytonium: A Pytonium instance (must already be initialized).
-        interval: Seconds between message loop updates (default ~60fps).
+        interval: Unused, kept for compatibility.
 
     Example::
 
@@ -74,10 +76,8 @@ async def run_pytonium_async(pytonium, interval=0.016):
         p.initialize("https://example.com", 800, 600)
         asyncio.run(run_pytonium_async(p))
     """
-    import asyncio
-    while pytonium.is_running():
-        pytonium.update_message_loop()
-        await asyncio.sleep(interval)
+    from . import aio
+    await aio.run(pytonium)
 
 
 async def run_pytonium_multi_async(instances, interval=0.016):
@@ -89,7 +89,7 @@ async def run_pytonium_multi_async(instances, interval=0.016):
 
     Args:
         instances: A list of initialized Pytonium instances.
-        interval: Seconds between message loop updates (default ~60fps).
+        interval: Unused, kept for compatibility.
 
     Example::
 
@@ -102,7 +102,5 @@ async def run_pytonium_multi_async(instances, interval=0.016):
         p2.initialize("https://example.org", 600, 400)
         asyncio.run(run_pytonium_multi_async([p1, p2]))
     """
-    import asyncio
-    while any(p.is_running() for p in instances):
-        instances[0].update_message_loop()
-        await asyncio.sleep(interval)
+    from . import aio
+    await aio.run(*instances)
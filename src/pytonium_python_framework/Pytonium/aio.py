@@ -0,0 +1,235 @@
+"""Run Pytonium inside an asyncio event loop.
+
+CEF tells Pytonium when its message loop has work. ``AsyncioMessagePump``
+turns that into event loop callbacks instead of polling: the wakeup file
+descriptor is watched with ``loop.add_reader`` and the work is scheduled with
+``loop.call_at``. Where the loop cannot watch it (Windows, the proactor loop),
+a helper thread waits for the work and hands it to the loop::
+
+    import asyncio
+    from Pytonium import Pytonium, aio
+
+    async def main():
+        p = Pytonium()
+        await aio.initialize(p, "https://example.com", 800, 600)
+        print(await aio.evaluate_javascript(p, "document.title"))
+        await aio.run(p)
+
+    asyncio.run(main())
+
+Bound ``async def`` functions called from JavaScript run as tasks on the loop
+(see ``Pytonium.set_asyncio_loop``).
+"""
+
+import asyncio
+import threading
+from typing import Any, Callable, List, Optional, Tuple
+
+# How often readiness is checked when there is no pump to check it after its
+# work, in background-thread mode.
+_POLL_INTERVAL = 0.01
+
+# How often the pump looks again while CEF is not initialized (before
+# initialize() and after shutdown), when the message loop delay stays 0.
+_IDLE_INTERVAL = 0.1
+
+# The pump of an event loop is stored on the loop, so it goes with it.
+_LOOP_ATTRIBUTE = "_pytonium_asyncio_pump"
+
+
+class AsyncioMessagePump:
+    """Drives the CEF message loop from an asyncio event loop.
+
+    The message loop is shared by all Pytonium instances, so one pump per event
+    loop is enough; use ``get_pump()``. In background-thread mode CEF pumps
+    itself and the pump only serves ``wait_until()``.
+
+    Only the class of ``pytonium`` is kept: the message loop methods are class
+    methods, and the pump must not keep an instance alive.
+    """
+
+    def __init__(self, pytonium, loop: Optional[asyncio.AbstractEventLoop] = None):
+        self._pytonium = pytonium if isinstance(pytonium, type) else type(pytonium)
+        self._loop = loop if loop is not None else asyncio.get_running_loop()
+        self._timer: Optional[asyncio.TimerHandle] = None
+        self._fd = -1
+        self._thread: Optional[threading.Thread] = None
+        self._stopping = threading.Event()
+        self._idle = threading.Event()
+        self._waiters: List[Tuple[Callable[[], bool], asyncio.Future]] = []
+        self._started = False
+
+    @property
+    def loop(self) -> asyncio.AbstractEventLoop:
+        return self._loop
+
+    def start(self) -> None:
+        """Start pumping. Does nothing if the pump already runs."""
+        if self._started:
+            return
+        self._started = True
+        if self._pytonium.is_background_thread():
+            return
+        fd = self._pytonium.get_message_loop_wakeup_fd()
+        if fd >= 0:
+            try:
+                self._loop.add_reader(fd, self._schedule)
+                self._fd = fd
+            except NotImplementedError:
+                pass
+        if self._fd < 0:
+            self._stopping.clear()
+            self._thread = threading.Thread(target=self._wait_for_work, name="PytoniumAsyncioPump", daemon=True)
+            self._thread.start()
+        else:
+            self._schedule()
+
+    def stop(self) -> None:
+        """Stop pumping. Pending ``wait_until()`` calls keep waiting until it is started again."""
+        if not self._started:
+            return
+        self._started = False
+        if self._fd >= 0:
+            self._loop.remove_reader(self._fd)
+            self._fd = -1
+        if self._timer is not None:
+            self._timer.cancel()
+            self._timer = None
+        if self._thread is not None:
+            self._stopping.set()
+            self._thread.join()
+            self._thread = None
+
+    async def wait_until(self, predicate: Callable[[], bool]) -> None:
+        """Wait until ``predicate()`` is true, checked after each message loop update."""
+        if predicate():
+            return
+        if not self._started or self._pytonium.is_background_thread():
+            while not predicate():
+                await asyncio.sleep(_POLL_INTERVAL)
+            return
+        future = self._loop.create_future()
+        self._waiters.append((predicate, future))
+        await future
+
+    def _schedule(self) -> None:
+        # Also drains the wakeup fd, so the reader does not fire again.
+        delay = self._pytonium.get_message_loop_delay()
+        if not self._pytonium.is_cef_initialized():
+            delay = _IDLE_INTERVAL
+        when = self._loop.time() + delay
+        if self._timer is not None:
+            if self._timer.when() <= when:
+                return
+            self._timer.cancel()
+        self._timer = self._loop.call_at(when, self._do_work)
+
+    def _do_work(self) -> None:
+        self._timer = None
+        if self._pytonium.is_cef_initialized():
+            self._pytonium.update_message_loop()
+        if self._fd >= 0:
+            self._schedule()
+        self._check_waiters()
+
+    def _do_work_from_thread(self) -> None:
+        try:
+            if self._started:
+                self._do_work()
+        finally:
+            self._idle.set()
+
+    def _wait_for_work(self) -> None:
+        while not self._stopping.is_set():
+            if not self._pytonium.is_cef_initialized():
+                # No work can be due; only the waiters are checked.
+                if self._stopping.wait(_IDLE_INTERVAL):
+                    return
+            elif not self._pytonium.wait_for_message_loop_work(0.1):
+                continue
+            self._idle.clear()
+            try:
+                self._loop.call_soon_threadsafe(self._do_work_from_thread)
+            except RuntimeError:
+                # The loop closed.
+                return
+            # Until the work ran, the wait would return right away.
+            while not self._idle.wait(0.1):
+                if self._stopping.is_set():
+                    return
+
+    def _check_waiters(self) -> None:
+        waiting = []
+        for predicate, future in self._waiters:
+            if future.done():
+                continue
+            try:
+                if predicate():
+                    future.set_result(None)
+                    continue
+            except Exception as error:
+                future.set_exception(error)
+                continue
+            waiting.append((predicate, future))
+        self._waiters = waiting
+
+
+def get_pump(pytonium, loop: Optional[asyncio.AbstractEventLoop] = None) -> AsyncioMessagePump:
+    """Get the running pump of ``loop`` (default: the running loop), starting one if needed."""
+    if loop is None:
+        loop = asyncio.get_running_loop()
+    pump = getattr(loop, _LOOP_ATTRIBUTE, None)
+    if pump is None:
+        pump = AsyncioMessagePump(pytonium, loop)
+        setattr(loop, _LOOP_ATTRIBUTE, pump)
+    pump.start()
+    return pump
+
+
+async def initialize(pytonium, start_url: str, init_width: int, init_height: int) -> None:
+    """Initialize ``pytonium`` and wait until its page can run JavaScript."""
+    pytonium.initialize(start_url, init_width, init_height)
+    pytonium.set_asyncio_loop(asyncio.get_running_loop())
+    await get_pump(pytonium).wait_until(pytonium.is_ready_to_execute_javascript)
+
+
+async def create_browser(pytonium, url: str, width: int, height: int, frameless: bool = False,
+                         icon_path: str = "") -> int:
+    """Create a browser for ``pytonium`` (CEF must be initialized) and wait until it can run JavaScript.
+
+    Returns:
+        The browser ID.
+    """
+    browser_id = pytonium.create_browser(url, width, height, frameless, icon_path)
+    pytonium.set_asyncio_loop(asyncio.get_running_loop())
+    await get_pump(pytonium).wait_until(pytonium.is_ready_to_execute_javascript)
+    return browser_id
+
+
+async def evaluate_javascript(pytonium, code: str) -> Any:
+    """Evaluate JavaScript in the main frame of ``pytonium``, see ``Pytonium.evaluate_javascript``."""
+    get_pump(pytonium)
+    return await asyncio.wrap_future(pytonium.evaluate_javascript(code))
+
+
+async def get_state(pytonium, namespace: str, key: str) -> Any:
+    """Read a value from the application state, see ``Pytonium.get_state_async``."""
+    get_pump(pytonium)
+    return await asyncio.wrap_future(pytonium.get_state_async(namespace, key))
+
+
+async def get_changes_since(pytonium, namespace: str, version: int = 0) -> Any:
+    """Read the state changes of a namespace, see ``Pytonium.get_changes_since``."""
+    get_pump(pytonium)
+    return await asyncio.wrap_future(pytonium.get_changes_since(namespace, version))
+
+
+async def run(*instances) -> None:
+    """Keep the message loop running until the browsers of all ``instances`` are closed."""
+    if not instances:
+        return
+    pump = get_pump(instances[0])
+    await pump.wait_until(lambda: not any(p.is_running() for p in instances))
+    # Unless other calls still wait on it; get_pump() starts it again.
+    if not pump._waiters:
+        pump.stop()
@@ -0,0 +1,177 @@
+"""Build and read ``.pytpak`` asset archives for Pytonium custom schemes.
+
+A custom scheme whose content root is a ``.pytpak`` file serves its files
+straight from the memory mapped archive instead of the file system::
+
+    pytonium.add_custom_scheme("app", "C:/my_app/app.pytpak")
+
+Build an archive from a folder with::
+
+    python -m Pytonium.asset_pack my_app/dist my_app/app.pytpak --compress
+
+The layout is documented in ``src/pytonium_library/asset_pack.h``.
+"""
+
+import argparse
+import gzip
+import os
+import struct
+from typing import Dict, List, Optional, Tuple
+
+MAGIC = b"PYTPAK01"
+VERSION = 1
+FLAG_GZIP = 1
+
+_HEADER = struct.Struct("<8sIIIIQQ")
+_ENTRY = struct.Struct("<QIIQQQq")
+
+# Formats that are already compressed and do not shrink any further.
+_INCOMPRESSIBLE_EXTENSIONS = {
+    ".br", ".gz", ".zip", ".7z", ".png", ".jpg", ".jpeg", ".gif", ".webp", ".avif",
+    ".mp3", ".mp4", ".ogg", ".webm", ".woff", ".woff2",
+}
+
+
+def fnv1a(data: bytes, seed: int) -> int:
+    """32 bit FNV-1a hash, seeded by xor-ing the seed into the offset basis."""
+    h = (0x811C9DC5 ^ seed) & 0xFFFFFFFF
+    for byte in data:
+        h ^= byte
+        h = (h * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def _build_index(keys: List[bytes]) -> Tuple[List[int], List[int]]:
+    """Builds a minimal perfect hash for ``keys`` with hash and displace.
+
+    Returns the per bucket seeds and, for every slot, the index of the key in it.
+    """
+    count = len(keys)
+    bucket_count = count // 2 + 1
+    buckets: List[List[int]] = [[] for _ in range(bucket_count)]
+    for index, key in enumerate(keys):
+        buckets[fnv1a(key, 0) % bucket_count].append(index)
+
+    seeds = [0] * bucket_count
+    slots: List[Optional[int]] = [None] * count
+    # Place the largest buckets first, while most slots are still free.
+    for bucket in sorted(range(bucket_count), key=lambda b: len(buckets[b]), reverse=True):
+        members = buckets[bucket]
+        if not members:
+            break
+        seed = 1
+        while True:
+            targets = [fnv1a(keys[i], seed) % count for i in members]
+            if len(set(targets)) == len(targets) and all(slots[t] is None for t in targets):
+                break
+            seed += 1
+            if seed > 0xFFFFFFFF:
+                raise RuntimeError("Could not build a perfect hash for the archive index")
+        seeds[bucket] = seed
+        for member, target in zip(members, targets):
+            slots[target] = member
+    return seeds, slots
+
+
+def build_asset_pack(source_folder: str, output_path: str, compress: bool = False) -> int:
+    """Packs all files below ``source_folder`` into ``output_path``.
+
+    Args:
+        source_folder: Folder whose files become the archive entries. Paths are
+            stored relative to it, with ``/`` separators.
+        output_path: The archive file to write.
+        compress: Store entries gzip compressed where that saves at least 10%.
+            Compressed entries are sent with ``Content-Encoding: gzip`` to clients
+            whose ``Accept-Encoding`` allows it and decompressed for all others.
+
+    Returns:
+        The number of files packed.
+    """
+    files = []
+    for root, _, names in os.walk(source_folder):
+        for name in names:
+            full_path = os.path.join(root, name)
+            if os.path.abspath(full_path) == os.path.abspath(output_path):
+                continue
+            relative = os.path.relpath(full_path, source_folder).replace(os.sep, "/")
+            files.append((relative.encode("utf-8"), full_path))
+    files.sort()
+
+    keys = [key for key, _ in files]
+    seeds, slots = _build_index(keys)
+
+    seeds_offset = _HEADER.size
+    entries_offset = seeds_offset + 4 * len(seeds)
+    data_offset = entries_offset + _ENTRY.size * len(files)
+
+    entries = [b""] * len(files)
+    blobs = []
+    for slot, index in enumerate(slots):
+        key, full_path = files[index]
+        with open(full_path, "rb") as f:
+            data = f.read()
+        flags = 0
+        stored = data
+        if compress and os.path.splitext(full_path)[1].lower() not in _INCOMPRESSIBLE_EXTENSIONS:
+            compressed = gzip.compress(data, compresslevel=9, mtime=0)
+            if len(compressed) < len(data) * 0.9:
+                flags |= FLAG_GZIP
+                stored = compressed
+        path_offset = data_offset
+        blobs.append(key)
+        data_offset += len(key)
+        entries[slot] = _ENTRY.pack(path_offset, len(key), flags, data_offset, len(stored), len(data),
+                                    int(os.path.getmtime(full_path)))
+        blobs.append(stored)
+        data_offset += len(stored)
+
+    with open(output_path, "wb") as out:
+        out.write(_HEADER.pack(MAGIC, VERSION, len(files), len(seeds), 0, seeds_offset, entries_offset))
+        out.write(struct.pack(f"<{len(seeds)}I", *seeds))
+        out.writelines(entries)
+        out.writelines(blobs)
+    return len(files)
+
+
+class AssetPackReader:
+    """Reads entries from a ``.pytpak`` archive, using the same lookup as Pytonium."""
+
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            self._data = f.read()
+        magic, version, self._entry_count, self._bucket_count, _, self._seeds_offset, self._entries_offset = \
+            _HEADER.unpack_from(self._data, 0)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{path} is not a Pytonium asset pack")
+
+    def __len__(self) -> int:
+        return self._entry_count
+
+    def get(self, path: str) -> Optional[bytes]:
+        """Returns the uncompressed content of ``path``, or None if it is not in the archive."""
+        if self._entry_count == 0:
+            return None
+        key = path.encode("utf-8")
+        bucket = fnv1a(key, 0) % self._bucket_count
+        seed, = struct.unpack_from("<I", self._data, self._seeds_offset + 4 * bucket)
+        slot = fnv1a(key, seed) % self._entry_count
+        path_offset, path_length, flags, data_offset, stored_size, _, _ = \
+            _ENTRY.unpack_from(self._data, self._entries_offset + _ENTRY.size * slot)
+        if self._data[path_offset:path_offset + path_length] != key:
+            return None
+        data = self._data[data_offset:data_offset + stored_size]
+        return gzip.decompress(data) if flags & FLAG_GZIP else data
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    parser = argparse.ArgumentParser(description="Build a Pytonium asset pack (.pytpak) from a folder.")
+    parser.add_argument("source_folder", help="Folder to pack")
+    parser.add_argument("output", help="Archive to write, e.g. app.pytpak")
+    parser.add_argument("--compress", action="store_true", help="gzip compress entries where it helps")
+    args = parser.parse_args(argv)
+    count = build_asset_pack(args.source_folder, args.output, args.compress)
+    print(f"Packed {count} files into {args.output}")
+
+
+if __name__ == "__main__":
+    main()
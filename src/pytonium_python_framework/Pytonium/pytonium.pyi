@@ -1,4 +1,5 @@
-from typing import Any, Callable, Optional, Sequence
+from concurrent.futures import Future
+from typing import Any, Callable, ContextManager, Dict, List, Optional, Sequence, Tuple, Union
 
 class Pytonium:
     def __init__(self) -> None: ...
@@ -12,6 +13,8 @@ class Pytonium:
     def initialize(self, start_url: str, init_width: int, init_height: int) -> None: ...
     def return_value_to_javascript(self, message_id: int, value: Any) -> None: ...
     def execute_javascript(self, code: str) -> None: ...
+    def evaluate_javascript(self, code: str) -> Future: ...
+    def set_asyncio_loop(self, loop: Any) -> None: ...
 
     def bind_function_to_javascript(
         self,
@@ -63,12 +66,60 @@ class Pytonium:
     def get_browser_id(self) -> int: ...
     def shutdown(self) -> None: ...
     def is_running(self) -> bool: ...
+    def is_ready_to_execute_javascript(self) -> bool: ...
 
     @classmethod
     def is_cef_initialized(cls) -> bool: ...
-    def update_message_loop(self) -> None: ...
-    def add_custom_scheme(self, scheme_identifier: str, scheme_content_root_folder: str) -> None: ...
+    @classmethod
+    def update_message_loop(cls) -> None: ...
+    def run(self) -> None: ...
+    @classmethod
+    def set_background_thread(cls, enabled: bool = True) -> None: ...
+    @classmethod
+    def is_background_thread(cls) -> bool: ...
+    @classmethod
+    def wait_for_message_loop_work(cls, timeout: Optional[float] = None) -> bool: ...
+    @classmethod
+    def get_message_loop_delay(cls) -> float: ...
+    @classmethod
+    def get_message_loop_wakeup_fd(cls) -> int: ...
+    @classmethod
+    def set_message_loop_max_delay(cls, seconds: float) -> None: ...
+    @classmethod
+    def get_message_loop_max_delay(cls) -> float: ...
+    @classmethod
+    def get_message_loop_stats(cls) -> Dict[str, int]: ...
+    @classmethod
+    def get_ui_thread_queue_stats(cls) -> Dict[str, int]: ...
+    @classmethod
+    def start_browser_pool(cls, url: str, size: int = 2, windowless: bool = False) -> None: ...
+    def start_bindings_browser_pool(self, url: str, size: int = 1, windowless: bool = False) -> None: ...
+    def stop_bindings_browser_pool(self) -> None: ...
+    @classmethod
+    def stop_browser_pool(cls) -> None: ...
+    @classmethod
+    def get_browser_pool_stats(cls) -> Dict[str, int]: ...
+    def add_custom_scheme(self, scheme_identifier: str, scheme_content_root_folder: str,
+                          cache_control: str = "no-cache", *, secure: bool = False, cors_enabled: bool = True,
+                          fetch_enabled: bool = False, csp_bypassing: bool = False, local: bool = False,
+                          display_isolated: bool = False, cross_origin_isolated: bool = False,
+                          headers: Optional[Dict[str, str]] = None) -> None: ...
     def add_mime_type_mapping(self, file_extension: str, mime_type: str) -> None: ...
+    def add_scheme_route(self, scheme_identifier: str, prefix: str,
+                         handler: Callable[["PytoniumSchemeRequest"], Any]) -> None: ...
+    def remove_scheme_route(self, scheme_identifier: str, prefix: str) -> None: ...
+    def add_virtual_file(self, scheme_identifier: str, path: str, data: Union[bytes, str], mime_type: str) -> None: ...
+    def remove_virtual_file(self, scheme_identifier: str, path: str) -> None: ...
+    @classmethod
+    def set_asset_cache_budget(cls, budget_bytes: int) -> None: ...
+    @classmethod
+    def clear_asset_cache(cls) -> None: ...
+    @classmethod
+    def get_asset_cache_stats(cls) -> Dict[str, int]: ...
+    @classmethod
+    def set_scheme_route_timeout(cls, seconds: float) -> None: ...
+    @classmethod
+    def get_scheme_route_timeout(cls) -> float: ...
     def set_cache_path(self, path: str) -> None: ...
     def set_custom_icon_path(self, path: str) -> None: ...
     def load_url(self, url: str) -> None: ...
@@ -76,6 +127,8 @@ class Pytonium:
     # Window control methods
     def set_frameless_window(self, frameless: bool) -> None: ...
     def set_osr_mode(self, osr: bool) -> None: ...
+    def set_headless(self, headless: bool) -> None: ...
+    def is_headless(self) -> bool: ...
     def minimize_window(self) -> None: ...
     def maximize_window(self) -> None: ...
     def restore_window(self) -> None: ...
@@ -89,6 +142,15 @@ class Pytonium:
     def resize_window(self, new_width: int, new_height: int, anchor: int = 0) -> None: ...
 
     def set_state(self, namespace: str, key: str, value: Any) -> None: ...
+    def set_states(self, namespace: str, values: dict[str, Any]) -> None: ...
+    def remove_state(self, namespace: str, key: str) -> None: ...
+    def get_state_async(self, namespace: str, key: str) -> Future[Any]: ...
+    def enable_state_cache(self, enabled: bool = True) -> None: ...
+    def get_changes_since(self, namespace: str, version: int = 0) -> Future[dict[str, Any]]: ...
+    def get_state_version(self, namespace: str, key: str) -> Future[int]: ...
+    def compare_and_set_state(self, namespace: str, key: str, expected_version: int, value: Any) -> Future[bool]: ...
+    def state_batch(self) -> ContextManager["Pytonium"]: ...
+    def get_pending_state_batch(self) -> Optional[dict[str, dict[str, Any]]]: ...
     def generate_typescript_definitions(self, filename: str) -> None: ...
 
     # Native window handle (Windows: HWND as int, Linux: X11 window ID)
@@ -98,3 +160,61 @@ class Pytonium:
     def on_title_change(self, callback: Callable[[str], None]) -> None: ...
     def on_address_change(self, callback: Callable[[str], None]) -> None: ...
     def on_fullscreen_change(self, callback: Callable[[bool], None]) -> None: ...
+    def on_frame(self, callback: Callable[..., None], pixel_format: str = "bgra",
+                 damage_only: bool = False) -> None: ...
+    def get_osr_paint_stats(self) -> Dict[str, int]: ...
+    def enable_frame_capture(self, enable: bool = True) -> None: ...
+    def capture_frame(self, only_new: bool = True) -> Optional["PytoniumFrame"]: ...
+    def get_frame_capture_stats(self) -> Dict[str, int]: ...
+    def start_recording(self, target: str, format: str = "y4m", pipe: bool = False, frame_rate: int = 30,
+                        queue_size: int = 8, pixel_format: str = "rgba") -> bool: ...
+    def stop_recording(self) -> None: ...
+    def get_recording_stats(self) -> Dict[str, Any]: ...
+    def set_frame_rate(self, frame_rate: int) -> None: ...
+    def set_adaptive_frame_rate(self, min_frame_rate: int = 5, max_frame_rate: int = 60) -> None: ...
+    def get_frame_rate_stats(self) -> Dict[str, Any]: ...
+    def get_renderer_cpu_usage(self) -> Future: ...
+    def start_pdf_pool(self, size: int = 2) -> None: ...
+    def stop_pdf_pool(self) -> None: ...
+    def render_pdf(self, url: Optional[str] = None, html: Optional[str] = None, data: Any = None,
+                   output_path: Optional[str] = None, landscape: bool = False, print_background: bool = True,
+                   scale: float = 1.0, paper_size: Optional[Tuple[float, float]] = None,
+                   margins: Union[float, Tuple[float, float, float, float], None] = None, page_ranges: str = "",
+                   prefer_css_page_size: bool = False, timeout: float = 30.0) -> Future: ...
+    def get_pdf_pool_stats(self) -> Dict[str, Any]: ...
+
+
+class PytoniumFrame:
+    """Read-only buffer of shape (height, width, 4) with premultiplied BGRA pixels."""
+    width: int
+    height: int
+    stride: int
+    sequence: int
+    timestamp: float
+    damage: Tuple[int, int, int, int]
+    damage_since: int
+
+    def to_bytes(self, pixel_format: str = "bgra",
+                 region: Optional[Tuple[int, int, int, int]] = None) -> bytes: ...
+
+
+def convert_pixels(pixels: Any, width: int, height: int, pixel_format: str, source_format: str = "bgra",
+                   region: Optional[Tuple[int, int, int, int]] = None) -> bytes: ...
+def get_pixel_convert_isa() -> str: ...
+def read_asset_pack_entry(archive: str, path: str, accept_encoding: str = "") -> Optional[Tuple[bytes, str]]: ...
+
+
+class PytoniumSchemeRequest:
+    request_id: int
+    method: str
+    url: str
+    path: str
+    headers: Dict[str, str]
+    body: bytes
+
+    def respond(self, status: int = 200, mime_type: str = "text/plain",
+                headers: Optional[Dict[str, str]] = None) -> bool: ...
+    def write(self, data: Union[bytes, str]) -> bool: ...
+    def finish(self) -> bool: ...
+    def send(self, data: Any, mime_type: Optional[str] = None, status: int = 200,
+             headers: Optional[Dict[str, str]] = None) -> bool: ...
@@ -4,9 +4,22 @@
 
 
 import inspect
+import json
 import warnings
-
-from .pytonium_library cimport PytoniumLibrary, CefValueWrapper, state_callback_object_ptr
+from concurrent.futures import Future
+
+from .pytonium_library cimport PytoniumLibrary, CefValueWrapper, state_callback_object_ptr, AssetCacheStats, SchemeRouteRequest, OsrFrame, OsrPaintStats, \
+    OsrFrameBuffer, OsrFrameCaptureStats, OsrFrameRateStats, FrameEncoderSettings, FrameEncoderStats, \
+    FRAME_ENCODER_Y4M, FRAME_ENCODER_PNG, FRAME_ENCODER_RAW, PdfRenderJob, PdfRenderPoolStats, MessagePumpStats
+from .pytonium_library cimport PixelFormat, PIXEL_FORMAT_BGRA, PIXEL_FORMAT_RGBA, PIXEL_FORMAT_BGRA_STRAIGHT, \
+    PIXEL_FORMAT_RGBA_STRAIGHT, PIXEL_FORMAT_BGR, PIXEL_FORMAT_RGB, PixelFormatBytes, ConvertPixels, \
+    GetPixelConvertIsa, GetPixelConvertIsaName
+from .pytonium_library cimport SetUiThreadWaitHooks, UiThreadQueueStats, GetUiThreadQueueStats
+from .pytonium_library cimport BrowserPoolStats
+from .pytonium_library cimport ReadAssetPackEntry
+from .pytonium_library cimport PendingStateBatch
+from .pytonium_library cimport CEF_SCHEME_OPTION_STANDARD, CEF_SCHEME_OPTION_LOCAL, CEF_SCHEME_OPTION_DISPLAY_ISOLATED, \
+    CEF_SCHEME_OPTION_SECURE, CEF_SCHEME_OPTION_CORS_ENABLED, CEF_SCHEME_OPTION_CSP_BYPASSING, CEF_SCHEME_OPTION_FETCH_ENABLED
 from libcpp.string cimport string
 
 from libcpp cimport bool as boolie
@@ -14,6 +27,12 @@ from libcpp.map cimport map  # Import map from the C++ standard library
 from libcpp.vector cimport vector  # Import vector from the C++ standard library
 from libcpp.pair cimport pair
 from libcpp.unordered_map cimport unordered_map
+from libcpp.memory cimport shared_ptr
+from cpython.buffer cimport PyBUF_WRITABLE
+from cpython.bytes cimport PyBytes_FromStringAndSize, PyBytes_AS_STRING
+from cpython.exc cimport PyErr_CheckSignals
+from cpython.ref cimport Py_REFCNT
+from libc.stdint cimport uint8_t, int64_t
 #from .header.pytonium_library cimport PytoniumLibrary, CefValueWrapper
 
 
@@ -81,13 +100,18 @@ cdef class PytoniumFunctionBindingWrapper:
 
 cdef class PytoniumStateHandlerWrapper:
     cdef object python_method
+    cdef object python_batch_method
 
-    def __init__(self, method):
+    def __init__(self, method, batch_method=None):
         self.python_method = method
+        self.python_batch_method = batch_method
 
     def __call__(self, namespace, key, arg):
         self.python_method(namespace, key, arg)
 
+    def call_batch(self, changes):
+        self.python_batch_method(changes)
+
     @property
     def get_python_method(self):
         return self.python_method
@@ -288,12 +312,13 @@ cdef inline void javascript_binding_object_callback(void *python_function_object
     try:
         arg_list = get_javascript_binding_arg_list(args, size, message_id)
 
-        if (<PytoniumFunctionBindingWrapper> python_function_object).returns_value:
+        return_value = (<PytoniumFunctionBindingWrapper> python_function_object)(*arg_list)
+        if inspect.iscoroutine(return_value):
+            (<Pytonium> (<PytoniumFunctionBindingWrapper> python_function_object).pytonium_instance)._dispatch_binding_coroutine(
+                return_value, message_id, (<PytoniumFunctionBindingWrapper> python_function_object).returns_value)
+        elif (<PytoniumFunctionBindingWrapper> python_function_object).returns_value:
             convert = PytoniumValueWrapper()
-            return_value = (<PytoniumFunctionBindingWrapper> python_function_object)(*arg_list)
             (<Pytonium> (<PytoniumFunctionBindingWrapper> python_function_object).pytonium_instance).pytonium_library.ReturnValueToJavascript(message_id, convert.PythonType_to_CefValueWrapper(return_value))
-        else:
-            (<PytoniumFunctionBindingWrapper> python_function_object)(*arg_list)
     except Exception:
         import traceback
         traceback.print_exc()
@@ -314,6 +339,85 @@ cdef inline void state_handler_callback(state_callback_object_ptr python_callbac
         import traceback
         traceback.print_exc()
 
+cdef inline void state_batch_handler_callback(state_callback_object_ptr python_callback_object, CefValueWrapper changes) noexcept with gil:
+    try:
+        converter = PytoniumValueWrapper()
+        (<PytoniumStateHandlerWrapper> python_callback_object).call_batch(converter.CefValueWrapper_to_PythonType(changes))
+    except Exception:
+        import traceback
+        traceback.print_exc()
+
+cdef class PytoniumPendingRequest:
+    """Keeps a Future alive until the browser answers the request it belongs to."""
+    cdef object future
+    cdef object result_converter
+    cdef set owner
+
+    def __init__(self, set owner, result_converter=None):
+        self.future = Future()
+        self.result_converter = result_converter
+        self.owner = owner
+        self.owner.add(self)
+
+    def resolve(self, success, value):
+        self.owner.discard(self)
+        if self.future.done():
+            return
+        if not success:
+            self.future.set_exception(RuntimeError("The browser closed before the request completed."))
+        elif self.result_converter is not None:
+            self.future.set_result(self.result_converter(value))
+        else:
+            self.future.set_result(value)
+
+    def fail(self, message):
+        self.owner.discard(self)
+        if not self.future.done():
+            self.future.set_exception(RuntimeError(message))
+
+cdef inline void state_request_callback(void* user_data, int request_id, boolie success, CefValueWrapper result) noexcept with gil:
+    try:
+        converter = PytoniumValueWrapper()
+        (<PytoniumPendingRequest> user_data).resolve(bool(success), converter.CefValueWrapper_to_PythonType(result))
+    except Exception:
+        import traceback
+        traceback.print_exc()
+
+def _convert_state_changes(value):
+    return {
+        "version": int(value.get("version", 0)),
+        "changes": value.get("changes", {}),
+        "removed": value.get("removed", []),
+        "reset": bool(value.get("reset", False)),
+    }
+
+cdef inline void pdf_render_callback(void* user_data, int request_id, boolie success, CefValueWrapper result) noexcept with gil:
+    try:
+        converter = PytoniumValueWrapper()
+        value = converter.CefValueWrapper_to_PythonType(result)
+        request = <PytoniumPendingRequest> user_data
+        if not success:
+            request.fail("The PDF pool stopped before the job completed.")
+        elif "error" in value:
+            request.fail(value["error"])
+        else:
+            try:
+                request.resolve(True, value["path"])
+            except OSError as e:
+                # The temporary PDF could not be read back.
+                request.fail(str(e))
+    except Exception:
+        import traceback
+        traceback.print_exc()
+
+def _read_temporary_pdf(path):
+    import os
+    try:
+        with open(path, "rb") as f:
+            return f.read()
+    finally:
+        os.remove(path)
+
 cdef class PytoniumWindowEventCallbackWrapper:
     """Wraps a Python callable for window event callbacks."""
     cdef object python_callback
@@ -345,6 +449,324 @@ cdef inline void _on_fullscreen_change_callback(void* user_data, boolie value) n
         import traceback
         traceback.print_exc()
 
+_PIXEL_FORMATS = {
+    "bgra": PIXEL_FORMAT_BGRA,
+    "rgba": PIXEL_FORMAT_RGBA,
+    "bgra_straight": PIXEL_FORMAT_BGRA_STRAIGHT,
+    "rgba_straight": PIXEL_FORMAT_RGBA_STRAIGHT,
+    "bgr": PIXEL_FORMAT_BGR,
+    "rgb": PIXEL_FORMAT_RGB,
+}
+
+cdef PixelFormat _pixel_format(str name) except *:
+    try:
+        return _PIXEL_FORMATS[name]
+    except KeyError:
+        raise ValueError(f"Unknown pixel format {name!r}, expected one of {', '.join(_PIXEL_FORMATS)}") from None
+
+cdef bytes _convert_pixels(const uint8_t* src, int src_stride, PixelFormat src_format, int width, int height,
+                           object region, PixelFormat dst_format):
+    cdef int x = 0, y = 0, region_width = width, region_height = height
+    if region is not None:
+        x, y, region_width, region_height = region
+        if x < 0 or y < 0 or region_width < 0 or region_height < 0 or \
+                x + region_width > width or y + region_height > height:
+            raise ValueError(f"region {tuple(region)} is outside of the {width}x{height} frame")
+    cdef int dst_stride = region_width * PixelFormatBytes(dst_format)
+    cdef bytes result = PyBytes_FromStringAndSize(NULL, <Py_ssize_t>dst_stride * region_height)
+    cdef uint8_t* dst = <uint8_t*>PyBytes_AS_STRING(result)
+    cdef boolie converted
+    with nogil:
+        converted = ConvertPixels(src, src_stride, src_format, x, y, region_width, region_height,
+                                  dst, dst_stride, dst_format)
+    if not converted:
+        raise ValueError("Pixels can only be converted from bgra, rgba, bgra_straight or rgba_straight")
+    return result
+
+def convert_pixels(pixels, width: int, height: int, pixel_format: str, source_format: str = "bgra", region=None) -> bytes:
+    """Convert a tightly packed frame to another pixel format.
+
+    Uses the SIMD kernels of the frame export (SSSE3/AVX2 or NEON, picked at runtime).
+
+    Args:
+        pixels: A bytes-like object of ``width * height * 4`` bytes.
+        width: Frame width in pixels.
+        height: Frame height in pixels.
+        pixel_format: ``"bgra"``, ``"rgba"``, ``"bgra_straight"``, ``"rgba_straight"``,
+            ``"bgr"`` or ``"rgb"``. Without suffix, alpha is premultiplied as painted
+            by Chromium; ``"bgr"``/``"rgb"`` drop alpha.
+        source_format: Format of ``pixels``, one of the four 4 byte formats.
+        region: Optional ``(x, y, width, height)`` to extract.
+
+    Returns:
+        The converted pixels, tightly packed.
+    """
+    cdef const uint8_t[::1] view = memoryview(pixels).cast("B")
+    if width < 0 or height < 0 or view.shape[0] < <Py_ssize_t>width * height * 4:
+        raise ValueError(f"pixels must hold {width}x{height} 4 byte pixels")
+    if width == 0 or height == 0:
+        return b""
+    return _convert_pixels(&view[0], width * 4, _pixel_format(source_format), width, height,
+                           region, _pixel_format(pixel_format))
+
+def get_pixel_convert_isa() -> str:
+    """Name of the instruction set the pixel conversion kernels use on this CPU."""
+    return GetPixelConvertIsaName(GetPixelConvertIsa()).decode("ascii")
+
+def read_asset_pack_entry(archive: str, path: str, accept_encoding: str = ""):
+    """Read a file from a ``.pytpak`` archive as a custom scheme would serve it.
+
+    Args:
+        archive: Path of the archive.
+        path: Path of the file inside the archive, relative to its root.
+        accept_encoding: The request's ``Accept-Encoding`` header. Compressed
+            entries are decompressed for clients that do not accept gzip.
+
+    Returns:
+        A ``(body, content_encoding)`` tuple, ``content_encoding`` being
+        ``"gzip"`` or ``""``, or None if the file is not in the archive.
+    """
+    cdef string body
+    cdef string content_encoding
+    if not ReadAssetPackEntry(archive.encode("utf-8"), path.encode("utf-8"), accept_encoding.encode("latin-1"),
+                              body, content_encoding):
+        return None
+    return body, content_encoding.decode("ascii")
+
+cdef class PytoniumFrameCallbackWrapper(PytoniumWindowEventCallbackWrapper):
+    """Frame callback, the pixel format it receives and whether it only gets the damage."""
+    cdef PixelFormat pixel_format
+    cdef boolie damage_only
+
+cdef inline void _on_frame_callback(void* user_data, const OsrFrame* frame) noexcept with gil:
+    cdef PytoniumFrameCallbackWrapper wrapper = <PytoniumFrameCallbackWrapper>user_data
+    try:
+        # CEF reuses the buffer after OnPaint returns, so the frame is copied,
+        # converted on the way if another format was asked for.
+        dirty_rects = [(frame.DirtyRects[i].X, frame.DirtyRects[i].Y, frame.DirtyRects[i].Width, frame.DirtyRects[i].Height)
+                       for i in range(frame.DirtyRectCount)]
+        if wrapper.damage_only:
+            damage = (frame.Damage.X, frame.Damage.Y, frame.Damage.Width, frame.Damage.Height)
+            pixels = _convert_pixels(<const uint8_t*>frame.Buffer, frame.Stride, PIXEL_FORMAT_BGRA,
+                                     frame.Width, frame.Height, damage, wrapper.pixel_format)
+            wrapper.python_callback(pixels, frame.Width, frame.Height, dirty_rects, damage)
+            return
+        if wrapper.pixel_format == PIXEL_FORMAT_BGRA:
+            pixels = (<const char*>frame.Buffer)[:frame.Stride * frame.Height]
+        else:
+            pixels = _convert_pixels(<const uint8_t*>frame.Buffer, frame.Stride, PIXEL_FORMAT_BGRA,
+                                     frame.Width, frame.Height, None, wrapper.pixel_format)
+        wrapper.python_callback(pixels, frame.Width, frame.Height, dirty_rects)
+    except Exception:
+        import traceback
+        traceback.print_exc()
+
+cdef class PytoniumFrame:
+    """A frame captured from an off-screen rendered browser.
+
+    Supports the buffer protocol without copying: ``numpy.asarray(frame)`` or
+    ``memoryview(frame)`` give a read-only ``(height, width, 4)`` array of
+    premultiplied BGRA bytes. The pixels stay valid as long as the frame (or a
+    view of it) is alive; Pytonium never paints into a captured frame.
+    """
+    cdef shared_ptr[const OsrFrameBuffer] _frame
+    cdef Py_ssize_t _shape[3]
+    cdef Py_ssize_t _strides[3]
+
+    def __getbuffer__(self, Py_buffer* buffer, int flags):
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("PytoniumFrame is read-only")
+        cdef const OsrFrameBuffer* frame = self._frame.get()
+        self._shape[0] = frame.Height
+        self._shape[1] = frame.Width
+        self._shape[2] = 4
+        self._strides[0] = frame.Stride
+        self._strides[1] = 4
+        self._strides[2] = 1
+        buffer.buf = <void*>frame.Pixels.data()
+        buffer.obj = self
+        buffer.len = <Py_ssize_t>frame.Pixels.size()
+        buffer.readonly = 1
+        buffer.itemsize = 1
+        buffer.format = b"B"
+        buffer.ndim = 3
+        buffer.shape = self._shape
+        buffer.strides = self._strides
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer* buffer):
+        pass
+
+    @property
+    def width(self) -> int:
+        return self._frame.get().Width
+
+    @property
+    def height(self) -> int:
+        return self._frame.get().Height
+
+    @property
+    def stride(self) -> int:
+        """Bytes per row."""
+        return self._frame.get().Stride
+
+    @property
+    def sequence(self) -> int:
+        """Paint counter of the browser, gaps mean frames were dropped."""
+        return self._frame.get().Sequence
+
+    @property
+    def timestamp(self) -> float:
+        """Paint time in seconds on a monotonic clock, for measuring frame intervals."""
+        return self._frame.get().TimestampUs / 1e6
+
+    @property
+    def damage(self) -> tuple:
+        """``(x, y, width, height)`` of the area that changed after frame ``damage_since``.
+
+        Covers the paints of dropped frames too. A consumer that kept a frame with
+        ``sequence >= damage_since`` only needs to update this area, otherwise it
+        needs the full frame, e.g. when another consumer captured in between.
+        """
+        cdef const OsrFrameBuffer* frame = self._frame.get()
+        return (frame.Damage.X, frame.Damage.Y, frame.Damage.Width, frame.Damage.Height)
+
+    @property
+    def damage_since(self) -> int:
+        """Sequence of the frame ``damage`` is relative to, 0 for the first frame."""
+        return self._frame.get().DamageSince
+
+    def to_bytes(self, pixel_format: str = "bgra", region=None) -> bytes:
+        """Returns a tightly packed copy of the pixels.
+
+        Args:
+            pixel_format: See ``convert_pixels()``, e.g. ``"rgba_straight"`` for
+                image writers or ``"rgb"`` for video encoders.
+            region: Optional ``(x, y, width, height)`` to copy, e.g. ``frame.damage``.
+        """
+        cdef const OsrFrameBuffer* frame = self._frame.get()
+        cdef PixelFormat dst_format = _pixel_format(pixel_format)
+        if dst_format == PIXEL_FORMAT_BGRA and region is None and frame.Stride == frame.Width * 4:
+            return (<const char*>frame.Pixels.data())[:frame.Pixels.size()]
+        return _convert_pixels(frame.Pixels.data(), frame.Stride, PIXEL_FORMAT_BGRA, frame.Width, frame.Height,
+                               region, dst_format)
+
+cdef class PytoniumSchemeRequest:
+    """A request to a Python route on a custom scheme.
+
+    Answer it either by returning the body from the route handler, or by calling
+    ``respond()``, then ``write()`` any number of times and finally ``finish()``.
+    The latter may happen later and from any thread, which allows streamed bodies.
+    """
+    cdef readonly int request_id
+    cdef readonly str method
+    cdef readonly str url
+    cdef readonly str path
+    cdef readonly dict headers
+    cdef readonly bytes body
+
+    def __init__(self, int request_id, str method, str url, str path, dict headers, bytes body):
+        self.request_id = request_id
+        self.method = method
+        self.url = url
+        self.path = path
+        self.headers = headers
+        self.body = body
+
+    def respond(self, status: int = 200, mime_type: str = "text/plain", headers: dict = None) -> bool:
+        """Send the status line and headers. Returns False if they were already sent."""
+        cdef map[string, string] cpp_headers
+        if headers:
+            for name, value in headers.items():
+                cpp_headers[str(name).encode("utf-8")] = str(value).encode("utf-8")
+        return PytoniumLibrary.RespondSchemeRequest(self.request_id, status, mime_type.encode("utf-8"), cpp_headers)
+
+    def write(self, data) -> bool:
+        """Append ``data`` (bytes or str) to the response body."""
+        if isinstance(data, str):
+            data = data.encode("utf-8")
+        return PytoniumLibrary.WriteSchemeRequest(self.request_id, bytes(data))
+
+    def finish(self) -> bool:
+        """Complete the response body."""
+        return PytoniumLibrary.FinishSchemeRequest(self.request_id)
+
+    def send(self, data, mime_type: str = None, status: int = 200, headers: dict = None) -> bool:
+        """Respond with a complete body in one call.
+
+        ``dict`` and ``list`` values are sent as JSON, ``str`` as text and
+        ``bytes`` as binary data, unless ``mime_type`` says otherwise.
+        """
+        if isinstance(data, (dict, list)):
+            data = json.dumps(data)
+            mime_type = mime_type or "application/json"
+        elif isinstance(data, str):
+            mime_type = mime_type or "text/plain"
+        else:
+            mime_type = mime_type or "application/octet-stream"
+        if not self.respond(status, mime_type, headers):
+            return False
+        self.write(data)
+        return self.finish()
+
+# Route handlers by token. The process-wide route registry only gets the token, so a
+# handler lives exactly as long as its route, independent of the Pytonium instance that
+# added it, and requests still queued for a removed route find no handler.
+_scheme_route_handlers = {}
+# (scheme, normalized prefix) -> token, to release the handler on remove or replace.
+_scheme_route_tokens = {}
+_next_scheme_route_token = 1
+
+def _normalize_route_prefix(prefix):
+    # As SchemeRouteRegistry::NormalizePath
+    prefix = prefix.lstrip("/")
+    for separator in "?#":
+        prefix = prefix.split(separator, 1)[0]
+    return prefix
+
+cdef inline boolie scheme_route_callback(void* user_data, int request_id, SchemeRouteRequest request) noexcept with gil:
+    headers = {}
+    for header in request.Headers:
+        headers[bytes.decode(header.first, "utf-8", "replace")] = bytes.decode(header.second, "utf-8", "replace")
+    py_request = PytoniumSchemeRequest(request_id, bytes.decode(request.Method, "utf-8"), bytes.decode(request.Url, "utf-8"),
+                                       bytes.decode(request.Path, "utf-8"), headers, request.Body)
+    handler = _scheme_route_handlers.get(<Py_ssize_t>user_data)
+    if handler is None:
+        py_request.send("Error: The route was removed.", "text/plain", 404)
+        return True
+    try:
+        result = handler(py_request)
+        if result is not None:
+            py_request.send(result)
+            return True
+        # Without a reference kept by the handler nobody can answer the request
+        # anymore. Returning False fails it, unless it was already finished.
+        return Py_REFCNT(py_request) > 1
+    except Exception as e:
+        import traceback
+        traceback.print_exc()
+        py_request.send(f"Error: {e}", "text/plain", 500)
+        return False
+
+cdef extern from "Python.h" nogil:
+    ctypedef struct PyThreadState
+    PyThreadState* PyEval_SaveThread()
+    void PyEval_RestoreThread(PyThreadState* state)
+    int PyGILState_Check()
+
+# In background-thread mode, calls waiting for CEF's UI thread release the GIL,
+# which the UI thread needs for Python callbacks.
+cdef void* _release_gil_for_ui_thread() noexcept nogil:
+    if PyGILState_Check():
+        return <void*>PyEval_SaveThread()
+    return NULL
+
+cdef void _reacquire_gil_for_ui_thread(void* token) noexcept nogil:
+    PyEval_RestoreThread(<PyThreadState*>token)
+
+SetUiThreadWaitHooks(_release_gil_for_ui_thread, _reacquire_gil_for_ui_thread)
+
 cdef str _global_pytonium_subprocess_path = ""
 
 def python_type_to_ts_type(python_type):
@@ -364,6 +786,9 @@ cdef class Pytonium:
     cdef list _pytonium_state_handler
     cdef PytoniumContextMenuWrapper _pytonium_context_menu
     cdef list _event_callback_wrappers
+    cdef set _pending_requests
+    cdef object _renderer_cpu_sample
+    cdef object _asyncio_loop
 
     def __init__(self):
         global _global_pytonium_subprocess_path
@@ -371,6 +796,8 @@ cdef class Pytonium:
         self._pytonium_state_handler = []
         self._pytonium_context_menu = PytoniumContextMenuWrapper()
         self._event_callback_wrappers = []
+        self._pending_requests = set()
+        self._asyncio_loop = None
         self.pytonium_library = PytoniumLibrary()
         self.pytonium_library.SetCustomSubprocessPath(_global_pytonium_subprocess_path.encode('utf-8'))
 
@@ -413,6 +840,73 @@ cdef class Pytonium:
         """
         self.pytonium_library.ExecuteJavascript(code.encode("utf-8"))
 
+    def evaluate_javascript(self, code: str) -> Future:
+        """Evaluate JavaScript code in the main frame and get its result.
+
+        The result is passed through ``JSON.stringify``: objects, arrays, strings,
+        numbers, booleans and null arrive as the matching Python values, ``undefined``
+        and functions as ``None``. Promises are not awaited.
+
+        Args:
+            code: The JavaScript code string to evaluate.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to the result. It fails with a
+            ``RuntimeError`` carrying the JavaScript error message if the code throws.
+        """
+        request = PytoniumPendingRequest(self._pending_requests, self._convert_evaluation_result)
+        request_id = self.pytonium_library.EvaluateJavascript(code.encode("utf-8"), state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def _convert_evaluation_result(self, value):
+        if value is not None and "error" in value:
+            raise RuntimeError(value["error"])
+        return None if value is None else value.get("value")
+
+    def set_asyncio_loop(self, loop) -> None:
+        """Set the asyncio event loop that runs coroutine functions bound to JavaScript.
+
+        A bound ``async def`` function called from JavaScript becomes a task on this loop;
+        with ``@returns_value_to_javascript`` its result resolves the JavaScript promise.
+        Without a loop set, the loop running in the calling thread is used. Set by the
+        helpers of ``Pytonium.aio``.
+
+        Args:
+            loop: An ``asyncio`` event loop, or ``None`` to unset it.
+        """
+        self._asyncio_loop = loop
+
+    def _dispatch_binding_coroutine(self, coroutine, message_id, returns_value):
+        import asyncio
+        loop = self._asyncio_loop
+        try:
+            running = asyncio.get_running_loop()
+        except RuntimeError:
+            running = None
+        if loop is None:
+            loop = running
+        if loop is None or loop.is_closed():
+            coroutine.close()
+            raise RuntimeError("A coroutine function was called from JavaScript without an asyncio loop, see set_asyncio_loop()")
+        if loop is running:
+            future = loop.create_task(coroutine)
+        else:
+            future = asyncio.run_coroutine_threadsafe(coroutine, loop)
+
+        def done(finished):
+            if finished.cancelled():
+                return
+            error = finished.exception()
+            if error is not None:
+                import traceback
+                traceback.print_exception(type(error), error, error.__traceback__)
+            elif returns_value:
+                self.return_value_to_javascript(message_id, finished.result())
+
+        future.add_done_callback(done)
+
     def bind_function_to_javascript(self, function_to_bind, name: str = "", javascript_object: str = "") -> None:
         """Bind a Python function so it can be called from JavaScript.
 
@@ -581,6 +1075,8 @@ cdef class Pytonium:
         """Register a state handler that receives state change notifications.
 
         The ``state_handler`` object must have an ``update_state(namespace, key, value)`` method.
+        If it also has an ``update_states(changes)`` method, batched updates (``setStates`` from
+        JavaScript) are delivered once as ``{namespace: {key: value}}`` instead of key by key.
 
         Args:
             state_handler: An object with an ``update_state`` method.
@@ -596,10 +1092,14 @@ cdef class Pytonium:
             return
         if has_update:
             state_handler_meth = getattr(state_handler, 'update_state')
-            py_meth_wrapper = PytoniumStateHandlerWrapper(state_handler_meth)
+            state_handler_batch_meth = getattr(state_handler, 'update_states', None)
+            py_meth_wrapper = PytoniumStateHandlerWrapper(state_handler_meth, state_handler_batch_meth)
             namespaces_converted = convert_list_of_strings_to_vector(namespaces)
             self._pytonium_state_handler.append(py_meth_wrapper)
-            self.pytonium_library.AddStateHandlerPythonBinding(state_handler_callback, <void *>self._pytonium_state_handler[len(self._pytonium_state_handler)-1], namespaces_converted)
+            if state_handler_batch_meth is not None:
+                self.pytonium_library.AddStateHandlerPythonBinding(state_handler_callback, <void *>self._pytonium_state_handler[len(self._pytonium_state_handler)-1], namespaces_converted, state_batch_handler_callback)
+            else:
+                self.pytonium_library.AddStateHandlerPythonBinding(state_handler_callback, <void *>self._pytonium_state_handler[len(self._pytonium_state_handler)-1], namespaces_converted, NULL)
 
     def set_context_menu_namespace(self, context_menu_namespace: str) -> None:
         """Set the active context menu namespace.
@@ -657,6 +1157,17 @@ cdef class Pytonium:
         """
         return self.pytonium_library.IsBrowserRunning()
 
+    def is_ready_to_execute_javascript(self) -> bool:
+        """Check if the page of this instance's browser has loaded and can run JavaScript.
+
+        ``execute_javascript()`` drops code while this is False.
+
+        Returns:
+            True once the main frame finished loading; False while it loads or
+            without a browser.
+        """
+        return self.pytonium_library.IsReadyToExecuteJavascript()
+
     @classmethod
     def is_cef_initialized(cls) -> bool:
         """Check if the CEF framework has been initialized.
@@ -666,20 +1177,267 @@ cdef class Pytonium:
         """
         return PytoniumLibrary.IsCefInitialized()
 
-    def update_message_loop(self) -> None:
-        """Process pending CEF messages. Call this in your main loop."""
-        self.pytonium_library.UpdateMessageLoop()
+    @classmethod
+    def update_message_loop(cls) -> None:
+        """Process pending CEF messages. Call this in your main loop.
+
+        The message loop is shared by all instances. Does nothing in
+        background-thread mode, see ``set_background_thread()``.
+        """
+        PytoniumLibrary.UpdateMessageLoop()
+
+    @classmethod
+    def set_background_thread(cls, enabled: bool = True) -> None:
+        """Run CEF on its own UI thread instead of the thread calling ``update_message_loop()``.
+
+        Must be called before the first ``initialize()``. CEF then pumps its messages
+        itself (``multi_threaded_message_loop``) and no thread has to call
+        ``update_message_loop()``. As in the default mode, the methods of every instance
+        may be called from any thread: calls are marshaled onto CEF's UI thread in order,
+        calls with results wait for it with the GIL released. Callbacks run on the UI
+        thread. Useful next to other event loops (Qt, asyncio servers, game loops).
+
+        Raises:
+            RuntimeError: If CEF is already initialized.
+        """
+        if PytoniumLibrary.IsCefInitialized():
+            raise RuntimeError("set_background_thread() must be called before CEF is initialized")
+        PytoniumLibrary.SetBackgroundThread(enabled)
+
+    @classmethod
+    def is_background_thread(cls) -> bool:
+        """Check if CEF runs (or will run) on its own UI thread, see ``set_background_thread()``."""
+        return PytoniumLibrary.IsBackgroundThread()
+
+    def run(self) -> None:
+        """Process CEF messages until this instance's browser is closed.
+
+        Unlike calling ``update_message_loop()`` at a fixed rate, this sleeps until
+        CEF has work due, with the GIL released, so an idle window costs no CPU and
+        events are handled without a polling delay. In background-thread mode it
+        only waits for the browser to close.
+        """
+        cdef boolie due
+        while self.pytonium_library.IsBrowserRunning():
+            # Bounded, so Ctrl+C is handled.
+            with nogil:
+                due = PytoniumLibrary.WaitForMessageLoopWork(100)
+            PyErr_CheckSignals()
+            if due:
+                PytoniumLibrary.UpdateMessageLoop()
+
+    @classmethod
+    def wait_for_message_loop_work(cls, timeout: float = None) -> bool:
+        """Sleep until ``update_message_loop()`` is due, with the GIL released.
+
+        For custom main loops: replaces a fixed ``time.sleep()`` between calls of
+        ``update_message_loop()``. Shared by all instances.
+
+        Args:
+            timeout: Maximum number of seconds to wait; ``None`` waits until work is due.
+
+        Returns:
+            True if work is due, False if the timeout passed first.
+        """
+        cdef int64_t timeout_ms = -1 if timeout is None else max(0, int(timeout * 1000))
+        cdef boolie due
+        with nogil:
+            due = PytoniumLibrary.WaitForMessageLoopWork(timeout_ms)
+        return due
+
+    @classmethod
+    def get_message_loop_delay(cls) -> float:
+        """Get the seconds until ``update_message_loop()`` is due; 0 if it is due now.
+
+        Also resets the wakeup file descriptor.
+        """
+        return PytoniumLibrary.GetMessageLoopDelay() / 1000.0
+
+    @classmethod
+    def get_message_loop_wakeup_fd(cls) -> int:
+        """Get a file descriptor that becomes readable when CEF scheduled work.
+
+        For event loops that wait on file descriptors: when it is readable, call
+        ``get_message_loop_delay()`` and ``update_message_loop()`` once the delay
+        passed. ``-1`` on Windows, where ``wait_for_message_loop_work()`` has to be used.
+        """
+        return PytoniumLibrary.GetMessageLoopWakeupFd()
+
+    @classmethod
+    def set_message_loop_max_delay(cls, seconds: float) -> None:
+        """Set the longest time the message loop waits without CEF scheduling work.
+
+        CEF does not schedule all of its work, so the loop wakes at least this often
+        (default 1/30 s). On Linux this also bounds the input latency of native windows,
+        whose events cannot wake the loop, so the default there is 1/60 s unless
+        Pytonium runs headless.
+        """
+        if seconds <= 0:
+            raise ValueError("seconds must be positive")
+        PytoniumLibrary.SetMessageLoopMaxDelay(max(1, int(seconds * 1000)))
+
+    @classmethod
+    def get_message_loop_max_delay(cls) -> float:
+        """Get the longest time the message loop waits without CEF scheduling work, in seconds."""
+        return PytoniumLibrary.GetMessageLoopMaxDelay() / 1000
+
+    @classmethod
+    def get_message_loop_stats(cls) -> dict:
+        """Get statistics of the message loop scheduling.
+
+        Returns:
+            A dict with the keys ``scheduled`` (work scheduled by CEF), ``work``
+            (``update_message_loop()`` calls), ``wakeups`` and ``timeouts`` (waits
+            that ended because work was due, or because of their timeout).
+        """
+        cdef MessagePumpStats stats = PytoniumLibrary.GetMessageLoopStats()
+        return {
+            "scheduled": stats.Scheduled,
+            "work": stats.Work,
+            "wakeups": stats.Wakeups,
+            "timeouts": stats.Timeouts,
+        }
+
+    @classmethod
+    def get_ui_thread_queue_stats(cls) -> dict:
+        """Get statistics of the calls marshaled onto CEF's UI thread.
+
+        Once CEF is initialized, calls made from other threads are queued for the UI
+        thread, which runs them in order, in batches between its own work.
+
+        Returns:
+            A dict with the keys ``posted`` (calls queued), ``executed`` (calls run)
+            and ``batches`` (times the UI thread drained the queue).
+        """
+        cdef UiThreadQueueStats stats = GetUiThreadQueueStats()
+        return {
+            "posted": stats.Posted,
+            "executed": stats.Executed,
+            "batches": stats.Batches,
+        }
+
+    @classmethod
+    def start_browser_pool(cls, url: str, size: int = 2, windowless: bool = False) -> None:
+        """Keep ``size`` hidden browsers loaded with ``url``, so new windows open instantly.
+
+        ``initialize()`` and ``create_browser()`` of any instance then take a pooled
+        browser for URLs on the site (scheme and host) of ``url`` and navigate it,
+        and a replacement is created in the background. ``url`` should be a light
+        page of the app; other sites, browsers of the other kind, and instances with
+        JavaScript bindings (see ``start_bindings_browser_pool()``) are created as
+        before. ``windowless`` pools serve headless browsers, and OSR browsers
+        except on Windows, whose layered OSR windows parent their browser; pools of
+        native windows need Windows.
+
+        Call after CEF is initialized; a running pool of the same kind without
+        bindings is replaced.
+        """
+        if size < 1:
+            raise ValueError("size must be at least 1")
+        if not PytoniumLibrary.StartBrowserPool(size, url.encode("utf-8"), windowless):
+            if not PytoniumLibrary.IsCefInitialized():
+                raise RuntimeError("CEF must be initialized before starting a browser pool")
+            raise RuntimeError("Pools of native windows need Windows; use windowless=True")
+
+    def start_bindings_browser_pool(self, url: str, size: int = 1, windowless: bool = False) -> None:
+        """Keep ``size`` hidden browsers with this instance's JavaScript bindings loaded with ``url``.
+
+        As ``start_browser_pool()``, but the pooled browsers carry the functions and
+        objects bound to this instance so far, which the renderer reads once per
+        renderer process; they serve ``initialize()`` and ``create_browser()`` of
+        this instance, or of another with the same bound callables. Bind
+        everything first, then start the pool and open the window later, e.g. a
+        window that is shown on demand. Several pools can run at once, one per
+        kind and set of bindings; a running pool for the same ones is replaced.
+        """
+        if size < 1:
+            raise ValueError("size must be at least 1")
+        if not self.pytonium_library.StartBindingsBrowserPool(size, url.encode("utf-8"), windowless):
+            if not PytoniumLibrary.IsCefInitialized():
+                raise RuntimeError("CEF must be initialized before starting a browser pool")
+            raise RuntimeError("Pools of native windows need Windows; use windowless=True")
+
+    def stop_bindings_browser_pool(self) -> None:
+        """Close the pooled browsers with this instance's bindings, e.g. once its window is open."""
+        self.pytonium_library.StopBindingsBrowserPool()
+
+    @classmethod
+    def stop_browser_pool(cls) -> None:
+        """Close the pooled browsers of all pools that were not taken. Also done on shutdown."""
+        PytoniumLibrary.StopBrowserPool()
+
+    @classmethod
+    def get_browser_pool_stats(cls) -> dict:
+        """Get statistics of the browser pools, summed over all running pools.
 
-    def add_custom_scheme(self, scheme_identifier: str, scheme_content_root_folder: str) -> None:
+        Returns:
+            A dict with the keys ``warm`` (loaded, ready to be taken), ``starting``,
+            ``created``, ``taken`` (browsers opened with a pooled browser) and
+            ``missed`` (browsers of a pool's kind and bindings opened without one).
+        """
+        cdef BrowserPoolStats stats = PytoniumLibrary.GetBrowserPoolStats()
+        return {
+            "warm": stats.Warm,
+            "starting": stats.Starting,
+            "created": stats.Created,
+            "taken": stats.Taken,
+            "missed": stats.Missed,
+        }
+
+    def add_custom_scheme(self, scheme_identifier: str, scheme_content_root_folder: str,
+                          cache_control: str = "no-cache", *, secure: bool = False, cors_enabled: bool = True,
+                          fetch_enabled: bool = False, csp_bypassing: bool = False, local: bool = False,
+                          display_isolated: bool = False, cross_origin_isolated: bool = False,
+                          headers: dict = None) -> None:
         """Register a custom URL scheme for serving local content.
 
-        Must be called before ``initialize()``.
+        Must be called before ``initialize()``. The scheme is always registered as
+        a standard scheme; the other flags map to CEF's ``cef_scheme_options_t``.
 
         Args:
             scheme_identifier: The scheme name (e.g. ``"app"`` for ``app://``).
             scheme_content_root_folder: Absolute path to the folder serving as content root.
+            cache_control: ``Cache-Control`` header sent with the scheme's files.
+                The default ``"no-cache"`` revalidates cached files with their
+                ``ETag``; use e.g. ``"max-age=31536000, immutable"`` for
+                fingerprinted assets, or ``""`` to send no header.
+            secure: Treat pages of the scheme as a secure context, like ``https``.
+            cors_enabled: Allow CORS requests to the scheme.
+            fetch_enabled: Allow ``fetch()`` requests to the scheme.
+            csp_bypassing: Let the scheme bypass Content-Security-Policy checks.
+            local: Treat the scheme like ``file://``.
+            display_isolated: Only pages of the same scheme may display its pages.
+            cross_origin_isolated: Send ``Cross-Origin-Opener-Policy: same-origin``
+                and ``Cross-Origin-Embedder-Policy: require-corp``, which makes the
+                pages cross-origin isolated so they can use ``SharedArrayBuffer``
+                and threaded WebAssembly. Implies ``secure`` and ``fetch_enabled``.
+            headers: Extra headers sent with every response of the scheme. They
+                override the headers set by ``cross_origin_isolated``.
         """
-        self.pytonium_library.AddCustomScheme(scheme_identifier.encode("utf-8"), scheme_content_root_folder.encode("utf-8"))
+        cdef int options = CEF_SCHEME_OPTION_STANDARD
+        cdef map[string, string] cpp_headers
+        if cross_origin_isolated:
+            secure = True
+            fetch_enabled = True
+            cpp_headers[b"Cross-Origin-Opener-Policy"] = b"same-origin"
+            cpp_headers[b"Cross-Origin-Embedder-Policy"] = b"require-corp"
+        if secure:
+            options |= CEF_SCHEME_OPTION_SECURE
+        if cors_enabled:
+            options |= CEF_SCHEME_OPTION_CORS_ENABLED
+        if fetch_enabled:
+            options |= CEF_SCHEME_OPTION_FETCH_ENABLED
+        if csp_bypassing:
+            options |= CEF_SCHEME_OPTION_CSP_BYPASSING
+        if local:
+            options |= CEF_SCHEME_OPTION_LOCAL
+        if display_isolated:
+            options |= CEF_SCHEME_OPTION_DISPLAY_ISOLATED
+        if headers:
+            for name, value in headers.items():
+                cpp_headers[str(name).encode("utf-8")] = str(value).encode("utf-8")
+        self.pytonium_library.AddCustomScheme(scheme_identifier.encode("utf-8"), scheme_content_root_folder.encode("utf-8"),
+                                              cache_control.encode("utf-8"), options, cpp_headers)
 
     def add_mime_type_mapping(self, file_extension: str, mime_type: str) -> None:
         """Add a custom file extension to MIME type mapping for custom schemes.
@@ -690,6 +1448,125 @@ cdef class Pytonium:
         """
         self.pytonium_library.AddMimeTypeMapping(file_extension.encode("utf-8"), mime_type.encode("utf-8"))
 
+    def add_scheme_route(self, scheme_identifier: str, prefix: str, handler) -> None:
+        """Answer requests to a custom scheme path prefix from Python.
+
+        ``handler`` is called on the main thread, while the message loop runs,
+        with a ``PytoniumSchemeRequest`` for every request whose path starts with
+        ``prefix``. The longest matching prefix wins. If the handler returns a
+        value it is sent as the response (see ``PytoniumSchemeRequest.send``).
+        If it returns None, it answers through the request object, possibly later
+        and from another thread, as long as it keeps a reference to the request.
+        Requests the handler dropped without finishing, or that raised, are
+        answered with 500. Requests never block CEF's IO thread.
+
+        Example::
+
+            def api(request):
+                return {"path": request.path, "method": request.method}
+
+            pytonium.add_custom_scheme("app", root_folder)
+            pytonium.add_scheme_route("app", "api/", api)
+
+        Args:
+            scheme_identifier: A scheme registered with ``add_custom_scheme()``.
+            prefix: Path prefix after ``scheme://``, e.g. ``"api/"``.
+            handler: Callable taking a ``PytoniumSchemeRequest``.
+        """
+        if not callable(handler):
+            raise TypeError(f"handler must be callable, got {type(handler).__name__}")
+        global _next_scheme_route_token
+        cdef Py_ssize_t token = _next_scheme_route_token
+        _next_scheme_route_token += 1
+        key = (scheme_identifier, _normalize_route_prefix(prefix))
+        _scheme_route_handlers[token] = handler
+        self.pytonium_library.AddSchemeRoute(scheme_identifier.encode("utf-8"), prefix.encode("utf-8"),
+                                             scheme_route_callback, <void*>token)
+        replaced = _scheme_route_tokens.get(key)
+        _scheme_route_tokens[key] = token
+        if replaced is not None:
+            del _scheme_route_handlers[replaced]
+
+    def remove_scheme_route(self, scheme_identifier: str, prefix: str) -> None:
+        """Stop answering requests to ``prefix`` from Python."""
+        self.pytonium_library.RemoveSchemeRoute(scheme_identifier.encode("utf-8"), prefix.encode("utf-8"))
+        token = _scheme_route_tokens.pop((scheme_identifier, _normalize_route_prefix(prefix)), None)
+        if token is not None:
+            del _scheme_route_handlers[token]
+
+    def add_virtual_file(self, scheme_identifier: str, path: str, data, mime_type: str) -> None:
+        """Serve in-memory ``data`` (bytes or str) at ``scheme://path``.
+
+        Virtual files take precedence over files in the scheme's content root
+        and can be replaced at any time.
+        """
+        if isinstance(data, str):
+            data = data.encode("utf-8")
+        self.pytonium_library.AddVirtualFile(scheme_identifier.encode("utf-8"), path.encode("utf-8"), bytes(data),
+                                             mime_type.encode("utf-8"))
+
+    def remove_virtual_file(self, scheme_identifier: str, path: str) -> None:
+        """Remove a file added with ``add_virtual_file()``."""
+        self.pytonium_library.RemoveVirtualFile(scheme_identifier.encode("utf-8"), path.encode("utf-8"))
+
+    @classmethod
+    def set_asset_cache_budget(cls, budget_bytes: int) -> None:
+        """Set the byte budget of the process-wide custom scheme asset cache.
+
+        Files served through custom schemes are cached by path and modification
+        time, least recently used files are evicted first. Files larger than a
+        quarter of the budget are streamed from disk instead. A budget of ``0``
+        disables the cache.
+
+        Args:
+            budget_bytes: Maximum number of bytes to keep cached (default 64 MB).
+        """
+        if budget_bytes < 0:
+            raise ValueError("budget_bytes must not be negative")
+        PytoniumLibrary.SetAssetCacheBudget(budget_bytes)
+
+    @classmethod
+    def clear_asset_cache(cls) -> None:
+        """Drop all entries from the custom scheme asset cache."""
+        PytoniumLibrary.ClearAssetCache()
+
+    @classmethod
+    def get_asset_cache_stats(cls) -> dict:
+        """Get statistics of the custom scheme asset cache.
+
+        Returns:
+            A dict with the keys ``hits``, ``misses``, ``evictions``,
+            ``entries``, ``bytes`` and ``budget``.
+        """
+        cdef AssetCacheStats stats = PytoniumLibrary.GetAssetCacheStats()
+        return {
+            "hits": stats.Hits,
+            "misses": stats.Misses,
+            "evictions": stats.Evictions,
+            "entries": stats.Entries,
+            "bytes": stats.Bytes,
+            "budget": stats.Budget,
+        }
+
+    @classmethod
+    def set_scheme_route_timeout(cls, seconds: float) -> None:
+        """Set how long a scheme route handler may take to send its headers.
+
+        Requests still waiting for headers after the timeout are answered with
+        504 and forgotten. Once headers were sent, the body may take any time.
+
+        Args:
+            seconds: The timeout (default 30). ``0`` disables it.
+        """
+        if seconds < 0:
+            raise ValueError("seconds must not be negative")
+        PytoniumLibrary.SetSchemeRouteTimeout(int(seconds * 1000))
+
+    @classmethod
+    def get_scheme_route_timeout(cls) -> float:
+        """Get the scheme route handler timeout in seconds."""
+        return PytoniumLibrary.GetSchemeRouteTimeout() / 1000
+
     def set_cache_path(self, path: str) -> None:
         """Set the path for the browser cache. Must be called before ``initialize()``.
 
@@ -723,6 +1600,353 @@ cdef class Pytonium:
         """Enable/disable off-screen rendering mode for transparent windows (must be called before initialize)."""
         self.pytonium_library.SetOsrMode(osr)
 
+    def set_headless(self, headless: bool):
+        """Render without window, display server or GPU (must be called before initialize).
+
+        Implies off-screen rendering mode. Frames are only delivered to ``on_frame()``
+        callbacks; ``set_window_size()`` resizes the rendered view.
+        """
+        self.pytonium_library.SetHeadless(headless)
+
+    def is_headless(self) -> bool:
+        """Returns True if headless rendering is enabled."""
+        return self.pytonium_library.IsHeadless()
+
+    def on_frame(self, callback, pixel_format: str = "bgra", damage_only: bool = False) -> None:
+        """Register a callback for frames painted by a headless browser.
+
+        Args:
+            callback: A callable that receives ``(pixels, width, height, dirty_rects)``:
+                the pixels as tightly packed ``bytes``, the frame size, and a list of
+                ``(x, y, width, height)`` rectangles that changed since the previous
+                frame. Called on the thread running the message loop.
+            pixel_format: Format of ``pixels``, see ``convert_pixels()``. The default
+                is Chromium's premultiplied BGRA.
+            damage_only: Copy only the bounding box of the dirty rects instead of the
+                whole frame, for consumers that keep the previous frame. The callback
+                then receives ``(pixels, width, height, dirty_rects, damage)``, with
+                ``pixels`` holding the tightly packed ``damage`` rectangle
+                ``(x, y, width, height)``.
+        """
+        cdef PytoniumFrameCallbackWrapper wrapper
+        if not callable(callback):
+            raise TypeError(f"callback must be callable, got {type(callback).__name__}")
+        wrapper = PytoniumFrameCallbackWrapper(callback)
+        wrapper.pixel_format = _pixel_format(pixel_format)
+        wrapper.damage_only = damage_only
+        self._event_callback_wrappers.append(wrapper)
+        self.pytonium_library.SetFrameCallback(_on_frame_callback, <void*>wrapper)
+
+    def enable_frame_capture(self, enable: bool = True) -> None:
+        """Publish every frame of the off-screen rendered browser for ``capture_frame()``.
+
+        Works with ``set_headless()`` and ``set_osr_mode()``. Call it before
+        capturing from other threads.
+        """
+        self.pytonium_library.EnableFrameCapture(enable)
+
+    def capture_frame(self, only_new: bool = True):
+        """Returns the latest frame as ``PytoniumFrame``, without copying pixels.
+
+        Never waits for the paint path and may be called from any thread.
+
+        Args:
+            only_new: Return None if no frame was painted since the last capture.
+                With False, the last captured frame is returned again.
+
+        Returns:
+            A ``PytoniumFrame``, or None if there is no (new) frame.
+        """
+        cdef shared_ptr[const OsrFrameBuffer] frame = self.pytonium_library.CaptureFrame(only_new)
+        if not frame:
+            return None
+        cdef PytoniumFrame result = PytoniumFrame.__new__(PytoniumFrame)
+        result._frame = frame
+        return result
+
+    def get_frame_capture_stats(self) -> dict:
+        """Get frame capture counters.
+
+        Returns:
+            A dict with the keys ``published`` (frames painted into the capture
+            buffers), ``captured`` and ``dropped`` (frames replaced by a newer
+            one before they were captured).
+        """
+        cdef OsrFrameCaptureStats stats = self.pytonium_library.GetFrameCaptureStats()
+        return {
+            "published": stats.Published,
+            "captured": stats.Captured,
+            "dropped": stats.Dropped,
+        }
+
+    def start_recording(self, target: str, format: str = "y4m", pipe: bool = False, frame_rate: int = 30,
+                        queue_size: int = 8, pixel_format: str = "rgba") -> bool:
+        """Record the off-screen rendered browser on a background thread.
+
+        Painting only copies each frame into a queue; converting and writing happen on
+        the encoder thread. While the encoder falls behind, new frames are dropped
+        instead of slowing down the browser. A running recording is stopped first.
+
+        Args:
+            target: Output file, the directory for ``"png"``, or with ``pipe`` a shell
+                command that reads the stream from stdin, e.g.
+                ``"ffmpeg -y -i - -c:v libx264 out.mp4"``.
+            format: ``"y4m"`` (YUV 4:2:0 video), ``"png"`` (one uncompressed PNG per
+                frame) or ``"raw"`` (headerless frames in ``pixel_format``).
+            pipe: Write the y4m or raw stream to the stdin of ``target``.
+            frame_rate: Frame rate of y4m and raw streams. Frames are repeated while
+                the page does not paint and skipped when it paints faster, so the
+                stream plays back in real time.
+            queue_size: Frames that may wait for the encoder thread.
+            pixel_format: Pixel format of raw streams, see ``convert_pixels()``.
+
+        Returns:
+            False if the output could not be opened.
+        """
+        formats = {"y4m": FRAME_ENCODER_Y4M, "png": FRAME_ENCODER_PNG, "raw": FRAME_ENCODER_RAW}
+        if format not in formats:
+            raise ValueError(f"Unknown recording format {format!r}, expected one of {', '.join(formats)}")
+        if frame_rate < 1 or queue_size < 1:
+            raise ValueError("frame_rate and queue_size must be at least 1")
+        if pipe and format == "png":
+            raise ValueError("PNG recordings are written to a directory and cannot be piped")
+        cdef FrameEncoderSettings settings
+        settings.Format = formats[format]
+        settings.Target = target.encode("utf-8")
+        settings.Pipe = pipe
+        settings.FrameRate = frame_rate
+        settings.QueueSize = queue_size
+        settings.RawFormat = _pixel_format(pixel_format)
+        return self.pytonium_library.StartRecording(settings)
+
+    def stop_recording(self) -> None:
+        """Finish the recording.
+
+        Waits until the queued frames are written and, with ``pipe``, until the
+        process exits. Safe to call when nothing is recorded.
+        """
+        self.pytonium_library.StopRecording()
+
+    def get_recording_stats(self) -> dict:
+        """Get the counters of the running or last recording.
+
+        Returns:
+            A dict with ``frames_submitted`` (frames painted while recording),
+            ``frames_encoded``, ``frames_dropped`` (queue full),
+            ``frames_duplicated`` and ``frames_skipped`` (to keep the frame rate),
+            ``errors``, ``bytes_written``, ``queue_depth``, ``max_queue_depth`` and
+            the ``avg_encode_latency`` and ``max_encode_latency`` from paint until
+            written, in seconds.
+        """
+        cdef FrameEncoderStats stats = self.pytonium_library.GetRecordingStats()
+        return {
+            "frames_submitted": stats.Submitted,
+            "frames_encoded": stats.Encoded,
+            "frames_dropped": stats.Dropped,
+            "frames_duplicated": stats.Duplicated,
+            "frames_skipped": stats.Skipped,
+            "errors": stats.Errors,
+            "bytes_written": stats.BytesWritten,
+            "queue_depth": stats.QueueDepth,
+            "max_queue_depth": stats.MaxQueueDepth,
+            "avg_encode_latency": stats.TotalLatencyUs / 1e6 / stats.Encoded if stats.Encoded else 0.0,
+            "max_encode_latency": stats.MaxLatencyUs / 1e6,
+        }
+
+    def set_frame_rate(self, frame_rate: int) -> None:
+        """Render the off-screen browser at a fixed rate.
+
+        Can be called before or after ``initialize()``; turns the adaptive frame rate
+        off. Windowed browsers render at the display rate and ignore it.
+
+        Args:
+            frame_rate: Frames per second, clamped to 1-60. The default is 60.
+        """
+        self.pytonium_library.SetFrameRate(frame_rate)
+
+    def set_adaptive_frame_rate(self, min_frame_rate: int = 5, max_frame_rate: int = 60) -> None:
+        """Let Pytonium pick the frame rate of the off-screen browser.
+
+        The rate is lowered step by step while the page paints rarely, e.g. a clock that
+        ticks once a second, and raised to ``max_frame_rate`` on input and while the
+        page animates.
+
+        Args:
+            min_frame_rate: Lowest rate in frames per second, at least 1.
+            max_frame_rate: Highest rate in frames per second, at most 60.
+        """
+        self.pytonium_library.SetAdaptiveFrameRate(min_frame_rate, max_frame_rate)
+
+    def get_frame_rate_stats(self) -> dict:
+        """Get the frame rate of the off-screen browser and the cost of its paints.
+
+        Returns:
+            A dict with the current ``frame_rate``, ``adaptive``, the number of
+            ``paints``, the seconds the browser process spent handling them
+            (``paint_time``) and the number of ``rate_changes``.
+        """
+        cdef OsrFrameRateStats stats = self.pytonium_library.GetFrameRateStats()
+        return {
+            "frame_rate": stats.FrameRate,
+            "adaptive": stats.Adaptive,
+            "paints": stats.Paints,
+            "paint_time": stats.PaintTimeUs / 1e6,
+            "rate_changes": stats.RateChanges,
+        }
+
+    def get_renderer_cpu_usage(self) -> Future:
+        """Measure the CPU use of the renderer process of this browser.
+
+        Browsers of different sites run in separate renderer processes; browsers
+        showing the same site may share one, and then report the same process.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to a dict with the ``pid``, the
+            process ``cpu_time`` in seconds, a monotonic ``timestamp`` in seconds and
+            ``cpu_percent``, the share of one core used since the previous call of
+            this method (``None`` on the first call or if the renderer changed).
+        """
+        request = PytoniumPendingRequest(self._pending_requests, self._convert_renderer_cpu_usage)
+        request_id = self.pytonium_library.GetRendererCpuUsage(state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def _convert_renderer_cpu_usage(self, value):
+        usage = {
+            "pid": int(value.get("pid", 0)),
+            "cpu_time": float(value.get("cpu_time", 0.0)),
+            "timestamp": float(value.get("timestamp", 0.0)),
+            "cpu_percent": None,
+        }
+        previous = self._renderer_cpu_sample
+        if previous is not None and previous["pid"] == usage["pid"] and usage["timestamp"] > previous["timestamp"]:
+            usage["cpu_percent"] = 100.0 * (usage["cpu_time"] - previous["cpu_time"]) / (usage["timestamp"] - previous["timestamp"])
+        self._renderer_cpu_sample = usage
+        return usage
+
+    def start_pdf_pool(self, size: int = 2) -> None:
+        """Start a pool of hidden browsers for ``render_pdf()``.
+
+        The browsers are created once and reused for every job, so a report does not
+        pay for starting a browser. Jobs are spread across the pool and printed in
+        parallel; each browser has its own renderer process, so throughput grows with
+        the pool size up to the number of cores. Requires ``initialize()``, which may
+        create a headless browser (``set_headless()``) if no window is wanted. A
+        running pool is stopped first.
+
+        Args:
+            size: Number of browsers.
+        """
+        if size < 1:
+            raise ValueError("size must be at least 1")
+        if not self.pytonium_library.StartPdfPool(size):
+            raise RuntimeError("Pytonium must be initialized before starting the PDF pool.")
+
+    def stop_pdf_pool(self) -> None:
+        """Close the browsers of the PDF pool. Jobs not finished yet fail."""
+        self.pytonium_library.StopPdfPool()
+
+    def render_pdf(self, url: str = None, html: str = None, data=None, output_path: str = None,
+                   landscape: bool = False, print_background: bool = True, scale: float = 1.0,
+                   paper_size=None, margins=None, page_ranges: str = "", prefer_css_page_size: bool = False,
+                   timeout: float = 30.0) -> Future:
+        """Render a page to PDF with the pool of ``start_pdf_pool()``.
+
+        Completes while ``update_message_loop()`` runs.
+
+        Args:
+            url: Page to print.
+            html: HTML to print instead of ``url``. Relative links cannot be resolved;
+                reference assets by absolute or custom scheme URLs.
+            data: JSON-serializable data for the page. Once the page loaded it is set as
+                ``window.pytoniumPdfData`` and a ``PytoniumPdfData`` event is dispatched;
+                the page is printed right after its listeners returned.
+            output_path: PDF file to write. Without it the future resolves to the PDF
+                as ``bytes``.
+            landscape: Landscape orientation.
+            print_background: Print background colors and images.
+            scale: Scale of the page, e.g. 0.5.
+            paper_size: ``(width, height)`` in inches; US Letter by default.
+            margins: Margin in inches, or ``(top, right, bottom, left)``.
+            page_ranges: Pages to print, e.g. ``"1-3, 5"``; all by default.
+            prefer_css_page_size: Use the page size of CSS ``@page`` rules.
+            timeout: Seconds after which the job fails.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to ``output_path`` or the PDF bytes.
+        """
+        if (url is None) == (html is None):
+            raise ValueError("Pass either url or html")
+        cdef PdfRenderJob job
+        job.Url = (url or "").encode("utf-8")
+        job.Html = (html or "").encode("utf-8")
+        job.DataJson = json.dumps(data).encode("utf-8") if data is not None else b""
+        job.OutputPath = (output_path or "").encode("utf-8")
+        job.Landscape = landscape
+        job.PrintBackground = print_background
+        job.Scale = scale
+        if paper_size is not None:
+            paper_width, paper_height = paper_size
+            job.PaperWidth = paper_width
+            job.PaperHeight = paper_height
+        if margins is not None:
+            if isinstance(margins, (int, float)):
+                margins = (margins, margins, margins, margins)
+            top, right, bottom, left = margins
+            job.MarginTop = top
+            job.MarginRight = right
+            job.MarginBottom = bottom
+            job.MarginLeft = left
+        job.PageRanges = page_ranges.encode("utf-8")
+        job.PreferCssPageSize = prefer_css_page_size
+        job.TimeoutMs = int(timeout * 1000)
+
+        request = PytoniumPendingRequest(self._pending_requests, None if output_path else _read_temporary_pdf)
+        if self.pytonium_library.RenderPdf(job, pdf_render_callback, <void *>request) < 0:
+            request.fail("The PDF pool is not running.")
+        return request.future
+
+    def get_pdf_pool_stats(self) -> dict:
+        """Get the state and counters of the PDF pool.
+
+        Returns:
+            A dict with the started ``browsers``, the ``busy`` ones, ``queued`` jobs,
+            ``completed`` and ``failed`` jobs and the ``avg_render_time`` and
+            ``max_render_time`` of completed jobs in seconds.
+        """
+        cdef PdfRenderPoolStats stats = self.pytonium_library.GetPdfPoolStats()
+        return {
+            "browsers": stats.Browsers,
+            "busy": stats.Busy,
+            "queued": stats.Queued,
+            "completed": stats.Completed,
+            "failed": stats.Failed,
+            "avg_render_time": stats.TotalRenderUs / 1e6 / stats.Completed if stats.Completed else 0.0,
+            "max_render_time": stats.MaxRenderUs / 1e6,
+        }
+
+    def get_osr_paint_stats(self) -> dict:
+        """Get paint statistics of the off-screen rendered browser.
+
+        Returns:
+            A dict with the keys ``frames``, ``full_frames`` (paints that copied
+            the whole frame, e.g. after a resize), ``bytes_copied`` and
+            ``dirty_pixels`` summed over all paints, ``bytes_per_frame``, and
+            the current ``width`` and ``height``. Headless browsers copy nothing
+            themselves, so ``bytes_copied`` stays 0 for them.
+        """
+        cdef OsrPaintStats stats = self.pytonium_library.GetOsrPaintStats()
+        return {
+            "frames": stats.Frames,
+            "full_frames": stats.FullFrames,
+            "bytes_copied": stats.BytesCopied,
+            "dirty_pixels": stats.DirtyPixels,
+            "bytes_per_frame": stats.BytesCopied // stats.Frames if stats.Frames else 0,
+            "width": stats.Width,
+            "height": stats.Height,
+        }
+
     def minimize_window(self):
         """Minimize the window."""
         self.pytonium_library.MinimizeWindow()
@@ -837,6 +2061,167 @@ cdef class Pytonium:
         converter = PytoniumValueWrapper()
         self.pytonium_library.SetState(namespace.encode("utf-8"), key.encode("utf-8"), converter.PythonType_to_CefValueWrapper(value))
 
+    def set_states(self, namespace: str, values: dict) -> None:
+        """Set several keys of a namespace as one atomic update.
+
+        The values are sent to the browser in a single message and applied at once, so
+        JavaScript subscribers receive one aggregated event instead of one per key.
+
+        Args:
+            namespace: The state namespace.
+            values: A dict mapping state keys to values.
+        """
+        cdef map[string, CefValueWrapper] cef_values
+        converter = PytoniumValueWrapper()
+        for key, value in values.items():
+            cef_values[key.encode("utf-8")] = converter.PythonType_to_CefValueWrapper(value)
+        self.pytonium_library.SetStates(namespace.encode("utf-8"), cef_values)
+
+    def remove_state(self, namespace: str, key: str) -> None:
+        """Remove a key from the application state.
+
+        Args:
+            namespace: The state namespace.
+            key: The state key to remove.
+        """
+        self.pytonium_library.RemoveState(namespace.encode("utf-8"), key.encode("utf-8"))
+
+    def get_state_async(self, namespace: str, key: str) -> Future:
+        """Read a value from the application state.
+
+        The value lives in the renderer process, so the read is answered asynchronously.
+        With the state cache enabled (see ``enable_state_cache``), known keys resolve
+        immediately without any IPC.
+
+        Args:
+            namespace: The state namespace.
+            key: The state key within the namespace.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to the value, or ``None`` if the key does not exist.
+        """
+        request = PytoniumPendingRequest(self._pending_requests)
+        request_id = self.pytonium_library.GetState(namespace.encode("utf-8"), key.encode("utf-8"), state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def enable_state_cache(self, enabled: bool = True) -> None:
+        """Keep a browser-side copy of the application state for fast Python reads.
+
+        The cache is filled by this instance's own writes and by answered reads. Keys that
+        JavaScript writes are dropped from it, since a Python write may still be on its way to
+        the renderer, and are read from the renderer again. It is cleared whenever the main
+        frame starts a navigation.
+
+        Args:
+            enabled: ``True`` to enable the cache, ``False`` to disable and clear it.
+        """
+        self.pytonium_library.SetStateCacheEnabled(enabled)
+
+    def get_changes_since(self, namespace: str, version: int = 0) -> Future:
+        """Query the keys of a namespace that changed after ``version``.
+
+        Every state write gets a monotonically increasing version. Keep the ``version`` of the
+        result and pass it to the next call to resync only what changed in between.
+
+        Args:
+            namespace: The state namespace.
+            version: The version to compare against, ``0`` returns the whole namespace.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to a dict with ``version`` (int),
+            ``changes`` (dict of key to value), ``removed`` (list of removed keys) and ``reset``.
+            If the versions since ``version`` can no longer be told apart, ``reset`` is ``True``
+            and ``changes`` holds the whole namespace; keys not in it were removed.
+        """
+        request = PytoniumPendingRequest(self._pending_requests, _convert_state_changes)
+        request_id = self.pytonium_library.GetStateChangesSince(namespace.encode("utf-8"), max(0, int(version)), state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def get_state_version(self, namespace: str, key: str) -> Future:
+        """Query the version of the last write to a key, for ``compare_and_set_state``.
+
+        Args:
+            namespace: The state namespace.
+            key: The state key within the namespace.
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to the version (int), ``0`` if the key does not exist.
+        """
+        request = PytoniumPendingRequest(self._pending_requests, int)
+        request_id = self.pytonium_library.GetStateVersion(namespace.encode("utf-8"), key.encode("utf-8"), state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def compare_and_set_state(self, namespace: str, key: str, expected_version: int, value: object) -> Future:
+        """Set a state value only if the key was not changed since ``expected_version``.
+
+        Args:
+            namespace: The state namespace.
+            key: The state key within the namespace.
+            expected_version: The key version the change is based on (see ``get_state_version``),
+                ``0`` if the key must not exist yet.
+            value: The value to store (int, float, str, bool, dict, or list).
+
+        Returns:
+            A ``concurrent.futures.Future`` resolving to ``True`` if the value was stored,
+            ``False`` if the key was changed in the meantime.
+        """
+        converter = PytoniumValueWrapper()
+        request = PytoniumPendingRequest(self._pending_requests, bool)
+        request_id = self.pytonium_library.CompareAndSetState(namespace.encode("utf-8"), key.encode("utf-8"), max(0, int(expected_version)), converter.PythonType_to_CefValueWrapper(value), state_request_callback, <void *>request)
+        if request_id < 0:
+            request.fail("No browser is running.")
+        return request.future
+
+    def state_batch(self):
+        """Group state changes into one atomic update.
+
+        Every ``set_state``, ``set_states`` and ``remove_state`` call inside the ``with``
+        block is buffered and sent as a single batch when the block exits. If the block
+        raises, its buffered changes are discarded. Batches can be nested: an inner batch
+        joins the outer one, and if it raises only its own changes are discarded.
+
+        A batch belongs to the thread that opened it; ``set_state`` calls made by other
+        threads meanwhile are not part of it.
+
+        Example::
+
+            with pytonium.state_batch():
+                pytonium.set_state("user", "name", "Ada")
+                pytonium.set_state("user", "age", 36)
+        """
+        return PytoniumStateBatch(self)
+
+    def get_pending_state_batch(self):
+        """Get the changes buffered by the innermost open ``state_batch()`` of this thread.
+
+        Returns:
+            ``None`` if the calling thread has no open batch, otherwise a dict with
+            ``updates`` (namespace -> key -> value) and ``removals`` (namespace -> list of keys).
+        """
+        cdef PendingStateBatch batch
+        if not self.pytonium_library.GetPendingStateBatch(batch):
+            return None
+        cdef PytoniumValueWrapper converter = PytoniumValueWrapper()
+        updates = {}
+        for namespace_values in batch.Updates:
+            values = {}
+            for key_value in namespace_values.second:
+                values[key_value.first.decode("utf-8")] = converter.CefValueWrapper_to_PythonType(key_value.second)
+            if values:
+                updates[namespace_values.first.decode("utf-8")] = values
+        removals = {}
+        for namespace_keys in batch.Removals:
+            keys = [key.decode("utf-8") for key in namespace_keys.second]
+            if keys:
+                removals[namespace_keys.first.decode("utf-8")] = keys
+        return {"updates": updates, "removals": removals}
+
     def generate_typescript_definitions(self, filename: str) -> None:
         """Generate TypeScript definition file for bound JavaScript functions.
 
@@ -875,12 +2260,27 @@ cdef class Pytonium:
         object_map["appState"].append(
             "function setState(namespace: string, key: string, value: any): void;"
         )
+        object_map["appState"].append(
+            "function setStates(namespace: string, values: { [key: string]: any }): void;"
+        )
         object_map["appState"].append(
             "function getState(namespace: string, key: string): any;"
         )
         object_map["appState"].append(
             "function removeState(namespace: string, key: string): void;"
         )
+        object_map["appState"].append(
+            "function compareAndSetState(namespace: string, key: string, expectedVersion: number, value: any): boolean;"
+        )
+        object_map["appState"].append(
+            "function getVersion(namespace: string): number;"
+        )
+        object_map["appState"].append(
+            "function getStateVersion(namespace: string, key: string): number;"
+        )
+        object_map["appState"].append(
+            "function getChangesSince(namespace: string, version: number): { version: number, changes: { [key: string]: any }, removed: string[], reset: boolean };"
+        )
 
         # Generate the TypeScript definitions
         for obj_name, functions in object_map.items():
@@ -907,3 +2307,22 @@ cdef class Pytonium:
             f.write('\n'.join(ts_definitions))
 
         print("TypeScript definitions generated.")
+
+
+cdef class PytoniumStateBatch:
+    """Context manager returned by ``Pytonium.state_batch()``."""
+    cdef Pytonium pytonium
+
+    def __init__(self, Pytonium pytonium):
+        self.pytonium = pytonium
+
+    def __enter__(self):
+        self.pytonium.pytonium_library.BeginStateBatch()
+        return self.pytonium
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if exc_type is not None:
+            self.pytonium.pytonium_library.DiscardStateBatch()
+        else:
+            self.pytonium.pytonium_library.CommitStateBatch()
+        return False
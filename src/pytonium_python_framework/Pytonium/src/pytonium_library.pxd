@@ -2,8 +2,11 @@
 # cython: language_level=3
 
 from libcpp.string cimport string
+from libc.stdint cimport uint8_t, int64_t, uint64_t
+from libcpp.memory cimport shared_ptr
 from libcpp cimport bool
 from libcpp.map cimport map  # Import map from the C++ standard library
+from libcpp.set cimport set as cpp_set
 from libcpp.vector cimport vector  # Import vector from the C++ standard library
 
 cdef extern from "src/pytonium_library/javascript_binding.h":
@@ -68,13 +71,196 @@ cdef extern from "src/pytonium_library/javascript_binding.h":
 cdef extern from "src/pytonium_library/application_state_python.h":
     ctypedef void (*state_callback_object_ptr)
     ctypedef void (*state_handler_function_ptr)(state_callback_object_ptr python_callback_object, string stateNamespace, string stateKey, CefValueWrapper callback_args)
+    ctypedef void (*state_batch_handler_function_ptr)(state_callback_object_ptr python_callback_object, CefValueWrapper changes)
+    ctypedef void (*state_request_callback_ptr)(void* user_data, int request_id, bool success, CefValueWrapper result)
 
 cdef extern from "src/pytonium_library/application_context_menu_binding.h":
     ctypedef void (*context_menu_handler_object_ptr)
     ctypedef void (*context_menu_handler_function_ptr)(context_menu_handler_object_ptr python_callback_object, string contextMenuNamespace, int contextMenuIndex)
 
 # Declare the class with cdef
+cdef extern from "src/pytonium_library/asset_cache.h":
+    cdef cppclass AssetCacheStats:
+        uint64_t Hits
+        uint64_t Misses
+        uint64_t Evictions
+        uint64_t Entries
+        uint64_t Bytes
+        uint64_t Budget
+
+cdef extern from "src/pytonium_library/custom_protocol_scheme_handler.h":
+    bool ReadAssetPackEntry(const string& archive, const string& path, const string& acceptEncoding,
+                            string& body, string& contentEncoding)
+
+cdef extern from "src/pytonium_library/cef_custom_scheme.h":
+    cdef enum:
+        CEF_SCHEME_OPTION_STANDARD
+        CEF_SCHEME_OPTION_LOCAL
+        CEF_SCHEME_OPTION_DISPLAY_ISOLATED
+        CEF_SCHEME_OPTION_SECURE
+        CEF_SCHEME_OPTION_CORS_ENABLED
+        CEF_SCHEME_OPTION_CSP_BYPASSING
+        CEF_SCHEME_OPTION_FETCH_ENABLED
+
+cdef extern from "src/pytonium_library/osr_surface.h":
+    cdef cppclass OsrRect:
+        int X
+        int Y
+        int Width
+        int Height
+    cdef cppclass OsrPaintStats:
+        uint64_t Frames
+        uint64_t FullFrames
+        uint64_t BytesCopied
+        uint64_t DirtyPixels
+        int Width
+        int Height
+
+cdef extern from "src/pytonium_library/pixel_convert.h":
+    cdef enum PixelFormat:
+        PIXEL_FORMAT_BGRA
+        PIXEL_FORMAT_RGBA
+        PIXEL_FORMAT_BGRA_STRAIGHT
+        PIXEL_FORMAT_RGBA_STRAIGHT
+        PIXEL_FORMAT_BGR
+        PIXEL_FORMAT_RGB
+    cdef enum PixelConvertIsa:
+        PIXEL_CONVERT_SCALAR
+        PIXEL_CONVERT_SSSE3
+        PIXEL_CONVERT_AVX2
+        PIXEL_CONVERT_NEON
+    int PixelFormatBytes(PixelFormat format)
+    PixelConvertIsa GetPixelConvertIsa()
+    const char* GetPixelConvertIsaName(PixelConvertIsa isa)
+    bool ConvertPixels(const uint8_t* src, int srcStride, PixelFormat srcFormat,
+                       int x, int y, int width, int height,
+                       uint8_t* dst, int dstStride, PixelFormat dstFormat) nogil
+
+cdef extern from "src/pytonium_library/osr_frame_rate.h":
+    cdef cppclass OsrFrameRateStats:
+        int FrameRate
+        bool Adaptive
+        uint64_t Paints
+        uint64_t PaintTimeUs
+        uint64_t RateChanges
+
+cdef extern from "src/pytonium_library/osr_frame_store.h":
+    cdef cppclass OsrFrameBuffer:
+        vector[uint8_t] Pixels
+        int Width
+        int Height
+        int Stride
+        uint64_t Sequence
+        int64_t TimestampUs
+        OsrRect Damage
+        uint64_t DamageSince
+    cdef cppclass OsrFrameCaptureStats:
+        uint64_t Published
+        uint64_t Captured
+        uint64_t Dropped
+
+cdef extern from "src/pytonium_library/osr_frame_encoder.h":
+    cdef enum FrameEncoderFormat:
+        FRAME_ENCODER_Y4M
+        FRAME_ENCODER_PNG
+        FRAME_ENCODER_RAW
+    cdef cppclass FrameEncoderSettings:
+        FrameEncoderFormat Format
+        string Target
+        bool Pipe
+        int FrameRate
+        size_t QueueSize
+        PixelFormat RawFormat
+    cdef cppclass FrameEncoderStats:
+        uint64_t Submitted
+        uint64_t Encoded
+        uint64_t Dropped
+        uint64_t Duplicated
+        uint64_t Skipped
+        uint64_t Errors
+        uint64_t BytesWritten
+        int QueueDepth
+        int MaxQueueDepth
+        uint64_t TotalLatencyUs
+        uint64_t MaxLatencyUs
+
+cdef extern from "src/pytonium_library/pdf_render_pool.h":
+    cdef cppclass PdfRenderJob:
+        string Url
+        string Html
+        string DataJson
+        string OutputPath
+        bool Landscape
+        bool PrintBackground
+        double Scale
+        double PaperWidth
+        double PaperHeight
+        double MarginTop
+        double MarginRight
+        double MarginBottom
+        double MarginLeft
+        string PageRanges
+        bool PreferCssPageSize
+        int TimeoutMs
+    cdef cppclass PdfRenderPoolStats:
+        int Browsers
+        int Busy
+        int Queued
+        uint64_t Completed
+        uint64_t Failed
+        uint64_t TotalRenderUs
+        uint64_t MaxRenderUs
+
+cdef extern from "src/pytonium_library/message_pump.h":
+    cdef cppclass MessagePumpStats:
+        uint64_t Scheduled
+        uint64_t Work
+        uint64_t Wakeups
+        uint64_t Timeouts
+
+cdef extern from "src/pytonium_library/ui_thread.h":
+    ctypedef void* (*ui_thread_wait_release_ptr)()
+    ctypedef void (*ui_thread_wait_reacquire_ptr)(void* token)
+    void SetUiThreadWaitHooks(ui_thread_wait_release_ptr release, ui_thread_wait_reacquire_ptr reacquire)
+    cdef cppclass UiThreadQueueStats:
+        int64_t Posted
+        int64_t Executed
+        int64_t Batches
+    UiThreadQueueStats GetUiThreadQueueStats()
+
+cdef extern from "src/pytonium_library/browser_pool.h":
+    cdef cppclass BrowserPoolStats:
+        int Warm
+        int Starting
+        uint64_t Created
+        uint64_t Taken
+        uint64_t Missed
+
+cdef extern from "src/pytonium_library/osr_frame_handler.h":
+    cdef cppclass OsrFrame:
+        const void* Buffer
+        int Width
+        int Height
+        int Stride
+        const OsrRect* DirtyRects
+        int DirtyRectCount
+        OsrRect Damage
+    ctypedef void (*osr_frame_callback_ptr)(void* user_data, const OsrFrame* frame)
+
+cdef extern from "src/pytonium_library/scheme_route.h":
+    cdef cppclass SchemeRouteRequest:
+        string Method
+        string Url
+        string Path
+        map[string, string] Headers
+        string Body
+    ctypedef bool (*scheme_route_handler_ptr)(void* user_data, int request_id, SchemeRouteRequest request)
+
 cdef extern from "src/pytonium_library/pytonium_library.h":
+    cdef cppclass PendingStateBatch:
+        map[string, map[string, CefValueWrapper]] Updates
+        map[string, cpp_set[string]] Removals
+
     cdef cppclass PytoniumLibrary:
         PytoniumLibrary() except +
         void InitPytonium(string start_url, int init_width, int init_height);
@@ -91,15 +277,52 @@ cdef extern from "src/pytonium_library/pytonium_library.h":
         @staticmethod
         void ShutdownCef()
 
+        @staticmethod
+        void SetBackgroundThread(bool background)
+        @staticmethod
+        bool IsBackgroundThread()
+
+        @staticmethod
+        bool StartBrowserPool(int size, const string& warmUrl, bool windowless)
+        @staticmethod
+        void StopBrowserPool()
+        @staticmethod
+        BrowserPoolStats GetBrowserPoolStats()
+
         void ExecuteJavascript(string code)
+        int EvaluateJavascript(string code, state_request_callback_ptr callback, void* user_data)
         void ReturnValueToJavascript(int message_id, CefValueWrapper returnValue)
         void ShutdownPytonium()
         bool IsRunning()
-        void UpdateMessageLoop();
+        bool IsReadyToExecuteJavascript()
+        @staticmethod
+        void UpdateMessageLoop()
+        @staticmethod
+        bool WaitForMessageLoopWork(int64_t timeoutMs) nogil
+        @staticmethod
+        int64_t GetMessageLoopDelay()
+        @staticmethod
+        int GetMessageLoopWakeupFd()
+        @staticmethod
+        void SetMessageLoopMaxDelay(int64_t delayMs)
+        @staticmethod
+        int64_t GetMessageLoopMaxDelay()
+        @staticmethod
+        MessagePumpStats GetMessageLoopStats()
         void AddJavascriptPythonBinding(string name, js_python_bindings_handler_function_ptr handler_callback, void* python_callable, string javascript_object, bool returns_value)
-        void AddStateHandlerPythonBinding(state_handler_function_ptr stateHandlerFunctionPtr, state_callback_object_ptr stateCallbackObjectPtr,  vector[string] namespacesToSubscribeTo)
+        void AddStateHandlerPythonBinding(state_handler_function_ptr stateHandlerFunctionPtr, state_callback_object_ptr stateCallbackObjectPtr,  vector[string] namespacesToSubscribeTo, state_batch_handler_function_ptr stateBatchHandlerFunctionPtr)
         void SetState(string stateNamespace, string key, CefValueWrapper value)
+        void SetStates(string stateNamespace, map[string, CefValueWrapper] values)
         void RemoveState(string stateNamespace, string key)
+        int GetState(string stateNamespace, string key, state_request_callback_ptr callback, void* user_data)
+        void SetStateCacheEnabled(bool enabled)
+        int GetStateChangesSince(string stateNamespace, uint64_t sinceVersion, state_request_callback_ptr callback, void* user_data)
+        int CompareAndSetState(string stateNamespace, string key, uint64_t expectedVersion, CefValueWrapper value, state_request_callback_ptr callback, void* user_data)
+        int GetStateVersion(string stateNamespace, string key, state_request_callback_ptr callback, void* user_data)
+        void BeginStateBatch()
+        void CommitStateBatch()
+        void DiscardStateBatch()
+        bool GetPendingStateBatch(PendingStateBatch& batch)
         void AddContextMenuEntry(context_menu_handler_function_ptr context_menuHandlerFunctionPtr, context_menu_handler_object_ptr context_menuCallbackObjectPtr, string contextMenuNameSpace, string contextMenuDisplayName, int contextMenuId)
         void SetCustomSubprocessPath(string path)
         void SetCustomCachePath(string cef_cache_path)
@@ -107,11 +330,53 @@ cdef extern from "src/pytonium_library/pytonium_library.h":
         void LoadUrl(string url);
         void SetCurrentContextMenuNamespace(string contextMenuNamespace);
         void SetShowDebugContextMenu(bool show);
-        void AddCustomScheme(string schemeIdentifier, string contentRootFolder);
+        void AddCustomScheme(string schemeIdentifier, string contentRootFolder, string cacheControl, int schemeOptions, map[string, string] responseHeaders);
         void AddMimeTypeMapping(string fileExtension, string mimeType);
+
+        void AddSchemeRoute(string schemeIdentifier, string prefix, scheme_route_handler_ptr handler, void* userData)
+        void RemoveSchemeRoute(string schemeIdentifier, string prefix)
+        void AddVirtualFile(string schemeIdentifier, string path, string data, string mimeType)
+        void RemoveVirtualFile(string schemeIdentifier, string path)
+        @staticmethod
+        bool RespondSchemeRequest(int requestId, int status, string mimeType, map[string, string] headers)
+        @staticmethod
+        bool WriteSchemeRequest(int requestId, string data)
+        @staticmethod
+        bool FinishSchemeRequest(int requestId)
+        @staticmethod
+        void SetSchemeRouteTimeout(int milliseconds)
+        @staticmethod
+        int GetSchemeRouteTimeout()
+
+        @staticmethod
+        void SetAssetCacheBudget(size_t bytes)
+        @staticmethod
+        void ClearAssetCache()
+        @staticmethod
+        AssetCacheStats GetAssetCacheStats()
         
         # OSR (off-screen rendering) mode for transparent windows
         void SetOsrMode(bool osr);
+        void SetHeadless(bool headless);
+        bool IsHeadless();
+        void SetFrameCallback(osr_frame_callback_ptr callback, void* user_data);
+        OsrPaintStats GetOsrPaintStats();
+        void EnableFrameCapture(bool enable);
+        shared_ptr[const OsrFrameBuffer] CaptureFrame(bool onlyNew);
+        OsrFrameCaptureStats GetFrameCaptureStats();
+        bool StartRecording(const FrameEncoderSettings& settings);
+        void StopRecording();
+        FrameEncoderStats GetRecordingStats();
+        void SetFrameRate(int frameRate);
+        void SetAdaptiveFrameRate(int minFrameRate, int maxFrameRate);
+        OsrFrameRateStats GetFrameRateStats();
+        int GetRendererCpuUsage(state_request_callback_ptr callback, void* user_data)
+        bool StartBindingsBrowserPool(int size, const string& warmUrl, bool windowless)
+        void StopBindingsBrowserPool()
+        bool StartPdfPool(int size)
+        void StopPdfPool()
+        int RenderPdf(PdfRenderJob job, state_request_callback_ptr callback, void* user_data)
+        PdfRenderPoolStats GetPdfPoolStats()
 
         # Window control methods
         void SetFramelessWindow(bool frameless);
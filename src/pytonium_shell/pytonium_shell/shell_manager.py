@@ -2,7 +2,6 @@
 
 import json
 import os
-import time
 
 from .widget_manager import WidgetManager
 from .system_services import SystemServices
@@ -104,7 +103,9 @@ class ShellManager:
                 self.widget_manager.update()
                 self.system_services.poll()
                 self.position_store.poll_save()
-                time.sleep(0.016)  # ~60 fps
+                # Wakes as soon as CEF has work due; the timeout keeps
+                # hotkeys, tray and services polled at ~60 fps.
+                self.widget_manager.wait_for_work(0.016)
         except KeyboardInterrupt:
             print("\nPytoniumShell: Interrupted.")
 
@@ -15,6 +15,13 @@ class WidgetInstance:
         self.mode = manifest.get("window", {}).get("mode", "widget")
         self.visible = True  # toggled by hotkeys / tray
 
+        # Windows opened after startup (dashboard, on-demand widgets): opens
+        # the window on first show, from a browser pool warmed at startup
+        # with this URL and kind
+        self.open_window = None
+        self.pool_url = None
+        self.pool_windowless = False
+
         # Bar mode: keep APPBARDATA reference for cleanup
         self.appbar_data = None
 
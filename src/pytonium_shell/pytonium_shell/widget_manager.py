@@ -3,6 +3,7 @@
 import importlib.util
 import json
 import os
+import sys
 import time
 
 from Pytonium import Pytonium
@@ -21,7 +22,8 @@ class WidgetManager:
         self.dashboard_widgets = []
         self._dashboard_visible = False
         self._pending_hide_time = None
-        self._wallpaper_check_counter = 0
+        self._opening_widgets = []
+        self._next_wallpaper_check = time.monotonic() + 5.0
 
     # -- Widget discovery & loading --------------------------------------------
 
@@ -42,6 +44,8 @@ class WidgetManager:
                 except Exception as e:
                     print(f"  Failed to load widget '{entry}': {e}")
 
+        self._warm_deferred_widgets()
+
     def _load_widget(self, name, widget_path, manifest_path):
         """Load a single widget from its directory."""
         with open(manifest_path, "r") as f:
@@ -93,8 +97,9 @@ class WidgetManager:
         else:
             raise ValueError(f"Unknown widget mode: '{mode}'")
 
-        # Inject theme
-        self.shell.theme.inject(p)
+        # Inject theme (deferred windows get it when their page has loaded)
+        if widget_inst.open_window is None:
+            self.shell.theme.inject(p)
 
         # Set up hot reload if enabled
         if manifest.get("hot_reload", False):
@@ -105,7 +110,22 @@ class WidgetManager:
     # -- Mode-specific setup methods -------------------------------------------
 
     def _setup_widget_mode(self, widget, window_config, entry_url):
-        """Set up a floating widget window."""
+        """Set up a floating widget window.
+
+        With ``open_on_demand`` it starts hidden and opens on its first toggle.
+        """
+        if window_config.get("open_on_demand", False):
+            def open_window(show):
+                self._open_widget_window(widget, window_config, entry_url, show)
+
+            if not self._defer_open(widget, window_config, entry_url, open_window):
+                open_window(False)
+            widget.visible = False
+        else:
+            self._open_widget_window(widget, window_config, entry_url, True)
+
+    def _open_widget_window(self, widget, window_config, entry_url, show):
+        """Open the window of a floating widget."""
         p = widget.pytonium
         width = window_config.get("width", 300)
         height = window_config.get("height", 200)
@@ -144,8 +164,25 @@ class WidgetManager:
                         saved["width"], saved["height"],
                     )
 
+            if not show:
+                Win32WindowHelper.hide_window(hwnd)
+
     def _setup_dashboard_mode(self, widget, window_config, entry_url):
-        """Set up a full-screen dashboard overlay (hidden by default)."""
+        """Set up a full-screen dashboard overlay (hidden by default).
+
+        The window opens on first show if a pooled browser can serve it,
+        otherwise now, hidden.
+        """
+        def open_window(show):
+            self._open_dashboard_window(widget, window_config, entry_url, show)
+
+        if not self._defer_open(widget, window_config, entry_url, open_window):
+            open_window(False)
+        widget.visible = False
+        self.dashboard_widgets.append(widget)
+
+    def _open_dashboard_window(self, widget, window_config, entry_url, show):
+        """Open the full-screen window of a dashboard."""
         p = widget.pytonium
         monitor = self._resolve_monitor(window_config.get("monitor", "primary"))
         width = monitor.width
@@ -158,10 +195,8 @@ class WidgetManager:
             Win32WindowHelper.make_always_on_top(hwnd)
             Win32WindowHelper.hide_from_taskbar(hwnd)
             Win32WindowHelper.set_position(hwnd, monitor.x, monitor.y, width, height)
-            Win32WindowHelper.hide_window(hwnd)
-
-        widget.visible = False
-        self.dashboard_widgets.append(widget)
+            if not show:
+                Win32WindowHelper.hide_window(hwnd)
 
     def _setup_bar_mode(self, widget, window_config, entry_url):
         """Set up a bar docked to a screen edge using SHAppBarMessage."""
@@ -223,6 +258,66 @@ class WidgetManager:
             if window_config.get("click_through", True):
                 Win32WindowHelper.make_click_through(hwnd)
 
+    # -- Deferred windows ------------------------------------------------------
+
+    @staticmethod
+    def _defer_open(widget, window_config, entry_url, open_window):
+        """Defer opening a window to its first show, from a pooled browser.
+
+        Returns False if no browser pool can serve the window: transparent
+        (OSR) windows on Windows are layered windows that parent their
+        browser, and pools of native windows need Windows.
+        """
+        windowless = window_config.get("transparent_background", False)
+        if windowless == (sys.platform == "win32"):
+            return False
+        widget.open_window = open_window
+        widget.pool_url = entry_url
+        widget.pool_windowless = windowless
+        return True
+
+    def _warm_deferred_widgets(self):
+        """Warm a browser pool for each deferred window.
+
+        The pool is started from the widget's own instance, so its browsers
+        carry the backend bindings, and loads the widget's entry page.
+        """
+        for w in self.active_widgets:
+            if w.open_window is None:
+                continue
+            if not Pytonium.is_cef_initialized():
+                # No other window started CEF; open this one now, hidden
+                self._open_deferred(w, False)
+                continue
+            try:
+                w.pytonium.start_bindings_browser_pool(
+                    w.pool_url, size=1, windowless=w.pool_windowless
+                )
+            except RuntimeError as e:
+                print(f"  No browser pool for '{w.name}': {e}")
+
+    def _open_deferred(self, widget, show):
+        """Open a deferred window and stop its browser pool."""
+        open_window = widget.open_window
+        widget.open_window = None
+        open_window(show)
+        widget.pytonium.stop_bindings_browser_pool()
+        # Code run before the page has loaded is dropped
+        self._opening_widgets.append(widget)
+
+    def _check_opened_pages(self):
+        """Theme deferred windows, and fade in dashboards, once their page has loaded."""
+        for w in list(self._opening_widgets):
+            if not w.pytonium.is_ready_to_execute_javascript():
+                continue
+            self._opening_widgets.remove(w)
+            self.shell.theme.inject(w.pytonium)
+            if w.mode == "dashboard" and w.visible:
+                w.pytonium.execute_javascript(
+                    "document.body.classList.remove('fade-out');"
+                    "document.body.classList.add('fade-in');"
+                )
+
     # -- Helpers ---------------------------------------------------------------
 
     @staticmethod
@@ -295,6 +390,11 @@ class WidgetManager:
         """Show all dashboard widgets with a fade-in animation."""
         self._dashboard_visible = True
         for w in self.dashboard_widgets:
+            w.visible = True
+            if w.open_window is not None:
+                # Fades in once the page has loaded, see _check_opened_pages
+                self._open_deferred(w, True)
+                continue
             hwnd = w.pytonium.get_native_window_handle()
             if hwnd:
                 # Show the window first, then trigger CSS fade-in
@@ -303,7 +403,6 @@ class WidgetManager:
                     "document.body.classList.remove('fade-out');"
                     "document.body.classList.add('fade-in');"
                 )
-            w.visible = True
 
     def hide_dashboard(self):
         """Hide all dashboard widgets with a fade-out animation."""
@@ -336,6 +435,10 @@ class WidgetManager:
         """Toggle visibility of a specific widget by name."""
         for w in self.active_widgets:
             if w.name == widget_name:
+                if w.open_window is not None:
+                    self._open_deferred(w, True)
+                    w.visible = True
+                    break
                 hwnd = w.pytonium.get_native_window_handle()
                 if hwnd:
                     if w.visible:
@@ -366,16 +469,21 @@ class WidgetManager:
     def update(self):
         """Pump the message loop. Only one instance needs to call this."""
         self._check_pending_hide()
+        self._check_opened_pages()
 
-        # Wallpaper health check every ~5 seconds (300 frames at 60fps)
-        self._wallpaper_check_counter += 1
-        if self._wallpaper_check_counter >= 300:
-            self._wallpaper_check_counter = 0
+        # Wallpaper health check every ~5 seconds
+        now = time.monotonic()
+        if now >= self._next_wallpaper_check:
+            self._next_wallpaper_check = now + 5.0
             self._check_wallpaper_health()
 
         if self.active_widgets:
             self.active_widgets[0].pytonium.update_message_loop()
 
+    def wait_for_work(self, timeout):
+        """Sleep until CEF has work due, at most ``timeout`` seconds."""
+        Pytonium.wait_for_message_loop_work(timeout)
+
     def any_running(self):
         """Check if any widget is still running."""
         return any(w.pytonium.is_running() for w in self.active_widgets)
@@ -33,9 +33,14 @@ int APIENTRY wWinMain(HINSTANCE hInstance,
     std::vector<JavascriptPythonBinding> placeHolderPython;
     std::vector<StateHandlerPythonBinding> placeHolderStatePython;
     std::vector<ContextMenuBinding>placeHolderContextMenuPython;
-    std::vector<CefCustomScheme>placeHolderSchemes;
+    // Custom schemes must be registered in the sub-processes too, the browser
+    // process passes them on the command line and in the environment (for
+    // processes forked from the zygote).
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
+    command_line->InitFromString(::GetCommandLineW());
+    std::vector<CefCustomScheme> customSchemes = GetSubprocessCustomSchemes(command_line->GetSwitchValue(kCustomSchemesSwitch).ToString());
     std::unordered_map<std::string, std::string> placeHolderMap;
-    CefRefPtr<CefWrapperApp> app(new CefWrapperApp("", placeHolder, placeHolderPython, placeHolderStatePython,placeHolderContextMenuPython,placeHolderSchemes, placeHolderMap));
+    CefRefPtr<CefWrapperApp> app(new CefWrapperApp("", placeHolder, placeHolderPython, placeHolderStatePython,placeHolderContextMenuPython, customSchemes, placeHolderMap));
 
     CefExecuteProcess(main_args, app.get(), sandbox_info);
 
@@ -26,9 +26,14 @@ int main(int argc, char *argv[])
     std::vector<JavascriptPythonBinding> placeHolderPython;
     std::vector<StateHandlerPythonBinding> placeHolderStatePython;
     std::vector<ContextMenuBinding> placeHolderContextMenuPython;
-    std::vector<CefCustomScheme> placeHolderScheme;
+    // Custom schemes must be registered in the sub-processes too, the browser
+    // process passes them on the command line and in the environment (for
+    // processes forked from the zygote).
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
+    command_line->InitFromArgv(argc, argv);
+    std::vector<CefCustomScheme> customSchemes = GetSubprocessCustomSchemes(command_line->GetSwitchValue(kCustomSchemesSwitch).ToString());
     std::unordered_map<std::string, std::string> placeHolderMap;
-    CefRefPtr<CefWrapperApp> app(new CefWrapperApp("", placeHolder, placeHolderPython, placeHolderStatePython, placeHolderContextMenuPython, placeHolderScheme, placeHolderMap));
+    CefRefPtr<CefWrapperApp> app(new CefWrapperApp("", placeHolder, placeHolderPython, placeHolderStatePython, placeHolderContextMenuPython, customSchemes, placeHolderMap));
 
     CefExecuteProcess(main_args, app.get(), sandbox_info);
 
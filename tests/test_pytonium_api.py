@@ -186,6 +186,7 @@ class TestInstanceState:
         from Pytonium import Pytonium
         p = Pytonium()
         assert p.is_running() is False
+        assert p.is_ready_to_execute_javascript() is False
 
     def test_get_window_handle_before_init(self):
         from Pytonium import Pytonium
@@ -201,6 +202,441 @@ class TestInstanceState:
         from Pytonium import Pytonium
         assert Pytonium.is_cef_initialized() is False
 
+    def test_headless_before_init(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        assert p.is_headless() is False
+        p.set_headless(True)
+        p.on_frame(lambda pixels, width, height, dirty_rects: None)
+        p.on_frame(lambda pixels, width, height, dirty_rects, damage: None, "rgba", damage_only=True)
+        assert p.is_headless() is True
+        with pytest.raises(TypeError, match="callable"):
+            p.on_frame("not callable")
+
+    def test_capture_frame_before_init(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.enable_frame_capture()
+        assert p.capture_frame() is None
+        assert p.capture_frame(only_new=False) is None
+        assert p.get_frame_capture_stats() == {"published": 0, "captured": 0, "dropped": 0}
+
+    def test_recording_before_init(self, tmp_path):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.stop_recording()
+        with pytest.raises(ValueError, match="format"):
+            p.start_recording(str(tmp_path / "out.gif"), format="gif")
+        with pytest.raises(ValueError, match="piped"):
+            p.start_recording("cat", format="png", pipe=True)
+        assert p.start_recording(str(tmp_path / "out.y4m")) is True
+        p.stop_recording()
+        stats = p.get_recording_stats()
+        assert stats["frames_submitted"] == 0
+        assert stats["errors"] == 0
+        assert p.start_recording(str(tmp_path / "missing" / "out.y4m")) is False
+
+    def test_pdf_pool_before_init(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with pytest.raises(RuntimeError, match="initialized"):
+            p.start_pdf_pool()
+        with pytest.raises(ValueError, match="url or html"):
+            p.render_pdf()
+        with pytest.raises(RuntimeError, match="not running"):
+            p.render_pdf(html="<p>report</p>").result(timeout=1)
+        assert p.get_pdf_pool_stats()["completed"] == 0
+        p.stop_pdf_pool()
+
+    def test_message_loop_scheduling_before_init(self):
+        from Pytonium import Pytonium
+        # Nothing ran yet, so the first update is due right away.
+        assert Pytonium.wait_for_message_loop_work(0.5) is True
+        assert Pytonium.get_message_loop_delay() == 0
+        assert isinstance(Pytonium.get_message_loop_wakeup_fd(), int)
+        # Native window input on Linux waits for the next update.
+        expected = 0.016 if sys.platform.startswith("linux") else 0.033
+        assert Pytonium.get_message_loop_max_delay() == expected
+        with pytest.raises(ValueError, match="positive"):
+            Pytonium.set_message_loop_max_delay(0)
+        assert Pytonium.get_message_loop_stats()["work"] == 0
+
+    def test_background_thread_before_init(self):
+        from Pytonium import Pytonium
+        assert Pytonium.is_background_thread() is False
+        Pytonium.set_background_thread()
+        try:
+            assert Pytonium.is_background_thread() is True
+        finally:
+            Pytonium.set_background_thread(False)
+        assert Pytonium.is_background_thread() is False
+
+    def test_calls_from_threads_before_init(self):
+        import threading
+        from Pytonium import Pytonium
+        p = Pytonium()
+        # Without a UI thread yet, calls run on the calling thread.
+        threads = [threading.Thread(target=p.execute_javascript, args=("1",)) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        assert Pytonium.get_ui_thread_queue_stats() == {"posted": 0, "executed": 0, "batches": 0}
+
+    def test_asyncio_before_init(self):
+        import asyncio
+        from Pytonium import Pytonium, aio
+        p = Pytonium()
+
+        async def main():
+            with pytest.raises(RuntimeError, match="No browser"):
+                await aio.evaluate_javascript(p, "1 + 1")
+            await aio.run(p)
+
+        asyncio.run(main())
+
+    def test_browser_pool_before_init(self):
+        from Pytonium import Pytonium
+        with pytest.raises(ValueError):
+            Pytonium.start_browser_pool("about:blank", size=0)
+        with pytest.raises(RuntimeError, match="CEF must be initialized"):
+            Pytonium.start_browser_pool("about:blank", windowless=True)
+        p = Pytonium()
+        with pytest.raises(ValueError):
+            p.start_bindings_browser_pool("about:blank", size=0)
+        with pytest.raises(RuntimeError, match="CEF must be initialized"):
+            p.start_bindings_browser_pool("about:blank", windowless=True)
+        p.stop_bindings_browser_pool()
+        Pytonium.stop_browser_pool()
+        assert Pytonium.get_browser_pool_stats() == {"warm": 0, "starting": 0, "created": 0, "taken": 0, "missed": 0}
+
+    def test_frame_rate_before_init(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        assert p.get_frame_rate_stats()["frame_rate"] == 60
+        p.set_frame_rate(500)
+        assert p.get_frame_rate_stats()["frame_rate"] == 60
+        p.set_frame_rate(24)
+        assert p.get_frame_rate_stats()["adaptive"] is False
+        p.set_adaptive_frame_rate(10, 30)
+        stats = p.get_frame_rate_stats()
+        assert stats["adaptive"] is True
+        assert stats["frame_rate"] == 30
+        with pytest.raises(RuntimeError, match="No browser"):
+            p.get_renderer_cpu_usage().result(timeout=1)
+
+
+class TestPixelConversion:
+    """Tests for the frame export pixel conversion kernels."""
+
+    @staticmethod
+    def _pixels():
+        # Every (color, alpha) pair plus a few odd pixels for the SIMD tails.
+        data = bytearray()
+        for a in range(256):
+            for c in range(0, 256, 5):
+                data += bytes((c, 255 - c, c // 2, a))
+        data += bytes((200, 100, 50, 10, 1, 2, 3, 0, 9, 8, 7, 255))
+        return bytes(data)
+
+    @staticmethod
+    def _unpremultiply(c, a):
+        return 0 if a == 0 else min(255, (c * 255 + a // 2) // a)
+
+    def test_swizzle_and_strip(self):
+        from Pytonium import convert_pixels
+        pixels = self._pixels()
+        width = len(pixels) // 4
+        rgba = convert_pixels(pixels, width, 1, "rgba")
+        rgb = convert_pixels(pixels, width, 1, "rgb")
+        for i in range(width):
+            b, g, r, a = pixels[i * 4:i * 4 + 4]
+            assert rgba[i * 4:i * 4 + 4] == bytes((r, g, b, a))
+            assert rgb[i * 3:i * 3 + 3] == bytes((r, g, b))
+
+    def test_unpremultiply_and_premultiply(self):
+        from Pytonium import convert_pixels
+        pixels = self._pixels()
+        width = len(pixels) // 4
+        straight = convert_pixels(pixels, width, 1, "rgba_straight")
+        premultiplied = convert_pixels(pixels, width, 1, "bgra", source_format="bgra_straight")
+        for i in range(width):
+            b, g, r, a = pixels[i * 4:i * 4 + 4]
+            expected = (self._unpremultiply(r, a), self._unpremultiply(g, a), self._unpremultiply(b, a), a)
+            assert straight[i * 4:i * 4 + 4] == bytes(expected)
+            assert premultiplied[i * 4:i * 4 + 4] == bytes((round(b * a / 255), round(g * a / 255), round(r * a / 255), a))
+
+    def test_region(self):
+        from Pytonium import convert_pixels
+        pixels = bytes(range(256)) * 4
+        region = convert_pixels(pixels, 16, 16, "bgra", region=(3, 2, 5, 4))
+        assert len(region) == 5 * 4 * 4
+        assert region[:20] == pixels[(2 * 16 + 3) * 4:(2 * 16 + 8) * 4]
+        with pytest.raises(ValueError, match="outside"):
+            convert_pixels(pixels, 16, 16, "bgra", region=(12, 0, 5, 1))
+        with pytest.raises(ValueError, match="Unknown pixel format"):
+            convert_pixels(pixels, 16, 16, "yuv")
+        with pytest.raises(ValueError):
+            convert_pixels(pixels, 16, 16, "bgra", source_format="rgb")
+
+    def test_isa_name(self):
+        from Pytonium import get_pixel_convert_isa
+        assert get_pixel_convert_isa() in ("scalar", "ssse3", "avx2", "neon")
+
+
+class TestStateBatch:
+    """Tests for batched state updates before a browser exists."""
+
+    def test_set_states_outside_batch_is_not_buffered(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.set_states("user", {"name": "Ada", "age": 36})
+        assert p.get_pending_state_batch() is None
+
+    def test_state_batch_buffers_until_commit(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with p.state_batch() as batch:
+            assert batch is p
+            p.set_state("user", "name", "Ada")
+            p.set_states("user", {"age": 36})
+            p.remove_state("user", "email")
+            assert p.get_pending_state_batch() == {
+                "updates": {"user": {"name": "Ada", "age": 36}},
+                "removals": {"user": ["email"]},
+            }
+            # A later change of the same key replaces the earlier one
+            p.remove_state("user", "age")
+            assert p.get_pending_state_batch() == {
+                "updates": {"user": {"name": "Ada"}},
+                "removals": {"user": ["age", "email"]},
+            }
+        assert p.get_pending_state_batch() is None
+
+    def test_nested_commit_joins_outer_batch(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with p.state_batch():
+            p.set_state("user", "name", "Ada")
+            with p.state_batch():
+                p.set_state("user", "name", "Grace")
+                p.set_state("ui", "theme", "dark")
+                assert p.get_pending_state_batch() == {
+                    "updates": {"user": {"name": "Grace"}, "ui": {"theme": "dark"}},
+                    "removals": {},
+                }
+            assert p.get_pending_state_batch() == {
+                "updates": {"user": {"name": "Grace"}, "ui": {"theme": "dark"}},
+                "removals": {},
+            }
+        assert p.get_pending_state_batch() is None
+
+    def test_nested_discard_keeps_outer_batch(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with p.state_batch():
+            p.set_state("user", "name", "Ada")
+            with pytest.raises(RuntimeError):
+                with p.state_batch():
+                    p.set_state("user", "name", "Grace")
+                    p.remove_state("user", "age")
+                    raise RuntimeError("abort")
+            assert p.get_pending_state_batch() == {
+                "updates": {"user": {"name": "Ada"}},
+                "removals": {},
+            }
+
+    def test_state_batch_discards_on_error(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with pytest.raises(RuntimeError):
+            with p.state_batch():
+                p.set_state("user", "name", "Ada")
+                raise RuntimeError("abort")
+        assert p.get_pending_state_batch() is None
+        # A new batch starts from a clean state
+        with p.state_batch():
+            assert p.get_pending_state_batch() == {"updates": {}, "removals": {}}
+
+    def test_state_batch_belongs_to_its_thread(self):
+        import threading
+        from Pytonium import Pytonium
+        p = Pytonium()
+        seen = []
+
+        def other_thread():
+            p.set_state("user", "age", 36)
+            seen.append(p.get_pending_state_batch())
+
+        with p.state_batch():
+            p.set_state("user", "name", "Ada")
+            thread = threading.Thread(target=other_thread)
+            thread.start()
+            thread.join()
+            assert seen == [None]
+            assert p.get_pending_state_batch() == {
+                "updates": {"user": {"name": "Ada"}},
+                "removals": {},
+            }
+
+
+class TestVersionedState:
+    """Tests for versioned state queries before a browser exists."""
+
+    def test_get_changes_since_without_browser(self):
+        from concurrent.futures import Future
+        from Pytonium import Pytonium
+        p = Pytonium()
+        future = p.get_changes_since("user", 0)
+        assert isinstance(future, Future)
+        with pytest.raises(RuntimeError, match="No browser"):
+            future.result(timeout=1)
+
+    def test_get_state_version_without_browser(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with pytest.raises(RuntimeError, match="No browser"):
+            p.get_state_version("user", "age").result(timeout=1)
+
+    def test_get_state_async_without_browser(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.enable_state_cache()
+        future = p.get_state_async("user", "name")
+        with pytest.raises(RuntimeError, match="No browser"):
+            future.result(timeout=1)
+
+    def test_compare_and_set_without_browser(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        future = p.compare_and_set_state("user", "name", 0, "Ada")
+        with pytest.raises(RuntimeError, match="No browser"):
+            future.result(timeout=1)
+
+
+class TestAssetCache:
+    """Tests for the custom scheme asset cache controls (no browser needed)."""
+
+    def test_stats_keys(self):
+        from Pytonium import Pytonium
+        stats = Pytonium.get_asset_cache_stats()
+        assert set(stats) == {"hits", "misses", "evictions", "entries", "bytes", "budget"}
+
+    def test_set_budget(self):
+        from Pytonium import Pytonium
+        Pytonium.set_asset_cache_budget(1024 * 1024)
+        assert Pytonium.get_asset_cache_stats()["budget"] == 1024 * 1024
+        Pytonium.clear_asset_cache()
+        assert Pytonium.get_asset_cache_stats()["entries"] == 0
+        Pytonium.set_asset_cache_budget(64 * 1024 * 1024)
+
+    def test_negative_budget_raises(self):
+        from Pytonium import Pytonium
+        with pytest.raises(ValueError):
+            Pytonium.set_asset_cache_budget(-1)
+
+
+class TestSchemeRoutes:
+    """Tests for Python routes and virtual files on custom schemes (no browser needed)."""
+
+    def test_route_requires_callable(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        with pytest.raises(TypeError):
+            p.add_scheme_route("app", "api/", "not callable")
+
+    def test_register_and_remove(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.add_scheme_route("app", "api/", lambda request: {"ok": True})
+        p.remove_scheme_route("app", "api/")
+        p.add_virtual_file("app", "config.json", '{"debug": true}', "application/json")
+        p.remove_virtual_file("app", "config.json")
+
+    def test_route_handler_lives_as_long_as_its_route(self):
+        import gc
+        import weakref
+        from Pytonium import Pytonium
+
+        class Handler:
+            def __call__(self, request):
+                return {"ok": True}
+
+        handler = Handler()
+        alive = weakref.ref(handler)
+        p = Pytonium()
+        p.add_scheme_route("app", "/lifetime/", handler)
+        del handler, p
+        gc.collect()
+        assert alive() is not None
+        Pytonium().remove_scheme_route("app", "lifetime/")
+        gc.collect()
+        assert alive() is None
+
+    def test_route_timeout(self):
+        from Pytonium import Pytonium
+        assert Pytonium.get_scheme_route_timeout() == 30
+        Pytonium.set_scheme_route_timeout(2.5)
+        assert Pytonium.get_scheme_route_timeout() == 2.5
+        Pytonium.set_scheme_route_timeout(30)
+        with pytest.raises(ValueError):
+            Pytonium.set_scheme_route_timeout(-1)
+
+    def test_scheme_options_and_headers(self):
+        from Pytonium import Pytonium
+        p = Pytonium()
+        p.add_custom_scheme("isolated", ".", cross_origin_isolated=True,
+                            headers={"Cross-Origin-Resource-Policy": "same-origin"})
+        p.add_custom_scheme("plain", ".", "", secure=True, fetch_enabled=True, cors_enabled=False)
+        with pytest.raises(TypeError):
+            p.add_custom_scheme("positional", ".", "no-cache", True)
+
+
+class TestAssetPack:
+    """Tests for building and reading .pytpak archives."""
+
+    def test_build_and_lookup(self, tmp_path):
+        from Pytonium.asset_pack import build_asset_pack, AssetPackReader
+        source = tmp_path / "dist"
+        (source / "js").mkdir(parents=True)
+        (source / "index.html").write_text("<html></html>")
+        for i in range(50):
+            (source / "js" / f"module{i}.js").write_text(f"export const value = {i};\n" * 20)
+
+        archive = tmp_path / "app.pytpak"
+        assert build_asset_pack(str(source), str(archive), compress=True) == 51
+
+        reader = AssetPackReader(str(archive))
+        assert len(reader) == 51
+        assert reader.get("index.html") == b"<html></html>"
+        for i in range(50):
+            assert reader.get(f"js/module{i}.js") == (f"export const value = {i};\n" * 20).encode()
+        assert reader.get("missing.js") is None
+
+    def test_gzip_entry_without_accept_encoding(self, tmp_path):
+        import gzip
+        from Pytonium import read_asset_pack_entry
+        from Pytonium.asset_pack import build_asset_pack
+        source = tmp_path / "dist"
+        source.mkdir()
+        content = ("export const value = 42;\n" * 200).encode()
+        (source / "app.js").write_bytes(content)
+        archive = tmp_path / "app.pytpak"
+        build_asset_pack(str(source), str(archive), compress=True)
+
+        assert read_asset_pack_entry(str(archive), "app.js") == (content, "")
+        assert read_asset_pack_entry(str(archive), "app.js", "br, gzip;q=0") == (content, "")
+        body, encoding = read_asset_pack_entry(str(archive), "app.js", "gzip, deflate, br")
+        assert encoding == "gzip"
+        assert len(body) < len(content) and gzip.decompress(body) == content
+        assert read_asset_pack_entry(str(archive), "missing.js") is None
+
+    def test_empty_folder(self, tmp_path):
+        from Pytonium.asset_pack import build_asset_pack, AssetPackReader
+        archive = tmp_path / "empty.pytpak"
+        assert build_asset_pack(str(tmp_path), str(archive)) == 0
+        assert AssetPackReader(str(archive)).get("index.html") is None
+
 
 class TestMultiInstanceImports:
     """Tests that multi-instance helpers are importable."""